@@ -72,7 +72,7 @@
 
 #define configUSE_PREEMPTION		1
 #define configUSE_IDLE_HOOK			1
-#define configUSE_TICK_HOOK			0
+#define configUSE_TICK_HOOK			1
 #define configCPU_CLOCK_HZ			( ( unsigned long ) FREERTOS_MCU_CLOCK_HZ )
 #define configTICK_RATE_HZ_RAW  1000
 #define configTICK_RATE_HZ			( ( portTickType ) configTICK_RATE_HZ_RAW )
@@ -93,6 +93,16 @@
 #define configUSE_MALLOC_FAILED_HOOK 1
 #define configTIMER_TASK_STACK_DEPTH (configMINIMAL_STACK_SIZE * 2)
 
+// Tickless idle, only allowed on the ground. See lowpower.c
+#define configUSE_TICKLESS_IDLE 1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 2
+#define portSUPPRESS_TICKS_AND_SLEEP(xExpectedIdleTime) lowPowerSuppressTicksAndSleep(xExpectedIdleTime)
+#define configPRE_SLEEP_PROCESSING(xIdleTime) lowPowerPreSleep(&(xIdleTime))
+#define configPOST_SLEEP_PROCESSING(xIdleTime) lowPowerPostSleep(xIdleTime)
+void lowPowerSuppressTicksAndSleep(uint32_t expectedIdleTime);
+void lowPowerPreSleep(uint32_t* idleTime);
+void lowPowerPostSleep(uint32_t idleTime);
+
 #define configMAX_PRIORITIES		( 6 )
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
 
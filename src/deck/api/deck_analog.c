@@ -27,10 +27,38 @@
 #include "deck.h"
 
 #include "stm32fxxx.h"
+#include "nvicconf.h"
 
 static  uint32_t  stregResolution;
 static  uint32_t  adcRange;
 
+/*
+ * Continuous scan: TIM8 triggers a scan of the enabled pins on ADC1, DMA2 stream 4
+ * moves the results to a circular buffer of two halves. When a half is full,
+ * the samples of each pin are summed, which keeps the value at 16 bits.
+ */
+#define SCAN_TIMER              TIM8
+#define SCAN_TIMER_CLK          RCC_APB2Periph_TIM8
+#define SCAN_TIMER_FREQ         168000000
+#define SCAN_DMA_STREAM         DMA2_Stream4
+#define SCAN_DMA_CHANNEL        DMA_Channel_0
+#define SCAN_DMA_IRQ            DMA2_Stream4_IRQn
+#define SCAN_DMA_IRQHandler     DMA2_Stream4_IRQHandler
+#define SCAN_DMA_FLAG_HTIF      DMA_FLAG_HTIF4
+#define SCAN_DMA_FLAG_TCIF      DMA_FLAG_TCIF4
+
+static uint8_t scanPins[ANALOG_SCAN_MAX_PINS];
+static uint8_t scanPinCount = 0;
+// Scans of scanPinCount samples each, the second half starts after ANALOG_SCAN_OVERSAMPLE scans
+static uint16_t scanBuffer[2 * ANALOG_SCAN_OVERSAMPLE * ANALOG_SCAN_MAX_PINS];
+// Latest value of each pin, a single 16-bit store so readers need no lock
+static volatile uint16_t scanValues[ANALOG_SCAN_MAX_PINS];
+static volatile uint32_t scanCount = 0;
+
+static void analogPinInit(uint32_t pin);
+static void analogScanStart(void);
+static void analogScanStop(void);
+
 void adcInit(void)
 {
   /*
@@ -85,7 +113,15 @@ uint16_t analogRead(uint32_t pin)
   assert_param((pin >= 1) && (pin <= 13));
   assert_param(deckGPIOMapping[pin-1].adcCh > -1);
 
-  /* Now set the GPIO pin to analog mode. */
+  analogPinInit(pin);
+
+  /* Read the appropriate ADC channel. */
+  return analogReadChannel((uint8_t)deckGPIOMapping[pin-1].adcCh);
+}
+
+static void analogPinInit(uint32_t pin)
+{
+  /* Set the GPIO pin to analog mode. */
 
   /* Enable clock for the peripheral of the pin.*/
   RCC_AHB1PeriphClockCmd(deckGPIOMapping[pin-1].periph, ENABLE);
@@ -102,9 +138,6 @@ uint16_t analogRead(uint32_t pin)
 
   /* TODO: Any settling time before we can do ADC after init on the GPIO pin? */
   GPIO_Init(deckGPIOMapping[pin-1].port, &GPIO_InitStructure);
-
-  /* Read the appropriate ADC channel. */
-  return analogReadChannel((uint8_t)deckGPIOMapping[pin-1].adcCh);
 }
 
 void analogReference(uint8_t type)
@@ -152,3 +185,177 @@ float analogReadVoltage(uint32_t pin)
   return voltage;
 
 }
+
+bool analogScanEnable(uint32_t pin)
+{
+  if (pin < 1 || pin > 13 || deckGPIOMapping[pin-1].adcCh < 0)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < scanPinCount; i++)
+  {
+    if (scanPins[i] == pin)
+    {
+      return true;
+    }
+  }
+
+  if (scanPinCount >= ANALOG_SCAN_MAX_PINS)
+  {
+    return false;
+  }
+
+  analogPinInit(pin);
+
+  analogScanStop();
+  scanPins[scanPinCount] = pin;
+  scanValues[scanPinCount] = 0;
+  scanPinCount++;
+  analogScanStart();
+
+  return true;
+}
+
+static int analogScanIndex(uint32_t pin)
+{
+  for (int i = 0; i < scanPinCount; i++)
+  {
+    if (scanPins[i] == pin)
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+bool analogScanIsEnabled(uint32_t pin)
+{
+  return analogScanIndex(pin) >= 0;
+}
+
+uint16_t analogScanRead(uint32_t pin)
+{
+  int index = analogScanIndex(pin);
+  if (index < 0)
+  {
+    return 0;
+  }
+
+  return scanValues[index];
+}
+
+float analogScanReadVoltage(uint32_t pin)
+{
+  return analogScanRead(pin) * (float)VREF / 65536.0f;
+}
+
+uint32_t analogScanGetCount(void)
+{
+  return scanCount;
+}
+
+static void analogScanStop(void)
+{
+  TIM_Cmd(SCAN_TIMER, DISABLE);
+  DMA_Cmd(SCAN_DMA_STREAM, DISABLE);
+  while (DMA_GetCmdStatus(SCAN_DMA_STREAM) != DISABLE);
+  ADC_DMACmd(ADC1, DISABLE);
+  ADC_Cmd(ADC1, DISABLE);
+}
+
+static void analogScanStart(void)
+{
+  ADC_InitTypeDef ADC_InitStructure;
+  DMA_InitTypeDef DMA_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+  TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1 | SCAN_TIMER_CLK, ENABLE);
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+
+  /* One scan of all pins per trigger, 12 bit */
+  ADC_StructInit(&ADC_InitStructure);
+  ADC_InitStructure.ADC_Resolution = ADC_Resolution_12b;
+  ADC_InitStructure.ADC_ScanConvMode = ENABLE;
+  ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
+  ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+  ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T8_TRGO;
+  ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
+  ADC_InitStructure.ADC_NbrOfConversion = scanPinCount;
+  ADC_Init(ADC1, &ADC_InitStructure);
+
+  for (int i = 0; i < scanPinCount; i++)
+  {
+    /* Longer than the 15 cycle minimum, deck signals are often not buffered */
+    ADC_RegularChannelConfig(ADC1, (uint8_t)deckGPIOMapping[scanPins[i]-1].adcCh, i + 1, ADC_SampleTime_56Cycles);
+  }
+
+  /* Circular transfer to both halves of the buffer */
+  DMA_DeInit(SCAN_DMA_STREAM);
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel = SCAN_DMA_CHANNEL;
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC1->DR;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)scanBuffer;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_BufferSize = 2 * ANALOG_SCAN_OVERSAMPLE * scanPinCount;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+  DMA_Init(SCAN_DMA_STREAM, &DMA_InitStructure);
+  DMA_ClearFlag(SCAN_DMA_STREAM, SCAN_DMA_FLAG_HTIF | SCAN_DMA_FLAG_TCIF);
+  DMA_ITConfig(SCAN_DMA_STREAM, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel = SCAN_DMA_IRQ;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_ADC_PRI;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  DMA_Cmd(SCAN_DMA_STREAM, ENABLE);
+  ADC_DMARequestAfterLastTransferCmd(ADC1, ENABLE);
+  ADC_DMACmd(ADC1, ENABLE);
+  ADC_Cmd(ADC1, ENABLE);
+
+  /* The update event of the timer triggers the scans */
+  TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+  TIM_TimeBaseStructure.TIM_Prescaler = 0;
+  TIM_TimeBaseStructure.TIM_Period = (SCAN_TIMER_FREQ / ANALOG_SCAN_RATE_HZ) - 1;
+  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+  TIM_TimeBaseInit(SCAN_TIMER, &TIM_TimeBaseStructure);
+  TIM_SelectOutputTrigger(SCAN_TIMER, TIM_TRGOSource_Update);
+  DBGMCU_Config(DBGMCU_TIM8_STOP, ENABLE);
+  TIM_Cmd(SCAN_TIMER, ENABLE);
+}
+
+static void analogScanDecimate(const uint16_t* samples)
+{
+  for (int i = 0; i < scanPinCount; i++)
+  {
+    uint32_t sum = 0;
+    for (int j = 0; j < ANALOG_SCAN_OVERSAMPLE; j++)
+    {
+      sum += samples[j * scanPinCount + i];
+    }
+    scanValues[i] = (uint16_t)sum;
+  }
+  scanCount++;
+}
+
+void __attribute__((used)) SCAN_DMA_IRQHandler(void)
+{
+  if (DMA_GetFlagStatus(SCAN_DMA_STREAM, SCAN_DMA_FLAG_HTIF))
+  {
+    DMA_ClearFlag(SCAN_DMA_STREAM, SCAN_DMA_FLAG_HTIF);
+    analogScanDecimate(&scanBuffer[0]);
+  }
+  if (DMA_GetFlagStatus(SCAN_DMA_STREAM, SCAN_DMA_FLAG_TCIF))
+  {
+    DMA_ClearFlag(SCAN_DMA_STREAM, SCAN_DMA_FLAG_TCIF);
+    analogScanDecimate(&scanBuffer[ANALOG_SCAN_OVERSAMPLE * scanPinCount]);
+  }
+}
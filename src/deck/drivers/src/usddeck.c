@@ -56,6 +56,8 @@
 #include "log.h"
 #include "param.h"
 #include "crc_bosch.h"
+#include "mission.h"
+#include "mission_executor.h"
 
 // Hardware defines
 #define USD_CS_PIN    DECK_GPIO_IO4
@@ -92,6 +94,8 @@ static FIL logFile;
 static xTimerHandle timer;
 static void usdTimer(xTimerHandle timer);
 
+static void loadMission(void);
+
 
 // Low lever driver functions
 static sdSpiContext_t sdSpiContext =
@@ -201,6 +205,8 @@ static void usdInit(DeckInfo *info)
     /* try to mount drives before creating the tasks */
     if (f_mount(&FatFs, "", 1) == FR_OK) {
       DEBUG_PRINT("mount SD-Card [OK].\n");
+      /* the log task is not running yet, the file object is free */
+      loadMission();
       /* try to open config file */
       bool success = false;
       while (f_open(&logFile, "config.txt", FA_READ) == FR_OK) {
@@ -281,6 +287,36 @@ static void usdInit(DeckInfo *info)
   isInit = true;
 }
 
+// Reads the mission file, if there is one, for the mission executor
+static void loadMission(void)
+{
+  if (f_open(&logFile, "mission.bin", FA_READ) != FR_OK) {
+    return;
+  }
+
+  UINT size = f_size(&logFile);
+  UINT bytesRead = 0;
+  uint8_t* data = NULL;
+  if (size <= sizeof(missionHeader_t) + MISSION_MAX_STEPS * sizeof(missionStep_t)) {
+    data = pvPortMalloc(size);
+  }
+
+  if (data && f_read(&logFile, data, size, &bytesRead) == FR_OK && bytesRead == size) {
+    missionExecutorInit();
+    int result = missionExecutorLoad(data, size);
+    if (result == 0) {
+      DEBUG_PRINT("Mission read [OK].\n");
+    } else {
+      DEBUG_PRINT("Mission read [FAIL] (%d).\n", result);
+    }
+  } else {
+    DEBUG_PRINT("Mission read [FAIL].\n");
+  }
+
+  vPortFree(data);
+  f_close(&logFile);
+}
+
 static void usdLogTask(void* prm)
 {
   TickType_t lastWakeTime = xTaskGetTickCount();
@@ -28,6 +28,7 @@
 #define __DECK_ANALOG_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /* Voltage reference types for the analogReference() function. */
 #define DEFAULT 0
@@ -48,4 +49,38 @@ void analogReadResolution(uint8_t bits);
  */
 float analogReadVoltage(uint32_t pin);
 
+/*
+ * Continuous scan of deck analog pins, sampled by a timer and moved by DMA.
+ * ANALOG_SCAN_OVERSAMPLE 12-bit samples are summed to one 16-bit value, new
+ * values come at ANALOG_SCAN_RATE_HZ / ANALOG_SCAN_OVERSAMPLE (1 kHz). Reading
+ * a value never blocks, it is the latest one.
+ */
+#define ANALOG_SCAN_MAX_PINS    5
+#define ANALOG_SCAN_RATE_HZ     16000
+#define ANALOG_SCAN_OVERSAMPLE  16
+
+/*
+ * Add a pin to the scan, the scan is restarted.
+ * @param[in] pin   deck pin to scan.
+ * @return          false if the pin has no ADC channel or the scan is full
+ */
+bool analogScanEnable(uint32_t pin);
+
+bool analogScanIsEnabled(uint32_t pin);
+
+/*
+ * Latest value of a scanned pin, 0 - 65535 over 0 - VREF.
+ */
+uint16_t analogScanRead(uint32_t pin);
+
+/*
+ * Latest voltage of a scanned pin in volts.
+ */
+float analogScanReadVoltage(uint32_t pin);
+
+/*
+ * Number of values produced, changes when new values are available.
+ */
+uint32_t analogScanGetCount(void);
+
 #endif
@@ -33,6 +33,7 @@
 
 #define EEPROM_I2C_ADDR     0x50
 #define EEPROM_SIZE         0x1FFF
+#define EEPROM_PAGE_SIZE    32
 
 /**
  * Initialize the i2c eeprom module
@@ -68,7 +69,7 @@ bool eepromReadBuffer(uint8_t* buffer, uint16_t readAddr, uint16_t len);
 
 /**
  * Write data to the eeprom from a supplied buffer.
- * Currently very slow as id does single byte write.
+ * The data is written in page writes, one write cycle (max 5 ms) per page touched.
  * @param buffer  The buffer to read the data from
  * @param writeAddr  The start address to write to
  * @param len  Number of bytes to write
@@ -77,7 +78,25 @@ bool eepromReadBuffer(uint8_t* buffer, uint16_t readAddr, uint16_t len);
  */
 bool eepromWriteBuffer(uint8_t* buffer, uint16_t writeAddr, uint16_t len);
 
-// TODO
+/**
+ * Write one page to the eeprom.
+ * @param buffer  The buffer to read the data from, EEPROM_PAGE_SIZE bytes
+ * @param writeAddr  The start address to write to, must be page aligned
+ *
+ * @return True on success, else false.
+ */
 bool eepromWritePage(uint8_t* buffer, uint16_t writeAddr);
 
+/**
+ * Write only the data that differs from the current eeprom contents. The changes
+ * within a page are combined into one page write, unchanged pages are not written.
+ * @param buffer  The buffer to read the data from
+ * @param current  The current contents of the eeprom at writeAddr, len bytes
+ * @param writeAddr  The start address to write to
+ * @param len  Number of bytes to write
+ *
+ * @return True on success, else false.
+ */
+bool eepromUpdateBuffer(uint8_t* buffer, const uint8_t* current, uint16_t writeAddr, uint16_t len);
+
 #endif // EERROM_H
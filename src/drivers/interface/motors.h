@@ -97,6 +97,21 @@
   #define MOTORS_BL_POLARITY           TIM_OCPolarity_Low
 #endif
 
+//#define ENABLE_DSHOT
+
+#ifdef ENABLE_DSHOT
+/**
+ * *VARNING* The ESCs must be flashed with firmware that supports DShot (BLHeli_S/BLHeli_32).
+ *
+ * Sends DShot frames instead of the PWM wave to brushless motor maps that have a timer DMA stream
+ * configured. The timer runs at the bit rate and a DMA burst on the update event writes the compare
+ * registers of all channels of the timer for every bit. Other maps fall back to the PWM wave.
+ */
+  #ifndef DSHOT_SPEED
+    #define DSHOT_SPEED                DSHOT600
+  #endif
+#endif
+
 #define NBR_OF_MOTORS 4
 // Motors IDs define
 #define MOTOR_M1  0
@@ -187,6 +202,11 @@ typedef struct
   uint32_t      timDbgStop;
   uint32_t      timPeriod;
   uint16_t      timPrescaler;
+  /* DShot, timer update DMA request. timDmaStream is NULL if not supported */
+  DMA_Stream_TypeDef* timDmaStream;
+  uint32_t      timDmaChannel;
+  uint32_t      timDmaFlags;
+  uint8_t       timChannel;  // Output compare channel, 0 for CH1
   /* Function pointers */
   void (*setCompare)(TIM_TypeDef* TIMx, uint32_t Compare);
   uint32_t (*getCompare)(TIM_TypeDef* TIMx);
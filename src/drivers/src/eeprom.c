@@ -37,9 +37,15 @@
 #include "debug.h"
 #include "eprintf.h"
 
+// The eeprom does not acknowledge its address while a write cycle is in progress (5 ms max),
+// it is polled at this interval until it does.
+#define EEPROM_WRITE_POLL_INTERVAL M2T(1)
+#define EEPROM_WRITE_TIMEOUT       M2T(20)
+
 #ifdef EEPROM_RUN_WRITE_READ_TEST
 static bool eepromTestWriteRead(void);
 #endif
+static bool eepromWaitForWriteCycle(uint16_t addr);
 
 static uint8_t devAddr;
 static I2C_Dev *I2Cx;
@@ -139,17 +145,26 @@ bool eepromReadBuffer(uint8_t* buffer, uint16_t readAddr, uint16_t len)
 bool eepromWriteBuffer(uint8_t* buffer, uint16_t writeAddr, uint16_t len)
 {
   bool status = true;
-  uint16_t index;
+  uint16_t index = 0;
 
   if ((uint32_t)writeAddr + len > EEPROM_SIZE)
   {
      return false;
   }
 
-  for (index = 0; index < len && status; index++)
+  // A write may not cross a page boundary, the address would wrap around within the page
+  while (index < len && status)
   {
-    status = i2cdevWrite16(I2Cx, devAddr, writeAddr + index, 1, &buffer[index]);
-    vTaskDelay(M2T(6));
+    uint16_t addr = writeAddr + index;
+    uint16_t chunk = EEPROM_PAGE_SIZE - (addr % EEPROM_PAGE_SIZE);
+    if (chunk > len - index)
+    {
+      chunk = len - index;
+    }
+
+    status = i2cdevWrite16(I2Cx, devAddr, addr, chunk, &buffer[index]) &&
+             eepromWaitForWriteCycle(addr);
+    index += chunk;
   }
 
   return status;
@@ -157,6 +172,69 @@ bool eepromWriteBuffer(uint8_t* buffer, uint16_t writeAddr, uint16_t len)
 
 bool eepromWritePage(uint8_t* buffer, uint16_t writeAddr)
 {
- //TODO: implement
+  if ((writeAddr % EEPROM_PAGE_SIZE) != 0)
+  {
+    return false;
+  }
+
+  return eepromWriteBuffer(buffer, writeAddr, EEPROM_PAGE_SIZE);
+}
+
+bool eepromUpdateBuffer(uint8_t* buffer, const uint8_t* current, uint16_t writeAddr, uint16_t len)
+{
+  bool status = true;
+  uint16_t index = 0;
+
+  if ((uint32_t)writeAddr + len > EEPROM_SIZE)
+  {
+     return false;
+  }
+
+  while (index < len && status)
+  {
+    uint16_t addr = writeAddr + index;
+    uint16_t chunk = EEPROM_PAGE_SIZE - (addr % EEPROM_PAGE_SIZE);
+    if (chunk > len - index)
+    {
+      chunk = len - index;
+    }
+
+    // Only write the changed span of each page, still one write cycle per page
+    uint16_t first = 0;
+    while (first < chunk && buffer[index + first] == current[index + first])
+    {
+      first++;
+    }
+    if (first < chunk)
+    {
+      uint16_t last = chunk - 1;
+      while (buffer[index + last] == current[index + last])
+      {
+        last--;
+      }
+      status = eepromWriteBuffer(&buffer[index + first], addr + first, last - first + 1);
+    }
+
+    index += chunk;
+  }
+
+  return status;
+}
+
+static bool eepromWaitForWriteCycle(uint16_t addr)
+{
+  uint8_t tmp;
+  uint32_t start = xTaskGetTickCount();
+
+  // Acknowledge polling, any access fails until the internal write cycle is done
+  do
+  {
+    vTaskDelay(EEPROM_WRITE_POLL_INTERVAL);
+    if (i2cdevRead16(I2Cx, devAddr, addr, 1, &tmp))
+    {
+      return true;
+    }
+  } while ((xTaskGetTickCount() - start) < EEPROM_WRITE_TIMEOUT);
+
   return false;
 }
@@ -35,6 +35,7 @@
 #include "i2cdev.h"
 #include "debug.h"
 #include "eprintf.h"
+#include "baroConvert.h"
 
 static uint8_t devAddr;
 static I2C_Dev *I2Cx;
@@ -157,15 +158,10 @@ bool lps25hGetData(float* pressure, float* temperature, float* asl)
   return status;
 }
 
-#include "math.h"
-// Constants used to determine altitude from pressure
-#define CONST_SEA_PRESSURE 102610.f //1026.1f //http://www.meteo.physik.uni-muenchen.de/dokuwiki/doku.php?id=wetter:stadt:messung
-#define CONST_PF 0.1902630958f //(1/5.25588f) Pressure factor
-#define CONST_PF2 44330.0f
-#define FIX_TEMP 25         // Fixed Temperature. ASL is a function of pressure and temperature, but as the temperature changes so much (blow a little towards the flie and watch it drop 5 degrees) it corrupts the ASL estimates.
-                            // TLDR: Adjusting for temp changes does more harm than good.
+// ASL is computed at a fixed temperature (25 degrees). ASL is a function of pressure and temperature,
+// but as the temperature changes so much (blow a little towards the flie and watch it drop 5 degrees)
+// it corrupts the ASL estimates. TLDR: Adjusting for temp changes does more harm than good.
 
-//TODO: pretty expensive function. Rather smooth the pressure estimates and only call this when needed
 /**
  * Converts pressure to altitude above sea level (ASL) in meters
  */
@@ -173,9 +169,7 @@ float lps25hPressureToAltitude(float* pressure/*, float* ground_pressure, float*
 {
     if (*pressure > 0)
     {
-        //return (1.f - pow(*pressure / CONST_SEA_PRESSURE, CONST_PF)) * CONST_PF2;
-        //return ((pow((1015.7 / *pressure), CONST_PF) - 1.0) * (25. + 273.15)) / 0.0065;
-        return ((powf((1015.7f / *pressure), CONST_PF) - 1.0f) * (FIX_TEMP + 273.15f)) / 0.0065f;
+        return baroPressureToAltitude(*pressure);
     }
     else
     {
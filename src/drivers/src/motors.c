@@ -27,6 +27,7 @@
  */
 
 #include <stdbool.h>
+#include <string.h>
 
 /* ST includes */
 #include "stm32fxxx.h"
@@ -40,6 +41,10 @@
 //Logging includes
 #include "log.h"
 
+#ifdef ENABLE_DSHOT
+#include "dshot.h"
+#endif
+
 static uint16_t motorsBLConvBitsTo16(uint16_t bits);
 static uint16_t motorsBLConv16ToBits(uint16_t bits);
 static uint16_t motorsConvBitsTo16(uint16_t bits);
@@ -61,6 +66,24 @@ static const uint16_t testsound[NBR_OF_MOTORS] = {A4, A5, F5, D5 };
 
 static bool isInit = false;
 
+#ifdef ENABLE_DSHOT
+// Frame bits followed by low slots so the line idles between frames
+#define DSHOT_DMA_BUFFER_BITS (DSHOT_FRAME_BITS + 2)
+#define DSHOT_TIM_CHANNELS    4
+
+typedef struct
+{
+  const MotorPerifDef* def;  // First motor on the timer, holds the timer and DMA config
+  uint32_t buffer[DSHOT_DMA_BUFFER_BITS][DSHOT_TIM_CHANNELS];  // CCR1-CCR4 for every bit
+} DshotTimer;
+
+static DshotTimer dshotTimers[NBR_OF_MOTORS];
+static DshotTimer* dshotMotorTimer[NBR_OF_MOTORS];
+static int dshotNbrOfTimers;
+static uint32_t dshotPeriod;
+static bool useDshot = false;
+#endif
+
 /* Private functions */
 
 static uint16_t motorsBLConvBitsTo16(uint16_t bits)
@@ -83,6 +106,98 @@ static uint16_t motorsConv16ToBits(uint16_t bits)
   return ((bits) >> (16 - MOTORS_PWM_BITS) & ((1 << MOTORS_PWM_BITS) - 1));
 }
 
+#ifdef ENABLE_DSHOT
+static bool motorsDshotSupported(const MotorPerifDef** motorMapSelect)
+{
+  for (int i = 0; i < NBR_OF_MOTORS; i++)
+  {
+    if (motorMapSelect[i]->drvType != BRUSHLESS || motorMapSelect[i]->timDmaStream == 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Set up one DMA burst per timer, writing CCR1-CCR4 on every update event
+static void motorsDshotInit(void)
+{
+  DMA_InitTypeDef DMA_InitStructure;
+
+  RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+  dshotNbrOfTimers = 0;
+  for (int i = 0; i < NBR_OF_MOTORS; i++)
+  {
+    DshotTimer* timer = 0;
+
+    for (int j = 0; j < dshotNbrOfTimers; j++)
+    {
+      if (dshotTimers[j].def->tim == motorMap[i]->tim)
+      {
+        timer = &dshotTimers[j];
+      }
+    }
+
+    if (timer == 0)
+    {
+      timer = &dshotTimers[dshotNbrOfTimers++];
+      timer->def = motorMap[i];
+      memset(timer->buffer, 0, sizeof(timer->buffer));
+
+      DMA_DeInit(timer->def->timDmaStream);
+      DMA_StructInit(&DMA_InitStructure);
+      DMA_InitStructure.DMA_Channel = timer->def->timDmaChannel;
+      DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&timer->def->tim->DMAR;
+      DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)timer->buffer;
+      DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+      DMA_InitStructure.DMA_BufferSize = DSHOT_DMA_BUFFER_BITS * DSHOT_TIM_CHANNELS;
+      DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+      DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+      DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+      DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+      DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+      DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+      DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+      DMA_Init(timer->def->timDmaStream, &DMA_InitStructure);
+
+      TIM_DMAConfig(timer->def->tim, TIM_DMABase_CCR1, TIM_DMABurstLength_4Transfers);
+      TIM_DMACmd(timer->def->tim, TIM_DMA_Update, ENABLE);
+    }
+
+    dshotMotorTimer[i] = timer;
+  }
+}
+
+static void motorsDshotDeInit(void)
+{
+  for (int i = 0; i < dshotNbrOfTimers; i++)
+  {
+    TIM_DMACmd(dshotTimers[i].def->tim, TIM_DMA_Update, DISABLE);
+    DMA_DeInit(dshotTimers[i].def->timDmaStream);
+  }
+  dshotNbrOfTimers = 0;
+}
+
+// Restart the DMA of every timer, the frames go out on the next update events
+static void motorsDshotSend(void)
+{
+  for (int i = 0; i < dshotNbrOfTimers; i++)
+  {
+    const MotorPerifDef* def = dshotTimers[i].def;
+
+    DMA_Cmd(def->timDmaStream, DISABLE);
+    while (DMA_GetCmdStatus(def->timDmaStream) == ENABLE)
+    {
+    }
+    DMA_ClearFlag(def->timDmaStream, def->timDmaFlags);
+    DMA_SetCurrDataCounter(def->timDmaStream, DSHOT_DMA_BUFFER_BITS * DSHOT_TIM_CHANNELS);
+    DMA_Cmd(def->timDmaStream, ENABLE);
+  }
+}
+#endif
+
 /* Public functions */
 
 //Initialization. Will set all motors ratio to 0%
@@ -102,6 +217,11 @@ void motorsInit(const MotorPerifDef** motorMapSelect)
 
   motorMap = motorMapSelect;
 
+#ifdef ENABLE_DSHOT
+  useDshot = motorsDshotSupported(motorMapSelect);
+  dshotPeriod = dshotBitPeriod(TIM_CLOCK_HZ, DSHOT_SPEED);
+#endif
+
   for (i = 0; i < NBR_OF_MOTORS; i++)
   {
     //Clock the gpio and the timers
@@ -125,6 +245,14 @@ void motorsInit(const MotorPerifDef** motorMapSelect)
     TIM_TimeBaseStructure.TIM_ClockDivision = 0;
     TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
     TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+#ifdef ENABLE_DSHOT
+    if (useDshot)
+    {
+      // One timer period per DShot bit
+      TIM_TimeBaseStructure.TIM_Period = dshotPeriod - 1;
+      TIM_TimeBaseStructure.TIM_Prescaler = 0;
+    }
+#endif
     TIM_TimeBaseInit(motorMap[i]->tim, &TIM_TimeBaseStructure);
 
     // PWM channels configuration (All identical!)
@@ -143,6 +271,13 @@ void motorsInit(const MotorPerifDef** motorMapSelect)
     TIM_CtrlPWMOutputs(motorMap[i]->tim, ENABLE);
   }
 
+#ifdef ENABLE_DSHOT
+  if (useDshot)
+  {
+    motorsDshotInit();
+  }
+#endif
+
   // Start the timers
   for (i = 0; i < NBR_OF_MOTORS; i++)
   {
@@ -157,6 +292,13 @@ void motorsDeInit(const MotorPerifDef** motorMapSelect)
   int i;
   GPIO_InitTypeDef GPIO_InitStructure;
 
+#ifdef ENABLE_DSHOT
+  if (useDshot)
+  {
+    motorsDshotDeInit();
+  }
+#endif
+
   for (i = 0; i < NBR_OF_MOTORS; i++)
   {
     // Configure default
@@ -207,6 +349,23 @@ void motorsSetRatio(uint32_t id, uint16_t ithrust)
 
     ratio = ithrust;
 
+  #ifdef ENABLE_DSHOT
+    if (useDshot)
+    {
+      uint16_t frame = dshotEncodeFrame(dshotThrottleFromRatio(ratio), false, false);
+
+      motor_ratios[id] = ratio;
+      dshotFrameToCompare(frame, dshotPeriod, &dshotMotorTimer[id]->buffer[0][motorMap[id]->timChannel], DSHOT_TIM_CHANNELS);
+
+      // All motors are set in order M1 to M4, send the frames of all timers together
+      if (id == MOTOR_M4)
+      {
+        motorsDshotSend();
+      }
+      return;
+    }
+  #endif
+
   #ifdef ENABLE_THRUST_BAT_COMPENSATED
     if (motorMap[id]->drvType == BRUSHED)
     {
@@ -236,6 +395,12 @@ int motorsGetRatio(uint32_t id)
   int ratio;
 
   ASSERT(id < NBR_OF_MOTORS);
+#ifdef ENABLE_DSHOT
+  if (useDshot)
+  {
+    return motor_ratios[id];
+  }
+#endif
   if (motorMap[id]->drvType == BRUSHLESS)
   {
     ratio = motorsBLConvBitsTo16(motorMap[id]->getCompare(motorMap[id]->tim));
@@ -263,6 +428,14 @@ void motorsBeep(int id, bool enable, uint16_t frequency, uint16_t ratio)
 
   ASSERT(id < NBR_OF_MOTORS);
 
+#ifdef ENABLE_DSHOT
+  if (useDshot)
+  {
+    // The timer base is the DShot bit rate, ESCs can not beep on the frame signal
+    return;
+  }
+#endif
+
   TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
 
   if (enable)
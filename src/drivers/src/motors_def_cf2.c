@@ -25,6 +25,15 @@
  *
  * This code mainly interfacing the PWM peripheral lib of ST.
  */
+
+// Timer update DMA requests used for DShot, DMA1 streams not used by other drivers
+#define TIM2_UP_DMA_STREAM  DMA1_Stream7
+#define TIM2_UP_DMA_CHANNEL DMA_Channel_3
+#define TIM2_UP_DMA_FLAGS   (DMA_FLAG_TCIF7 | DMA_FLAG_HTIF7 | DMA_FLAG_TEIF7 | DMA_FLAG_DMEIF7 | DMA_FLAG_FEIF7)
+#define TIM4_UP_DMA_STREAM  DMA1_Stream6
+#define TIM4_UP_DMA_CHANNEL DMA_Channel_2
+#define TIM4_UP_DMA_FLAGS   (DMA_FLAG_TCIF6 | DMA_FLAG_HTIF6 | DMA_FLAG_TEIF6 | DMA_FLAG_DMEIF6 | DMA_FLAG_FEIF6)
+
 // Connector M1, PA1, TIM2_CH2
 static const MotorPerifDef CONN_M1 =
 {
@@ -129,6 +138,10 @@ static const MotorPerifDef CONN_M1_BL_INV =
     .timDbgStop    = DBGMCU_TIM2_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM2_UP_DMA_STREAM,
+    .timDmaChannel = TIM2_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM2_UP_DMA_FLAGS,
+    .timChannel    = 1,
     .setCompare    = TIM_SetCompare2,
     .getCompare    = TIM_GetCapture2,
     .ocInit        = TIM_OC2Init,
@@ -151,6 +164,10 @@ static const MotorPerifDef CONN_M2_BL_INV =
     .timDbgStop    = DBGMCU_TIM2_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM2_UP_DMA_STREAM,
+    .timDmaChannel = TIM2_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM2_UP_DMA_FLAGS,
+    .timChannel    = 3,
     .setCompare    = TIM_SetCompare4,
     .getCompare    = TIM_GetCapture4,
     .ocInit        = TIM_OC4Init,
@@ -173,6 +190,10 @@ static const MotorPerifDef CONN_M3_BL_INV =
     .timDbgStop    = DBGMCU_TIM2_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM2_UP_DMA_STREAM,
+    .timDmaChannel = TIM2_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM2_UP_DMA_FLAGS,
+    .timChannel    = 0,
     .setCompare    = TIM_SetCompare1,
     .getCompare    = TIM_GetCapture1,
     .ocInit        = TIM_OC1Init,
@@ -195,6 +216,10 @@ static const MotorPerifDef CONN_M4_BL_INV =
     .timDbgStop    = DBGMCU_TIM4_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM4_UP_DMA_STREAM,
+    .timDmaChannel = TIM4_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM4_UP_DMA_FLAGS,
+    .timChannel    = 3,
     .setCompare    = TIM_SetCompare4,
     .getCompare    = TIM_GetCapture4,
     .ocInit        = TIM_OC4Init,
@@ -217,6 +242,10 @@ static const MotorPerifDef RZR_M1_BL =
     .timDbgStop    = DBGMCU_TIM2_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM2_UP_DMA_STREAM,
+    .timDmaChannel = TIM2_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM2_UP_DMA_FLAGS,
+    .timChannel    = 1,
     .setCompare    = TIM_SetCompare2,
     .getCompare    = TIM_GetCapture2,
     .ocInit        = TIM_OC2Init,
@@ -239,6 +268,10 @@ static const MotorPerifDef RZR_M2_BL =
     .timDbgStop    = DBGMCU_TIM2_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM2_UP_DMA_STREAM,
+    .timDmaChannel = TIM2_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM2_UP_DMA_FLAGS,
+    .timChannel    = 3,
     .setCompare    = TIM_SetCompare4,
     .getCompare    = TIM_GetCapture4,
     .ocInit        = TIM_OC4Init,
@@ -261,6 +294,10 @@ static const MotorPerifDef RZR_M3_BL =
     .timDbgStop    = DBGMCU_TIM2_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM2_UP_DMA_STREAM,
+    .timDmaChannel = TIM2_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM2_UP_DMA_FLAGS,
+    .timChannel    = 0,
     .setCompare    = TIM_SetCompare1,
     .getCompare    = TIM_GetCapture1,
     .ocInit        = TIM_OC1Init,
@@ -283,6 +320,10 @@ static const MotorPerifDef RZR_M4_BL =
     .timDbgStop    = DBGMCU_TIM4_STOP,
     .timPeriod     = MOTORS_BL_PWM_PERIOD,
     .timPrescaler  = MOTORS_BL_PWM_PRESCALE,
+    .timDmaStream  = TIM4_UP_DMA_STREAM,
+    .timDmaChannel = TIM4_UP_DMA_CHANNEL,
+    .timDmaFlags   = TIM4_UP_DMA_FLAGS,
+    .timChannel    = 3,
     .setCompare    = TIM_SetCompare4,
     .getCompare    = TIM_GetCapture4,
     .ocInit        = TIM_OC4Init,
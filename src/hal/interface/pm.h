@@ -117,6 +117,12 @@ void pmSyslinkUpdate(SyslinkPacket *slp);
  */
 float pmGetBatteryVoltage(void);
 
+/**
+ * Returns the estimated open circuit battery voltage in volts, which does not sag
+ * under load. The measured voltage until the estimator is running.
+ */
+float pmGetBatteryRestVoltage(void);
+
 /**
  * Returns the min battery voltage i volts as a float
  */
@@ -26,6 +26,9 @@
 #ifndef __SENSORS_H__
 #define __SENSORS_H__
 
+#include "FreeRTOS.h"
+#include "queue.h"
+
 #include "stabilizer_types.h"
 
 void sensorsInit(void);
@@ -41,14 +44,55 @@ bool sensorsManufacturingTest(void);
 void sensorsAcquire(sensorData_t *sensors, const uint32_t tick);
 
 /**
- * This function should block and unlock at 1KhZ
+ * This function should block and unlock at 1KhZ, or at SENSORS_IDLE_RATE_HZ
+ * when idle
  */
 void sensorsWaitDataReady(void);
 
-// Allows individual sensor measurement
-bool sensorsReadGyro(Axis3f *gyro);
-bool sensorsReadAcc(Axis3f *acc);
-bool sensorsReadMag(Axis3f *mag);
-bool sensorsReadBaro(baro_t *baro);
+/**
+ * Read the sensors at SENSORS_IDLE_RATE_HZ instead, while the Crazyflie is
+ * idle on the ground. The IMU data ready interrupt is masked meanwhile so it
+ * does not wake the core.
+ */
+#define SENSORS_IDLE_RATE_HZ 100
+void sensorsSetIdle(bool isIdle);
+
+// Allows individual sensor measurement. The timestamp is set to the
+// acquisition time of the sample, in microseconds (usecTimestamp()).
+bool sensorsReadGyro(Axis3f *gyro, uint64_t *timestamp);
+bool sensorsReadAcc(Axis3f *acc, uint64_t *timestamp);
+bool sensorsReadMag(Axis3f *mag, uint64_t *timestamp);
+bool sensorsReadBaro(baro_t *baro, uint64_t *timestamp);
+
+// Queue elements used by the sensor implementations to keep the
+// acquisition time together with the sample
+typedef struct {
+  Axis3f axis;
+  uint64_t timestamp;
+} timedAxis3f_t;
+
+static inline bool sensorsReadAxis3f(xQueueHandle queue, Axis3f *axis, uint64_t *timestamp)
+{
+  timedAxis3f_t sample;
+  if (pdTRUE != xQueueReceive(queue, &sample, 0))
+  {
+    return false;
+  }
+
+  *axis = sample.axis;
+  *timestamp = sample.timestamp;
+  return true;
+}
+
+static inline void sensorsQueueAxis3f(xQueueHandle queue, const Axis3f *axis, uint64_t timestamp)
+{
+  timedAxis3f_t sample = {.axis = *axis, .timestamp = timestamp};
+  xQueueOverwrite(queue, &sample);
+}
+
+typedef struct {
+  baro_t baro;
+  uint64_t timestamp;
+} timedBaro_t;
 
 #endif //__SENSORS_H__
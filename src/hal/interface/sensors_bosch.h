@@ -57,12 +57,15 @@
 #include "bmp280.h"
 #include "bmp3.h"
 #include "bstdr_comm_support.h"
+#include "baroConvert.h"
 
 #define SENSORS_READ_RATE_HZ            1000
 #define SENSORS_STARTUP_TIME_MS         1000
 #define SENSORS_READ_BARO_HZ            50
+#define SENSORS_READ_BMP388_HZ          100
 #define SENSORS_READ_MAG_HZ             20
 #define SENSORS_DELAY_BARO              (SENSORS_READ_RATE_HZ/SENSORS_READ_BARO_HZ)
+#define SENSORS_DELAY_BMP388            (SENSORS_READ_RATE_HZ/SENSORS_READ_BMP388_HZ)
 #define SENSORS_DELAY_MAG               (SENSORS_READ_RATE_HZ/SENSORS_READ_MAG_HZ)
 
 /* calculate constants */
@@ -29,7 +29,8 @@
 #include <stdint.h>
 
 /**
- * Initialize microsecond-resolution timer (TIM1).
+ * Initialize microsecond-resolution timer (DWT cycle counter). Calling it
+ * again has no effect.
  */
 void initUsecTimer(void);
 
@@ -38,4 +39,28 @@ void initUsecTimer(void);
  */
 uint64_t usecTimestamp(void);
 
+/**
+ * Get timestamp in core clock cycles, for sub-microsecond resolution.
+ * Has to be called at least once every 2^31 cycles to stay monotonic.
+ */
+uint64_t cycleTimestamp(void);
+
+/**
+ * Sleep (wfi) until an interrupt is pending, and add the cycles the cycle
+ * counter missed during the sleep. Must be called with interrupts disabled,
+ * the pending interrupt is handled when they are enabled again.
+ */
+void usecTimerSleep(void);
+
+/**
+ * Convert between the cycle, microsecond and RTOS tick time domains.
+ * cyclesToUsecf() is intended for short durations, such as the difference
+ * between two cycle timestamps.
+ */
+uint64_t cyclesToUsec(uint64_t cycles);
+float cyclesToUsecf(uint32_t cycles);
+uint64_t usecToCycles(uint64_t usec);
+uint32_t usecToTicks(uint64_t usec);
+uint64_t ticksToUsec(uint32_t ticks);
+
 #endif /* USEC_TIME_H_ */
@@ -292,6 +292,12 @@ float pmGetBatteryVoltage(void)
   return batteryVoltage;
 }
 
+float pmGetBatteryRestVoltage(void)
+{
+  // No open circuit voltage estimate on this platform
+  return batteryVoltage;
+}
+
 float pmGetBatteryVoltageMin(void)
 {
   return batteryVoltageMin;
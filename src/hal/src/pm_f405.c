@@ -37,10 +37,13 @@
 #include "pm.h"
 #include "led.h"
 #include "log.h"
+#include "param.h"
 #include "ledseq.h"
 #include "commander.h"
 #include "sound.h"
 #include "deck.h"
+#include "motors.h"
+#include "batteryEstimator.h"
 
 typedef struct _PmSyslinkInfo
 {
@@ -79,7 +82,24 @@ static PmSyslinkInfo pmSyslinkInfo;
 
 static uint8_t batteryLevel;
 
+// State of charge estimation, the current is measured on a deck or modelled from the motor ratios
+#define PM_BAT_CAPACITY        0.25f  // Ah
+#define PM_BAT_R0              0.15f  // Ohm, initial series resistance
+#define PM_BAT_FLIGHT_CURRENT  2.1f   // A, initial guess of the current in flight
+#define PM_FLYING_MOTOR_RATIO  0.1f   // Mean motor ratio above which the motors are considered running
+static batteryEstimator_t batteryEstimator;
+static float batteryCurrent;
+static float batteryOcv;
+static float batteryCapacity = PM_BAT_CAPACITY;
+static float batteryStateOfCharge;
+static uint16_t batteryFlightTime;
+static float batteryIdleCurrent = 0.1f;
+static float batteryFullCurrent = 8.0f;
+static float batteryReserve = 0.1f;
+static uint32_t batteryEstimatorTick;
+
 static void pmSetBatteryVoltage(float voltage);
+static void pmUpdateBatteryEstimator(uint32_t tick);
 
 const static float bat671723HS25C[10] =
 {
@@ -100,6 +120,8 @@ void pmInit(void)
   if(isInit)
     return;
   
+  batteryEstimatorInit(&batteryEstimator, PM_BAT_CAPACITY, PM_BAT_R0, PM_BAT_FLIGHT_CURRENT);
+
   xTaskCreate(pmTask, PM_TASK_NAME,
               PM_TASK_STACKSIZE, NULL, PM_TASK_PRI, NULL);
   
@@ -171,6 +193,11 @@ float pmGetBatteryVoltage(void)
   return batteryVoltage;
 }
 
+float pmGetBatteryRestVoltage(void)
+{
+  return batteryEstimator.isInit ? batteryOcv : batteryVoltage;
+}
+
 float pmGetBatteryVoltageMin(void)
 {
   return batteryVoltageMin;
@@ -223,10 +250,22 @@ PMStates pmUpdateState()
   return state;
 }
 
+static float pmReadDeckPinVoltage(uint8_t pin)
+{
+  if (analogScanIsEnabled(pin))
+  {
+    return analogScanReadVoltage(pin);
+  }
+
+  return analogReadVoltage(pin);
+}
+
 void pmEnableExtBatteryCurrMeasuring(uint8_t pin, float ampPerVolt)
 {
   extBatCurrDeckPin = pin;
   extBatCurrAmpPerVolt = ampPerVolt;
+  // Sampled continuously, the current is averaged over 1 ms instead of a single conversion
+  analogScanEnable(pin);
 }
 
 float pmMeasureExtBatteryCurrent(void)
@@ -235,7 +274,7 @@ float pmMeasureExtBatteryCurrent(void)
 
   if (extBatCurrDeckPin)
   {
-    current = analogReadVoltage(extBatCurrDeckPin) * extBatCurrAmpPerVolt;
+    current = pmReadDeckPinVoltage(extBatCurrDeckPin) * extBatCurrAmpPerVolt;
   }
   else
   {
@@ -249,6 +288,7 @@ void pmEnableExtBatteryVoltMeasuring(uint8_t pin, float multiplier)
 {
   extBatVoltDeckPin = pin;
   extBatVoltMultiplier = multiplier;
+  analogScanEnable(pin);
 }
 
 float pmMeasureExtBatteryVoltage(void)
@@ -257,7 +297,7 @@ float pmMeasureExtBatteryVoltage(void)
 
   if (extBatVoltDeckPin)
   {
-    voltage = analogReadVoltage(extBatVoltDeckPin) * extBatVoltMultiplier;
+    voltage = pmReadDeckPinVoltage(extBatVoltDeckPin) * extBatVoltMultiplier;
   }
   else
   {
@@ -268,6 +308,56 @@ float pmMeasureExtBatteryVoltage(void)
 }
 
 
+/**
+ * Runs the state of charge estimation while on battery, it restarts from the
+ * voltage after charging.
+ */
+static void pmUpdateBatteryEstimator(uint32_t tick)
+{
+  float dt = (float)(tick - batteryEstimatorTick) / configTICK_RATE_HZ;
+  batteryEstimatorTick = tick;
+
+  // The estimator divides by the capacity, a capacity that is not positive is rejected
+  if (batteryCapacity > 0.0f)
+  {
+    batteryEstimator.capacity = batteryCapacity;
+  }
+  else
+  {
+    batteryCapacity = batteryEstimator.capacity;
+  }
+
+  if (pmState != battery && pmState != lowPower)
+  {
+    batteryEstimatorReset(&batteryEstimator);
+    return;
+  }
+
+  float meanRatio = 0;
+  for (int i = 0; i < NBR_OF_MOTORS; i++)
+  {
+    meanRatio += motorsGetRatio(i);
+  }
+  meanRatio /= NBR_OF_MOTORS * (float)UINT16_MAX;
+
+  bool isCurrentMeasured = (extBatCurrDeckPin != 0);
+  if (isCurrentMeasured)
+  {
+    batteryCurrent = extBatteryCurrent;
+  }
+  else
+  {
+    batteryCurrent = batteryMotorCurrent(meanRatio, batteryIdleCurrent, batteryFullCurrent);
+  }
+
+  batteryEstimatorUpdate(&batteryEstimator, pmGetBatteryVoltage(), batteryCurrent, isCurrentMeasured,
+                         meanRatio > PM_FLYING_MOTOR_RATIO, dt);
+
+  batteryOcv = batteryEstimatorGetOcv(&batteryEstimator);
+  batteryStateOfCharge = batteryEstimator.soc;
+  batteryFlightTime = (uint16_t)batteryEstimatorGetFlightTime(&batteryEstimator, batteryReserve);
+}
+
 // return true if battery discharging
 bool pmIsDischarging(void) {
     PMStates pmState;
@@ -285,6 +375,7 @@ void pmTask(void *param)
   tickCount = xTaskGetTickCount();
   batteryLowTimeStamp = tickCount;
   batteryCriticalLowTimeStamp = tickCount;
+  batteryEstimatorTick = tickCount;
 
   pmSetChargeState(charge500mA);
   vTaskDelay(500);
@@ -297,9 +388,21 @@ void pmTask(void *param)
     extBatteryVoltage = pmMeasureExtBatteryVoltage();
     extBatteryVoltageMV = (uint16_t)(extBatteryVoltage * 1000);
     extBatteryCurrent = pmMeasureExtBatteryCurrent();
-    batteryLevel = pmBatteryChargeFromVoltage(pmGetBatteryVoltage()) * 10;
+    pmUpdateBatteryEstimator(tickCount);
+
+    // On battery the low warning uses the estimated open circuit voltage, so the
+    // voltage sag of aggressive maneuvers does not trigger it. The critical level
+    // is on the measured voltage, a cell that sags that far must land.
+    if (batteryEstimator.isInit)
+    {
+      batteryLevel = (uint8_t)(batteryStateOfCharge * 100 + 0.5f);
+    }
+    else
+    {
+      batteryLevel = pmBatteryChargeFromVoltage(pmGetBatteryVoltage()) * 10;
+    }
 
-    if (pmGetBatteryVoltage() > PM_BAT_LOW_VOLTAGE)
+    if (pmGetBatteryRestVoltage() > PM_BAT_LOW_VOLTAGE)
     {
       batteryLowTimeStamp = tickCount;
     }
@@ -393,5 +496,17 @@ LOG_ADD(LOG_FLOAT, extCurr, &extBatteryCurrent)
 LOG_ADD(LOG_FLOAT, chargeCurrent, &pmSyslinkInfo.chargeCurrent)
 LOG_ADD(LOG_INT8, state, &pmState)
 LOG_ADD(LOG_UINT8, batteryLevel, &batteryLevel)
+LOG_ADD(LOG_FLOAT, soc, &batteryStateOfCharge)
+LOG_ADD(LOG_UINT16, flightTime, &batteryFlightTime)
+LOG_ADD(LOG_FLOAT, current, &batteryCurrent)
+LOG_ADD(LOG_FLOAT, ocv, &batteryOcv)
+LOG_ADD(LOG_FLOAT, r0, &batteryEstimator.r0)
 LOG_GROUP_STOP(pm)
 
+PARAM_GROUP_START(pm)
+PARAM_ADD(PARAM_FLOAT, capacity, &batteryCapacity)
+PARAM_ADD(PARAM_FLOAT, idleCurr, &batteryIdleCurrent)
+PARAM_ADD(PARAM_FLOAT, fullCurr, &batteryFullCurrent)
+PARAM_ADD(PARAM_FLOAT, reserve, &batteryReserve)
+PARAM_GROUP_STOP(pm)
+
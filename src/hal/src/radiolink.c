@@ -39,12 +39,18 @@
 #include "crtp.h"
 #include "configblock.h"
 #include "log.h"
+#include "param.h"
 #include "led.h"
 #include "ledseq.h"
 #include "queuemonitor.h"
+#include "linkQuality.h"
 
 #define RADIOLINK_TX_QUEUE_SIZE (1)
 
+#define RADIOLINK_QUALITY_UPDATE_MS 250
+// Free CRTP tx queue packets below which the downlink is backlogged
+#define RADIOLINK_BACKLOG_FREE 20
+
 static xQueueHandle  txQueue;
 static xQueueHandle crtpPacketDelivery;
 
@@ -53,15 +59,21 @@ static bool isInit;
 static int radiolinkSendCRTPPacket(CRTPPacket *p);
 static int radiolinkSetEnable(bool enable);
 static int radiolinkReceiveCRTPPacket(CRTPPacket *p);
+static float radiolinkGetTelemetryRate(void);
 
 //Local RSSI variable used to enable logging of RSSI values from Radio
 static uint8_t rssi;
 
+static linkQuality_t linkQuality;
+static uint32_t lastQualityUpdate;
+static uint8_t isThrottleEnabled = 1;
+
 static struct crtpLinkOperations radiolinkOp =
 {
   .setEnable         = radiolinkSetEnable,
   .sendPacket        = radiolinkSendCRTPPacket,
   .receivePacket     = radiolinkReceiveCRTPPacket,
+  .telemetryRate     = radiolinkGetTelemetryRate,
 };
 
 void radiolinkInit(void)
@@ -77,6 +89,8 @@ void radiolinkInit(void)
 
   ASSERT(crtpPacketDelivery);
 
+  linkQualityInit(&linkQuality);
+
   syslinkInit();
 
   radiolinkSetChannel(configblockGetRadioChannel());
@@ -132,9 +146,38 @@ void radiolinkSetPowerDbm(int8_t powerDbm)
 }
 
 
+// Called with the sample added, in a critical section since both the
+// syslink and the CRTP tx tasks add samples
+static void updateLinkQuality(void)
+{
+  uint32_t now = xTaskGetTickCount();
+  if (now - lastQualityUpdate >= M2T(RADIOLINK_QUALITY_UPDATE_MS))
+  {
+    lastQualityUpdate = now;
+    linkQualityUpdate(&linkQuality, crtpGetFreeTxQueuePackets() < RADIOLINK_BACKLOG_FREE);
+  }
+}
+
+static void addSendSample(bool isAcked)
+{
+  taskENTER_CRITICAL();
+  linkQualityAddSend(&linkQuality, isAcked);
+  updateLinkQuality();
+  taskEXIT_CRITICAL();
+}
+
 void radiolinkSyslinkDispatch(SyslinkPacket *slp)
 {
   static SyslinkPacket txPacket;
+
+  // A CRTP packet is the header followed by at most CRTP_MAX_DATA_SIZE bytes,
+  // the modules rely on it when decoding the data
+  if ((slp->type == SYSLINK_RADIO_RAW || slp->type == SYSLINK_RADIO_RAW_BROADCAST) &&
+      (slp->length == 0 || slp->length > CRTP_MAX_DATA_SIZE + 1))
+  {
+    return;
+  }
+
   if (slp->type == SYSLINK_RADIO_RAW)
   {
     slp->length--; // Decrease to get CRTP size.
@@ -156,6 +199,10 @@ void radiolinkSyslinkDispatch(SyslinkPacket *slp)
 	{
 		//Extract RSSI sample sent from radio
 		memcpy(&rssi, slp->data, sizeof(uint8_t));
+		taskENTER_CRITICAL();
+		linkQualityAddRssi(&linkQuality, rssi);
+		updateLinkQuality();
+		taskEXIT_CRITICAL();
 	}
 }
 
@@ -179,14 +226,23 @@ static int radiolinkSendCRTPPacket(CRTPPacket *p)
   slp.length = p->size + 1;
   memcpy(slp.data, &p->header, p->size + 1);
 
+  // The queue holds one packet, that leaves on the ACK of the next uplink
+  // packet. A send that times out is retried by the CRTP tx task.
   if (xQueueSend(txQueue, &slp, M2T(100)) == pdTRUE)
   {
+    addSendSample(true);
     return true;
   }
 
+  addSendSample(false);
   return false;
 }
 
+static float radiolinkGetTelemetryRate(void)
+{
+  return isThrottleEnabled ? linkQuality.rate : 1.0f;
+}
+
 struct crtpLinkOperations * radiolinkGetLink()
 {
   return &radiolinkOp;
@@ -199,4 +255,12 @@ static int radiolinkSetEnable(bool enable)
 
 LOG_GROUP_START(radio)
 LOG_ADD(LOG_UINT8, rssi, &rssi)
+LOG_ADD(LOG_FLOAT, quality, &linkQuality.quality)
+LOG_ADD(LOG_FLOAT, ackRatio, &linkQuality.ackRatio)
+LOG_ADD(LOG_UINT32, retries, &linkQuality.retries)
+LOG_ADD(LOG_FLOAT, logRate, &linkQuality.rate)
 LOG_GROUP_STOP(radio)
+
+PARAM_GROUP_START(radio)
+PARAM_ADD(PARAM_UINT8, logThrottle, &isThrottleEnabled)
+PARAM_GROUP_STOP(radio)
@@ -56,13 +56,15 @@ static bool isInit = false;
 static bool allSensorsAreCalibrated = false;
 static sensorData_t sensorData;
 static uint64_t imuIntTimestamp;
+static volatile bool isIdle;
 
 static int32_t varianceSampleTime;
 static uint8_t sensorsAccLpfAttFactor;
 
 static bool isBarometerPresent = false;
 static bool isMagnetometerPresent = false;
-static uint8_t baroMeasDelayMin = SENSORS_DELAY_BARO;
+static uint8_t baroMeasDelayMin = SENSORS_DELAY_BMP388;
+static bmp388Calib_t bmp388Calib;
 
 // Pre-calculated values for accelerometer alignment
 float cosPitch;
@@ -291,11 +293,13 @@ static void sensorsDeviceInit(void)
     /* Select the pressure and temperature sensor to be enabled */
     bmp388Dev.settings.press_en = BMP3_ENABLE;
     bmp388Dev.settings.temp_en = BMP3_ENABLE;
-    /* Select the output data rate and oversampling settings for pressure and temperature */
-    bmp388Dev.settings.odr_filter.press_os = BMP3_OVERSAMPLING_8X;
+    /* Select the output data rate and oversampling settings for pressure and temperature.
+     * 100 Hz allows at most 2x pressure oversampling, the IIR filter keeps the same
+     * time constant (80 ms) as 8x oversampling with coefficient 3 at 50 Hz. */
+    bmp388Dev.settings.odr_filter.press_os = BMP3_OVERSAMPLING_2X;
     bmp388Dev.settings.odr_filter.temp_os = BMP3_NO_OVERSAMPLING;
-    bmp388Dev.settings.odr_filter.odr = BMP3_ODR_50_HZ;
-    bmp388Dev.settings.odr_filter.iir_filter = BMP3_IIR_FILTER_COEFF_3;
+    bmp388Dev.settings.odr_filter.odr = BMP3_ODR_100_HZ;
+    bmp388Dev.settings.odr_filter.iir_filter = BMP3_IIR_FILTER_COEFF_7;
     /* Assign the settings which needs to be set in the sensor */
     settings_sel = BMP3_PRESS_EN_SEL | BMP3_TEMP_EN_SEL | BMP3_PRESS_OS_SEL | BMP3_TEMP_OS_SEL | BMP3_ODR_SEL | BMP3_IIR_FILTER_SEL;
     rslt = bmp3_set_sensor_settings(settings_sel, &bmp388Dev);
@@ -319,7 +323,11 @@ static void sensorsDeviceInit(void)
 
     /* Print the temperature and pressure data */
 //    DEBUG_PRINT("BMP388 T:%0.2f  P:%0.2f\n",data.temperature, data.pressure/100.0f);
-    baroMeasDelayMin = SENSORS_DELAY_BARO;
+    uint8_t calibRegs[BMP3_CALIB_DATA_LEN];
+    bmp3_get_regs(BMP3_CALIB_DATA_ADDR, calibRegs, BMP3_CALIB_DATA_LEN, &bmp388Dev);
+    bmp388CalibInit(&bmp388Calib, calibRegs);
+
+    baroMeasDelayMin = SENSORS_DELAY_BMP388;
   }
   else
   {
@@ -343,10 +351,10 @@ static void sensorsDeviceInit(void)
 
 static void sensorsTaskInit(void)
 {
-  accelDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  gyroDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  magDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  baroDataQueue = xQueueCreate(1, sizeof(baro_t));
+  accelDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  gyroDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  magDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  baroDataQueue = xQueueCreate(1, sizeof(timedBaro_t));
 
   xTaskCreate(sensorsTask, SENSORS_TASK_NAME, SENSORS_TASK_STACKSIZE,
               NULL, SENSORS_TASK_PRI, NULL);
@@ -405,6 +413,20 @@ sensorsAccelCalibrate(BiasObj* accel, BiasObj* gyro)
   }
 }
 
+// Waits for the next IMU sample. When idle the data ready interrupt is masked
+// and the IMU is read at SENSORS_IDLE_RATE_HZ instead.
+static bool sensorsWaitImuSample(void)
+{
+  if (isIdle)
+  {
+    vTaskDelay(M2T(1000 / SENSORS_IDLE_RATE_HZ));
+    imuIntTimestamp = usecTimestamp();
+    return true;
+  }
+
+  return pdTRUE == xSemaphoreTake(sensorsDataReady, portMAX_DELAY);
+}
+
 static void sensorsTask(void *param)
 {
   systemWaitStart();
@@ -424,7 +446,7 @@ static void sensorsTask(void *param)
   //vTaskDelayUntil(&lastWakeTime, M2T(1500));
   while (1)
   {
-    if (pdTRUE == xSemaphoreTake(sensorsDataReady, portMAX_DELAY))
+    if (sensorsWaitImuSample())
     {
       sensorData.interruptTimestamp = imuIntTimestamp;
       /* calibrate if necessary */
@@ -467,28 +489,33 @@ static void sensorsTask(void *param)
                                SENSORS_BMI088_G_PER_LSB_CFG);
 
       sensorsAccAlignToGravity(&accelScaled, &sensorData.acc);
+      sensorData.gyroTimestamp = sensorData.interruptTimestamp;
+      sensorData.accTimestamp = sensorData.interruptTimestamp;
 
       }
       if (isBarometerPresent)
       {
-        static uint8_t baroMeasDelay = SENSORS_DELAY_BARO;
+        static uint8_t baroMeasDelay = SENSORS_DELAY_BMP388;
         if (--baroMeasDelay == 0)
         {
-          uint8_t sensor_comp = BMP3_PRESS | BMP3_TEMP;
-          struct bmp3_data data;
+          uint8_t data[BMP3_P_T_DATA_LEN];
           baro_t* baro388 = &sensorData.baro;
-          /* Temperature and Pressure data are read and stored in the bmp3_data instance */
-          bmp3_get_sensor_data(sensor_comp, &data, &bmp388Dev);
-          sensorsScaleBaro(baro388, data.pressure, data.temperature);
+          /* Raw pressure and temperature are compensated in fixed point */
+          sensorData.baroTimestamp = usecTimestamp();
+          bmp3_get_regs(BMP3_DATA_ADDR, data, BMP3_P_T_DATA_LEN, &bmp388Dev);
+          uint32_t rawPressure = ((uint32_t)data[2] << 16) | ((uint32_t)data[1] << 8) | data[0];
+          uint32_t rawTemperature = ((uint32_t)data[5] << 16) | ((uint32_t)data[4] << 8) | data[3];
+          int32_t temperature = bmp388SetTemperature(&bmp388Calib, rawTemperature);
+          uint32_t pressure = bmp388CompensatePressure(&bmp388Calib, rawPressure);
+          sensorsScaleBaro(baro388, pressure * 0.01f, temperature * 0.01f);
           baroMeasDelay = baroMeasDelayMin;
+
+          timedBaro_t baroSample = {.baro = sensorData.baro, .timestamp = sensorData.baroTimestamp};
+          xQueueOverwrite(baroDataQueue, &baroSample);
         }
       }
-      xQueueOverwrite(accelDataQueue, &sensorData.acc);
-      xQueueOverwrite(gyroDataQueue, &sensorData.gyro);
-      if (isBarometerPresent)
-      {
-        xQueueOverwrite(baroDataQueue, &sensorData.baro);
-      }
+      sensorsQueueAxis3f(accelDataQueue, &sensorData.acc, sensorData.accTimestamp);
+      sensorsQueueAxis3f(gyroDataQueue, &sensorData.gyro, sensorData.gyroTimestamp);
 
       xSemaphoreGive(dataReady);
     }
@@ -500,6 +527,22 @@ void sensorsWaitDataReady(void)
   xSemaphoreTake(dataReady, portMAX_DELAY);
 }
 
+void sensorsSetIdle(bool idle)
+{
+  if (idle)
+  {
+    isIdle = true;
+    EXTI->IMR &= ~EXTI_Line14;
+    // Wake the task waiting for the interrupt
+    xSemaphoreGive(sensorsDataReady);
+  }
+  else
+  {
+    EXTI->IMR |= EXTI_Line14;
+    isIdle = false;
+  }
+}
+
 static void sensorsBiasMalloc(BiasObj* bias)
 {
   /* allocate memory for buffer */
@@ -645,36 +688,43 @@ static void sensorsScaleBaro(baro_t* baroScaled, float pressure,
 {
   baroScaled->pressure = pressure*0.01f;
   baroScaled->temperature = temperature;
-  baroScaled->asl = ((powf((1015.7f / baroScaled->pressure), 0.1902630958f)
-      - 1.0f) * (25.0f + 273.15f)) / 0.0065f;
+  baroScaled->asl = baroPressureToAltitude(baroScaled->pressure);
 }
 
-bool sensorsReadGyro(Axis3f *gyro)
+bool sensorsReadGyro(Axis3f *gyro, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(gyroDataQueue, gyro, 0));
+  return sensorsReadAxis3f(gyroDataQueue, gyro, timestamp);
 }
 
-bool sensorsReadAcc(Axis3f *acc)
+bool sensorsReadAcc(Axis3f *acc, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(accelDataQueue, acc, 0));
+  return sensorsReadAxis3f(accelDataQueue, acc, timestamp);
 }
 
-bool sensorsReadMag(Axis3f *mag)
+bool sensorsReadMag(Axis3f *mag, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(magDataQueue, mag, 0));
+  return sensorsReadAxis3f(magDataQueue, mag, timestamp);
 }
 
-bool sensorsReadBaro(baro_t *baro)
+bool sensorsReadBaro(baro_t *baro, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(baroDataQueue, baro, 0));
+  timedBaro_t sample;
+  if (pdTRUE != xQueueReceive(baroDataQueue, &sample, 0))
+  {
+    return false;
+  }
+
+  *baro = sample.baro;
+  *timestamp = sample.timestamp;
+  return true;
 }
 
 void sensorsAcquire(sensorData_t *sensors, const uint32_t tick)
 {
-  sensorsReadGyro(&sensors->gyro);
-  sensorsReadAcc(&sensors->acc);
-  sensorsReadMag(&sensors->mag);
-  sensorsReadBaro(&sensors->baro);
+  sensorsReadGyro(&sensors->gyro, &sensors->gyroTimestamp);
+  sensorsReadAcc(&sensors->acc, &sensors->accTimestamp);
+  sensorsReadMag(&sensors->mag, &sensors->magTimestamp);
+  sensorsReadBaro(&sensors->baro, &sensors->baroTimestamp);
   zRangerReadRange(&sensors->zrange, tick);
   sensors->interruptTimestamp = sensorData.interruptTimestamp;
 }
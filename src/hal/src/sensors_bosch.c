@@ -79,6 +79,7 @@ static xSemaphoreHandle dataReady;
 
 static bool isInit = false;
 static bool allSensorsAreCalibrated = false;
+static volatile bool isIdle;
 static sensorData_t sensors;
 
 static int32_t varianceSampleTime;
@@ -294,14 +295,14 @@ static void sensorsDeviceInit(void)
 
 static void sensorsTaskInit(void)
 {
-  accelPrimDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  gyroPrimDataQueue = xQueueCreate(1, sizeof(Axis3f));
+  accelPrimDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  gyroPrimDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
 #ifdef LOG_SEC_IMU
   accelSecDataQueue = xQueueCreate(1, sizeof(Axis3f));
   gyroSecDataQueue = xQueueCreate(1, sizeof(Axis3f));
 #endif
-  magPrimDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  baroPrimDataQueue = xQueueCreate(1, sizeof(baro_t));
+  magPrimDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  baroPrimDataQueue = xQueueCreate(1, sizeof(timedBaro_t));
 
   xTaskCreate(sensorsTask, SENSORS_TASK_NAME, SENSORS_TASK_STACKSIZE,
               NULL, SENSORS_TASK_PRI, NULL);
@@ -420,7 +421,7 @@ static void sensorsTask(void *param)
   //vTaskDelayUntil(&lastWakeTime, M2T(1500));
   while (1)
     {
-      vTaskDelayUntil(&lastWakeTime, F2T(SENSORS_READ_RATE_HZ));
+      vTaskDelayUntil(&lastWakeTime, F2T(isIdle ? SENSORS_IDLE_RATE_HZ : SENSORS_READ_RATE_HZ));
       /* calibrate if necessary */
       if (!allSensorsAreCalibrated)
         {
@@ -454,6 +455,8 @@ static void sensorsTask(void *param)
         }
       else {
           /* get data from chosen sensors */
+          sensors.gyroTimestamp = usecTimestamp();
+          sensors.accTimestamp = sensors.gyroTimestamp;
           sensorsGyroGet(&gyroPrim, gyroPrimInUse);
           sensorsAccelGet(&accelPrim, accelPrimInUse);
 #ifdef LOG_SEC_IMU
@@ -534,11 +537,14 @@ static void sensorsTask(void *param)
 
           if (--magMeasDelay == 0)
             {
+              sensors.magTimestamp = usecTimestamp();
               bmm150_read_mag_data(&bmm150Dev);
               sensors.mag.x = bmm150Dev.data.x;
               sensors.mag.y = bmm150Dev.data.y;
               sensors.mag.z = bmm150Dev.data.z;
               magMeasDelay = SENSORS_DELAY_MAG;
+
+              sensorsQueueAxis3f(magPrimDataQueue, &sensors.mag, sensors.magTimestamp);
             }
         }
 
@@ -551,29 +557,23 @@ static void sensorsTask(void *param)
 
           if (--baroMeasDelay == 0)
             {
+              sensors.baroTimestamp = usecTimestamp();
               bmp280_read_pressure_temperature(&v_pres_u32, &v_temp_s32);
               sensorsScaleBaro(baro280, (float)v_pres_u32, (float)v_temp_s32/100.0f);
               baroMeasDelay = baroMeasDelayMin;
+
+              timedBaro_t baroSample = {.baro = sensors.baro, .timestamp = sensors.baroTimestamp};
+              xQueueOverwrite(baroPrimDataQueue, &baroSample);
             }
         }
-      xQueueOverwrite(accelPrimDataQueue, &sensors.acc);
-      xQueueOverwrite(gyroPrimDataQueue, &sensors.gyro);
+      sensorsQueueAxis3f(accelPrimDataQueue, &sensors.acc, sensors.accTimestamp);
+      sensorsQueueAxis3f(gyroPrimDataQueue, &sensors.gyro, sensors.gyroTimestamp);
 
 #ifdef LOG_SEC_IMU
       xQueueOverwrite(gyroSecDataQueue, &sensors.gyroSec);
       xQueueOverwrite(accelSecDataQueue, &sensors.accSec);
 #endif
 
-      if (isBarometerPresent)
-        {
-          xQueueOverwrite(baroPrimDataQueue, &sensors.baro);
-        }
-
-      if (isMagnetometerPresent)
-        {
-          xQueueOverwrite(magPrimDataQueue, &sensors.mag);
-        }
-
       xSemaphoreGive(dataReady);
     }
 }
@@ -583,6 +583,12 @@ void sensorsWaitDataReady(void)
   xSemaphoreTake(dataReady, portMAX_DELAY);
 }
 
+void sensorsSetIdle(bool idle)
+{
+  // The sensors are polled, only the read rate changes
+  isIdle = idle;
+}
+
 static void sensorsBiasMalloc(BiasObj* bias)
 {
   /* allocate memory for buffer */
@@ -724,13 +730,12 @@ static void sensorsScaleBaro(baro_t* baroScaled, float pressure,
                              float temperature) {
   baroScaled->pressure = pressure*0.01f;
   baroScaled->temperature = temperature;
-  baroScaled->asl = ((powf((1015.7f / baroScaled->pressure), 0.1902630958f)
-      - 1.0f) * (25.0f + 273.15f)) / 0.0065f;
+  baroScaled->asl = baroPressureToAltitude(baroScaled->pressure);
 }
 
-bool sensorsReadGyro(Axis3f *gyro)
+bool sensorsReadGyro(Axis3f *gyro, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(gyroPrimDataQueue, gyro, 0));
+  return sensorsReadAxis3f(gyroPrimDataQueue, gyro, timestamp);
 }
 
 #ifdef LOG_SEC_IMU
@@ -745,27 +750,35 @@ bool sensorsReadAccSec(Axis3f *acc)
 }
 #endif
 
-bool sensorsReadAcc(Axis3f *acc)
+bool sensorsReadAcc(Axis3f *acc, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(accelPrimDataQueue, acc, 0));
+  return sensorsReadAxis3f(accelPrimDataQueue, acc, timestamp);
 }
 
-bool sensorsReadMag(Axis3f *mag)
+bool sensorsReadMag(Axis3f *mag, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(magPrimDataQueue, mag, 0));
+  return sensorsReadAxis3f(magPrimDataQueue, mag, timestamp);
 }
 
-bool sensorsReadBaro(baro_t *baro)
+bool sensorsReadBaro(baro_t *baro, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(baroPrimDataQueue, baro, 0));
+  timedBaro_t sample;
+  if (pdTRUE != xQueueReceive(baroPrimDataQueue, &sample, 0))
+  {
+    return false;
+  }
+
+  *baro = sample.baro;
+  *timestamp = sample.timestamp;
+  return true;
 }
 
 void sensorsAcquire(sensorData_t *sensors, const uint32_t tick)
 {
-  sensorsReadGyro(&sensors->gyro);
-  sensorsReadAcc(&sensors->acc);
-  sensorsReadMag(&sensors->mag);
-  sensorsReadBaro(&sensors->baro);
+  sensorsReadGyro(&sensors->gyro, &sensors->gyroTimestamp);
+  sensorsReadAcc(&sensors->acc, &sensors->accTimestamp);
+  sensorsReadMag(&sensors->mag, &sensors->magTimestamp);
+  sensorsReadBaro(&sensors->baro, &sensors->baroTimestamp);
   zRangerReadRange(&sensors->zrange, tick);
 #ifdef LOG_SEC_IMU
   sensorsReadGyroSec(&sensors->gyroSec);
@@ -43,12 +43,17 @@
 #include "system.h"
 #include "configblock.h"
 #include "param.h"
+#include "log.h"
 #include "debug.h"
 #include "imu.h"
 #include "nvicconf.h"
 #include "ledseq.h"
 #include "sound.h"
 #include "filter.h"
+#include "dynNotch.h"
+#include "spectrum.h"
+#include "magCalib.h"
+#include "worker.h"
 
 /**
  * Enable 250Hz digital LPF mode. However does not work with
@@ -110,6 +115,7 @@ static xSemaphoreHandle dataReady;
 static bool isInit = false;
 static sensorData_t sensorData;
 static uint64_t imuIntTimestamp;
+static volatile bool isIdle;
 
 static BiasObj gyroBiasRunning;
 static Axis3f  gyroBias;
@@ -127,6 +133,29 @@ static lpf2pData accLpf[3];
 static lpf2pData gyroLpf[3];
 static void applyAxis3fLpf(lpf2pData *data, Axis3f* in);
 
+// Notch filtering of the motor vibrations on the gyro, before the low pass
+#define GYRO_SAMPLE_FREQ 1000
+static dynNotch_t gyroNotch;
+static uint8_t gyroNotchEnable = 0;
+static uint8_t gyroNotchPeaks = 3;
+static float gyroNotchQ = 3.0f;
+static float gyroNotchMinFreq = 80.0f;
+static float gyroNotchMaxFreq = 450.0f;
+static float gyroNotchMinAmp = 1.0f;
+static void applyAxis3fDynNotch(Axis3f* in);
+
+// Hard and soft iron calibration of the magnetometer. Setting start collects samples while
+// the Crazyflie is rotated in all directions, the fit is solved and stored when enough are taken.
+static magCalibration_t magCalibration;
+static magCalibration_t magCalibrationStored;
+static magCalib_t magCalibrator;
+static uint8_t magCalibStartRequest = 0;
+static uint16_t magCalibSamples = 300;
+static float magCalibMinSeparation = 0.03f; // gauss
+static void processMagCalibration(Axis3f* mag);
+static void magCalibLoad(void);
+static void magCalibStore(void* arg);
+
 static bool isBarometerPresent = false;
 static bool isMagnetometerPresent = false;
 
@@ -161,32 +190,40 @@ static void sensorsAddBiasValue(BiasObj* bias, int16_t x, int16_t y, int16_t z);
 static bool sensorsFindBiasValue(BiasObj* bias);
 static void sensorsAccAlignToGravity(Axis3f* in, Axis3f* out);
 
-bool sensorsReadGyro(Axis3f *gyro)
+bool sensorsReadGyro(Axis3f *gyro, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(gyroDataQueue, gyro, 0));
+  return sensorsReadAxis3f(gyroDataQueue, gyro, timestamp);
 }
 
-bool sensorsReadAcc(Axis3f *acc)
+bool sensorsReadAcc(Axis3f *acc, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(accelerometerDataQueue, acc, 0));
+  return sensorsReadAxis3f(accelerometerDataQueue, acc, timestamp);
 }
 
-bool sensorsReadMag(Axis3f *mag)
+bool sensorsReadMag(Axis3f *mag, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(magnetometerDataQueue, mag, 0));
+  return sensorsReadAxis3f(magnetometerDataQueue, mag, timestamp);
 }
 
-bool sensorsReadBaro(baro_t *baro)
+bool sensorsReadBaro(baro_t *baro, uint64_t *timestamp)
 {
-  return (pdTRUE == xQueueReceive(barometerDataQueue, baro, 0));
+  timedBaro_t sample;
+  if (pdTRUE != xQueueReceive(barometerDataQueue, &sample, 0))
+  {
+    return false;
+  }
+
+  *baro = sample.baro;
+  *timestamp = sample.timestamp;
+  return true;
 }
 
 void sensorsAcquire(sensorData_t *sensors, const uint32_t tick)
 {
-  sensorsReadGyro(&sensors->gyro);
-  sensorsReadAcc(&sensors->acc);
-  sensorsReadMag(&sensors->mag);
-  sensorsReadBaro(&sensors->baro);
+  sensorsReadGyro(&sensors->gyro, &sensors->gyroTimestamp);
+  sensorsReadAcc(&sensors->acc, &sensors->accTimestamp);
+  sensorsReadMag(&sensors->mag, &sensors->magTimestamp);
+  sensorsReadBaro(&sensors->baro, &sensors->baroTimestamp);
   zRangerReadRange(&sensors->zrange, tick);
   sensors->interruptTimestamp = sensorData.interruptTimestamp;
 }
@@ -195,6 +232,22 @@ bool sensorsAreCalibrated() {
   return gyroBiasFound;
 }
 
+// Waits for the next IMU sample. When idle the data ready interrupt is masked
+// and the IMU is read at SENSORS_IDLE_RATE_HZ instead. The read right after
+// leaving idle clears the interrupt latched while masked, which has not
+// raised an edge, so the next sample raises it again.
+static bool sensorsWaitImuSample(void)
+{
+  if (isIdle)
+  {
+    vTaskDelay(M2T(1000 / SENSORS_IDLE_RATE_HZ));
+    imuIntTimestamp = usecTimestamp();
+    return true;
+  }
+
+  return pdTRUE == xSemaphoreTake(sensorsDataReady, portMAX_DELAY);
+}
+
 static void sensorsTask(void *param)
 {
   systemWaitStart();
@@ -203,7 +256,7 @@ static void sensorsTask(void *param)
 
   while (1)
   {
-    if (pdTRUE == xSemaphoreTake(sensorsDataReady, portMAX_DELAY))
+    if (sensorsWaitImuSample())
     {
       sensorData.interruptTimestamp = imuIntTimestamp;
       // data is ready to be read
@@ -224,15 +277,26 @@ static void sensorsTask(void *param)
                   SENSORS_MPU6500_BUFF_LEN + SENSORS_MAG_BUFF_LEN : SENSORS_MPU6500_BUFF_LEN]));
       }
 
-      xQueueOverwrite(accelerometerDataQueue, &sensorData.acc);
-      xQueueOverwrite(gyroDataQueue, &sensorData.gyro);
-      if (isMagnetometerPresent)
+      // Solving the magnetometer calibration is spread over the sensor reads
+      if (magCalibrator.state == magCalibSolving && magCalibStep(&magCalibrator) == magCalibDone)
       {
-        xQueueOverwrite(magnetometerDataQueue, &sensorData.mag);
+        magCalibration = magCalibrator.result;
+        magCalibrationStored = magCalibration;
+        workerSchedule(magCalibStore, &magCalibrationStored);
       }
-      if (isBarometerPresent)
+
+      sensorsQueueAxis3f(accelerometerDataQueue, &sensorData.acc, sensorData.accTimestamp);
+      sensorsQueueAxis3f(gyroDataQueue, &sensorData.gyro, sensorData.gyroTimestamp);
+      // Magnetometer and barometer samples are only queued when new, so the
+      // consumers see each sample once with its acquisition time
+      if (isMagnetometerPresent && sensorData.magTimestamp == sensorData.interruptTimestamp)
+      {
+        sensorsQueueAxis3f(magnetometerDataQueue, &sensorData.mag, sensorData.magTimestamp);
+      }
+      if (isBarometerPresent && sensorData.baroTimestamp == sensorData.interruptTimestamp)
       {
-        xQueueOverwrite(barometerDataQueue, &sensorData.baro);
+        timedBaro_t baroSample = {.baro = sensorData.baro, .timestamp = sensorData.baroTimestamp};
+        xQueueOverwrite(barometerDataQueue, &baroSample);
       }
 
       // Unlock stabilizer task
@@ -246,6 +310,22 @@ void sensorsWaitDataReady(void)
   xSemaphoreTake(dataReady, portMAX_DELAY);
 }
 
+void sensorsSetIdle(bool idle)
+{
+  if (idle)
+  {
+    isIdle = true;
+    EXTI->IMR &= ~EXTI_Line13;
+    // Wake the task waiting for the interrupt
+    xSemaphoreGive(sensorsDataReady);
+  }
+  else
+  {
+    EXTI->IMR |= EXTI_Line13;
+    isIdle = false;
+  }
+}
+
 void processBarometerMeasurements(const uint8_t *buffer)
 {
   static uint32_t rawPressure = 0;
@@ -254,6 +334,7 @@ void processBarometerMeasurements(const uint8_t *buffer)
   // Check if there is a new pressure update
   if (buffer[0] & 0x02) {
     rawPressure = ((uint32_t) buffer[3] << 16) | ((uint32_t) buffer[2] << 8) | buffer[1];
+    sensorData.baroTimestamp = sensorData.interruptTimestamp;
   }
   // Check if there is a new temp update
   if (buffer[0] & 0x01) {
@@ -272,15 +353,71 @@ void processMagnetometerMeasurements(const uint8_t *buffer)
     int16_t headingy = (((int16_t) buffer[4]) << 8) | buffer[3];
     int16_t headingz = (((int16_t) buffer[6]) << 8) | buffer[5];
 
-    sensorData.mag.x = (float)headingx / MAG_GAUSS_PER_LSB;
-    sensorData.mag.y = (float)headingy / MAG_GAUSS_PER_LSB;
-    sensorData.mag.z = (float)headingz / MAG_GAUSS_PER_LSB;
+    // The AK8963 axes are x and y swapped and z inverted compared to the MPU6500
+    sensorData.mag.x = (float)headingy / MAG_GAUSS_PER_LSB;
+    sensorData.mag.y = (float)headingx / MAG_GAUSS_PER_LSB;
+    sensorData.mag.z = -(float)headingz / MAG_GAUSS_PER_LSB;
+    processMagCalibration(&sensorData.mag);
+    sensorData.magTimestamp = sensorData.interruptTimestamp;
+  }
+}
+
+static void processMagCalibration(Axis3f* mag)
+{
+  if (magCalibStartRequest)
+  {
+    magCalibStartRequest = 0;
+    magCalibStart(&magCalibrator, magCalibMinSeparation);
+  }
+
+  if (magCalibrator.state == magCalibCollecting)
+  {
+    magCalibAddSample(&magCalibrator, mag->axis);
+    if (magCalibrator.sampleCount >= magCalibSamples)
+    {
+      magCalibSolve(&magCalibrator);
+    }
+  }
+
+  magCalibApply(&magCalibration, mag->axis);
+}
+
+static void magCalibLoad(void)
+{
+  float offset[3];
+  float softIron[6];
+
+  magCalibSetIdentity(&magCalibration);
+  if (configblockGetMagCalibration(offset, softIron))
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      magCalibration.offset[i] = offset[i];
+      magCalibration.softIron[i][i] = softIron[i];
+    }
+    magCalibration.softIron[0][1] = magCalibration.softIron[1][0] = softIron[3];
+    magCalibration.softIron[0][2] = magCalibration.softIron[2][0] = softIron[4];
+    magCalibration.softIron[1][2] = magCalibration.softIron[2][1] = softIron[5];
+  }
+}
+
+// Runs in the worker task, the eeprom write takes too long for the sensor task
+static void magCalibStore(void* arg)
+{
+  const magCalibration_t* cal = arg;
+  const float softIron[6] = {cal->softIron[0][0], cal->softIron[1][1], cal->softIron[2][2],
+                             cal->softIron[0][1], cal->softIron[0][2], cal->softIron[1][2]};
+
+  if (!configblockSetMagCalibration(cal->offset, softIron))
+  {
+    DEBUG_PRINT("Storing magnetometer calibration [FAIL].\n");
   }
 }
 
 void processAccGyroMeasurements(const uint8_t *buffer)
 {
   Axis3f accScaled;
+  Axis3f gyroUnfiltered;
   // Note the ordering to correct the rotated 90º IMU coordinate system
   int16_t ay = (((int16_t) buffer[0]) << 8) | buffer[1];
   int16_t ax = (((int16_t) buffer[2]) << 8) | buffer[3];
@@ -303,12 +440,17 @@ void processAccGyroMeasurements(const uint8_t *buffer)
   sensorData.gyro.x = -(gx - gyroBias.x) * SENSORS_DEG_PER_LSB_CFG;
   sensorData.gyro.y =  (gy - gyroBias.y) * SENSORS_DEG_PER_LSB_CFG;
   sensorData.gyro.z =  (gz - gyroBias.z) * SENSORS_DEG_PER_LSB_CFG;
+  sensorData.gyroTimestamp = sensorData.interruptTimestamp;
+  gyroUnfiltered = sensorData.gyro;
+  applyAxis3fDynNotch(&sensorData.gyro);
   applyAxis3fLpf((lpf2pData*)(&gyroLpf), &sensorData.gyro);
 
   accScaled.x = -(ax) * SENSORS_G_PER_LSB_CFG / accScale;
   accScaled.y =  (ay) * SENSORS_G_PER_LSB_CFG / accScale;
   accScaled.z =  (az) * SENSORS_G_PER_LSB_CFG / accScale;
   sensorsAccAlignToGravity(&accScaled, &sensorData.acc);
+  sensorData.accTimestamp = sensorData.interruptTimestamp;
+  spectrumAddSample(&gyroUnfiltered, &sensorData.acc);
   applyAxis3fLpf((lpf2pData*)(&accLpf), &sensorData.acc);
 }
 
@@ -370,7 +512,7 @@ static void sensorsDeviceInit(void)
   // Init second order filer for accelerometer
   for (uint8_t i = 0; i < 3; i++)
   {
-    lpf2pInit(&gyroLpf[i], 1000, GYRO_LPF_CUTOFF_FREQ);
+    lpf2pInit(&gyroLpf[i], GYRO_SAMPLE_FREQ, GYRO_LPF_CUTOFF_FREQ);
     lpf2pInit(&accLpf[i],  1000, ACCEL_LPF_CUTOFF_FREQ);
   }
 #endif
@@ -409,6 +551,8 @@ static void sensorsDeviceInit(void)
   sinPitch = sinf(configblockGetCalibPitch() * (float) M_PI/180);
   cosRoll = cosf(configblockGetCalibRoll() * (float) M_PI/180);
   sinRoll = sinf(configblockGetCalibRoll() * (float) M_PI/180);
+
+  magCalibLoad();
 }
 
 
@@ -472,10 +616,10 @@ static void sensorsSetupSlaveRead(void)
 
 static void sensorsTaskInit(void)
 {
-  accelerometerDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  gyroDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  magnetometerDataQueue = xQueueCreate(1, sizeof(Axis3f));
-  barometerDataQueue = xQueueCreate(1, sizeof(baro_t));
+  accelerometerDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  gyroDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  magnetometerDataQueue = xQueueCreate(1, sizeof(timedAxis3f_t));
+  barometerDataQueue = xQueueCreate(1, sizeof(timedBaro_t));
 
   xTaskCreate(sensorsTask, SENSORS_TASK_NAME, SENSORS_TASK_STACKSIZE, NULL, SENSORS_TASK_PRI, NULL);
 }
@@ -878,6 +1022,73 @@ static void applyAxis3fLpf(lpf2pData *data, Axis3f* in)
   }
 }
 
+static void applyAxis3fDynNotch(Axis3f* in)
+{
+  static bool isRunning = false;
+  static uint8_t peaks;
+  static float q, minFreq, maxFreq, minAmp;
+
+  if (!gyroNotchEnable)
+  {
+    isRunning = false;
+    return;
+  }
+
+  // Restart the tracking when a parameter is changed
+  if (!isRunning || peaks != gyroNotchPeaks || q != gyroNotchQ || minFreq != gyroNotchMinFreq ||
+      maxFreq != gyroNotchMaxFreq || minAmp != gyroNotchMinAmp)
+  {
+    peaks = gyroNotchPeaks;
+    q = gyroNotchQ;
+    minFreq = gyroNotchMinFreq;
+    maxFreq = gyroNotchMaxFreq;
+    minAmp = gyroNotchMinAmp;
+    dynNotchInit(&gyroNotch, GYRO_SAMPLE_FREQ, minFreq, maxFreq, q, peaks, minAmp);
+    isRunning = true;
+  }
+
+  dynNotchApply(&gyroNotch, in->axis);
+}
+
+PARAM_GROUP_START(gyroNotch)
+PARAM_ADD(PARAM_UINT8, enable, &gyroNotchEnable)
+PARAM_ADD(PARAM_UINT8, peaks, &gyroNotchPeaks)
+PARAM_ADD(PARAM_FLOAT, q, &gyroNotchQ)
+PARAM_ADD(PARAM_FLOAT, minHz, &gyroNotchMinFreq)
+PARAM_ADD(PARAM_FLOAT, maxHz, &gyroNotchMaxFreq)
+PARAM_ADD(PARAM_FLOAT, minAmp, &gyroNotchMinAmp)
+PARAM_GROUP_STOP(gyroNotch)
+
+LOG_GROUP_START(gyroNotch)
+LOG_ADD(LOG_UINT8, source, &gyroNotch.source)
+LOG_ADD(LOG_FLOAT, x1, &gyroNotch.centerFreq[0][0])
+LOG_ADD(LOG_FLOAT, x2, &gyroNotch.centerFreq[0][1])
+LOG_ADD(LOG_FLOAT, x3, &gyroNotch.centerFreq[0][2])
+LOG_ADD(LOG_FLOAT, x4, &gyroNotch.centerFreq[0][3])
+LOG_ADD(LOG_FLOAT, y1, &gyroNotch.centerFreq[1][0])
+LOG_ADD(LOG_FLOAT, y2, &gyroNotch.centerFreq[1][1])
+LOG_ADD(LOG_FLOAT, y3, &gyroNotch.centerFreq[1][2])
+LOG_ADD(LOG_FLOAT, y4, &gyroNotch.centerFreq[1][3])
+LOG_ADD(LOG_FLOAT, z1, &gyroNotch.centerFreq[2][0])
+LOG_ADD(LOG_FLOAT, z2, &gyroNotch.centerFreq[2][1])
+LOG_ADD(LOG_FLOAT, z3, &gyroNotch.centerFreq[2][2])
+LOG_ADD(LOG_FLOAT, z4, &gyroNotch.centerFreq[2][3])
+LOG_GROUP_STOP(gyroNotch)
+
+PARAM_GROUP_START(magCalib)
+PARAM_ADD(PARAM_UINT8, start, &magCalibStartRequest)
+PARAM_ADD(PARAM_UINT16, samples, &magCalibSamples)
+PARAM_ADD(PARAM_FLOAT, minSep, &magCalibMinSeparation)
+PARAM_GROUP_STOP(magCalib)
+
+LOG_GROUP_START(magCalib)
+LOG_ADD(LOG_UINT8, state, &magCalibrator.state)
+LOG_ADD(LOG_UINT16, count, &magCalibrator.sampleCount)
+LOG_ADD(LOG_FLOAT, offX, &magCalibration.offset[0])
+LOG_ADD(LOG_FLOAT, offY, &magCalibration.offset[1])
+LOG_ADD(LOG_FLOAT, offZ, &magCalibration.offset[2])
+LOG_GROUP_STOP(magCalib)
+
 PARAM_GROUP_START(imu_sensors)
 PARAM_ADD(PARAM_UINT8 | PARAM_RONLY, HMC5883L, &isMagnetometerPresent)
 PARAM_ADD(PARAM_UINT8 | PARAM_RONLY, MS5611, &isBarometerPresent) // TODO: Rename MS5611 to LPS25H. Client needs to be updated at the same time.
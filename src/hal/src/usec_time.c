@@ -23,66 +23,166 @@
  *
  *
  * usec_time.c - microsecond-resolution timer and timestamps.
+ *
+ * Timestamps are based on the free running 32-bit DWT cycle counter of the
+ * core. The counter is extended to 63 bits without locks or interrupts by
+ * keeping the most significant bit of the last observed counter value
+ * together with the wrap count in one 32-bit word (see cycleTimestamp()).
+ * The extension stays valid as long as the counter is sampled at least once
+ * every half wrap period (12.8 s at 168 MHz), which the RTOS tick hook
+ * guarantees. The tickless idle suppresses the tick for at most 50 ms and
+ * samples the counter around each sleep.
+ *
+ * The cycle counter stops with the core clock in sleep, while the SysTick
+ * keeps counting the same clock. usecTimerSleep() measures each sleep with
+ * the SysTick and adds the cycles the counter missed.
  */
 
+#include <stdbool.h>
+
 #include "usec_time.h"
 
-#include "nvicconf.h"
+#include "FreeRTOS.h"
 #include "stm32fxxx.h"
 
-static uint32_t usecTimerHighCount;
+#define CYCLE_HIGH_MSB 0x80000000u
+
+// Division by a constant as a multiplication with its reciprocal, scaled
+// by 2^shift. See reciprocalInit().
+typedef struct
+{
+  uint32_t multiplier;
+  uint32_t shift;
+} reciprocal_t;
+
+static bool isInit = false;
+static uint32_t cyclesPerUsec;
+static volatile uint32_t cycleHigh;
+static reciprocal_t cyclesPerUsecReciprocal;
+static reciprocal_t usecPerTickReciprocal;
+
+// The reciprocal is rounded up and scaled to 32 significant bits. The
+// quotient is exact for dividends below 2^31, above that it can be larger
+// than the exact one by at most one part in 2^31. Divisor must be at least 2.
+static void reciprocalInit(reciprocal_t* reciprocal, uint32_t divisor)
+{
+  uint32_t bits = 0;
+  while ((1u << bits) < divisor)
+  {
+    bits++;
+  }
+
+  reciprocal->shift = 31 + bits;
+  reciprocal->multiplier = (uint32_t)((1ull << reciprocal->shift) / divisor + 1);
+}
+
+// Two 32 by 32 bit multiplications, dividend must be below 2^63
+static uint64_t reciprocalDivide(const reciprocal_t* reciprocal, uint64_t dividend)
+{
+  uint64_t high = (uint64_t)(uint32_t)(dividend >> 32) * reciprocal->multiplier;
+  uint64_t low = (uint64_t)(uint32_t)dividend * reciprocal->multiplier;
+
+  return (high + (low >> 32)) >> (reciprocal->shift - 32);
+}
 
 void initUsecTimer(void)
 {
-  usecTimerHighCount = 0;
-
-  TIM_TimeBaseInitTypeDef  TIM_TimeBaseStructure;
-  NVIC_InitTypeDef NVIC_InitStructure;
-
-  //Enable the Timer
-  RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM7, ENABLE);
-
-  //Timer configuration
-  TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
-  // APB1 clock is /4, but APB clock inputs to timers are doubled when
-  // the APB clock runs slower than /1, so APB1 timers see a /2 clock
-  TIM_TimeBaseStructure.TIM_Prescaler = SystemCoreClock / (1000 * 1000) / 2;
-  TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
-  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
-  TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
-  TIM_TimeBaseInit(TIM7, &TIM_TimeBaseStructure);
-
-  NVIC_InitStructure.NVIC_IRQChannel = TIM7_IRQn;
-  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_TRACE_TIM_PRI;
-  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
-  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-  NVIC_Init(&NVIC_InitStructure);
-
-  DBGMCU_APB1PeriphConfig(DBGMCU_TIM7_STOP, ENABLE);
-  TIM_ITConfig(TIM7, TIM_IT_Update, ENABLE);
-  TIM_Cmd(TIM7, ENABLE);
+  if (isInit)
+  {
+    return;
+  }
+
+  cyclesPerUsec = SystemCoreClock / (1000 * 1000);
+  cycleHigh = 0;
+  reciprocalInit(&cyclesPerUsecReciprocal, cyclesPerUsec);
+  reciprocalInit(&usecPerTickReciprocal, 1000 * 1000 / configTICK_RATE_HZ);
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  isInit = true;
 }
 
-uint64_t usecTimestamp(void)
+uint64_t cycleTimestamp(void)
+{
+  uint32_t high = cycleHigh;
+  // The high word must be read before the counter
+  __asm volatile ("" ::: "memory");
+  uint32_t low = DWT->CYCCNT;
+
+  // The counter MSB differs from the one last seen, it has moved half a
+  // wrap. Update the high word, adding one to the wrap count when the MSB
+  // went from one to zero. Concurrent updaters write the same value.
+  if ((low ^ high) & CYCLE_HIGH_MSB)
+  {
+    high = (high ^ CYCLE_HIGH_MSB) + (high >> 31);
+    cycleHigh = high;
+  }
+
+  return ((uint64_t)(high & ~CYCLE_HIGH_MSB) << 32) | low;
+}
+
+void usecTimerSleep(void)
 {
-  uint32_t high0;
-  __atomic_load(&usecTimerHighCount, &high0, __ATOMIC_SEQ_CST);
-  uint32_t low = TIM7->CNT;
-  uint32_t high;
-  __atomic_load(&usecTimerHighCount, &high, __ATOMIC_SEQ_CST);
-
-  // There was no increment in between
-  if (high == high0)
+  // The SysTick registers are read in an order that tells a counter that
+  // reached zero between the reads apart from one that did in the sleep
+  const uint32_t tickStart = SysTick->VAL;
+  const uint32_t cycleStart = DWT->CYCCNT;
+  const bool isPendingBefore = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+
+  __asm volatile ("dsb");
+  __asm volatile ("wfi");
+  __asm volatile ("isb");
+
+  const bool isPendingAfter = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+  const uint32_t tickEnd = SysTick->VAL;
+  const uint32_t cycleEnd = DWT->CYCCNT;
+
+  // The SysTick counts down the core clock and is reloaded the clock after
+  // it reads zero. Reaching zero pends its interrupt, which ends the sleep.
+  // A zero start value was written, as when the tickless idle restarts it,
+  // and is a full period from the next zero.
+  const uint32_t period = SysTick->LOAD + 1;
+  uint32_t sleepCycles;
+  if (isPendingAfter && !isPendingBefore)
   {
-    return (((uint64_t)high) << 16) + low;
+    sleepCycles = (tickStart ? tickStart : period) + (tickEnd ? period - tickEnd : 0);
   }
-  // There was an increment, but we don't expect another one soon
-  return (((uint64_t)high) << 16) + TIM7->CNT;
+  else
+  {
+    sleepCycles = tickEnd <= tickStart ? tickStart - tickEnd : tickStart + period - tickEnd;
+  }
+
+  DWT->CYCCNT += sleepCycles - (cycleEnd - cycleStart);
 }
 
-void __attribute__((used)) TIM7_IRQHandler(void)
+uint64_t usecTimestamp(void)
 {
-  TIM_ClearITPendingBit(TIM7, TIM_IT_Update);
+  return cyclesToUsec(cycleTimestamp());
+}
 
-  __sync_fetch_and_add(&usecTimerHighCount, 1);
+uint64_t cyclesToUsec(uint64_t cycles)
+{
+  return reciprocalDivide(&cyclesPerUsecReciprocal, cycles);
+}
+
+float cyclesToUsecf(uint32_t cycles)
+{
+  return (float)cycles / (float)cyclesPerUsec;
+}
+
+uint64_t usecToCycles(uint64_t usec)
+{
+  return usec * cyclesPerUsec;
+}
+
+uint32_t usecToTicks(uint64_t usec)
+{
+  return (uint32_t)reciprocalDivide(&usecPerTickReciprocal, usec);
+}
+
+uint64_t ticksToUsec(uint32_t ticks)
+{
+  return (uint64_t)ticks * (1000 * 1000 / configTICK_RATE_HZ);
 }
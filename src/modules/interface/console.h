@@ -71,11 +71,25 @@ int consolePuts(char *str);
 void consoleFlush(void);
 
 /**
- * Macro implementing consolePrintf with eprintf
+ * Put a number of characters on the console buffer. The buffer is locked once
+ * for all of them, not once per character.
  *
- * @param FMT String format
- * @patam ... Parameters to print
+ * @param str Characters to print, need not be null terminated
+ * @param len Number of characters
+ * @return The number of characters printed
  */
-#define consolePrintf(FMT, ...) eprintf(consolePutchar, FMT, ## __VA_ARGS__)
+int consolePutn(const char *str, int len);
+
+/**
+ * Printf to the console. The string is formatted on the stack with evsnprintf
+ * and put on the console buffer with one consolePutn. Strings too long for
+ * the buffer (64 characters) are printed a character at a time instead.
+ *
+ * @param fmt String format
+ * @param ... Parameters to print
+ * @return The number of characters printed
+ */
+int consolePrintf(const char *fmt, ...)
+    __attribute__ (( format(printf, 1, 2) ));
 
 #endif /*CONSOLE_H_*/
@@ -167,6 +167,7 @@ struct crtpLinkOperations
   int (*receivePacket)(CRTPPacket *pk);
   bool (*isConnected)(void);
   int (*reset)(void);
+  float (*telemetryRate)(void);
 };
 
 void crtpSetLink(struct crtpLinkOperations * lk);
@@ -179,6 +180,12 @@ void crtpSetLink(struct crtpLinkOperations * lk);
  */
 bool crtpIsConnected(void);
 
+/**
+ * Share of the periodic telemetry the link can take, 0 - 1. Links that do
+ * not control it take all of it.
+ */
+float crtpGetTelemetryRate(void);
+
 /**
  * Reset the CRTP communication by flushing all the queues that
  * contain packages.
@@ -27,11 +27,17 @@
 #define CRTP_COMMANDER_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "stabilizer_types.h"
 #include "crtp.h"
 
 void crtpCommanderInit(void);
 void crtpCommanderRpytDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk);
-void crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk);
+
+/**
+ * Decode a generic setpoint packet. Returns false if the packet is malformed
+ * or of an unknown type, the setpoint should then be ignored.
+ */
+bool crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk);
 
 #endif /* CRTP_COMMANDER_H_ */
@@ -67,4 +67,16 @@ void crtpCommanderHighLevelStop();
 // True if we have landed or emergency-stopped.
 bool crtpCommanderHighLevelIsStopped();
 
+// Commands for onboard clients, such as the mission executor. They apply
+// regardless of the group mask, and return 0 or an error as the CRTP
+// commands do.
+int crtpCommanderHighLevelTakeoff(float height, float duration);
+int crtpCommanderHighLevelLand(float height, float duration);
+int crtpCommanderHighLevelGoTo(bool relative, float x, float y, float z, float yaw, float duration);
+int crtpCommanderHighLevelStartTrajectory(uint8_t trajectoryId, float timescale, bool relative, bool reversed);
+
+// True when the current trajectory, takeoff, landing or go to has been flown
+// to its end, or if stopped.
+bool crtpCommanderHighLevelIsTrajectoryFinished(void);
+
 #endif /* CRTP_COMMANDER_HIGH_LEVEL_H_ */
@@ -80,4 +80,11 @@ void estimatorKalmanSetShift(float deltax, float deltay);
 
 void estimatorKalmanGetEstimatedPos(point_t* pos);
 
+/**
+ * Quality of the position estimate, 0 (no valid position) to 100. Based on the
+ * consistency of the measurement innovations, the covariance and the age of the
+ * aiding measurements.
+ */
+uint8_t estimatorKalmanGetPositionQuality();
+
 #endif // __ESTIMATOR_KALMAN_H__
\ No newline at end of file
@@ -0,0 +1,57 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lowpower.h - Tickless idle while on the ground
+ *
+ * When the stabilizer is not flying the RTOS tick is suppressed while all
+ * tasks are blocked, and the core sleeps until the next task is due or an
+ * interrupt wakes it up. In flight the tick runs as usual, so that the
+ * control loop timing is not affected.
+ */
+
+#ifndef __LOWPOWER_H__
+#define __LOWPOWER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Called by the kernel, see portSUPPRESS_TICKS_AND_SLEEP in FreeRTOSConfig.h.
+ * Returns without sleeping when the tickless idle is not allowed.
+ */
+void lowPowerSuppressTicksAndSleep(uint32_t expectedIdleTime);
+
+/**
+ * Called by the port with interrupts disabled right before and after the
+ * sleep, see configPRE_SLEEP_PROCESSING and configPOST_SLEEP_PROCESSING.
+ */
+void lowPowerPreSleep(uint32_t* idleTime);
+void lowPowerPostSleep(uint32_t idleTime);
+
+/**
+ * True when the Crazyflie is idle on the ground: not flying and no setpoint
+ * source active. The stabilizer then slows the sensor reads down.
+ */
+bool lowPowerIsIdle(void);
+
+#endif /* __LOWPOWER_H__ */
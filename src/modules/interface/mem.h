@@ -34,6 +34,7 @@
 #define MEM_SETTINGS_CH     0
 #define MEM_READ_CH         1
 #define MEM_WRITE_CH        2
+#define MEM_WINDOW_CH       3  // See mem_window.h
 
 #define MEM_CMD_GET_NBR     1
 #define MEM_CMD_GET_INFO    2
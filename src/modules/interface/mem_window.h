@@ -0,0 +1,119 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * mem_window.h - Windowed transfers for the memory port
+ *
+ * The read and write channels of the memory port move one packet per round
+ * trip. On the window channel a client instead streams a window of packets
+ * and gets one answer per window, with a CRC-32 (as crcSlow() in crc.h) to
+ * check the data. All values are little endian.
+ *
+ * Write:
+ *   -> WRITE_START  memId, uint32 addr, uint32 len, uint8 window
+ *   <- WRITE_START  status
+ *   -> WRITE_DATA   uint32 offset, data (up to MEM_WINDOW_MAX_DATA bytes)
+ *   <- WRITE_ACK    status, uint32 offset, uint32 crc
+ * The data is written in sequence, a packet is only written if its offset
+ * (from addr) is where the previous one ended, others are dropped. After
+ * every window of data packets, and when len bytes are written, a WRITE_ACK
+ * gives the number of bytes written so far and the CRC of them. The client
+ * continues from that offset, resending what was dropped. A SYNC is
+ * answered with a WRITE_ACK right away, to use when an ACK is lost.
+ *
+ * Read:
+ *   -> READ_START   memId, uint32 addr, uint32 len, uint8 window
+ *   <- READ_START   status
+ *   -> READ_WINDOW  uint32 offset
+ *   <- READ_DATA    uint32 offset, data   (up to window packets)
+ *   <- READ_END     status, uint32 end offset, uint32 crc of the window
+ * A client that misses a packet asks for the next window from the first
+ * offset it is missing.
+ *
+ * A status is 0 or an errno. A failed write stops the transfer, the
+ * following ACKs keep the status until a new transfer is started.
+ */
+
+#ifndef __MEM_WINDOW_H__
+#define __MEM_WINDOW_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MEM_WINDOW_CMD_WRITE_START 0
+#define MEM_WINDOW_CMD_WRITE_DATA  1
+#define MEM_WINDOW_CMD_WRITE_ACK   2
+#define MEM_WINDOW_CMD_SYNC        3
+#define MEM_WINDOW_CMD_READ_START  4
+#define MEM_WINDOW_CMD_READ_WINDOW 5
+#define MEM_WINDOW_CMD_READ_DATA   6
+#define MEM_WINDOW_CMD_READ_END    7
+
+// A CRTP packet, command and offset followed by the data
+#define MEM_WINDOW_PACKET_SIZE 30
+#define MEM_WINDOW_DATA_HEADER 5
+#define MEM_WINDOW_MAX_DATA    (MEM_WINDOW_PACKET_SIZE - MEM_WINDOW_DATA_HEADER)
+
+#define MEM_WINDOW_MAX_PACKETS 32
+
+typedef struct
+{
+  // Access one memory of the memory port, return 0 or an errno
+  uint8_t (*read)(uint8_t memId, uint32_t addr, uint8_t len, uint8_t* dest);
+  uint8_t (*write)(uint8_t memId, uint32_t addr, uint8_t len, const uint8_t* src);
+  // Send a packet on the window channel
+  void (*send)(const uint8_t* data, uint8_t size);
+} memWindowOps_t;
+
+typedef enum
+{
+  memWindowIdle = 0,
+  memWindowWriting,
+  memWindowReading,
+} memWindowMode_t;
+
+typedef struct
+{
+  const memWindowOps_t* ops;
+
+  memWindowMode_t mode;
+  uint8_t memId;
+  uint32_t addr;
+  uint32_t len;
+  uint8_t window;    // Packets
+  uint8_t status;
+
+  // Write
+  uint32_t offset;   // Bytes written
+  uint32_t crc;      // Of the bytes written, as a crcSlowUpdate() remainder
+  uint8_t received;  // Data packets since the last ACK
+} memWindow_t;
+
+void memWindowInit(memWindow_t* mw, const memWindowOps_t* ops);
+
+/**
+ * Handle a packet received on the window channel, the answers are sent
+ * through ops->send().
+ */
+void memWindowHandlePacket(memWindow_t* mw, const uint8_t* data, uint8_t size);
+
+#endif /* __MEM_WINDOW_H__ */
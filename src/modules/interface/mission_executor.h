@@ -0,0 +1,54 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * mission_executor.h - Runs a mission from the uSD card without the radio
+ *
+ * The mission file (see mission.h) is loaded at start up by the uSD deck and
+ * started with the START_MISSION command of the high-level commander, which
+ * can be broadcast to start a swarm at once. From then on the mission runs
+ * without the radio, with its time counted from the start command. The
+ * high-level commander must be enabled, parameter commander.enHighLevel.
+ */
+
+#ifndef __MISSION_EXECUTOR_H__
+#define __MISSION_EXECUTOR_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void missionExecutorInit(void);
+bool missionExecutorTest(void);
+
+/**
+ * Load a mission file, see missionLoad().
+ * @return 0 or an error, ENODEV if not initialized.
+ */
+int missionExecutorLoad(const uint8_t* data, uint32_t len);
+
+/**
+ * Start the loaded mission, mission time 0 is now.
+ * @return 0 or an error, ENOENT without a mission.
+ */
+int missionExecutorStart(void);
+
+#endif /* __MISSION_EXECUTOR_H__ */
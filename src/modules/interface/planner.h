@@ -68,6 +68,10 @@ void plan_stop(struct planner *p);
 // and also after an emergency stop.
 bool plan_is_stopped(struct planner *p);
 
+// query if the current trajectory has been flown to its end,
+// or if the planner is stopped.
+bool plan_is_finished(struct planner *p, float t);
+
 // get the planner's current goal.
 struct traj_eval plan_current_goal(struct planner *p, float t);
 
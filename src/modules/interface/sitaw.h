@@ -38,6 +38,9 @@ bool sitAwARTest(float accX, float accY, float accZ);
 bool sitAwARDetected(void);
 bool sitAwTuTest(float eulerRollActual, float eulerPitchActual);
 bool sitAwTuDetected(void);
+bool sitAwPQTest(uint8_t positionQuality);
+bool sitAwPQHoldDetected(void);
+bool sitAwPQLandDetected(void);
 void sitAwInit(void);
 void sitAwUpdateSetpoint(setpoint_t *setpoint, const sensorData_t *sensorData,
                                                const state_t *state);
@@ -47,6 +50,7 @@ void sitAwUpdateSetpoint(setpoint_t *setpoint, const sensorData_t *sensorData,
 //#define SITAW_FF_ENABLED           /* Uncomment to enable */
 //#define SITAW_AR_ENABLED           /* Uncomment to enable */
 #define SITAW_TU_ENABLED           /* Uncomment to enable */
+//#define SITAW_PQ_ENABLED           /* Uncomment to enable */
 
 /* Configuration options for the 'Free Fall' detection. */
 #define SITAW_FF_THRESHOLD 0.1     /* The default tolerance for AccWZ deviations from -1, indicating Free Fall. */
@@ -60,17 +64,25 @@ void sitAwUpdateSetpoint(setpoint_t *setpoint, const sensorData_t *sensorData,
 #define SITAW_TU_THRESHOLD 60      /* The minimum roll angle indicating a Tumbled situation. */
 #define SITAW_TU_TRIGGER_COUNT 15  /* The number of consecutive tests for Tumbled to be detected. Configured for 250Hz testing. */
 
+/* Configuration options for the 'Position Quality' detection. Requires the Kalman estimator. */
+#define SITAW_PQ_HOLD_THRESHOLD 40    /* Position quality (0-100) at or below which the horizontal position is held. */
+#define SITAW_PQ_LAND_THRESHOLD 10    /* Position quality (0-100) at or below which the Crazyflie lands. */
+#define SITAW_PQ_TRIGGER_COUNT 500    /* The number of consecutive tests for a poor position to be detected. Configured for 1000Hz testing. */
+#define SITAW_PQ_LAND_VELOCITY 0.3f   /* The descent velocity (m/s) when landing due to a poor position. */
+
 /* LOG configurations. Enable these to be able to log detection in the cfclient. */
 #define SITAW_LOG_ENABLED            /* Uncomment to enable LOG framework. */
 //#define SITAW_FF_LOG_ENABLED       /* Uncomment to enable LOG framework for the Free Fall detection trigger object. */
 //#define SITAW_AR_LOG_ENABLED       /* Uncomment to enable LOG framework for the At Rest detection trigger object. */
 //#define SITAW_TU_LOG_ENABLED       /* Uncomment to enable LOG framework for the Tumbled detection trigger object. */
 #define SITAW_LOG_ALL_DETECT_ENABLED /* Uncomment to enable LOG framework for all 'Detected' flags. */
+//#define SITAW_PQ_LOG_ENABLED       /* Uncomment to enable LOG framework for the Position Quality detection trigger objects. */
 
 /* PARAM configurations. Enable these to be able to tweak detection configurations from the cfclient. */
 //#define SITAW_PARAM_ENABLED        /* Uncomment to enable PARAM framework. */
 //#define SITAW_FF_PARAM_ENABLED     /* Uncomment to enable PARAM framework for the Free Fall detection. */
 //#define SITAW_AR_PARAM_ENABLED     /* Uncomment to enable PARAM framework for the At Rest detection. */
 //#define SITAW_TU_PARAM_ENABLED     /* Uncomment to enable PARAM framework for the Tumbled detection. */
+//#define SITAW_PQ_PARAM_ENABLED     /* Uncomment to enable PARAM framework for the Position Quality detection. */
 
 #endif
@@ -0,0 +1,78 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * spectrum.h - Averaged power spectra of the gyro and accelerometer
+ *
+ * A measurement is started with the parameter spectrum.start. Windows of
+ * spectrum.size samples (Hann window) are captured from the unfiltered
+ * sensor data, alternating between the gyro and the accelerometer axes, and
+ * their power spectral densities are averaged until spectrum.windows windows
+ * per axis are done.
+ *
+ * The result is read through the memory subsystem, little endian:
+ *   0: uint8   version (SPECTRUM_MEM_VERSION)
+ *   1: uint8   state, see spectrumState_t
+ *   2: uint16  FFT size
+ *   4: uint16  windows averaged so far
+ *   6: uint16  number of bins (size / 2), bin k is at k * sampleRate / size
+ *   8: float   sample rate (Hz)
+ *  12: float   psd[6][SPECTRUM_MAX_SIZE / 2], the first bins values of every row are used.
+ *              Gyro x, y, z in (deg/s)^2/Hz then acc x, y, z in g^2/Hz.
+ */
+
+#ifndef __SPECTRUM_H__
+#define __SPECTRUM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stabilizer_types.h"
+
+#define SPECTRUM_MEM_VERSION 1
+#define SPECTRUM_MAX_SIZE    256
+#define SPECTRUM_AXES        6
+#define SPECTRUM_HEADER_SIZE 12
+#define SPECTRUM_MEM_SIZE    (SPECTRUM_HEADER_SIZE + SPECTRUM_AXES * (SPECTRUM_MAX_SIZE / 2) * sizeof(float))
+
+typedef enum
+{
+  spectrumStateIdle = 0,
+  spectrumStateMeasuring,
+  spectrumStateDone,
+} spectrumState_t;
+
+void spectrumInit(void);
+bool spectrumTest(void);
+
+/**
+ * Feed one sample of unfiltered sensor data, called from the sensor task at
+ * the IMU rate. Only copies the sample while a window is captured.
+ */
+void spectrumAddSample(const Axis3f* gyro, const Axis3f* acc);
+
+/**
+ * Read the result, see the layout above.
+ */
+bool spectrumReadMem(uint32_t memAddr, uint8_t readLen, uint8_t* dest);
+
+#endif /* __SPECTRUM_H__ */
@@ -46,6 +46,12 @@ void stabilizerInit(StateEstimatorType estimator);
  */
 bool stabilizerTest(void);
 
+/**
+ * True while the motors are given thrust, and for a while after. Safe to
+ * call from any context.
+ */
+bool stabilizerIsFlying(void);
+
 /**
  * Enable emergency stop, will shut-off energy to the motors.
  */
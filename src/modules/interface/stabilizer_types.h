@@ -130,6 +130,10 @@ typedef struct sensorData_s {
   Axis3f gyroSec;           // deg/s
 #endif
   uint64_t interruptTimestamp;
+  uint64_t accTimestamp;    // us, acquisition time of the samples
+  uint64_t gyroTimestamp;
+  uint64_t magTimestamp;
+  uint64_t baroTimestamp;
 } sensorData_t;
 
 typedef struct state_s {
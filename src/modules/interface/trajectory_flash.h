@@ -0,0 +1,60 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * trajectory_flash.h - Trajectories stored in a reserved flash sector
+ *
+ * The last sector of the flash (sector 11, 128 KB) is kept out of the
+ * firmware by the linker scripts and holds an image of trajectories that
+ * survives a power cycle, see trajectoryStore.h for the layout. The image is
+ * uploaded and read back through the memory subsystem. The trajectories of
+ * the index are defined in the high level commander at startup, with their
+ * pieces evaluated straight from flash.
+ *
+ * Erasing the sector stalls the CPU for 1-2 s, the flash is single bank.
+ * Uploads are therefore only accepted on the ground: with the high level
+ * commander stopped and the motors off. Otherwise a write answers EBUSY.
+ */
+
+#ifndef __TRAJECTORY_FLASH_H__
+#define __TRAJECTORY_FLASH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "trajectoryStore.h"
+
+#define TRAJECTORY_FLASH_ADDRESS 0x080E0000
+#define TRAJECTORY_FLASH_SIZE    (128 * 1024)
+
+void trajectoryFlashInit(void);
+bool trajectoryFlashTest(void);
+
+/**
+ * Memory subsystem access, the write returns 0 or an errno as status.
+ */
+bool trajectoryFlashReadMem(uint32_t memAddr, uint8_t readLen, uint8_t* dest);
+uint8_t trajectoryFlashWriteMem(uint32_t memAddr, uint8_t writeLen, const uint8_t* src);
+
+const trajectoryStore_t* trajectoryFlashGetStore(void);
+
+#endif /* __TRAJECTORY_FLASH_H__ */
@@ -25,12 +25,15 @@
  */
 
 #include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
 
 /*FreeRtos includes*/
 #include "FreeRTOS.h"
 #include "semphr.h"
 
 #include "crtp.h"
+#include "console.h"
 
 #ifdef STM32F40_41xxx
 #include "stm32f4xx.h"
@@ -41,6 +44,9 @@
 #endif
 #endif
 
+// Fits most debug lines, longer ones are printed a character at a time
+#define CONSOLE_PRINTF_BUFFER_SIZE 64
+
 CRTPPacket messageToPrint;
 xSemaphoreHandle synch = NULL;
 
@@ -83,9 +89,35 @@ bool consoleTest(void)
   return isInit;
 }
 
-int consolePutchar(int ch)
+/**
+ * Add a character to the message, sending it at the end of a line or when
+ * full. Called with synch taken.
+ */
+static void consoleAddToMessage(int ch)
 {
   int i;
+
+  if (messageToPrint.size < CRTP_MAX_DATA_SIZE)
+  {
+    messageToPrint.data[messageToPrint.size] = (unsigned char)ch;
+    messageToPrint.size++;
+  }
+  if (ch == '\n' || messageToPrint.size >= CRTP_MAX_DATA_SIZE)
+  {
+    if (crtpGetFreeTxQueuePackets() == 1)
+    {
+      for (i = 0; i < sizeof(fullMsg) && (messageToPrint.size - i) > 0; i++)
+      {
+        messageToPrint.data[messageToPrint.size - i] =
+            (uint8_t)fullMsg[sizeof(fullMsg) - i - 1];
+      }
+    }
+    consoleSendMessage();
+  }
+}
+
+int consolePutchar(int ch)
+{
   bool isInInterrupt = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
 
   if (!isInit) {
@@ -98,27 +130,64 @@ int consolePutchar(int ch)
 
   if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
   {
-    if (messageToPrint.size < CRTP_MAX_DATA_SIZE)
+    consoleAddToMessage(ch);
+    xSemaphoreGive(synch);
+  }
+
+  return (unsigned char)ch;
+}
+
+int consolePutn(const char *str, int len)
+{
+  int i;
+  bool isInInterrupt = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
+
+  if (!isInit) {
+    return 0;
+  }
+
+  if (isInInterrupt) {
+    for (i = 0; i < len; i++)
     {
-      messageToPrint.data[messageToPrint.size] = (unsigned char)ch;
-      messageToPrint.size++;
+      consolePutcharFromISR(str[i]);
     }
-    if (ch == '\n' || messageToPrint.size >= CRTP_MAX_DATA_SIZE)
+    return len;
+  }
+
+  if (xSemaphoreTake(synch, portMAX_DELAY) == pdTRUE)
+  {
+    for (i = 0; i < len; i++)
     {
-      if (crtpGetFreeTxQueuePackets() == 1)
-      {
-        for (i = 0; i < sizeof(fullMsg) && (messageToPrint.size - i) > 0; i++)
-        {
-          messageToPrint.data[messageToPrint.size - i] =
-              (uint8_t)fullMsg[sizeof(fullMsg) - i - 1];
-        }
-      }
-      consoleSendMessage();
+      consoleAddToMessage(str[i]);
     }
     xSemaphoreGive(synch);
   }
 
-  return (unsigned char)ch;
+  return len;
+}
+
+int consolePrintf(const char *fmt, ...)
+{
+  char buffer[CONSOLE_PRINTF_BUFFER_SIZE];
+  va_list ap;
+  int len;
+
+  va_start(ap, fmt);
+  len = evsnprintf(buffer, sizeof(buffer), fmt, ap);
+  va_end(ap);
+
+  if (len < (int)sizeof(buffer))
+  {
+    consolePutn(buffer, len);
+  }
+  else
+  {
+    va_start(ap, fmt);
+    len = evprintf(consolePutchar, (char *)fmt, ap);
+    va_end(ap);
+  }
+
+  return len;
 }
 
 int consolePutcharFromISR(int ch) {
@@ -138,12 +207,7 @@ int consolePutcharFromISR(int ch) {
 
 int consolePuts(char *str)
 {
-  int ret = 0;
-
-  while(*str)
-    ret |= consolePutchar(*str++);
-
-  return ret;
+  return consolePutn(str, strlen(str));
 }
 
 void consoleFlush(void)
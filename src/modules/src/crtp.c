@@ -247,6 +247,13 @@ bool crtpIsConnected(void)
   return true;
 }
 
+float crtpGetTelemetryRate(void)
+{
+  if (link->telemetryRate)
+    return link->telemetryRate();
+  return 1.0f;
+}
+
 void crtpSetLink(struct crtpLinkOperations * lk)
 {
   if(link)
@@ -56,7 +56,8 @@ static void commanderCrtpCB(CRTPPacket* pk)
     crtpCommanderRpytDecodeSetpoint(&setpoint, pk);
     commanderSetSetpoint(&setpoint, COMMANDER_PRIORITY_CRTP);
   } else if (pk->port == CRTP_PORT_SETPOINT_GENERIC && pk->channel == 0) {
-    crtpCommanderGenericDecodeSetpoint(&setpoint, pk);
-    commanderSetSetpoint(&setpoint, COMMANDER_PRIORITY_CRTP);
+    if (crtpCommanderGenericDecodeSetpoint(&setpoint, pk)) {
+      commanderSetSetpoint(&setpoint, COMMANDER_PRIORITY_CRTP);
+    }
   }
 }
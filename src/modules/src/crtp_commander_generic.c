@@ -53,13 +53,14 @@
 /* To add a new packet:
  *   1 - Add a new type in the packetType_e enum.
  *   2 - Implement a decoder function with good documentation about the data
- *       structure and the intent of the packet.
+ *       structure and the intent of the packet. The data comes straight from
+ *       the radio, check the length before using it.
  *   3 - Add the decoder function to the packetDecoders array.
  *   4 - Create a new params group for your handler if necessary
  *   5 - Pull-request your change :-)
  */
 
-typedef void (*packetDecoder_t)(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen);
+typedef bool (*packetDecoder_t)(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen);
 
 /* ---===== 1 - packetType_e enum =====--- */
 enum packet_type {
@@ -75,15 +76,16 @@ enum packet_type {
 
 /* ---===== 2 - Decoding functions =====--- */
 /* The setpoint structure is reinitialized to 0 before being passed to the
- * functions
+ * functions. The functions return false if the packet does not have the
+ * expected size, the setpoint is then not used.
  */
 
 /* stopDecoder
  * Keeps setpoint to 0: stops the motors and fall
  */
-static void stopDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool stopDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
-  return;
+  return true;
 }
 
 /* velocityDecoder
@@ -95,11 +97,13 @@ struct velocityPacket_s {
   float vz;        // ...
   float yawrate;  // deg/s
 } __attribute__((packed));
-static void velocityDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool velocityDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
   const struct velocityPacket_s *values = data;
 
-  ASSERT(datalen == sizeof(struct velocityPacket_s));
+  if (datalen != sizeof(struct velocityPacket_s)) {
+    return false;
+  }
 
   setpoint->mode.x = modeVelocity;
   setpoint->mode.y = modeVelocity;
@@ -112,6 +116,8 @@ static void velocityDecoder(setpoint_t *setpoint, uint8_t type, const void *data
   setpoint->mode.yaw = modeVelocity;
 
   setpoint->attitudeRate.yaw = -values->yawrate;
+
+  return true;
 }
 
 /* zDistanceDecoder
@@ -123,12 +129,14 @@ struct zDistancePacket_s {
   float yawrate;         // deg/s
   float zDistance;        // m in the world frame of reference
 } __attribute__((packed));
-static void zDistanceDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool zDistanceDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
   const struct zDistancePacket_s *values = data;
 
 
-  ASSERT(datalen == sizeof(struct zDistancePacket_s));
+  if (datalen != sizeof(struct zDistancePacket_s)) {
+    return false;
+  }
 
   setpoint->mode.z = modeAbs;
 
@@ -145,6 +153,8 @@ static void zDistanceDecoder(setpoint_t *setpoint, uint8_t type, const void *dat
 
   setpoint->attitude.roll = values->roll;
   setpoint->attitude.pitch = values->pitch;
+
+  return true;
 }
 
 /* cppmEmuDecoder
@@ -183,13 +193,17 @@ static inline float getChannelUnitMultiplier(uint16_t channelValue, uint16_t cha
   return ((float)channelValue - (float)channelMidpoint) / (float)channelRange;
 }
 
-static void cppmEmuDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool cppmEmuDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
   bool isSelfLevelEnabled = true;
 
-  ASSERT(datalen >= 9); // minimum 9 bytes expected - 1byte header + four 2byte channels
+  if (datalen < 9) { // minimum 9 bytes expected - 1byte header + four 2byte channels
+    return false;
+  }
   const struct cppmEmuPacket_s *values = data;
-  ASSERT(datalen == 9 + (2*values->hdr.numAuxChannels)); // Total size is 9 + number of active aux channels
+  if (datalen != 9 + (2*values->hdr.numAuxChannels)) { // Total size is 9 + number of active aux channels
+    return false;
+  }
 
   // Aux channel 0 is reserved for enabling/disabling self-leveling
   // If it's in use, check and see if it's set and enable self-leveling.
@@ -230,6 +244,8 @@ static void cppmEmuDecoder(setpoint_t *setpoint, uint8_t type, const void *data,
   {
     setpoint->thrust = 0;
   }
+
+  return true;
 }
 
 /* altHoldDecoder
@@ -241,11 +257,13 @@ struct altHoldPacket_s {
   float yawrate;         // deg/s
   float zVelocity;       // m/s in the world frame of reference
 } __attribute__((packed));
-static void altHoldDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool altHoldDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
   const struct altHoldPacket_s *values = data;
 
-  ASSERT(datalen == sizeof(struct altHoldPacket_s));
+  if (datalen != sizeof(struct altHoldPacket_s)) {
+    return false;
+  }
 
 
   setpoint->mode.z = modeVelocity;
@@ -263,6 +281,8 @@ static void altHoldDecoder(setpoint_t *setpoint, uint8_t type, const void *data,
 
   setpoint->attitude.roll = values->roll;
   setpoint->attitude.pitch = values->pitch;
+
+  return true;
 }
 
 /* hoverDecoder
@@ -274,11 +294,13 @@ struct hoverPacket_s {
   float yawrate;      // deg/s
   float zDistance;    // m in the world frame of reference
 } __attribute__((packed));
-static void hoverDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool hoverDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
   const struct hoverPacket_s *values = data;
 
-  ASSERT(datalen == sizeof(struct hoverPacket_s));
+  if (datalen != sizeof(struct hoverPacket_s)) {
+    return false;
+  }
 
   setpoint->mode.z = modeAbs;
   setpoint->position.z = values->zDistance;
@@ -294,6 +316,8 @@ static void hoverDecoder(setpoint_t *setpoint, uint8_t type, const void *data, s
   setpoint->velocity.y = values->vy;
 
   setpoint->velocity_body = true;
+
+  return true;
 }
 
 struct fullStatePacket_s {
@@ -311,11 +335,13 @@ struct fullStatePacket_s {
   int16_t ratePitch; //  (NOTE: limits to about 5 full circles per sec.
   int16_t rateYaw;   //   may not be enough for extremely aggressive flight.)
 } __attribute__((packed));
-static void fullStateDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool fullStateDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
   const struct fullStatePacket_s *values = data;
 
-  ASSERT(datalen == sizeof(struct fullStatePacket_s));
+  if (datalen != sizeof(struct fullStatePacket_s)) {
+    return false;
+  }
 
   #define UNPACK(x) \
   setpoint->mode.x = modeAbs; \
@@ -338,6 +364,8 @@ static void fullStateDecoder(setpoint_t *setpoint, uint8_t type, const void *dat
   setpoint->mode.roll = modeDisable;
   setpoint->mode.pitch = modeDisable;
   setpoint->mode.yaw = modeDisable;
+
+  return true;
 }
 
 /* positionDecoder
@@ -349,10 +377,14 @@ static void fullStateDecoder(setpoint_t *setpoint, uint8_t type, const void *dat
    float z;
    float yaw;   // Orientation in degree
  } __attribute__((packed));
-static void positionDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
+static bool positionDecoder(setpoint_t *setpoint, uint8_t type, const void *data, size_t datalen)
 {
   const struct positionPacket_s *values = data;
 
+  if (datalen != sizeof(struct positionPacket_s)) {
+    return false;
+  }
+
   setpoint->mode.x = modeAbs;
   setpoint->mode.y = modeAbs;
   setpoint->mode.z = modeAbs;
@@ -365,6 +397,8 @@ static void positionDecoder(setpoint_t *setpoint, uint8_t type, const void *data
   setpoint->mode.yaw = modeAbs;
 
   setpoint->attitude.yaw = values->yaw;
+
+  return true;
 }
 
  /* ---===== 3 - packetDecoders array =====--- */
@@ -380,11 +414,13 @@ const static packetDecoder_t packetDecoders[] = {
 };
 
 /* Decoder switch */
-void crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk)
+bool crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk)
 {
   static int nTypes = -1;
 
-  ASSERT(pk->size > 0);
+  if (pk->size == 0) {
+    return false;
+  }
 
   if (nTypes<0) {
     nTypes = sizeof(packetDecoders)/sizeof(packetDecoders[0]);
@@ -395,8 +431,10 @@ void crtpCommanderGenericDecodeSetpoint(setpoint_t *setpoint, CRTPPacket *pk)
   memset(setpoint, 0, sizeof(setpoint_t));
 
   if (type<nTypes && (packetDecoders[type] != NULL)) {
-    packetDecoders[type](setpoint, type, ((char*)pk->data)+1, pk->size-1);
+    return packetDecoders[type](setpoint, type, ((char*)pk->data)+1, pk->size-1);
   }
+
+  return false;
 }
 
 // Params for generic CRTP handlers
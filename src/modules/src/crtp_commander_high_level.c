@@ -54,12 +54,15 @@ such as: take-off, landing, polynomial trajectories.
 #include "planner.h"
 #include "log.h"
 #include "param.h"
+#include "trajectory_flash.h"
+#include "mission_executor.h"
 
 // Local types
 enum TrajectoryLocation_e {
   TRAJECTORY_LOCATION_INVALID = 0,
   TRAJECTORY_LOCATION_MEM     = 1, // for trajectories that are uploaded dynamically
-  // Future features might include trajectories on flash or uSD card
+  TRAJECTORY_LOCATION_FLASH   = 2, // for trajectories stored in flash, see trajectory_flash.h
+  // Future features might include trajectories on uSD card
 };
 
 enum TrajectoryType_e {
@@ -77,11 +80,15 @@ struct trajectoryDescription
       uint32_t offset;  // offset in uploaded memory
       uint8_t n_pieces;
     } __attribute__((packed)) mem; // if trajectoryLocation is TRAJECTORY_LOCATION_MEM
+    struct {
+      uint32_t offset;  // offset in the stored image
+      uint8_t n_pieces;
+    } __attribute__((packed)) flash; // if trajectoryLocation is TRAJECTORY_LOCATION_FLASH
   } trajectoryIdentifier;
 } __attribute__((packed));
 
 // Global variables
-uint8_t trajectories_memory[TRAJECTORY_MEMORY_SIZE];
+uint8_t trajectories_memory[TRAJECTORY_MEMORY_SIZE] __attribute__((aligned(4)));
 static struct trajectoryDescription trajectory_descriptions[NUM_TRAJECTORY_DEFINITIONS];
 
 static bool isInit = false;
@@ -105,6 +112,7 @@ enum TrajectoryCommand_e {
   COMMAND_GO_TO                   = 4,
   COMMAND_START_TRAJECTORY        = 5,
   COMMAND_DEFINE_TRAJECTORY       = 6,
+  COMMAND_START_MISSION           = 7,
 };
 
 struct data_set_group_mask {
@@ -156,6 +164,24 @@ struct data_define_trajectory {
   struct trajectoryDescription description;
 } __attribute__((packed));
 
+// starts the onboard mission, see mission_executor.h. Broadcast to start a
+// swarm at the same time.
+struct data_start_mission {
+  uint8_t groupMask; // mask for which CFs this should apply to
+} __attribute__((packed));
+
+// size of the data following the command byte
+static const uint8_t commandDataSize[] = {
+  [COMMAND_SET_GROUP_MASK]    = sizeof(struct data_set_group_mask),
+  [COMMAND_TAKEOFF]           = sizeof(struct data_takeoff),
+  [COMMAND_LAND]              = sizeof(struct data_land),
+  [COMMAND_STOP]              = sizeof(struct data_stop),
+  [COMMAND_GO_TO]             = sizeof(struct data_go_to),
+  [COMMAND_START_TRAJECTORY]  = sizeof(struct data_start_trajectory),
+  [COMMAND_DEFINE_TRAJECTORY] = sizeof(struct data_define_trajectory),
+  [COMMAND_START_MISSION]     = sizeof(struct data_start_mission),
+};
+
 // Private functions
 static void crtpCommanderHighLevelTask(void * prm);
 
@@ -166,8 +192,23 @@ static int stop(const struct data_stop* data);
 static int go_to(const struct data_go_to* data);
 static int start_trajectory(const struct data_start_trajectory* data);
 static int define_trajectory(const struct data_define_trajectory* data);
+static int start_mission(const struct data_start_mission* data);
+static void define_stored_trajectories(void);
 
 // Helper functions
+static bool isCommandComplete(const CRTPPacket* p)
+{
+  if (p->size < 1) {
+    return false;
+  }
+  uint8_t command = p->data[0];
+  if (command >= sizeof(commandDataSize)) {
+    // unknown commands are answered with ENOEXEC
+    return true;
+  }
+  return p->size >= 1 + commandDataSize[command];
+}
+
 static struct vec state2vec(struct vec3_s v)
 {
   return mkvec(v.x, v.y, v.z);
@@ -191,6 +232,9 @@ void crtpCommanderHighLevelInit(void)
 
   lockTraj = xSemaphoreCreateMutex();
 
+  trajectoryFlashInit();
+  define_stored_trajectories();
+
   pos = vzero();
   yaw = 0;
 
@@ -261,6 +305,14 @@ void crtpCommanderHighLevelTask(void * prm)
   while(1) {
     crtpReceivePacketBlock(CRTP_PORT_SETPOINT_HL, &p);
 
+    if (!isCommandComplete(&p)) {
+      // the data comes straight from the radio, do not use what was not sent
+      p.data[3] = EINVAL;
+      p.size = 4;
+      crtpSendPacket(&p);
+      continue;
+    }
+
     switch(p.data[0])
     {
       case COMMAND_SET_GROUP_MASK:
@@ -284,6 +336,9 @@ void crtpCommanderHighLevelTask(void * prm)
       case COMMAND_DEFINE_TRAJECTORY:
         ret = define_trajectory((const struct data_define_trajectory*)&p.data[1]);
         break;
+      case COMMAND_START_MISSION:
+        ret = start_mission((const struct data_start_mission*)&p.data[1]);
+        break;
       default:
         ret = ENOEXEC;
         break;
@@ -357,14 +412,30 @@ int start_trajectory(const struct data_start_trajectory* data)
   if (isInGroup(data->groupMask)) {
     if (data->trajectoryId < NUM_TRAJECTORY_DEFINITIONS) {
       struct trajectoryDescription* trajDesc = &trajectory_descriptions[data->trajectoryId];
+      const struct poly4d* pieces = NULL;
+      uint8_t n_pieces = 0;
       if (   trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_MEM
           && trajDesc->trajectoryType == TRAJECTORY_TYPE_POLY4D) {
+        n_pieces = trajDesc->trajectoryIdentifier.mem.n_pieces;
+        pieces = (struct poly4d*)&trajectories_memory[trajDesc->trajectoryIdentifier.mem.offset];
+      }
+      else if (   trajDesc->trajectoryLocation == TRAJECTORY_LOCATION_FLASH
+               && trajDesc->trajectoryType == TRAJECTORY_TYPE_POLY4D) {
+        // the stored image may have been replaced since the definition
+        n_pieces = trajDesc->trajectoryIdentifier.flash.n_pieces;
+        pieces = trajectoryStoreGetData(trajectoryFlashGetStore(),
+          trajDesc->trajectoryIdentifier.flash.offset, n_pieces * sizeof(struct poly4d));
+        if (pieces == NULL) {
+          return ENOENT;
+        }
+      }
+      if (pieces != NULL) {
         xSemaphoreTake(lockTraj, portMAX_DELAY);
         float t = usecTimestamp() / 1e6;
         trajectory.t_begin = t;
         trajectory.timescale = data->timescale;
-        trajectory.n_pieces = trajDesc->trajectoryIdentifier.mem.n_pieces;
-        trajectory.pieces = (struct poly4d*)&trajectories_memory[trajDesc->trajectoryIdentifier.mem.offset];
+        trajectory.n_pieces = n_pieces;
+        trajectory.pieces = (struct poly4d*)pieces;
         if (data->relative) {
           trajectory.shift = vzero();
           struct traj_eval traj_init;
@@ -381,7 +452,12 @@ int start_trajectory(const struct data_start_trajectory* data)
         }
         result = plan_start_trajectory(&planner, &trajectory, data->reversed);
         xSemaphoreGive(lockTraj);
+      } else {
+        // not defined
+        result = ENOENT;
       }
+    } else {
+      result = ENOENT;
     }
   }
   return result;
@@ -392,6 +468,112 @@ int define_trajectory(const struct data_define_trajectory* data)
   if (data->trajectoryId >= NUM_TRAJECTORY_DEFINITIONS) {
     return ENOEXEC;
   }
-  trajectory_descriptions[data->trajectoryId] = data->description;
+
+  const struct trajectoryDescription* description = &data->description;
+  if (description->trajectoryLocation == TRAJECTORY_LOCATION_MEM) {
+    // the pieces must be inside the trajectory memory, and word aligned since
+    // they are evaluated through float pointers
+    uint32_t offset = description->trajectoryIdentifier.mem.offset;
+    uint32_t size = description->trajectoryIdentifier.mem.n_pieces * sizeof(struct poly4d);
+    if (   description->trajectoryType != TRAJECTORY_TYPE_POLY4D
+        || description->trajectoryIdentifier.mem.n_pieces == 0
+        || offset > TRAJECTORY_MEMORY_SIZE
+        || size > TRAJECTORY_MEMORY_SIZE - offset
+        || (offset % sizeof(float)) != 0) {
+      return EINVAL;
+    }
+  }
+  else if (description->trajectoryLocation == TRAJECTORY_LOCATION_FLASH) {
+    // the pieces are checked against the stored image when started
+    if (   description->trajectoryType != TRAJECTORY_TYPE_POLY4D
+        || description->trajectoryIdentifier.flash.n_pieces == 0
+        || (description->trajectoryIdentifier.flash.offset % sizeof(float)) != 0) {
+      return EINVAL;
+    }
+  }
+
+  trajectory_descriptions[data->trajectoryId] = *description;
   return 0;
 }
+
+int start_mission(const struct data_start_mission* data)
+{
+  int result = 0;
+  if (isInGroup(data->groupMask)) {
+    result = missionExecutorStart();
+  }
+  return result;
+}
+
+// defines the trajectories in the index of the stored image
+static void define_stored_trajectories(void)
+{
+  const trajectoryStore_t* store = trajectoryFlashGetStore();
+  for (int i = 0; i < trajectoryStoreCount(store); i++) {
+    trajectoryStoreEntry_t entry;
+    if (!trajectoryStoreGetEntry(store, i, &entry)
+        || entry.size != entry.n_pieces * sizeof(struct poly4d)) {
+      continue;
+    }
+
+    struct data_define_trajectory data = {
+      .trajectoryId = entry.trajectoryId,
+      .description = {
+        .trajectoryLocation = TRAJECTORY_LOCATION_FLASH,
+        .trajectoryType = entry.type,
+        .trajectoryIdentifier.flash = {
+          .offset = entry.offset,
+          .n_pieces = entry.n_pieces,
+        },
+      },
+    };
+    define_trajectory(&data);
+  }
+}
+
+// Onboard clients, the group mask does not apply
+
+int crtpCommanderHighLevelTakeoff(float height, float duration)
+{
+  struct data_takeoff data = {.height = height, .duration = duration};
+  return takeoff(&data);
+}
+
+int crtpCommanderHighLevelLand(float height, float duration)
+{
+  struct data_land data = {.height = height, .duration = duration};
+  return land(&data);
+}
+
+int crtpCommanderHighLevelGoTo(bool relative, float x, float y, float z, float yaw, float duration)
+{
+  struct data_go_to data = {
+    .relative = relative,
+    .x = x,
+    .y = y,
+    .z = z,
+    .yaw = yaw,
+    .duration = duration,
+  };
+  return go_to(&data);
+}
+
+int crtpCommanderHighLevelStartTrajectory(uint8_t trajectoryId, float timescale, bool relative, bool reversed)
+{
+  struct data_start_trajectory data = {
+    .relative = relative,
+    .reversed = reversed,
+    .trajectoryId = trajectoryId,
+    .timescale = timescale,
+  };
+  return start_trajectory(&data);
+}
+
+bool crtpCommanderHighLevelIsTrajectoryFinished(void)
+{
+  xSemaphoreTake(lockTraj, portMAX_DELAY);
+  float t = usecTimestamp() / 1e6;
+  bool result = plan_is_finished(&planner, t);
+  xSemaphoreGive(lockTraj);
+  return result;
+}
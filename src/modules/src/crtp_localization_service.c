@@ -116,6 +116,7 @@ static void locSrvCrtpCB(CRTPPacket* pk)
       break;
     case GENERIC_TYPE:
       genericLocHandle(pk);
+      break;
     case EXT_POSITION_PACKED:
       extPositionPackedHandler(pk);
     default:
@@ -125,6 +126,10 @@ static void locSrvCrtpCB(CRTPPacket* pk)
 
 static void extPositionHandler(CRTPPacket* pk)
 {
+  if (pk->size < sizeof(struct CrtpExtPosition)) {
+    return;
+  }
+
   crtpExtPosCache.targetVal[!crtpExtPosCache.activeSide] = *((struct CrtpExtPosition*)pk->data);
   crtpExtPosCache.activeSide = !crtpExtPosCache.activeSide;
   crtpExtPosCache.timestamp = xTaskGetTickCount();
@@ -132,8 +137,8 @@ static void extPositionHandler(CRTPPacket* pk)
 
 static void genericLocHandle(CRTPPacket* pk)
 {
-  uint8_t type = pk->data[0];
   if (pk->size < 1) return;
+  uint8_t type = pk->data[0];
 
   if (type == LPS_SHORT_LPP_PACKET && pk->size >= 2) {
     bool success = lpsSendLppShort(pk->data[1], &pk->data[2], pk->size-2);
@@ -11,9 +11,15 @@
 #define POS_UPDATE_RATE RATE_100_HZ
 #define POS_UPDATE_DT 1.0/POS_UPDATE_RATE
 
+// Longest gyro sample span accepted as attitude time step
+#define ATTITUDE_MAX_DT (0.1f)
+
+static uint64_t lastAttitudeTimestamp;
+
 void estimatorComplementaryInit(void)
 {
   sensfusion6Init();
+  lastAttitudeTimestamp = 0;
 }
 
 bool estimatorComplementaryTest(void)
@@ -29,9 +35,19 @@ void estimatorComplementary(state_t *state, sensorData_t *sensorData, control_t
 {
   sensorsAcquire(sensorData, tick); // Read sensors at full rate (1000Hz)
   if (RATE_DO_EXECUTE(ATTITUDE_UPDATE_RATE, tick)) {
+    // Use the time between the gyro samples rather than the nominal rate when known
+    float dt = ATTITUDE_UPDATE_DT;
+    if (lastAttitudeTimestamp != 0 && sensorData->gyroTimestamp > lastAttitudeTimestamp) {
+      float sampleDt = (float)(sensorData->gyroTimestamp - lastAttitudeTimestamp) * 1e-6f;
+      if (sampleDt < ATTITUDE_MAX_DT) {
+        dt = sampleDt;
+      }
+    }
+    lastAttitudeTimestamp = sensorData->gyroTimestamp;
+
     sensfusion6UpdateQ(sensorData->gyro.x, sensorData->gyro.y, sensorData->gyro.z,
                        sensorData->acc.x, sensorData->acc.y, sensorData->acc.z,
-                       ATTITUDE_UPDATE_DT);
+                       dt);
 
     // Save attitude, adjusted for the legacy CF2 body coordinate system
     sensfusion6GetEulerRPY(&state->attitude.roll, &state->attitude.pitch, &state->attitude.yaw);
@@ -48,7 +64,7 @@ void estimatorComplementary(state_t *state, sensorData_t *sensorData, control_t
                                                     sensorData->acc.y,
                                                     sensorData->acc.z);
 
-    positionUpdateVelocity(state->acc.z, ATTITUDE_UPDATE_DT);
+    positionUpdateVelocity(state->acc.z, dt);
   }
 
   if (RATE_DO_EXECUTE(POS_UPDATE_RATE, tick)) {
@@ -67,12 +67,42 @@
 #include "log.h"
 #include "param.h"
 
+#include <string.h>
 #include "math.h"
 #include "arm_math.h"
+#include "innovationMonitor.h"
+#include "adaptiveNoise.h"
+#ifdef KALMAN_USE_UD
+#include "udFactor.h"
+#endif
 
 //#define KALMAN_USE_BARO_UPDATE
 //#define KALMAN_NAN_CHECK
 
+/**
+ * State layout
+ *
+ * By default the filter estimates the full 9 dimensional state. When the deck set can not observe the
+ * horizontal position (or velocity) those states only add cost, the layout can then be reduced at compile time:
+ * - KALMAN_LAYOUT_FLOW: x/y position is dead-reckoned outside of the filter (Flow deck, z-ranger)
+ * - KALMAN_LAYOUT_HEIGHT: x/y position and velocity are dropped, z and attitude only (z-ranger, baro)
+ * Measurements that depend on a dropped state are refused when enqueued.
+ */
+#if defined(KALMAN_LAYOUT_HEIGHT)
+  #define KALMAN_HAS_POSITION_XY 0
+  #define KALMAN_HAS_VELOCITY_XY 0
+#elif defined(KALMAN_LAYOUT_FLOW)
+  #define KALMAN_HAS_POSITION_XY 0
+  #define KALMAN_HAS_VELOCITY_XY 1
+#else
+  #define KALMAN_HAS_POSITION_XY 1
+  #define KALMAN_HAS_VELOCITY_XY 1
+#endif
+
+#if defined(KALMAN_DECOUPLE_XY) && !KALMAN_HAS_POSITION_XY
+  #error "KALMAN_DECOUPLE_XY can not be used with a reduced state layout, use KALMAN_LAYOUT_HEIGHT instead"
+#endif
+
 
 /**
  * Primary Kalman filter functions
@@ -81,13 +111,23 @@
  *  - Predicting the current state forward */
 static void stateEstimatorPredict(float thrust, Axis3f *acc, Axis3f *gyro, float dt);
 static void stateEstimatorAddProcessNoise(float dt);
+static void stateEstimatorUpdateFlightPhase(Axis3f *acc, Axis3f *gyro);
 
 /*  - Measurement updates based on sensors */
-static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise);
+typedef enum
+{
+  MEAS_TOF, MEAS_HEIGHT, MEAS_POSITION, MEAS_DISTANCE, MEAS_TDOA, MEAS_FLOW_X, MEAS_FLOW_Y, MEAS_BARO, MEAS_DRAG, MEAS_MAG, MEAS_TYPE_COUNT
+} measurementType_t;
+
+static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise, measurementType_t type);
 static void stateEstimatorUpdateWithAccOnGround(Axis3f *acc);
+#if KALMAN_HAS_VELOCITY_XY
+static void stateEstimatorUpdateWithAccDrag(Axis3f *acc);
+#endif
 #ifdef KALMAN_USE_BARO_UPDATE
 static void stateEstimatorUpdateWithBaro(baro_t *baro);
 #endif
+static void stateEstimatorUpdateWithMagHeading(Axis3f *mag);
 
 /*  - Finalization to incorporate attitude error into body attitude */
 static void stateEstimatorFinalize(sensorData_t *sensors, uint32_t tick);
@@ -95,6 +135,9 @@ static void stateEstimatorFinalize(sensorData_t *sensors, uint32_t tick);
 /*  - Externalization to move the filter's internal state into the external state expected by other modules */
 static void stateEstimatorExternalizeState(state_t *state, sensorData_t *sensors, uint32_t tick);
 
+/*  - Health monitoring, based on the innovations of the measurement updates */
+static void stateEstimatorUpdateHealth(uint32_t tick);
+
 
 /**
  * Additionally, the filter supports the incorporation of additional sensors into the state estimate
@@ -107,6 +150,7 @@ static void stateEstimatorExternalizeState(state_t *state, sensorData_t *sensors
  * As well as by the following internal functions and datatypes
  */
 
+#if KALMAN_HAS_POSITION_XY
 // Distance-to-point measurements
 static xQueueHandle distDataQueue;
 #define DIST_QUEUE_LENGTH (10)
@@ -116,6 +160,7 @@ static void stateEstimatorUpdateWithDistance(distanceMeasurement_t *dist);
 static inline bool stateEstimatorHasDistanceMeasurement(distanceMeasurement_t *dist) {
   return (pdTRUE == xQueueReceive(distDataQueue, dist, 0));
 }
+#endif
 
 // Direct measurements of Crazyflie position
 static xQueueHandle posDataQueue;
@@ -127,6 +172,7 @@ static inline bool stateEstimatorHasPositionMeasurement(positionMeasurement_t *p
   return (pdTRUE == xQueueReceive(posDataQueue, pos, 0));
 }
 
+#if KALMAN_HAS_POSITION_XY
 // Measurements of a UWB Tx/Rx
 static xQueueHandle tdoaDataQueue;
 #define UWB_QUEUE_LENGTH (10)
@@ -136,8 +182,9 @@ static void stateEstimatorUpdateWithTDOA(tdoaMeasurement_t *uwb);
 static inline bool stateEstimatorHasTDOAPacket(tdoaMeasurement_t *uwb) {
   return (pdTRUE == xQueueReceive(tdoaDataQueue, uwb, 0));
 }
+#endif
 
-
+#if KALMAN_HAS_VELOCITY_XY
 // Measurements of flow (dnx, dny)
 static xQueueHandle flowDataQueue;
 #define FLOW_QUEUE_LENGTH (10)
@@ -147,6 +194,7 @@ static void stateEstimatorUpdateWithFlow(flowMeasurement_t *flow, sensorData_t *
 static inline bool stateEstimatorHasFlowPacket(flowMeasurement_t *flow) {
   return (pdTRUE == xQueueReceive(flowDataQueue, flow, 0));
 }
+#endif
 
 // Measurements of TOF from laser sensor
 static xQueueHandle tofDataQueue;
@@ -179,7 +227,7 @@ static inline bool stateEstimatorHasHeightPacket(heightMeasurement_t *height) {
 #define CRAZYFLIE_WEIGHT_grams (27.0f)
 
 //thrust is thrust mapped for 65536 <==> 60 GRAMS!
-#define CONTROL_TO_ACC (GRAVITY_MAGNITUDE*60.0f/CRAZYFLIE_WEIGHT_grams/65536.0f)
+#define CONTROL_TO_ACC(mass_grams) (GRAVITY_MAGNITUDE*60.0f/(mass_grams)/65536.0f)
 
 // TODO: Decouple the TDOA implementation from the Kalman filter...
 #define METERS_PER_TDOATICK (4.691763979e-3f)
@@ -191,6 +239,8 @@ static inline bool stateEstimatorHasHeightPacket(heightMeasurement_t *height) {
  */
 #define PREDICT_RATE RATE_100_HZ // this is slower than the IMU update rate of 500Hz
 #define BARO_RATE RATE_25_HZ
+// Longest IMU sample span accepted as prediction time step, beyond it the tick count is used
+#define MAX_PREDICTION_DT (0.1f)
 
 // the point at which the dynamics change from stationary to flying
 #define IN_FLIGHT_THRUST_THRESHOLD (GRAVITY_MAGNITUDE*0.1f)
@@ -212,7 +262,9 @@ static inline bool stateEstimatorHasHeightPacket(heightMeasurement_t *height) {
 #define MAX_VELOCITY (10) //meters per second
 
 // Initial variances, uncertain of position, but know we're stationary and roughly flat
+#if KALMAN_HAS_POSITION_XY
 static const float stdDevInitialPosition_xy = 100;
+#endif
 static const float stdDevInitialPosition_z = 1;
 static const float stdDevInitialVelocity = 0.01;
 static const float stdDevInitialAttitude_rollpitch = 0.01;
@@ -227,6 +279,66 @@ static float measNoiseBaro = 2.0f; // meters
 static float measNoiseGyro_rollpitch = 0.1f; // radians per second
 static float measNoiseGyro_yaw = 0.1f; // radians per second
 
+/**
+ * Magnetometer heading
+ *
+ * The heading of the calibrated magnetic field, after rotating it to the world frame, is fused as a
+ * yaw measurement. The heading of the field in the world frame is taken at the first fusion after a
+ * reset, so the yaw does not jump but stops drifting.
+ */
+static uint8_t useMag = 0;
+static float measNoiseMag = 0.1f; // radians
+static float magHeadingReference;
+static bool isMagHeadingReferenceSet = false;
+// Horizontal field strength, relative to the total, below which the heading is not used
+#define MAG_MIN_HORIZONTAL_RATIO (0.2f)
+
+/**
+ * Adaptive noise
+ *
+ * When enabled, the measurement noise of each measurement type is estimated online from the
+ * innovations (covariance matching) and used instead of the stdDev reported with the measurement.
+ * The process noise is scaled by the detected flight phase: on the ground, hovering or
+ * flying aggressively.
+ */
+typedef enum
+{
+  FLIGHT_PHASE_GROUND, FLIGHT_PHASE_HOVER, FLIGHT_PHASE_AGGRESSIVE
+} flightPhase_t;
+
+static uint8_t useAdaptiveNoise = 0;
+static float adaptiveNoiseRate = 0.005f; // weight of one innovation, rate and bounds are applied on reset
+static float adaptiveNoiseMinScale = 0.25f; // measurement variance relative to the reported variance
+static float adaptiveNoiseMaxScale = 25.0f;
+static float procNoiseScaleGround = 0.5f; // process noise stdDev relative to the tuned values
+static float procNoiseScaleAggressive = 2.0f;
+
+// Agitation, a filtered mix of acceleration and rotation, above which the flight is aggressive
+#define AGGRESSIVE_ACC_DEVIATION (3.0f) // ms^-2 from gravity
+#define AGGRESSIVE_GYRO_RATE (2.0f) // radians per second
+#define AGGRESSIVE_AGITATION_ENTER (1.0f)
+#define AGGRESSIVE_AGITATION_EXIT (0.5f)
+#define AGITATION_FILTER_GAIN (0.05f)
+
+/**
+ * Aerodynamic model
+ *
+ * The rotors produce a drag force proportional to the body-frame horizontal velocity (rotor drag, or
+ * blade flapping and induced drag). The accelerometers measure it directly, which makes the horizontal
+ * velocity observable in flight. Near the ground the rotors produce more thrust for the same
+ * command (ground effect), which matters when the z acceleration is predicted from the thrust command.
+ */
+static float vehicleMass = CRAZYFLIE_WEIGHT_grams; // grams, including decks and batteries
+#define VEHICLE_MIN_MASS_grams (10.0f) // the mass parameter is limited to this, it divides the thrust
+static uint8_t useDragModel = 0;
+static float dragCoeff_xy = 0.35f; // drag acceleration per velocity, s^-1
+static float measNoiseAccDrag = 1.0f; // meters per second^2, mostly vibrations
+static uint8_t useThrustModel = 0; // predict the z acceleration from the thrust command instead of the accelerometer
+static float rotorRadius = 0.023f; // meters, for the ground effect
+
+// Limit the ground effect to the height where the simple model is still reasonable
+#define GROUND_EFFECT_MIN_HEIGHT_RADIUS (1.0f) // in rotor radii, gives a maximum thrust gain of 6.7 %
+
 static float initialX = 0.5;
 static float initialY = 0.5;
 static float initialZ = 0.0;
@@ -245,15 +357,32 @@ static float procNoiseSkew = 10e-6f; // seconds per second^2 (is multiplied by d
  * - SKEW: the skew from anchor system clock to quad clock
  *
  * For more information, refer to the paper
+ *
+ * Only the first STATE_DIM states are part of the filter (and the covariance). States dropped by a
+ * reduced layout are placed after STATE_DIM, their mean is still propagated by the prediction.
  */
 
 // The quad's state, stored as a column vector
 typedef enum
 {
-  STATE_X, STATE_Y, STATE_Z, STATE_PX, STATE_PY, STATE_PZ, STATE_D0, STATE_D1, STATE_D2, STATE_DIM
+#if KALMAN_HAS_POSITION_XY
+  STATE_X, STATE_Y,
+#endif
+  STATE_Z,
+#if KALMAN_HAS_VELOCITY_XY
+  STATE_PX, STATE_PY,
+#endif
+  STATE_PZ, STATE_D0, STATE_D1, STATE_D2, STATE_DIM,
+#if !KALMAN_HAS_POSITION_XY
+  STATE_X = STATE_DIM, STATE_Y,
+#endif
+#if !KALMAN_HAS_VELOCITY_XY
+  STATE_PX, STATE_PY,
+#endif
+  STATE_VECTOR_DIM
 } stateIdx_t;
 
-static float S[STATE_DIM];
+static float S[STATE_VECTOR_DIM];
 
 // The quad's attitude as a quaternion (w,x,y,z)
 // We store as a quaternion to allow easy normalization (in comparison to a rotation matrix),
@@ -267,6 +396,23 @@ static float R[3][3] = {{1,0,0},{0,1,0},{0,0,1}};
 static float P[STATE_DIM][STATE_DIM];
 static arm_matrix_instance_f32 Pm = {STATE_DIM, STATE_DIM, (float *)P};
 
+#ifdef KALMAN_USE_UD
+// The factors of the covariance matrix, P = U*D*U'. These are updated by the filter
+// and P is recomputed from them after every change.
+static float covU[STATE_DIM][STATE_DIM];
+static float covD[STATE_DIM];
+
+// Process noise is added to the factors on the next prediction or update, not every loop
+static float pendingProcessNoise[STATE_DIM];
+static bool hasPendingProcessNoise;
+
+static void stateEstimatorPredictFactors(const float *A);
+static void stateEstimatorFactorizeCovariance();
+#endif
+
+// Number of times the covariance has been clamped to the bounds, a sign of numerical problems
+static uint32_t covarianceClampCount;
+
 
 /**
  * Internal variables. Note that static declaration results in default initialization (to 0)
@@ -285,6 +431,8 @@ static uint32_t accAccumulatorCount;
 static uint32_t thrustAccumulatorCount;
 static uint32_t gyroAccumulatorCount;
 static uint32_t baroAccumulatorCount;
+static uint64_t lastGyroTimestamp;        // acquisition time of the latest accumulated gyro sample
+static uint64_t lastPredictionTimestamp;  // acquisition time of the latest gyro sample used in a prediction
 static bool quadIsFlying = false;
 static int32_t lastTDOAUpdate;
 static float stateSkew;
@@ -293,6 +441,29 @@ static uint32_t lastFlightCmd;
 static uint32_t takeoffTime;
 static uint32_t tdoaCount;
 
+/**
+ * Estimator health
+ *
+ * The normalized innovation squared (NIS) of every scalar update is tracked per measurement type.
+ * Together with the covariance and the age of the aiding measurements, this gives a position
+ * quality, 0 (no valid position) to 100, that for instance the situation awareness can act on.
+ */
+#define NIS_WINDOW_SIZE (50)
+#define HEALTH_MAX_MEASUREMENT_AGE M2T(500)
+#define HEALTH_STDDEV_GOOD (0.05f) // meters (or meters per second), quality 100
+#define HEALTH_STDDEV_BAD (1.0f)  // meters (or meters per second), quality 0
+
+static innovationMonitor_t innovationMonitors[MEAS_TYPE_COUNT];
+static uint16_t nisInconsistent; // One bit per measurement type, set if the last NIS window failed the chi-square test
+static uint8_t positionQuality;
+static uint8_t histogramMeasType; // Measurement type to expose the innovation histogram of the last NIS window for in the log
+static uint16_t histogram[INNOVATION_MONITOR_HISTOGRAM_BINS];
+
+static adaptiveNoise_t measNoiseAdaptation[MEAS_TYPE_COUNT];
+static uint8_t flightPhase = FLIGHT_PHASE_GROUND; // flightPhase_t, stored as uint8_t for logging
+static float agitation;
+static float procNoiseScale = 1.0f;
+
 /**
  * Supporting and utility functions
  */
@@ -353,6 +524,9 @@ static void decoupleState(stateIdx_t state)
   P[state][state] = MAX_COVARIANCE;
   // set state to zero
   S[state] = 0;
+#ifdef KALMAN_USE_UD
+  stateEstimatorFactorizeCovariance();
+#endif
 }
 #endif
 
@@ -380,26 +554,31 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
   // Average the last IMU measurements. We do this because the prediction loop is
   // slower than the IMU loop, but the IMU information is required externally at
   // a higher rate (for body rate control).
-  if (sensorsReadAcc(&sensors->acc)) {
+  if (sensorsReadAcc(&sensors->acc, &sensors->accTimestamp)) {
     accAccumulator.x += GRAVITY_MAGNITUDE*sensors->acc.x; // accelerometer is in Gs
     accAccumulator.y += GRAVITY_MAGNITUDE*sensors->acc.y; // but the estimator requires ms^-2
     accAccumulator.z += GRAVITY_MAGNITUDE*sensors->acc.z;
     accAccumulatorCount++;
   }
 
-  if (sensorsReadGyro(&sensors->gyro)) {
+  if (sensorsReadGyro(&sensors->gyro, &sensors->gyroTimestamp)) {
     gyroAccumulator.x += sensors->gyro.x * DEG_TO_RAD; // gyro is in deg/sec
     gyroAccumulator.y += sensors->gyro.y * DEG_TO_RAD; // but the estimator requires rad/sec
     gyroAccumulator.z += sensors->gyro.z * DEG_TO_RAD;
     gyroAccumulatorCount++;
+    lastGyroTimestamp = sensors->gyroTimestamp;
   }
 
-  if (sensorsReadMag(&sensors->mag)) {
-      // Currently the magnetometer doesn't play a part in the estimation
+  if (sensorsReadMag(&sensors->mag, &sensors->magTimestamp)) {
+    if (useMag) {
+      stateEstimatorUpdateWithMagHeading(&sensors->mag);
+      doneUpdate = true;
+    }
   }
 
   // Average the thrust command from the last timestep, generated externally by the controller
-  thrustAccumulator += control->thrust * CONTROL_TO_ACC; // thrust is in grams, we need ms^-2
+  const float mass = fmaxf(vehicleMass, VEHICLE_MIN_MASS_grams);
+  thrustAccumulator += control->thrust * CONTROL_TO_ACC(mass); // thrust is in grams, we need ms^-2
   thrustAccumulatorCount++;
 
   // Run the system dynamics to predict the state forward.
@@ -418,12 +597,27 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
 
     thrustAccumulator /= thrustAccumulatorCount;
 
+    // Integrate over the time actually spanned by the IMU samples when known,
+    // the tick count only has a 1 ms resolution and does not follow the sensor clock
     float dt = (float)(osTick-lastPrediction)/configTICK_RATE_HZ;
+    if (lastPredictionTimestamp != 0 && lastGyroTimestamp > lastPredictionTimestamp) {
+      float sampleDt = (float)(lastGyroTimestamp - lastPredictionTimestamp) * 1e-6f;
+      if (sampleDt < MAX_PREDICTION_DT) {
+        dt = sampleDt;
+      }
+    }
+    lastPredictionTimestamp = lastGyroTimestamp;
     stateEstimatorPredict(thrustAccumulator, &accAccumulator, &gyroAccumulator, dt);
+    stateEstimatorUpdateFlightPhase(&accAccumulator, &gyroAccumulator);
 
     if (!quadIsFlying) { // accelerometers give us information about attitude on slanted ground
       stateEstimatorUpdateWithAccOnGround(&accAccumulator);
     }
+#if KALMAN_HAS_VELOCITY_XY
+    else if (useDragModel) { // and about the horizontal velocity through the rotor drag in flight
+      stateEstimatorUpdateWithAccDrag(&accAccumulator);
+    }
+#endif
 
     lastPrediction = osTick;
 
@@ -434,6 +628,8 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
     thrustAccumulator = 0;
     thrustAccumulatorCount = 0;
 
+    stateEstimatorUpdateHealth(osTick);
+
     doneUpdate = true;
   }
 
@@ -450,7 +646,7 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
    * Update the state estimate with the barometer measurements
    */
   // Accumulate the barometer measurements
-  if (sensorsReadBaro(&sensors->baro)) {
+  if (sensorsReadBaro(&sensors->baro, &sensors->baroTimestamp)) {
 #ifdef KALMAN_USE_BARO_UPDATE
     baroAccumulator.asl += sensors->baro.asl;
     baroAccumulatorCount++;
@@ -489,12 +685,14 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
     doneUpdate = true;
   }
 
+#if KALMAN_HAS_POSITION_XY
   distanceMeasurement_t dist;
   while (stateEstimatorHasDistanceMeasurement(&dist))
   {
     stateEstimatorUpdateWithDistance(&dist);
     doneUpdate = true;
   }
+#endif
 
   positionMeasurement_t pos;
   while (stateEstimatorHasPositionMeasurement(&pos))
@@ -503,19 +701,23 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
     doneUpdate = true;
   }
 
+#if KALMAN_HAS_POSITION_XY
   tdoaMeasurement_t tdoa;
   while (stateEstimatorHasTDOAPacket(&tdoa))
   {
     stateEstimatorUpdateWithTDOA(&tdoa);
     doneUpdate = true;
   }
+#endif
 
+#if KALMAN_HAS_VELOCITY_XY
   flowMeasurement_t flow;
   while (stateEstimatorHasFlowPacket(&flow))
   {
     stateEstimatorUpdateWithFlow(&flow, sensors);
     doneUpdate = true;
   }
+#endif
 
   /**
    * If an update has been made, the state is finalized:
@@ -538,6 +740,20 @@ void estimatorKalman(state_t *state, sensorData_t *sensors, control_t *control,
   stateEstimatorAssertNotNaN();
 }
 
+/**
+ * Thrust gain in ground effect at height z, Cheeseman and Bennett: T/T_inf = 1/(1 - (r/4z)^2)
+ */
+static float stateEstimatorGroundEffect(float z)
+{
+  const float minHeight = GROUND_EFFECT_MIN_HEIGHT_RADIUS * rotorRadius;
+  if (z < minHeight) {
+    z = minHeight;
+  }
+
+  const float ratio = rotorRadius / (4.0f * z);
+  return 1.0f / (1.0f - ratio * ratio);
+}
+
 static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, float dt)
 {
   /* Here we discretize (euler forward) and linearise the quadrocopter dynamics in order
@@ -546,7 +762,7 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
    * QUADROCOPTER DYNAMICS (see paper):
    *
    * \dot{x} = R(I + [[d]])p
-   * \dot{p} = f/m * e3 - [[\omega]]p - g(I - [[d]])R^-1 e3 //drag negligible
+   * \dot{p} = f/m * e3 - [[\omega]]p - g(I - [[d]])R^-1 e3 - K p //K is the rotor drag, when enabled
    * \dot{d} = \omega
    *
    * where [[.]] is the cross-product matrix of .
@@ -563,6 +779,7 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
 
   // The linearized update matrix
   static float A[STATE_DIM][STATE_DIM];
+#ifndef KALMAN_USE_UD
   static arm_matrix_instance_f32 Am = { STATE_DIM, STATE_DIM, (float *)A}; // linearized dynamics for covariance update;
 
   // Temporary matrices for the covariance updates
@@ -571,17 +788,27 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
 
   static float tmpNN2d[STATE_DIM * STATE_DIM];
   static arm_matrix_instance_f32 tmpNN2m = { STATE_DIM, STATE_DIM, tmpNN2d};
+#endif
 
   float dt2 = dt*dt;
 
+  // rotor drag, only modelled in flight where the thrust dominates
+#if KALMAN_HAS_VELOCITY_XY
+  const float drag = (useDragModel && quadIsFlying) ? dragCoeff_xy : 0.0f;
+#endif
+
   // ====== DYNAMICS LINEARIZATION ======
   // Initialize as the identity
+#if KALMAN_HAS_POSITION_XY
   A[STATE_X][STATE_X] = 1;
   A[STATE_Y][STATE_Y] = 1;
+#endif
   A[STATE_Z][STATE_Z] = 1;
 
+#if KALMAN_HAS_VELOCITY_XY
   A[STATE_PX][STATE_PX] = 1;
   A[STATE_PY][STATE_PY] = 1;
+#endif
   A[STATE_PZ][STATE_PZ] = 1;
 
   A[STATE_D0][STATE_D0] = 1;
@@ -589,55 +816,77 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
   A[STATE_D2][STATE_D2] = 1;
 
   // position from body-frame velocity
+#if KALMAN_HAS_VELOCITY_XY
+#if KALMAN_HAS_POSITION_XY
   A[STATE_X][STATE_PX] = R[0][0]*dt;
   A[STATE_Y][STATE_PX] = R[1][0]*dt;
+#endif
   A[STATE_Z][STATE_PX] = R[2][0]*dt;
 
+#if KALMAN_HAS_POSITION_XY
   A[STATE_X][STATE_PY] = R[0][1]*dt;
   A[STATE_Y][STATE_PY] = R[1][1]*dt;
+#endif
   A[STATE_Z][STATE_PY] = R[2][1]*dt;
+#endif
 
+#if KALMAN_HAS_POSITION_XY
   A[STATE_X][STATE_PZ] = R[0][2]*dt;
   A[STATE_Y][STATE_PZ] = R[1][2]*dt;
+#endif
   A[STATE_Z][STATE_PZ] = R[2][2]*dt;
 
   // position from attitude error
+#if KALMAN_HAS_POSITION_XY
   A[STATE_X][STATE_D0] = (S[STATE_PY]*R[0][2] - S[STATE_PZ]*R[0][1])*dt;
   A[STATE_Y][STATE_D0] = (S[STATE_PY]*R[1][2] - S[STATE_PZ]*R[1][1])*dt;
+#endif
   A[STATE_Z][STATE_D0] = (S[STATE_PY]*R[2][2] - S[STATE_PZ]*R[2][1])*dt;
 
+#if KALMAN_HAS_POSITION_XY
   A[STATE_X][STATE_D1] = (- S[STATE_PX]*R[0][2] + S[STATE_PZ]*R[0][0])*dt;
   A[STATE_Y][STATE_D1] = (- S[STATE_PX]*R[1][2] + S[STATE_PZ]*R[1][0])*dt;
+#endif
   A[STATE_Z][STATE_D1] = (- S[STATE_PX]*R[2][2] + S[STATE_PZ]*R[2][0])*dt;
 
+#if KALMAN_HAS_POSITION_XY
   A[STATE_X][STATE_D2] = (S[STATE_PX]*R[0][1] - S[STATE_PY]*R[0][0])*dt;
   A[STATE_Y][STATE_D2] = (S[STATE_PX]*R[1][1] - S[STATE_PY]*R[1][0])*dt;
+#endif
   A[STATE_Z][STATE_D2] = (S[STATE_PX]*R[2][1] - S[STATE_PY]*R[2][0])*dt;
 
   // body-frame velocity from body-frame velocity
-  A[STATE_PX][STATE_PX] = 1; //drag negligible
+#if KALMAN_HAS_VELOCITY_XY
+  A[STATE_PX][STATE_PX] = 1 - drag*dt;
   A[STATE_PY][STATE_PX] =-gyro->z*dt;
   A[STATE_PZ][STATE_PX] = gyro->y*dt;
 
   A[STATE_PX][STATE_PY] = gyro->z*dt;
-  A[STATE_PY][STATE_PY] = 1; //drag negligible
+  A[STATE_PY][STATE_PY] = 1 - drag*dt;
   A[STATE_PZ][STATE_PY] =-gyro->x*dt;
 
   A[STATE_PX][STATE_PZ] =-gyro->y*dt;
   A[STATE_PY][STATE_PZ] = gyro->x*dt;
+#endif
   A[STATE_PZ][STATE_PZ] = 1; //drag negligible
 
   // body-frame velocity from attitude error
+#if KALMAN_HAS_VELOCITY_XY
   A[STATE_PX][STATE_D0] =  0;
   A[STATE_PY][STATE_D0] = -GRAVITY_MAGNITUDE*R[2][2]*dt;
+#endif
   A[STATE_PZ][STATE_D0] =  GRAVITY_MAGNITUDE*R[2][1]*dt;
 
+#if KALMAN_HAS_VELOCITY_XY
   A[STATE_PX][STATE_D1] =  GRAVITY_MAGNITUDE*R[2][2]*dt;
   A[STATE_PY][STATE_D1] =  0;
+#endif
   A[STATE_PZ][STATE_D1] = -GRAVITY_MAGNITUDE*R[2][0]*dt;
 
+#if KALMAN_HAS_VELOCITY_XY
   A[STATE_PX][STATE_D2] = -GRAVITY_MAGNITUDE*R[2][1]*dt;
   A[STATE_PY][STATE_D2] =  GRAVITY_MAGNITUDE*R[2][0]*dt;
+#endif
   A[STATE_PZ][STATE_D2] =  0;
 
   // attitude error from attitude error
@@ -674,9 +923,13 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
 
 
   // ====== COVARIANCE UPDATE ======
+#ifdef KALMAN_USE_UD
+  stateEstimatorPredictFactors((float *)A); // A (P + Q) A'
+#else
   mat_mult(&Am, &Pm, &tmpNN1m); // A P
   mat_trans(&Am, &tmpNN2m); // A'
   mat_mult(&tmpNN1m, &tmpNN2m, &Pm); // A P A'
+#endif
   // Process noise is added after the return from the prediction step
 
   // ====== PREDICTION STEP ======
@@ -699,11 +952,14 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
 
   if (quadIsFlying) // only acceleration in z direction
   {
-    // TODO: In the next lines, can either use cmdThrust/mass, or acc->z. Need to test which is more reliable.
+    // In the next lines, can either use cmdThrust/mass, or acc->z.
     // cmdThrust's error comes from poorly calibrated mass, and inexact cmdThrust -> thrust map
     // acc->z's error comes from measurement noise and accelerometer scaling
-    // float zacc = cmdThrust;
-    zacc = acc->z;
+    if (useThrustModel) {
+      zacc = cmdThrust * stateEstimatorGroundEffect(S[STATE_Z]);
+    } else {
+      zacc = acc->z;
+    }
 
     // position updates in the body frame (will be rotated to inertial frame)
     dx = S[STATE_PX] * dt;
@@ -720,9 +976,14 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
     tmpSPY = S[STATE_PY];
     tmpSPZ = S[STATE_PZ];
 
-    // body-velocity update: accelerometers - gyros cross velocity - gravity in body frame
+    // body-velocity update: accelerometers - gyros cross velocity - gravity in body frame - rotor drag
+#if KALMAN_HAS_VELOCITY_XY
+    S[STATE_PX] += dt * (gyro->z * tmpSPY - gyro->y * tmpSPZ - GRAVITY_MAGNITUDE * R[2][0] - drag * tmpSPX);
+    S[STATE_PY] += dt * (-gyro->z * tmpSPX + gyro->x * tmpSPZ - GRAVITY_MAGNITUDE * R[2][1] - drag * tmpSPY);
+#else
     S[STATE_PX] += dt * (gyro->z * tmpSPY - gyro->y * tmpSPZ - GRAVITY_MAGNITUDE * R[2][0]);
     S[STATE_PY] += dt * (-gyro->z * tmpSPX + gyro->x * tmpSPZ - GRAVITY_MAGNITUDE * R[2][1]);
+#endif
     S[STATE_PZ] += dt * (zacc + gyro->y * tmpSPX - gyro->x * tmpSPY - GRAVITY_MAGNITUDE * R[2][2]);
   }
   else // Acceleration can be in any direction, as measured by the accelerometer. This occurs, eg. in freefall or while being carried.
@@ -748,6 +1009,13 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
     S[STATE_PZ] += dt * (acc->z + gyro->y * tmpSPX - gyro->x * tmpSPY - GRAVITY_MAGNITUDE * R[2][2]);
   }
 
+#if !KALMAN_HAS_VELOCITY_XY
+  // The horizontal velocity is not observable in this layout, integrating the accelerometers
+  // would only make it drift. Keep it at zero, as KALMAN_DECOUPLE_XY does for the full filter.
+  S[STATE_PX] = 0;
+  S[STATE_PY] = 0;
+#endif
+
   // attitude update (rotate by gyroscope), we do this in quaternions
   // this is the gyroscope angular velocity integrated over the sample period
   float dtwx = dt*gyro->x;
@@ -786,44 +1054,96 @@ static void stateEstimatorPredict(float cmdThrust, Axis3f *acc, Axis3f *gyro, fl
   stateEstimatorAssertNotNaN();
 }
 
+static void stateEstimatorUpdateFlightPhase(Axis3f *acc, Axis3f *gyro)
+{
+  float accDeviation = fabsf(arm_sqrt(acc->x*acc->x + acc->y*acc->y + acc->z*acc->z) - GRAVITY_MAGNITUDE);
+  float gyroRate = arm_sqrt(gyro->x*gyro->x + gyro->y*gyro->y + gyro->z*gyro->z);
+  float sample = accDeviation / AGGRESSIVE_ACC_DEVIATION + gyroRate / AGGRESSIVE_GYRO_RATE;
+  agitation += AGITATION_FILTER_GAIN * (sample - agitation);
+
+  if (!quadIsFlying) {
+    flightPhase = FLIGHT_PHASE_GROUND;
+  } else if (flightPhase == FLIGHT_PHASE_AGGRESSIVE) {
+    flightPhase = (agitation > AGGRESSIVE_AGITATION_EXIT) ? FLIGHT_PHASE_AGGRESSIVE : FLIGHT_PHASE_HOVER;
+  } else {
+    flightPhase = (agitation > AGGRESSIVE_AGITATION_ENTER) ? FLIGHT_PHASE_AGGRESSIVE : FLIGHT_PHASE_HOVER;
+  }
+
+  if (!useAdaptiveNoise) {
+    procNoiseScale = 1.0f;
+  } else if (flightPhase == FLIGHT_PHASE_GROUND) {
+    procNoiseScale = procNoiseScaleGround;
+  } else if (flightPhase == FLIGHT_PHASE_AGGRESSIVE) {
+    procNoiseScale = procNoiseScaleAggressive;
+  } else {
+    procNoiseScale = 1.0f;
+  }
+}
+
+static void stateEstimatorAddStateNoise(stateIdx_t state, float variance)
+{
+#ifdef KALMAN_USE_UD
+  pendingProcessNoise[state] += variance;
+  hasPendingProcessNoise = true;
+#else
+  P[state][state] += variance;
+#endif
+}
+
 static void stateEstimatorAddProcessNoise(float dt)
 {
+#if KALMAN_HAS_VELOCITY_XY
+  const float procNoiseAcc_xy_scaled = procNoiseAcc_xy * procNoiseScale;
+#endif
+  const float procNoiseAcc_z_scaled = procNoiseAcc_z * procNoiseScale;
+  const float measNoiseGyro_rollpitch_scaled = measNoiseGyro_rollpitch * procNoiseScale;
+  const float measNoiseGyro_yaw_scaled = measNoiseGyro_yaw * procNoiseScale;
+
   if (dt>0)
   {
-    P[STATE_X][STATE_X] += powf(procNoiseAcc_xy*dt*dt + procNoiseVel*dt + procNoisePos, 2);  // add process noise on position
-    P[STATE_Y][STATE_Y] += powf(procNoiseAcc_xy*dt*dt + procNoiseVel*dt + procNoisePos, 2);  // add process noise on position
-    P[STATE_Z][STATE_Z] += powf(procNoiseAcc_z*dt*dt + procNoiseVel*dt + procNoisePos, 2);  // add process noise on position
+#if KALMAN_HAS_POSITION_XY
+    stateEstimatorAddStateNoise(STATE_X, powf(procNoiseAcc_xy_scaled*dt*dt + procNoiseVel*dt + procNoisePos, 2));  // add process noise on position
+    stateEstimatorAddStateNoise(STATE_Y, powf(procNoiseAcc_xy_scaled*dt*dt + procNoiseVel*dt + procNoisePos, 2));  // add process noise on position
+#endif
+    stateEstimatorAddStateNoise(STATE_Z, powf(procNoiseAcc_z_scaled*dt*dt + procNoiseVel*dt + procNoisePos, 2));  // add process noise on position
 
-    P[STATE_PX][STATE_PX] += powf(procNoiseAcc_xy*dt + procNoiseVel, 2); // add process noise on velocity
-    P[STATE_PY][STATE_PY] += powf(procNoiseAcc_xy*dt + procNoiseVel, 2); // add process noise on velocity
-    P[STATE_PZ][STATE_PZ] += powf(procNoiseAcc_z*dt + procNoiseVel, 2); // add process noise on velocity
+#if KALMAN_HAS_VELOCITY_XY
+    stateEstimatorAddStateNoise(STATE_PX, powf(procNoiseAcc_xy_scaled*dt + procNoiseVel, 2)); // add process noise on velocity
+    stateEstimatorAddStateNoise(STATE_PY, powf(procNoiseAcc_xy_scaled*dt + procNoiseVel, 2)); // add process noise on velocity
+#endif
+    stateEstimatorAddStateNoise(STATE_PZ, powf(procNoiseAcc_z_scaled*dt + procNoiseVel, 2)); // add process noise on velocity
 
-    P[STATE_D0][STATE_D0] += powf(measNoiseGyro_rollpitch * dt + procNoiseAtt, 2);
-    P[STATE_D1][STATE_D1] += powf(measNoiseGyro_rollpitch * dt + procNoiseAtt, 2);
-    P[STATE_D2][STATE_D2] += powf(measNoiseGyro_yaw * dt + procNoiseAtt, 2);
+    stateEstimatorAddStateNoise(STATE_D0, powf(measNoiseGyro_rollpitch_scaled * dt + procNoiseAtt, 2));
+    stateEstimatorAddStateNoise(STATE_D1, powf(measNoiseGyro_rollpitch_scaled * dt + procNoiseAtt, 2));
+    stateEstimatorAddStateNoise(STATE_D2, powf(measNoiseGyro_yaw_scaled * dt + procNoiseAtt, 2));
   }
 
+#ifndef KALMAN_USE_UD
   for (int i=0; i<STATE_DIM; i++) {
     for (int j=i; j<STATE_DIM; j++) {
       float p = 0.5f*P[i][j] + 0.5f*P[j][i];
       if (isnan(p) || p > MAX_COVARIANCE) {
         P[i][j] = P[j][i] = MAX_COVARIANCE;
+        covarianceClampCount++;
       } else if ( i==j && p < MIN_COVARIANCE ) {
         P[i][j] = P[j][i] = MIN_COVARIANCE;
+        covarianceClampCount++;
       } else {
         P[i][j] = P[j][i] = p;
       }
     }
   }
+#endif
 
   stateEstimatorAssertNotNaN();
 }
 
 
-static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise)
+static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error, float stdMeasNoise, measurementType_t type)
 {
   // The Kalman gain as a column vector
   static float K[STATE_DIM];
+#ifndef KALMAN_USE_UD
   static arm_matrix_instance_f32 Km = {STATE_DIM, 1, (float *)K};
 
   // Temporary matrices for the covariance updates
@@ -835,6 +1155,7 @@ static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error,
 
   static float tmpNN3d[STATE_DIM * STATE_DIM];
   static arm_matrix_instance_f32 tmpNN3m = {STATE_DIM, STATE_DIM, tmpNN3d};
+#endif
 
   static float HTd[STATE_DIM * 1];
   static arm_matrix_instance_f32 HTm = {STATE_DIM, 1, HTd};
@@ -845,18 +1166,38 @@ static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error,
   configASSERT(Hm->numRows == 1);
   configASSERT(Hm->numCols == STATE_DIM);
 
+#ifdef KALMAN_USE_UD
+  stateEstimatorPredictFactors(NULL); // add the pending process noise
+#endif
+
   // ====== INNOVATION COVARIANCE ======
 
   mat_trans(Hm, &HTm);
   mat_mult(&Pm, &HTm, &PHTm); // PH'
-  float R = stdMeasNoise*stdMeasNoise;
-  float HPHR = R; // HPH' + R
-  for (int i=0; i<STATE_DIM; i++) { // Add the element of HPH' to the above
-    HPHR += Hm->pData[i]*PHTd[i]; // this obviously only works if the update is scalar (as in this function)
+  float nominalR = stdMeasNoise*stdMeasNoise;
+  float R = useAdaptiveNoise ? adaptiveNoiseGetVariance(&measNoiseAdaptation[type], nominalR) : nominalR;
+  float HPH = 0; // HPH'
+  for (int i=0; i<STATE_DIM; i++) {
+    HPH += Hm->pData[i]*PHTd[i]; // this obviously only works if the update is scalar (as in this function)
   }
+  float HPHR = HPH + R; // HPH' + R
   configASSERT(!isnan(HPHR));
 
+  innovationMonitorAdd(&innovationMonitors[type], error, HPHR, xTaskGetTickCount());
+  if (useAdaptiveNoise) {
+    adaptiveNoiseUpdate(&measNoiseAdaptation[type], error, HPH, nominalR);
+  }
+
   // ====== MEASUREMENT UPDATE ======
+#ifdef KALMAN_USE_UD
+  // The factorized update calculates the same gain and the updated covariance in one pass
+  udScalarUpdate((float *)covU, covD, STATE_DIM, Hm->pData, R, K);
+  for (int i=0; i<STATE_DIM; i++) {
+    S[i] = S[i] + K[i] * error; // state update
+  }
+  stateEstimatorPredictFactors(NULL); // bound the factors and update P
+  stateEstimatorAssertNotNaN();
+#else
   // Calculate the Kalman gain and perform the state update
   for (int i=0; i<STATE_DIM; i++) {
     K[i] = PHTd[i]/HPHR; // kalman gain = (PH' (HPH' + R )^-1)
@@ -879,8 +1220,10 @@ static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error,
       float p = 0.5f*P[i][j] + 0.5f*P[j][i] + v; // add measurement noise
       if (isnan(p) || p > MAX_COVARIANCE) {
         P[i][j] = P[j][i] = MAX_COVARIANCE;
+        covarianceClampCount++;
       } else if ( i==j && p < MIN_COVARIANCE ) {
         P[i][j] = P[j][i] = MIN_COVARIANCE;
+        covarianceClampCount++;
       } else {
         P[i][j] = P[j][i] = p;
       }
@@ -888,8 +1231,47 @@ static void stateEstimatorScalarUpdate(arm_matrix_instance_f32 *Hm, float error,
   }
 
   stateEstimatorAssertNotNaN();
+#endif
+}
+
+#ifdef KALMAN_USE_UD
+/**
+ * Adds the pending process noise Q to the covariance factors, propagates them through
+ * A (NULL for identity), so the factors become those of A(P+Q)A', and recalculates P.
+ * The noise was added to P after the previous prediction in the dense filter, so it is
+ * propagated through A here as well.
+ */
+static void stateEstimatorPredictFactors(const float *A)
+{
+  if (A != NULL || hasPendingProcessNoise) {
+    udPredict((float *)covU, covD, STATE_DIM, A, hasPendingProcessNoise ? pendingProcessNoise : NULL);
+    memset(pendingProcessNoise, 0, sizeof(pendingProcessNoise));
+    hasPendingProcessNoise = false;
+  }
+
+  // The factors are positive definite by construction, the bounds only catch divergence
+  for (int i=0; i<STATE_DIM; i++) {
+    if (isnan(covD[i]) || covD[i] > MAX_COVARIANCE) {
+      covD[i] = MAX_COVARIANCE;
+      covarianceClampCount++;
+    } else if (covD[i] < MIN_COVARIANCE) {
+      covD[i] = MIN_COVARIANCE;
+      covarianceClampCount++;
+    }
+  }
+
+  udToCovariance((float *)covU, covD, (float *)P, STATE_DIM);
 }
 
+// Sets the factors from P, after P has been changed directly
+static void stateEstimatorFactorizeCovariance()
+{
+  if (!udFactorize((float *)P, (float *)covU, covD, STATE_DIM)) {
+    resetEstimation = true;
+  }
+}
+#endif
+
 static void stateEstimatorUpdateWithAccOnGround(Axis3f *acc)
 {
   // The following code is disabled due to the function not being complete (and that we aim for zero warnings).
@@ -913,6 +1295,22 @@ static void stateEstimatorUpdateWithAccOnGround(Axis3f *acc)
 #endif
 }
 
+#if KALMAN_HAS_VELOCITY_XY
+static void stateEstimatorUpdateWithAccDrag(Axis3f *acc)
+{
+  // In flight the horizontal specific force is the rotor drag, acc = -K * p (body frame)
+  float h[STATE_DIM] = {0};
+  arm_matrix_instance_f32 H = {1, STATE_DIM, h};
+
+  h[STATE_PX] = -dragCoeff_xy;
+  stateEstimatorScalarUpdate(&H, acc->x + dragCoeff_xy * S[STATE_PX], measNoiseAccDrag, MEAS_DRAG);
+
+  h[STATE_PX] = 0;
+  h[STATE_PY] = -dragCoeff_xy;
+  stateEstimatorScalarUpdate(&H, acc->y + dragCoeff_xy * S[STATE_PY], measNoiseAccDrag, MEAS_DRAG);
+}
+#endif
+
 #ifdef KALMAN_USE_BARO_UPDATE
 static void stateEstimatorUpdateWithBaro(baro_t *baro)
 {
@@ -929,29 +1327,74 @@ static void stateEstimatorUpdateWithBaro(baro_t *baro)
   }
 
   float meas = (baro->asl - baroReferenceHeight);
-  stateEstimatorScalarUpdate(&H, meas - S[STATE_Z], measNoiseBaro);
+  stateEstimatorScalarUpdate(&H, meas - S[STATE_Z], measNoiseBaro, MEAS_BARO);
 }
 #endif
 
+static void stateEstimatorUpdateWithMagHeading(Axis3f *mag)
+{
+  // The field in the world frame
+  float m[3];
+  for (int i = 0; i < 3; i++) {
+    m[i] = R[i][0] * mag->x + R[i][1] * mag->y + R[i][2] * mag->z;
+  }
+
+  float horizontal2 = m[0] * m[0] + m[1] * m[1];
+  float total2 = horizontal2 + m[2] * m[2];
+  if (horizontal2 < MAG_MIN_HORIZONTAL_RATIO * MAG_MIN_HORIZONTAL_RATIO * total2 || total2 == 0) {
+    return;
+  }
+
+  float heading = atan2f(m[1], m[0]);
+  if (!isMagHeadingReferenceSet) {
+    magHeadingReference = heading;
+    isMagHeadingReferenceSet = true;
+    return;
+  }
+
+  float error = magHeadingReference - heading;
+  if (error > PI) {
+    error -= 2 * PI;
+  } else if (error < -PI) {
+    error += 2 * PI;
+  }
+
+  // A rotation d of the body rotates the world frame field by R*d. The heading changes with the
+  // rotation about the vertical, and with the horizontal rotations when the field is inclined.
+  float h[STATE_DIM] = {0};
+  arm_matrix_instance_f32 H = {1, STATE_DIM, h};
+  float inclination = m[2] / horizontal2;
+  h[STATE_D0] = R[2][0] - inclination * (m[0] * R[0][0] + m[1] * R[1][0]);
+  h[STATE_D1] = R[2][1] - inclination * (m[0] * R[0][1] + m[1] * R[1][1]);
+  h[STATE_D2] = R[2][2] - inclination * (m[0] * R[0][2] + m[1] * R[1][2]);
+
+  stateEstimatorScalarUpdate(&H, error, measNoiseMag, MEAS_MAG);
+}
+
 static void stateEstimatorUpdateWithAbsoluteHeight(heightMeasurement_t* height) {
   float h[STATE_DIM] = {0};
   arm_matrix_instance_f32 H = {1, STATE_DIM, h};
   h[STATE_Z] = 1;
-  stateEstimatorScalarUpdate(&H, height->height - S[STATE_Z], height->stdDev);
+  stateEstimatorScalarUpdate(&H, height->height - S[STATE_Z], height->stdDev, MEAS_HEIGHT);
 }
 
 static void stateEstimatorUpdateWithPosition(positionMeasurement_t *xyz)
 {
   // a direct measurement of states x, y, and z
   // do a scalar update for each state, since this should be faster than updating all together
+  static const stateIdx_t positionStates[] = {STATE_X, STATE_Y, STATE_Z};
   for (int i=0; i<3; i++) {
+    if (positionStates[i] >= STATE_DIM) {
+      continue; // not part of the state layout, only z is used
+    }
     float h[STATE_DIM] = {0};
     arm_matrix_instance_f32 H = {1, STATE_DIM, h};
-    h[STATE_X+i] = 1;
-    stateEstimatorScalarUpdate(&H, xyz->pos[i] - S[STATE_X+i], xyz->stdDev);
+    h[positionStates[i]] = 1;
+    stateEstimatorScalarUpdate(&H, xyz->pos[i] - S[positionStates[i]], xyz->stdDev, MEAS_POSITION);
   }
 }
 
+#if KALMAN_HAS_POSITION_XY
 static void stateEstimatorUpdateWithDistance(distanceMeasurement_t *d)
 {
   // a measurement of distance to point (x, y, z)
@@ -970,7 +1413,7 @@ static void stateEstimatorUpdateWithDistance(distanceMeasurement_t *d)
   h[STATE_Y] = dy/predictedDistance;
   h[STATE_Z] = dz/predictedDistance;
 
-  stateEstimatorScalarUpdate(&H, measuredDistance-predictedDistance, d->stdDev);
+  stateEstimatorScalarUpdate(&H, measuredDistance-predictedDistance, d->stdDev, MEAS_DISTANCE);
 }
 
 static void stateEstimatorUpdateWithTDOA(tdoaMeasurement_t *tdoa)
@@ -1005,12 +1448,14 @@ static void stateEstimatorUpdateWithTDOA(tdoaMeasurement_t *tdoa)
     h[STATE_Y] = ((y - y1) / d1 - (y - y0) / d0);
     h[STATE_Z] = ((z - z1) / d1 - (z - z0) / d0);
 
-    stateEstimatorScalarUpdate(&H, error, tdoa->stdDev);
+    stateEstimatorScalarUpdate(&H, error, tdoa->stdDev, MEAS_TDOA);
   }
 
   tdoaCount++;
 }
+#endif
 
+#if KALMAN_HAS_VELOCITY_XY
 // TODO remove the temporary test variables (used for logging)
 static float omegax_b;
 static float omegay_b;
@@ -1072,7 +1517,7 @@ static void stateEstimatorUpdateWithFlow(flowMeasurement_t *flow, sensorData_t *
   hx[STATE_PX] = (Npix * flow->dt / thetapix) * (R[2][2] / z_g);
 
   //First update
-  stateEstimatorScalarUpdate(&Hx, measuredNX-predictedNX, flow->stdDevX);
+  stateEstimatorScalarUpdate(&Hx, measuredNX-predictedNX, flow->stdDevX, MEAS_FLOW_X);
 
   // ~~~ Y velocity prediction and update ~~~
   float hy[STATE_DIM] = {0};
@@ -1085,8 +1530,9 @@ static void stateEstimatorUpdateWithFlow(flowMeasurement_t *flow, sensorData_t *
   hy[STATE_PY] = (Npix * flow->dt / thetapix) * (R[2][2] / z_g);
 
   // Second update
-  stateEstimatorScalarUpdate(&Hy, measuredNY-predictedNY, flow->stdDevY);
+  stateEstimatorScalarUpdate(&Hy, measuredNY-predictedNY, flow->stdDevY, MEAS_FLOW_Y);
 }
+#endif
 
 static void stateEstimatorUpdateWithTof(tofMeasurement_t *tof)
 {
@@ -1111,7 +1557,7 @@ static void stateEstimatorUpdateWithTof(tofMeasurement_t *tof)
     //h[STATE_Z] = 1 / cosf(angle);
 
     // Scalar update
-    stateEstimatorScalarUpdate(&H, measuredDistance-predictedDistance, tof->stdDev);
+    stateEstimatorScalarUpdate(&H, measuredDistance-predictedDistance, tof->stdDev, MEAS_TOF);
   }
 }
 
@@ -1119,6 +1565,7 @@ static void stateEstimatorFinalize(sensorData_t *sensors, uint32_t tick)
 {
   // Matrix to rotate the attitude covariances once updated
   static float A[STATE_DIM][STATE_DIM];
+#ifndef KALMAN_USE_UD
   static arm_matrix_instance_f32 Am = {STATE_DIM, STATE_DIM, (float *)A};
 
   // Temporary matrices for the covariance updates
@@ -1127,6 +1574,7 @@ static void stateEstimatorFinalize(sensorData_t *sensors, uint32_t tick)
 
   static float tmpNN2d[STATE_DIM * STATE_DIM];
   static arm_matrix_instance_f32 tmpNN2m = {STATE_DIM, STATE_DIM, tmpNN2d};
+#endif
 
   // Incorporate the attitude error (Kalman filter state) with the attitude
   float v0 = S[STATE_D0];
@@ -1169,12 +1617,16 @@ static void stateEstimatorFinalize(sensorData_t *sensors, uint32_t tick)
     float d1 = v1/2; // so we use a first order approximation to d0 = tan(|v0|/2)*v0/|v0|
     float d2 = v2/2;
 
+#if KALMAN_HAS_POSITION_XY
     A[STATE_X][STATE_X] = 1;
     A[STATE_Y][STATE_Y] = 1;
+#endif
     A[STATE_Z][STATE_Z] = 1;
 
+#if KALMAN_HAS_VELOCITY_XY
     A[STATE_PX][STATE_PX] = 1;
     A[STATE_PY][STATE_PY] = 1;
+#endif
     A[STATE_PZ][STATE_PZ] = 1;
 
     A[STATE_D0][STATE_D0] =  1 - d1*d1/2 - d2*d2/2;
@@ -1189,9 +1641,13 @@ static void stateEstimatorFinalize(sensorData_t *sensors, uint32_t tick)
     A[STATE_D2][STATE_D1] = -d0 + d1*d2/2;
     A[STATE_D2][STATE_D2] = 1 - d0*d0/2 - d1*d1/2;
 
+#ifdef KALMAN_USE_UD
+    stateEstimatorPredictFactors((float *)A); // A(P+Q)A'
+#else
     mat_trans(&Am, &tmpNN1m); // A'
     mat_mult(&Am, &Pm, &tmpNN2m); // AP
     mat_mult(&tmpNN2m, &tmpNN1m, &Pm); //APA'
+#endif
   }
 
   // convert the new attitude to a rotation matrix, such that we can rotate body-frame velocity and acc
@@ -1213,28 +1669,37 @@ static void stateEstimatorFinalize(sensorData_t *sensors, uint32_t tick)
   S[STATE_D2] = 0;
 
   // constrain the states
+  static const stateIdx_t positionStates[] = {STATE_X, STATE_Y, STATE_Z};
+  static const stateIdx_t velocityStates[] = {STATE_PX, STATE_PY, STATE_PZ};
   for (int i=0; i<3; i++)
   {
-    if (S[STATE_X+i] < -MAX_POSITION) { S[STATE_X+i] = -MAX_POSITION; }
-    else if (S[STATE_X+i] > MAX_POSITION) { S[STATE_X+i] = MAX_POSITION; }
+    const stateIdx_t p = positionStates[i];
+    const stateIdx_t v = velocityStates[i];
 
-    if (S[STATE_PX+i] < -MAX_VELOCITY) { S[STATE_PX+i] = -MAX_VELOCITY; }
-    else if (S[STATE_PX+i] > MAX_VELOCITY) { S[STATE_PX+i] = MAX_VELOCITY; }
+    if (S[p] < -MAX_POSITION) { S[p] = -MAX_POSITION; }
+    else if (S[p] > MAX_POSITION) { S[p] = MAX_POSITION; }
+
+    if (S[v] < -MAX_VELOCITY) { S[v] = -MAX_VELOCITY; }
+    else if (S[v] > MAX_VELOCITY) { S[v] = MAX_VELOCITY; }
   }
 
+#ifndef KALMAN_USE_UD
   // enforce symmetry of the covariance matrix, and ensure the values stay bounded
   for (int i=0; i<STATE_DIM; i++) {
     for (int j=i; j<STATE_DIM; j++) {
       float p = 0.5f*P[i][j] + 0.5f*P[j][i];
       if (isnan(p) || p > MAX_COVARIANCE) {
         P[i][j] = P[j][i] = MAX_COVARIANCE;
+        covarianceClampCount++;
       } else if ( i==j && p < MIN_COVARIANCE ) {
         P[i][j] = P[j][i] = MIN_COVARIANCE;
+        covarianceClampCount++;
       } else {
         P[i][j] = P[j][i] = p;
       }
     }
   }
+#endif
 
   stateEstimatorAssertNotNaN();
 }
@@ -1292,23 +1757,91 @@ static void stateEstimatorExternalizeState(state_t *state, sensorData_t *sensors
   };
 }
 
+static uint8_t scoreFromStdDev(float variance)
+{
+  float stdDev = arm_sqrt(variance);
+  if (stdDev <= HEALTH_STDDEV_GOOD) {
+    return 100;
+  }
+  if (stdDev >= HEALTH_STDDEV_BAD) {
+    return 0;
+  }
+  return (uint8_t)(100.0f * (HEALTH_STDDEV_BAD - stdDev) / (HEALTH_STDDEV_BAD - HEALTH_STDDEV_GOOD));
+}
+
+static void stateEstimatorUpdateHealth(uint32_t tick)
+{
+  uint8_t consistencyScore = 100;
+  bool hasAbsoluteXY = false;
+  bool hasAiding = false;
+
+  nisInconsistent = 0;
+  for (int i = 0; i < MEAS_TYPE_COUNT; i++) {
+    const innovationMonitor_t* monitor = &innovationMonitors[i];
+    if (!monitor->isConsistent) {
+      nisInconsistent |= (1 << i);
+    }
+
+    if (innovationMonitorIsActive(monitor, tick, HEALTH_MAX_MEASUREMENT_AGE)) {
+      hasAiding |= (i != MEAS_DRAG && i != MEAS_MAG); // measured on board, not position aids
+      hasAbsoluteXY |= (i == MEAS_POSITION || i == MEAS_DISTANCE || i == MEAS_TDOA);
+
+      uint8_t score = innovationMonitorGetScore(monitor);
+      if (score < consistencyScore) {
+        consistencyScore = score;
+      }
+    }
+  }
+
+  // Without an absolute horizontal reference the position is dead-reckoned, the velocity is then what matters
+  float maxVariance = P[STATE_Z][STATE_Z];
+#if KALMAN_HAS_POSITION_XY
+  if (hasAbsoluteXY) {
+    maxVariance = fmaxf(maxVariance, fmaxf(P[STATE_X][STATE_X], P[STATE_Y][STATE_Y]));
+  } else
+#endif
+  {
+#if KALMAN_HAS_VELOCITY_XY
+    maxVariance = fmaxf(maxVariance, fmaxf(P[STATE_PX][STATE_PX], P[STATE_PY][STATE_PY]));
+#endif
+  }
+  uint8_t covarianceScore = scoreFromStdDev(maxVariance);
+
+  if (!hasAiding) {
+    positionQuality = 0;
+  } else {
+    positionQuality = (consistencyScore < covarianceScore) ? consistencyScore : covarianceScore;
+  }
+
+  if (histogramMeasType < MEAS_TYPE_COUNT) {
+    memcpy(histogram, innovationMonitors[histogramMeasType].histogram, sizeof(histogram));
+  }
+}
 
 void estimatorKalmanInit(void) {
   if (!isInit)
   {
+#if KALMAN_HAS_POSITION_XY
     distDataQueue = xQueueCreate(DIST_QUEUE_LENGTH, sizeof(distanceMeasurement_t));
-    posDataQueue = xQueueCreate(POS_QUEUE_LENGTH, sizeof(positionMeasurement_t));
     tdoaDataQueue = xQueueCreate(UWB_QUEUE_LENGTH, sizeof(tdoaMeasurement_t));
+#endif
+#if KALMAN_HAS_VELOCITY_XY
     flowDataQueue = xQueueCreate(FLOW_QUEUE_LENGTH, sizeof(flowMeasurement_t));
+#endif
+    posDataQueue = xQueueCreate(POS_QUEUE_LENGTH, sizeof(positionMeasurement_t));
     tofDataQueue = xQueueCreate(TOF_QUEUE_LENGTH, sizeof(tofMeasurement_t));
     heightDataQueue = xQueueCreate(HEIGHT_QUEUE_LENGTH, sizeof(heightMeasurement_t));
   }
   else
   {
+#if KALMAN_HAS_POSITION_XY
     xQueueReset(distDataQueue);
-    xQueueReset(posDataQueue);
     xQueueReset(tdoaDataQueue);
+#endif
+#if KALMAN_HAS_VELOCITY_XY
     xQueueReset(flowDataQueue);
+#endif
+    xQueueReset(posDataQueue);
     xQueueReset(tofDataQueue);
   }
 
@@ -1326,6 +1859,8 @@ void estimatorKalmanInit(void) {
   gyroAccumulatorCount = 0;
   thrustAccumulatorCount = 0;
   baroAccumulatorCount = 0;
+  lastPredictionTimestamp = 0;
+  isMagHeadingReferenceSet = false;
 
   // Reset all matrices to 0 (like uppon system reset)
   memset(q, 0, sizeof(q));
@@ -1358,12 +1893,16 @@ void estimatorKalmanInit(void) {
   }
 
   // initialize state variances
+#if KALMAN_HAS_POSITION_XY
   P[STATE_X][STATE_X]  = powf(stdDevInitialPosition_xy, 2);
   P[STATE_Y][STATE_Y]  = powf(stdDevInitialPosition_xy, 2);
+#endif
   P[STATE_Z][STATE_Z]  = powf(stdDevInitialPosition_z, 2);
 
+#if KALMAN_HAS_VELOCITY_XY
   P[STATE_PX][STATE_PX] = powf(stdDevInitialVelocity, 2);
   P[STATE_PY][STATE_PY] = powf(stdDevInitialVelocity, 2);
+#endif
   P[STATE_PZ][STATE_PZ] = powf(stdDevInitialVelocity, 2);
 
   P[STATE_D0][STATE_D0] = powf(stdDevInitialAttitude_rollpitch, 2);
@@ -1372,7 +1911,25 @@ void estimatorKalmanInit(void) {
 
   varSkew = powf(stdDevInitialSkew, 2);
 
+#ifdef KALMAN_USE_UD
+  memset(pendingProcessNoise, 0, sizeof(pendingProcessNoise));
+  hasPendingProcessNoise = false;
+  stateEstimatorFactorizeCovariance();
+#endif
+  covarianceClampCount = 0;
+
   tdoaCount = 0;
+
+  for (int i = 0; i < MEAS_TYPE_COUNT; i++) {
+    innovationMonitorInit(&innovationMonitors[i], NIS_WINDOW_SIZE);
+    adaptiveNoiseInit(&measNoiseAdaptation[i], adaptiveNoiseRate, adaptiveNoiseMinScale, adaptiveNoiseMaxScale);
+  }
+  flightPhase = FLIGHT_PHASE_GROUND;
+  agitation = 0;
+  procNoiseScale = 1.0f;
+  nisInconsistent = 0;
+  positionQuality = 0;
+
   isInit = true;
 }
 
@@ -1397,7 +1954,11 @@ static bool stateEstimatorEnqueueExternalMeasurement(xQueueHandle queue, void *m
 bool estimatorKalmanEnqueueTDOA(tdoaMeasurement_t *uwb)
 {
   ASSERT(isInit);
+#if KALMAN_HAS_POSITION_XY
   return stateEstimatorEnqueueExternalMeasurement(tdoaDataQueue, (void *)uwb);
+#else
+  return false;
+#endif
 }
 
 bool estimatorKalmanEnqueuePosition(positionMeasurement_t *pos)
@@ -1409,14 +1970,22 @@ bool estimatorKalmanEnqueuePosition(positionMeasurement_t *pos)
 bool estimatorKalmanEnqueueDistance(distanceMeasurement_t *dist)
 {
   ASSERT(isInit);
+#if KALMAN_HAS_POSITION_XY
   return stateEstimatorEnqueueExternalMeasurement(distDataQueue, (void *)dist);
+#else
+  return false;
+#endif
 }
 
 bool estimatorKalmanEnqueueFlow(flowMeasurement_t *flow)
 {
   // A flow measurement (dnx,  dny) [accumulated pixels]
   ASSERT(isInit);
+#if KALMAN_HAS_VELOCITY_XY
   return stateEstimatorEnqueueExternalMeasurement(flowDataQueue, (void *)flow);
+#else
+  return false;
+#endif
 }
 
 bool estimatorKalmanEnqueueTOF(tofMeasurement_t *tof)
@@ -1458,6 +2027,10 @@ void estimatorKalmanGetEstimatedPos(point_t* pos) {
   pos->z = S[STATE_Z];
 }
 
+uint8_t estimatorKalmanGetPositionQuality() {
+  return positionQuality;
+}
+
 // Temporary development groups
 LOG_GROUP_START(kalman_states)
   LOG_ADD(LOG_FLOAT, ox, &S[STATE_X])
@@ -1466,12 +2039,14 @@ LOG_GROUP_START(kalman_states)
   LOG_ADD(LOG_FLOAT, vy, &S[STATE_PY])
 LOG_GROUP_STOP(kalman_states)
 
+#if KALMAN_HAS_VELOCITY_XY
 LOG_GROUP_START(kalman_pred)
   LOG_ADD(LOG_FLOAT, predNX, &predictedNX)
   LOG_ADD(LOG_FLOAT, predNY, &predictedNY)
   LOG_ADD(LOG_FLOAT, measNX, &measuredNX)
   LOG_ADD(LOG_FLOAT, measNY, &measuredNY)
 LOG_GROUP_STOP(kalman_pred)
+#endif
 
 // Stock log groups
 LOG_GROUP_START(kalman)
@@ -1486,11 +2061,15 @@ LOG_GROUP_START(kalman)
   LOG_ADD(LOG_FLOAT, stateD1, &S[STATE_D1])
   LOG_ADD(LOG_FLOAT, stateD2, &S[STATE_D2])
   LOG_ADD(LOG_FLOAT, stateSkew, &stateSkew)
+#if KALMAN_HAS_POSITION_XY
   LOG_ADD(LOG_FLOAT, varX, &P[STATE_X][STATE_X])
   LOG_ADD(LOG_FLOAT, varY, &P[STATE_Y][STATE_Y])
+#endif
   LOG_ADD(LOG_FLOAT, varZ, &P[STATE_Z][STATE_Z])
+#if KALMAN_HAS_VELOCITY_XY
   LOG_ADD(LOG_FLOAT, varPX, &P[STATE_PX][STATE_PX])
   LOG_ADD(LOG_FLOAT, varPY, &P[STATE_PY][STATE_PY])
+#endif
   LOG_ADD(LOG_FLOAT, varPZ, &P[STATE_PZ][STATE_PZ])
   LOG_ADD(LOG_FLOAT, varD0, &P[STATE_D0][STATE_D0])
   LOG_ADD(LOG_FLOAT, varD1, &P[STATE_D1][STATE_D1])
@@ -1500,8 +2079,56 @@ LOG_GROUP_START(kalman)
   LOG_ADD(LOG_FLOAT, q1, &q[1])
   LOG_ADD(LOG_FLOAT, q2, &q[2])
   LOG_ADD(LOG_FLOAT, q3, &q[3])
+  LOG_ADD(LOG_UINT32, covClamp, &covarianceClampCount)
 LOG_GROUP_STOP(kalman)
 
+LOG_GROUP_START(kalman_nis)
+  LOG_ADD(LOG_UINT8, posQuality, &positionQuality)
+  LOG_ADD(LOG_UINT16, inconsistent, &nisInconsistent)
+  LOG_ADD(LOG_FP16, tof, &innovationMonitors[MEAS_TOF].nisMean)
+  LOG_ADD(LOG_FP16, height, &innovationMonitors[MEAS_HEIGHT].nisMean)
+  LOG_ADD(LOG_FP16, pos, &innovationMonitors[MEAS_POSITION].nisMean)
+  LOG_ADD(LOG_FP16, dist, &innovationMonitors[MEAS_DISTANCE].nisMean)
+  LOG_ADD(LOG_FP16, tdoa, &innovationMonitors[MEAS_TDOA].nisMean)
+  LOG_ADD(LOG_FP16, flowX, &innovationMonitors[MEAS_FLOW_X].nisMean)
+  LOG_ADD(LOG_FP16, flowY, &innovationMonitors[MEAS_FLOW_Y].nisMean)
+  LOG_ADD(LOG_FP16, baro, &innovationMonitors[MEAS_BARO].nisMean)
+  LOG_ADD(LOG_FP16, drag, &innovationMonitors[MEAS_DRAG].nisMean)
+  LOG_ADD(LOG_FP16, mag, &innovationMonitors[MEAS_MAG].nisMean)
+LOG_GROUP_STOP(kalman_nis)
+
+LOG_GROUP_START(kalman_nisCnt)
+  LOG_ADD(LOG_UINT32, tof, &innovationMonitors[MEAS_TOF].updateCount)
+  LOG_ADD(LOG_UINT32, height, &innovationMonitors[MEAS_HEIGHT].updateCount)
+  LOG_ADD(LOG_UINT32, pos, &innovationMonitors[MEAS_POSITION].updateCount)
+  LOG_ADD(LOG_UINT32, dist, &innovationMonitors[MEAS_DISTANCE].updateCount)
+  LOG_ADD(LOG_UINT32, tdoa, &innovationMonitors[MEAS_TDOA].updateCount)
+  LOG_ADD(LOG_UINT32, flowX, &innovationMonitors[MEAS_FLOW_X].updateCount)
+  LOG_ADD(LOG_UINT32, flowY, &innovationMonitors[MEAS_FLOW_Y].updateCount)
+  LOG_ADD(LOG_UINT32, baro, &innovationMonitors[MEAS_BARO].updateCount)
+  LOG_ADD(LOG_UINT32, drag, &innovationMonitors[MEAS_DRAG].updateCount)
+  LOG_ADD(LOG_UINT32, mag, &innovationMonitors[MEAS_MAG].updateCount)
+  LOG_ADD(LOG_UINT16, hist0, &histogram[0])
+  LOG_ADD(LOG_UINT16, hist1, &histogram[1])
+  LOG_ADD(LOG_UINT16, hist2, &histogram[2])
+  LOG_ADD(LOG_UINT16, hist3, &histogram[3])
+LOG_GROUP_STOP(kalman_nisCnt)
+
+LOG_GROUP_START(kalman_adapt)
+  LOG_ADD(LOG_UINT8, phase, &flightPhase)
+  LOG_ADD(LOG_FLOAT, pNScale, &procNoiseScale)
+  LOG_ADD(LOG_FP16, tof, &measNoiseAdaptation[MEAS_TOF].scale)
+  LOG_ADD(LOG_FP16, height, &measNoiseAdaptation[MEAS_HEIGHT].scale)
+  LOG_ADD(LOG_FP16, pos, &measNoiseAdaptation[MEAS_POSITION].scale)
+  LOG_ADD(LOG_FP16, dist, &measNoiseAdaptation[MEAS_DISTANCE].scale)
+  LOG_ADD(LOG_FP16, tdoa, &measNoiseAdaptation[MEAS_TDOA].scale)
+  LOG_ADD(LOG_FP16, flowX, &measNoiseAdaptation[MEAS_FLOW_X].scale)
+  LOG_ADD(LOG_FP16, flowY, &measNoiseAdaptation[MEAS_FLOW_Y].scale)
+  LOG_ADD(LOG_FP16, baro, &measNoiseAdaptation[MEAS_BARO].scale)
+  LOG_ADD(LOG_FP16, drag, &measNoiseAdaptation[MEAS_DRAG].scale)
+  LOG_ADD(LOG_FP16, mag, &measNoiseAdaptation[MEAS_MAG].scale)
+LOG_GROUP_STOP(kalman_adapt)
+
 PARAM_GROUP_START(kalman)
   PARAM_ADD(PARAM_UINT8, resetEstimation, &resetEstimation)
   PARAM_ADD(PARAM_UINT8, quadIsFlying, &quadIsFlying)
@@ -1517,4 +2144,19 @@ PARAM_GROUP_START(kalman)
   PARAM_ADD(PARAM_FLOAT, initialX, &initialX)
   PARAM_ADD(PARAM_FLOAT, initialY, &initialY)
   PARAM_ADD(PARAM_FLOAT, initialZ, &initialZ)
+  PARAM_ADD(PARAM_UINT8, histMeasType, &histogramMeasType)
+  PARAM_ADD(PARAM_UINT8, adaptive, &useAdaptiveNoise)
+  PARAM_ADD(PARAM_FLOAT, anRate, &adaptiveNoiseRate)
+  PARAM_ADD(PARAM_FLOAT, anMinScale, &adaptiveNoiseMinScale)
+  PARAM_ADD(PARAM_FLOAT, anMaxScale, &adaptiveNoiseMaxScale)
+  PARAM_ADD(PARAM_FLOAT, pNScaleGnd, &procNoiseScaleGround)
+  PARAM_ADD(PARAM_FLOAT, pNScaleAggr, &procNoiseScaleAggressive)
+  PARAM_ADD(PARAM_FLOAT, mass, &vehicleMass)
+  PARAM_ADD(PARAM_UINT8, dragModel, &useDragModel)
+  PARAM_ADD(PARAM_FLOAT, dragXY, &dragCoeff_xy)
+  PARAM_ADD(PARAM_FLOAT, mNAccDrag, &measNoiseAccDrag)
+  PARAM_ADD(PARAM_UINT8, useMag, &useMag)
+  PARAM_ADD(PARAM_FLOAT, mNMag, &measNoiseMag)
+  PARAM_ADD(PARAM_UINT8, thrustModel, &useThrustModel)
+  PARAM_ADD(PARAM_FLOAT, rotorRadius, &rotorRadius)
 PARAM_GROUP_STOP(kalman)
@@ -86,6 +86,7 @@ struct log_block {
   int id;
   xTimerHandle timer;
   struct log_ops * ops;
+  float credit;  // Runs owed to the block, see logBlockTimed()
 };
 
 static struct log_ops logOps[LOG_MAX_OPS];
@@ -123,6 +124,10 @@ struct ops_setting_v2 {
 
 #define BLOCK_ID_FREE -1
 
+// CRTP tx queue packets left to the other ports, log packets are dropped
+// rather than taking them
+#define LOG_TX_QUEUE_RESERVE 10
+
 //Private functions
 static void logTask(void * prm);
 static void logTOCProcess(int command);
@@ -363,18 +368,20 @@ void logTOCProcess(int command)
 void logControlProcess()
 {
   int ret = ENOEXEC;
+  // Length of the settings following the command and the block id
+  int settingsLength = (p.size > 2) ? p.size - 2 : 0;
 
   switch(p.data[0])
   {
     case CONTROL_CREATE_BLOCK:
       ret = logCreateBlock( p.data[1],
                             (struct ops_setting*)&p.data[2],
-                            (p.size-2)/sizeof(struct ops_setting) );
+                            settingsLength/sizeof(struct ops_setting) );
       break;
     case CONTROL_APPEND_BLOCK:
       ret = logAppendBlock( p.data[1],
                             (struct ops_setting*)&p.data[2],
-                            (p.size-2)/sizeof(struct ops_setting) );
+                            settingsLength/sizeof(struct ops_setting) );
       break;
     case CONTROL_DELETE_BLOCK:
       ret = logDeleteBlock( p.data[1] );
@@ -392,12 +399,12 @@ void logControlProcess()
     case CONTROL_CREATE_BLOCK_V2:
       ret = logCreateBlockV2( p.data[1],
                             (struct ops_setting_v2*)&p.data[2],
-                            (p.size-2)/sizeof(struct ops_setting_v2) );
+                            settingsLength/sizeof(struct ops_setting_v2) );
       break;
     case CONTROL_APPEND_BLOCK_V2:
       ret = logAppendBlockV2( p.data[1],
                             (struct ops_setting_v2*)&p.data[2],
-                            (p.size-2)/sizeof(struct ops_setting_v2) );
+                            settingsLength/sizeof(struct ops_setting_v2) );
       break;
   }
 
@@ -470,6 +477,7 @@ static struct log_ops * opsMalloc();
 static void opsFree(struct log_ops * ops);
 static void blockAppendOps(struct log_block * block, struct log_ops * ops);
 static int variableGetIndex(int id);
+static bool isValidType(int type);
 
 static int logAppendBlock(int id, struct ops_setting * settings, int len)
 {
@@ -494,6 +502,11 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
     struct log_ops * ops;
     int varId;
 
+    if (!isValidType(settings[i].logType&0x0F)) {
+      LOG_ERROR("Trying to append an unknown type. Block id %d.\n", id);
+      return EINVAL;
+    }
+
     if ((currentLength + typeLength[settings[i].logType&0x0F])>LOG_MAX_LEN) {
       LOG_ERROR("Trying to append a full block. Block id %d.\n", id);
       return E2BIG;
@@ -521,6 +534,12 @@ static int logAppendBlock(int id, struct ops_setting * settings, int len)
 
       LOG_DEBUG("Appended variable %d to block %d\n", settings[i].id, id);
     } else {                     //Memory variable
+      // The address takes the space of the two following settings
+      if (!isValidType((settings[i].logType>>4)&0x0F) || i + 2 >= len) {
+        LOG_ERROR("Trying to add an invalid memory variable. Block id %d.\n", id);
+        return EINVAL;
+      }
+
       //TODO: Check that the address is in ram
       ops->variable    = (void*)(&settings[i]+1);
       ops->storageType = (settings[i].logType>>4)&0x0F;
@@ -560,6 +579,11 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
     struct log_ops * ops;
     int varId;
 
+    if (!isValidType(settings[i].logType&0x0F)) {
+      LOG_ERROR("Trying to append an unknown type. Block id %d.\n", id);
+      return EINVAL;
+    }
+
     if ((currentLength + typeLength[settings[i].logType&0x0F])>LOG_MAX_LEN) {
       LOG_ERROR("Trying to append a full block. Block id %d.\n", id);
       return E2BIG;
@@ -587,6 +611,12 @@ static int logAppendBlockV2(int id, struct ops_setting_v2 * settings, int len)
 
       LOG_DEBUG("Appended variable %d to block %d\n", settings[i].id, id);
     } else {                     //Memory variable
+      // The address takes the space of the two following settings
+      if (!isValidType((settings[i].logType>>4)&0x0F) || i + 2 >= len) {
+        LOG_ERROR("Trying to add an invalid memory variable. Block id %d.\n", id);
+        return EINVAL;
+      }
+
       //TODO: Check that the address is in ram
       ops->variable    = (void*)(&settings[i]+1);
       ops->storageType = (settings[i].logType>>4)&0x0F;
@@ -651,6 +681,7 @@ static int logStartBlock(int id, unsigned int period)
 
   if (period>0)
   {
+    logBlocks[i].credit = 1.0f;
     xTimerChangePeriod(logBlocks[i].timer, M2T(period), 100);
     xTimerStart(logBlocks[i].timer, 100);
   } else {
@@ -678,10 +709,19 @@ static int logStopBlock(int id)
   return 0;
 }
 
-/* This function is called by the timer subsystem */
+/* This function is called by the timer subsystem. When the link can not
+ * take all the telemetry only every few periods are run, which lengthens the
+ * period of all blocks by the same factor. */
 void logBlockTimed(xTimerHandle timer)
 {
-  workerSchedule(logRunBlock, pvTimerGetTimerID(timer));
+  struct log_block *blk = pvTimerGetTimerID(timer);
+
+  blk->credit += crtpGetTelemetryRate();
+  if (blk->credit >= 1.0f)
+  {
+    blk->credit -= 1.0f;
+    workerSchedule(logRunBlock, blk);
+  }
 }
 
 /* Appends data to a packet if space is available; returns false on failure. */
@@ -814,7 +854,7 @@ void logRunBlock(void * arg)
     logReset();
     crtpReset();
   }
-  else
+  else if (crtpGetFreeTxQueuePackets() > LOG_TX_QUEUE_RESERVE)
   {
     crtpSendPacket(&pk);
   }
@@ -959,6 +999,11 @@ void* logGetAddress(int varid)
   return logs[varid].address;
 }
 
+static bool isValidType(int type)
+{
+  return type >= LOG_UINT8 && type <= LOG_FP16;
+}
+
 uint8_t logVarSize(int type)
 {
   return typeLength[type];
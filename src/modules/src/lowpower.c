@@ -0,0 +1,150 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * lowpower.c - Tickless idle while on the ground
+ *
+ * The port suppresses the tick, the hooks here decide when that is allowed
+ * and sleep with usecTimerSleep(), which keeps the cycle counter running
+ * across the sleep, and measure the sleeps. The wake latency is the time
+ * from the SysTick expiry to the core running again, for the sleeps that
+ * last until the next task is due. The sleeps ended by an interrupt, such as
+ * the IMU data ready, are counted but have no known wake time.
+ *
+ * When idle on the ground, with no setpoint source active either, the
+ * stabilizer reads the sensors at SENSORS_IDLE_RATE_HZ with the IMU data
+ * ready interrupt masked, so the sleeps are no longer cut every millisecond.
+ */
+
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "stm32fxxx.h"
+#include "param.h"
+#include "log.h"
+#include "lowpower.h"
+#include "stabilizer.h"
+#include "commander.h"
+#include "usec_time.h"
+#include "sleepStats.h"
+
+// The watchdog is fed from the idle hook between the sleeps, keep the sum of
+// its period and a sleep well below the ~188 ms timeout
+#define LOWPOWER_MAX_SLEEP_MS 50
+#define LOWPOWER_STATS_WINDOW_MS 1000
+
+// Defined by the port
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime);
+
+static uint8_t isEnabled = 1;
+static uint8_t isActive;
+
+static sleepStats_t stats;
+static bool isStatsInit;
+static uint64_t sleepStart;
+
+// Result of the last statistics window
+static float sleepRatio;
+static uint32_t sleeps;
+static float meanSleepUs;
+static float meanLatencyUs;
+static float maxLatencyUs;
+
+static void updateStats(void)
+{
+  uint64_t now = cycleTimestamp();
+
+  if (!isStatsInit) {
+    sleepStatsInit(&stats, now);
+    isStatsInit = true;
+  }
+
+  if (sleepStatsUpdate(&stats, now, usecToCycles(LOWPOWER_STATS_WINDOW_MS * 1000))) {
+    sleepRatio = stats.sleepRatio;
+    sleeps = stats.sleeps;
+    meanSleepUs = cyclesToUsecf(stats.meanSleep);
+    meanLatencyUs = cyclesToUsecf(stats.meanLatency);
+    maxLatencyUs = cyclesToUsecf(stats.maxLatency);
+  }
+}
+
+void lowPowerSuppressTicksAndSleep(uint32_t expectedIdleTime)
+{
+  updateStats();
+
+  isActive = isEnabled && !stabilizerIsFlying();
+#ifdef DEBUG
+  // Sleep does not work when debugging the chip with SWD, see the idle hook
+  isActive = false;
+#endif
+
+  if (!isActive) {
+    return;
+  }
+
+  if (expectedIdleTime > M2T(LOWPOWER_MAX_SLEEP_MS)) {
+    expectedIdleTime = M2T(LOWPOWER_MAX_SLEEP_MS);
+  }
+  vPortSuppressTicksAndSleep(expectedIdleTime);
+}
+
+void lowPowerPreSleep(uint32_t* idleTime)
+{
+  sleepStart = cycleTimestamp();
+
+  // The port skips its own wfi
+  *idleTime = 0;
+  usecTimerSleep();
+}
+
+void lowPowerPostSleep(uint32_t idleTime)
+{
+  const uint32_t sleepCycles = (uint32_t)(cycleTimestamp() - sleepStart);
+
+  // The SysTick interrupt is pending if it expired during the sleep. It has
+  // been reloaded then, and counted down from the reload value since.
+  const bool isTickWakeup = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+  const uint32_t latencyCycles = SysTick->LOAD - SysTick->VAL;
+
+  sleepStatsAdd(&stats, sleepCycles, isTickWakeup, latencyCycles);
+}
+
+bool lowPowerIsIdle(void)
+{
+  return isEnabled && !stabilizerIsFlying() &&
+         commanderGetActivePriority() == COMMANDER_PRIORITY_DISABLE;
+}
+
+PARAM_GROUP_START(lowpower)
+PARAM_ADD(PARAM_UINT8, tickless, &isEnabled)
+PARAM_GROUP_STOP(lowpower)
+
+LOG_GROUP_START(lowpower)
+LOG_ADD(LOG_UINT8, active, &isActive)
+LOG_ADD(LOG_FLOAT, sleepRatio, &sleepRatio)
+LOG_ADD(LOG_UINT32, sleeps, &sleeps)
+LOG_ADD(LOG_FLOAT, sleepUs, &meanSleepUs)
+LOG_ADD(LOG_FLOAT, wakeLatUs, &meanLatencyUs)
+LOG_ADD(LOG_FLOAT, wakeLatMaxUs, &maxLatencyUs)
+LOG_GROUP_STOP(lowpower)
@@ -38,12 +38,15 @@
 #include "config.h"
 #include "crtp.h"
 #include "mem.h"
+#include "mem_window.h"
 #include "ow.h"
 #include "eeprom.h"
 
 #include "ledring12.h"
 #include "locodeck.h"
 #include "crtp_commander_high_level.h"
+#include "spectrum.h"
+#include "trajectory_flash.h"
 
 #include "console.h"
 #include "assert.h"
@@ -67,7 +70,9 @@
 #define LEDMEM_ID       0x01
 #define LOCO_ID         0x02
 #define TRAJ_ID         0x03
-#define OW_FIRST_ID     0x04
+#define SPECTRUM_ID     0x04
+#define TRAJ_FLASH_ID   0x05
+#define OW_FIRST_ID     0x06
 
 #define STATUS_OK 0
 
@@ -76,6 +81,8 @@
 #define MEM_TYPE_LED12  0x10
 #define MEM_TYPE_LOCO   0x11
 #define MEM_TYPE_TRAJ   0x12
+#define MEM_TYPE_SPECTRUM 0x13
+#define MEM_TYPE_TRAJ_FLASH 0x14
 
 #define MEM_LOCO_INFO             0x0000
 #define MEM_LOCO_ANCHOR_BASE      0x1000
@@ -89,10 +96,14 @@ static void memTask(void * prm);
 static void memSettingsProcess(int command);
 static void memWriteProcess(void);
 static void memReadProcess(void);
+static uint8_t readMemory(uint8_t memId, uint32_t memAddr, uint8_t readLen, uint8_t* dest);
+static uint8_t writeMemory(uint8_t memId, uint32_t memAddr, uint8_t writeLen, const uint8_t* src);
+static void sendWindowPacket(const uint8_t* data, uint8_t size);
 static uint8_t handleLocoMemRead(uint32_t memAddr, uint8_t readLen, uint8_t* dest);
 static void createNbrResponse(CRTPPacket* p);
 static void createInfoResponse(CRTPPacket* p, uint8_t memId);
 static void createInfoResponseBody(CRTPPacket* p, uint8_t type, uint32_t memSize, const uint8_t data[8]);
+static bool isInRange(uint32_t memAddr, uint32_t len, uint32_t memSize);
 
 static bool isInit = false;
 
@@ -105,6 +116,14 @@ static const OwSerialNum eepromSerialNum =
 static const uint8_t noData[8] = {0, 0, 0, 0, 0, 0, 0, 0};
 static CRTPPacket p;
 
+static memWindow_t window;
+static const memWindowOps_t windowOps = {
+  .read = readMemory,
+  .write = writeMemory,
+  .send = sendWindowPacket,
+};
+static CRTPPacket windowPacket;
+
 void memInit(void)
 {
   if(isInit)
@@ -114,6 +133,8 @@ void memInit(void)
     isInit = true;
   else
     isInit = false;
+
+  memWindowInit(&window, &windowOps);
   
   //Start the mem task
   xTaskCreate(memTask, MEM_TASK_NAME,
@@ -144,6 +165,9 @@ void memTask(void * param)
       case MEM_WRITE_CH:
         memWriteProcess();
         break;
+      case MEM_WINDOW_CH:
+        memWindowHandlePacket(&window, p.data, p.size);
+        break;
       default:
         break;
 		}
@@ -199,6 +223,12 @@ void createInfoResponse(CRTPPacket* p, uint8_t memId)
     case TRAJ_ID:
       createInfoResponseBody(p, MEM_TYPE_TRAJ, sizeof(trajectories_memory), noData);
       break;
+    case SPECTRUM_ID:
+      createInfoResponseBody(p, MEM_TYPE_SPECTRUM, SPECTRUM_MEM_SIZE, noData);
+      break;
+    case TRAJ_FLASH_ID:
+      createInfoResponseBody(p, MEM_TYPE_TRAJ_FLASH, TRAJECTORY_FLASH_SIZE, noData);
+      break;
     default:
       if (owGetinfo(memId - OW_FIRST_ID, &serialNbr))
       {
@@ -234,12 +264,47 @@ void memReadProcess()
   p.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_READ_CH);
   // Dont' touch the first 5 bytes, they will be the same.
 
+  // The request must be complete and the data must fit in the answer
+  if (p.size < 6 || readLen > MEM_MAX_LEN - 6)
+  {
+    p.data[5] = EIO;
+    p.size = 6;
+    crtpSendPacket(&p);
+    return;
+  }
+
+  status = readMemory(memId, memAddr, readLen, &p.data[6]);
+
+#if 0
+  {
+    int i;
+    for (i = 0; i < readLen; i++)
+      consolePrintf("%X ", p.data[i+6]);
+
+    consolePrintf("\nStatus %i\n", status);
+  }
+#endif
+
+  p.data[5] = status;
+  if (status == STATUS_OK)
+    p.size = 6 + readLen;
+  else
+    p.size = 6;
+
+
+  crtpSendPacket(&p);
+}
+
+uint8_t readMemory(uint8_t memId, uint32_t memAddr, uint8_t readLen, uint8_t* dest)
+{
+  uint8_t status = STATUS_OK;
+
   switch(memId)
   {
     case EEPROM_ID:
       {
-        if (memAddr + readLen <= EEPROM_SIZE &&
-            eepromReadBuffer(&p.data[6], memAddr, readLen))
+        if (isInRange(memAddr, readLen, EEPROM_SIZE) &&
+            eepromReadBuffer(dest, memAddr, readLen))
           status = STATUS_OK;
         else
           status = EIO;
@@ -248,8 +313,8 @@ void memReadProcess()
 
     case LEDMEM_ID:
       {
-        if (memAddr + readLen <= sizeof(ledringmem) &&
-            memcpy(&p.data[6], &(ledringmem[memAddr]), readLen))
+        if (isInRange(memAddr, readLen, sizeof(ledringmem)) &&
+            memcpy(dest, &(ledringmem[memAddr]), readLen))
           status = STATUS_OK;
         else
           status = EIO;
@@ -257,13 +322,13 @@ void memReadProcess()
       break;
 
     case LOCO_ID:
-      status = handleLocoMemRead(memAddr, readLen, &p.data[6]);
+      status = handleLocoMemRead(memAddr, readLen, dest);
       break;
 
     case TRAJ_ID:
       {
-        if (memAddr + readLen <= sizeof(trajectories_memory) &&
-            memcpy(&p.data[6], &(trajectories_memory[memAddr]), readLen)) {
+        if (isInRange(memAddr, readLen, sizeof(trajectories_memory)) &&
+            memcpy(dest, &(trajectories_memory[memAddr]), readLen)) {
           status = STATUS_OK;
         } else {
           status = EIO;
@@ -271,11 +336,19 @@ void memReadProcess()
       }
       break;
 
+    case SPECTRUM_ID:
+      status = spectrumReadMem(memAddr, readLen, dest) ? STATUS_OK : EIO;
+      break;
+
+    case TRAJ_FLASH_ID:
+      status = trajectoryFlashReadMem(memAddr, readLen, dest) ? STATUS_OK : EIO;
+      break;
+
     default:
       {
         memId = memId - OW_FIRST_ID;
-        if (memAddr + readLen <= OW_MAX_SIZE &&
-            owRead(memId, memAddr, readLen, &p.data[6]))
+        if (isInRange(memAddr, readLen, OW_MAX_SIZE) &&
+            owRead(memId, memAddr, readLen, dest))
           status = STATUS_OK;
         else
           status = EIO;
@@ -283,24 +356,13 @@ void memReadProcess()
       break;
   }
 
-#if 0
-  {
-    int i;
-    for (i = 0; i < readLen; i++)
-      consolePrintf("%X ", p.data[i+6]);
-
-    consolePrintf("\nStatus %i\n", status);
-  }
-#endif
-
-  p.data[5] = status;
-  if (status == STATUS_OK)
-    p.size = 6 + readLen;
-  else
-    p.size = 6;
-
+  return status;
+}
 
-  crtpSendPacket(&p);
+// Checks the access without overflowing memAddr + len
+bool isInRange(uint32_t memAddr, uint32_t len, uint32_t memSize)
+{
+  return memAddr <= memSize && len <= memSize - memAddr;
 }
 
 #define ANCHOR_ID_LIST_LENGTH 256
@@ -368,12 +430,32 @@ void memWriteProcess()
   p.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_WRITE_CH);
   // Dont' touch the first 5 bytes, they will be the same.
 
+  if (p.size < 5)
+  {
+    p.data[5] = EIO;
+    p.size = 6;
+    crtpSendPacket(&p);
+    return;
+  }
+
+  status = writeMemory(memId, memAddr, writeLen, &p.data[5]);
+
+  p.data[5] = status;
+  p.size = 6;
+
+  crtpSendPacket(&p);
+}
+
+uint8_t writeMemory(uint8_t memId, uint32_t memAddr, uint8_t writeLen, const uint8_t* src)
+{
+  uint8_t status = STATUS_OK;
+
   switch(memId)
   {
     case EEPROM_ID:
       {
-        if (memAddr + writeLen <= EEPROM_SIZE &&
-            eepromWriteBuffer(&p.data[5], memAddr, writeLen))
+        if (isInRange(memAddr, writeLen, EEPROM_SIZE) &&
+            eepromWriteBuffer((uint8_t*)src, memAddr, writeLen))
           status = STATUS_OK;
         else
           status = EIO;
@@ -382,9 +464,9 @@ void memWriteProcess()
 
     case LEDMEM_ID:
       {
-        if ((memAddr + writeLen) <= sizeof(ledringmem))
+        if (isInRange(memAddr, writeLen, sizeof(ledringmem)))
         {
-          memcpy(&(ledringmem[memAddr]), &p.data[5], writeLen);
+          memcpy(&(ledringmem[memAddr]), src, writeLen);
           MEM_DEBUG("LED write addr:%i, led:%i\n", memAddr, writeLen);
         }
         else
@@ -401,8 +483,8 @@ void memWriteProcess()
 
     case TRAJ_ID:
       {
-        if ((memAddr + writeLen) <= sizeof(trajectories_memory)) {
-          memcpy(&(trajectories_memory[memAddr]), &p.data[5], writeLen);
+        if (isInRange(memAddr, writeLen, sizeof(trajectories_memory))) {
+          memcpy(&(trajectories_memory[memAddr]), src, writeLen);
           status = STATUS_OK;
         } else {
           status = EIO;
@@ -410,11 +492,20 @@ void memWriteProcess()
       }
       break;
 
+    case SPECTRUM_ID:
+      // Read only
+      status = EIO;
+      break;
+
+    case TRAJ_FLASH_ID:
+      status = trajectoryFlashWriteMem(memAddr, writeLen, src);
+      break;
+
     default:
       {
         memId = memId - OW_FIRST_ID;
-        if (memAddr + writeLen <= OW_MAX_SIZE &&
-            owWrite(memId, memAddr, writeLen, &p.data[5]))
+        if (isInRange(memAddr, writeLen, OW_MAX_SIZE) &&
+            owWrite(memId, memAddr, writeLen, (uint8_t*)src))
           status = STATUS_OK;
         else
           status = EIO;
@@ -422,8 +513,14 @@ void memWriteProcess()
       break;
   }
 
-  p.data[5] = status;
-  p.size = 6;
+  return status;
+}
 
-  crtpSendPacket(&p);
+// Blocks rather than drop a packet of a window when the queue is full
+void sendWindowPacket(const uint8_t* data, uint8_t size)
+{
+  windowPacket.header = CRTP_HEADER(CRTP_PORT_MEM, MEM_WINDOW_CH);
+  windowPacket.size = size;
+  memcpy(windowPacket.data, data, size);
+  crtpSendPacketBlock(&windowPacket);
 }
@@ -0,0 +1,192 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * mem_window.c - Windowed transfers for the memory port
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "mem_window.h"
+#include "crc.h"
+
+#define START_SIZE 11
+
+static void sendStatus(memWindow_t* mw, uint8_t command, uint8_t status)
+{
+  uint8_t answer[2] = {command, status};
+  mw->ops->send(answer, sizeof(answer));
+}
+
+// A WRITE_ACK or READ_END
+static void sendAck(memWindow_t* mw, uint8_t command, uint8_t status, uint32_t offset, uint32_t crc)
+{
+  uint8_t answer[10] = {command, status};
+  crc = crcSlowFinalize(crc);
+  memcpy(&answer[2], &offset, 4);
+  memcpy(&answer[6], &crc, 4);
+  mw->ops->send(answer, sizeof(answer));
+}
+
+static void sendWriteAck(memWindow_t* mw)
+{
+  sendAck(mw, MEM_WINDOW_CMD_WRITE_ACK, mw->status, mw->offset, mw->crc);
+  mw->received = 0;
+}
+
+static void start(memWindow_t* mw, memWindowMode_t mode, const uint8_t* data, uint8_t size)
+{
+  mw->mode = memWindowIdle;
+  if (size < START_SIZE) {
+    sendStatus(mw, data[0], EINVAL);
+    return;
+  }
+
+  mw->memId = data[1];
+  memcpy(&mw->addr, &data[2], 4);
+  memcpy(&mw->len, &data[6], 4);
+  mw->window = data[10];
+  mw->offset = 0;
+  mw->crc = INITIAL_REMAINDER;
+  mw->received = 0;
+  mw->status = 0;
+
+  // The end of the range must fit in the 32 bit address
+  if (mw->window == 0 || mw->window > MEM_WINDOW_MAX_PACKETS || mw->len > UINT32_MAX - mw->addr) {
+    sendStatus(mw, data[0], EINVAL);
+    return;
+  }
+
+  mw->mode = mode;
+  sendStatus(mw, data[0], 0);
+}
+
+static void handleWriteData(memWindow_t* mw, const uint8_t* data, uint8_t size)
+{
+  if (mw->mode != memWindowWriting || mw->status != 0 || size < MEM_WINDOW_DATA_HEADER) {
+    return;
+  }
+
+  uint32_t offset;
+  memcpy(&offset, &data[1], 4);
+  const uint8_t* payload = &data[MEM_WINDOW_DATA_HEADER];
+  uint8_t len = size - MEM_WINDOW_DATA_HEADER;
+
+  // Anything but the next part is dropped, the ACK tells where to go on from
+  if (offset == mw->offset && len > 0) {
+    if (len > mw->len - mw->offset) {
+      mw->status = EINVAL;
+    } else {
+      mw->status = mw->ops->write(mw->memId, mw->addr + offset, len, payload);
+    }
+
+    if (mw->status == 0) {
+      mw->offset += len;
+      mw->crc = crcSlowUpdate(mw->crc, (void*)payload, len);
+    }
+  }
+
+  mw->received++;
+  if (mw->received >= mw->window || mw->offset == mw->len || mw->status != 0) {
+    sendWriteAck(mw);
+  }
+}
+
+static void handleSync(memWindow_t* mw)
+{
+  if (mw->mode != memWindowWriting) {
+    sendAck(mw, MEM_WINDOW_CMD_WRITE_ACK, EINVAL, 0, INITIAL_REMAINDER);
+    return;
+  }
+
+  sendWriteAck(mw);
+}
+
+static void handleReadWindow(memWindow_t* mw, const uint8_t* data, uint8_t size)
+{
+  uint32_t offset;
+  if (mw->mode != memWindowReading || size < MEM_WINDOW_DATA_HEADER) {
+    sendAck(mw, MEM_WINDOW_CMD_READ_END, EINVAL, 0, INITIAL_REMAINDER);
+    return;
+  }
+  memcpy(&offset, &data[1], 4);
+  if (offset > mw->len) {
+    sendAck(mw, MEM_WINDOW_CMD_READ_END, EINVAL, offset, INITIAL_REMAINDER);
+    return;
+  }
+
+  uint32_t crc = INITIAL_REMAINDER;
+  uint8_t status = 0;
+  for (int i = 0; i < mw->window && offset < mw->len; i++) {
+    uint8_t packet[MEM_WINDOW_PACKET_SIZE] = {MEM_WINDOW_CMD_READ_DATA};
+    uint8_t len = MEM_WINDOW_MAX_DATA;
+    if (mw->len - offset < len) {
+      len = mw->len - offset;
+    }
+
+    status = mw->ops->read(mw->memId, mw->addr + offset, len, &packet[MEM_WINDOW_DATA_HEADER]);
+    if (status != 0) {
+      break;
+    }
+
+    memcpy(&packet[1], &offset, 4);
+    mw->ops->send(packet, MEM_WINDOW_DATA_HEADER + len);
+    crc = crcSlowUpdate(crc, &packet[MEM_WINDOW_DATA_HEADER], len);
+    offset += len;
+  }
+
+  sendAck(mw, MEM_WINDOW_CMD_READ_END, status, offset, crc);
+}
+
+void memWindowInit(memWindow_t* mw, const memWindowOps_t* ops)
+{
+  memset(mw, 0, sizeof(*mw));
+  mw->ops = ops;
+}
+
+void memWindowHandlePacket(memWindow_t* mw, const uint8_t* data, uint8_t size)
+{
+  if (size < 1) {
+    return;
+  }
+
+  switch (data[0]) {
+    case MEM_WINDOW_CMD_WRITE_START:
+      start(mw, memWindowWriting, data, size);
+      break;
+    case MEM_WINDOW_CMD_WRITE_DATA:
+      handleWriteData(mw, data, size);
+      break;
+    case MEM_WINDOW_CMD_SYNC:
+      handleSync(mw);
+      break;
+    case MEM_WINDOW_CMD_READ_START:
+      start(mw, memWindowReading, data, size);
+      break;
+    case MEM_WINDOW_CMD_READ_WINDOW:
+      handleReadWindow(mw, data, size);
+      break;
+    default:
+      break;
+  }
+}
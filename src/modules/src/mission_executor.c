@@ -0,0 +1,146 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * mission_executor.c - Runs a mission from the uSD card without the radio
+ */
+
+#define DEBUG_MODULE "MISSION"
+
+#include <errno.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "config.h"
+#include "system.h"
+#include "debug.h"
+#include "log.h"
+#include "pm.h"
+#include "usec_time.h"
+#include "crtp_commander_high_level.h"
+#include "mission.h"
+
+#include "mission_executor.h"
+
+#define MISSION_UPDATE_RATE_MS 20
+
+static bool isInit = false;
+static xSemaphoreHandle lock;
+
+static mission_t mission;
+static uint64_t startTimestamp;
+
+// Logging
+static uint8_t state;
+static uint16_t step;
+
+static const missionOps_t ops = {
+  .takeoff = crtpCommanderHighLevelTakeoff,
+  .land = crtpCommanderHighLevelLand,
+  .goTo = crtpCommanderHighLevelGoTo,
+  .startTrajectory = crtpCommanderHighLevelStartTrajectory,
+  .isTrajectoryFinished = crtpCommanderHighLevelIsTrajectoryFinished,
+  .isStopped = crtpCommanderHighLevelIsStopped,
+  .batteryVoltage = pmGetBatteryRestVoltage,
+};
+
+static void missionExecutorTask(void* param);
+
+void missionExecutorInit(void)
+{
+  if (isInit)
+  {
+    return;
+  }
+
+  missionInit(&mission, &ops);
+  lock = xSemaphoreCreateMutex();
+  xTaskCreate(missionExecutorTask, MISSION_TASK_NAME, MISSION_TASK_STACKSIZE, NULL, MISSION_TASK_PRI, NULL);
+
+  isInit = true;
+}
+
+bool missionExecutorTest(void)
+{
+  return isInit;
+}
+
+int missionExecutorLoad(const uint8_t* data, uint32_t len)
+{
+  if (!isInit)
+  {
+    return ENODEV;
+  }
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  int result = missionLoad(&mission, data, len);
+  state = mission.state;
+  xSemaphoreGive(lock);
+
+  return result;
+}
+
+int missionExecutorStart(void)
+{
+  if (!isInit)
+  {
+    return ENOENT;
+  }
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  int result = missionStart(&mission);
+  if (result == 0)
+  {
+    startTimestamp = usecTimestamp();
+  }
+  xSemaphoreGive(lock);
+
+  return result;
+}
+
+static void missionExecutorTask(void* param)
+{
+  systemWaitStart();
+
+  TickType_t lastWakeTime = xTaskGetTickCount();
+  while (1)
+  {
+    vTaskDelayUntil(&lastWakeTime, M2T(MISSION_UPDATE_RATE_MS));
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (mission.state == missionStateRunning)
+    {
+      float time = (usecTimestamp() - startTimestamp) / 1e6f;
+      missionUpdate(&mission, time);
+    }
+    state = mission.state;
+    step = mission.current;
+    xSemaphoreGive(lock);
+  }
+}
+
+LOG_GROUP_START(mission)
+LOG_ADD(LOG_UINT8, state, &state)
+LOG_ADD(LOG_UINT16, step, &step)
+LOG_GROUP_STOP(mission)
@@ -75,7 +75,8 @@ extern struct param_s _param_stop;
 static void paramWriteProcess();
 static void paramReadProcess();
 static int variableGetIndex(int id);
-static char paramWriteByNameProcess(char* group, char* name, int type, void *valptr);
+static int paramSize(int type);
+static char paramWriteByNameProcess(char* group, char* name, int type, void *valptr, int valLength);
 
 //Pointer to the parameters list and length of it
 static struct param_s * params;
@@ -165,31 +166,33 @@ void paramTask(void * prm)
 		else if (p.channel==WRITE_CH)
 		  paramWriteProcess();
     else if (p.channel==MISC_CH) {
-      if (p.data[0] == MISC_SETBYNAME) {
-        int i, nzero = 0;
+      if (p.size >= 1 && p.data[0] == MISC_SETBYNAME) {
         char *group;
         char *name;
+        char *nameEnd;
         uint8_t type;
         void * valPtr;
+        int valLength;
         int error;
 
-        // If the packet contains at least 2 zeros in the first 28 bytes
-        // The packet decoding algorithm will not crash
-        for (i=0; i<CRTP_MAX_DATA_SIZE; i++) {
-          if (p.data[i] == '\0') nzero++;
-        }
-
-        if (nzero < 2) return;
-
+        // The group and the name are zero terminated strings followed by the
+        // type and the value, all of which must be within the packet
+        char *end = (char*)&p.data[p.size];
         group = (char*)&p.data[1];
-        name = (char*)&p.data[1+strlen(group)+1];
-        type = p.data[1+strlen(group)+1+strlen(name)+1];
-        valPtr = &p.data[1+strlen(group)+1+strlen(name)+2];
+        name = memchr(group, '\0', end - group);
+        if (name == NULL) continue;
+        name++;
+        nameEnd = memchr(name, '\0', end - name);
+        if (nameEnd == NULL || nameEnd + 1 >= end) continue;
+
+        type = nameEnd[1];
+        valPtr = &nameEnd[2];
+        valLength = end - (char*)valPtr;
 
-        error = paramWriteByNameProcess(group, name, type, valPtr);
+        error = paramWriteByNameProcess(group, name, type, valPtr, valLength);
 
-        p.data[1+strlen(group)+1+strlen(name)+1] = error;
-        p.size = 1+strlen(group)+1+strlen(name)+1+1;
+        nameEnd[1] = error;
+        p.size = (uint8_t*)&nameEnd[2] - p.data;
         crtpSendPacket(&p);
       }
     }
@@ -311,6 +314,8 @@ static void paramWriteProcess()
 {
   if (useV2) {
     uint16_t ident;
+    if (p.size < 2)
+      return;
     memcpy(&ident, &p.data[0], 2);
 
     void* valptr = &p.data[2];
@@ -329,24 +334,29 @@ static void paramWriteProcess()
     if (params[id].type & PARAM_RONLY)
       return;
 
+    if (p.size < 2 + paramSize(params[id].type))
+      return;
+
     switch (params[id].type & PARAM_BYTES_MASK)
     {
     case PARAM_1BYTE:
-      *(uint8_t*)params[id].address = *(uint8_t*)valptr;
+      memcpy(params[id].address, valptr, sizeof(uint8_t));
       break;
       case PARAM_2BYTES:
-        *(uint16_t*)params[id].address = *(uint16_t*)valptr;
+        memcpy(params[id].address, valptr, sizeof(uint16_t));
         break;
     case PARAM_4BYTES:
-        *(uint32_t*)params[id].address = *(uint32_t*)valptr;
+        memcpy(params[id].address, valptr, sizeof(uint32_t));
         break;
     case PARAM_8BYTES:
-        *(uint64_t*)params[id].address = *(uint64_t*)valptr;
+        memcpy(params[id].address, valptr, sizeof(uint64_t));
         break;
     }
 
     crtpSendPacket(&p);
   } else {
+    if (p.size < 1)
+      return;
     int ident = p.data[0];
     void* valptr = &p.data[1];
     int id;
@@ -366,19 +376,22 @@ static void paramWriteProcess()
   	if (params[id].type & PARAM_RONLY)
   		return;
 
+    if (p.size < 1 + paramSize(params[id].type))
+      return;
+
     switch (params[id].type & PARAM_BYTES_MASK)
     {
    	case PARAM_1BYTE:
-   		*(uint8_t*)params[id].address = *(uint8_t*)valptr;
+   		memcpy(params[id].address, valptr, sizeof(uint8_t));
    		break;
       case PARAM_2BYTES:
-    	  *(uint16_t*)params[id].address = *(uint16_t*)valptr;
+    	  memcpy(params[id].address, valptr, sizeof(uint16_t));
         break;
    	case PARAM_4BYTES:
-        *(uint32_t*)params[id].address = *(uint32_t*)valptr;
+        memcpy(params[id].address, valptr, sizeof(uint32_t));
         break;
    	case PARAM_8BYTES:
-        *(uint64_t*)params[id].address = *(uint64_t*)valptr;
+        memcpy(params[id].address, valptr, sizeof(uint64_t));
         break;
     }
 
@@ -386,7 +399,7 @@ static void paramWriteProcess()
   }
 }
 
-static char paramWriteByNameProcess(char* group, char* name, int type, void *valptr) {
+static char paramWriteByNameProcess(char* group, char* name, int type, void *valptr, int valLength) {
   int ptr;
   char *pgroup = "";
 
@@ -418,19 +431,23 @@ static char paramWriteByNameProcess(char* group, char* name, int type, void *val
     return EACCES;
   }
 
+  if (valLength < paramSize(type)) {
+    return EINVAL;
+  }
+
   switch (params[ptr].type & PARAM_BYTES_MASK)
   {
  	case PARAM_1BYTE:
- 		*(uint8_t*)params[ptr].address = *(uint8_t*)valptr;
+ 		memcpy(params[ptr].address, valptr, sizeof(uint8_t));
  		break;
     case PARAM_2BYTES:
-  	  *(uint16_t*)params[ptr].address = *(uint16_t*)valptr;
+  	  memcpy(params[ptr].address, valptr, sizeof(uint16_t));
       break;
  	case PARAM_4BYTES:
-      *(uint32_t*)params[ptr].address = *(uint32_t*)valptr;
+      memcpy(params[ptr].address, valptr, sizeof(uint32_t));
       break;
  	case PARAM_8BYTES:
-      *(uint64_t*)params[ptr].address = *(uint64_t*)valptr;
+      memcpy(params[ptr].address, valptr, sizeof(uint64_t));
       break;
   }
 
@@ -441,6 +458,8 @@ static void paramReadProcess()
 {
   if (useV2) {
     uint16_t ident;
+    if (p.size < 2)
+      return;
     memcpy(&ident, &p.data[0], 2);
     int id = variableGetIndex(ident);
 
@@ -474,6 +493,8 @@ static void paramReadProcess()
         break;
     }
   } else {
+    if (p.size < 1)
+      return;
     uint8_t ident = p.data[0];
     int id = variableGetIndex(ident);
 
@@ -532,3 +553,8 @@ static int variableGetIndex(int id)
 
   return i;
 }
+
+static int paramSize(int type)
+{
+  return 1 << (type & PARAM_BYTES_MASK);
+}
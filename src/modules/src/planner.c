@@ -36,6 +36,8 @@ SOFTWARE.
 implementation of planning state machine
 */
 
+#include <stddef.h>
+
 #include "planner.h"
 
 static struct piecewise_traj planned_trajectory;
@@ -73,6 +75,11 @@ bool plan_is_stopped(struct planner *p)
 	return p->state == TRAJECTORY_STATE_IDLE;
 }
 
+bool plan_is_finished(struct planner *p, float t)
+{
+	return p->state == TRAJECTORY_STATE_IDLE || piecewise_is_finished(p->trajectory, t);
+}
+
 struct traj_eval plan_current_goal(struct planner *p, float t)
 {
 	switch (p->state) {
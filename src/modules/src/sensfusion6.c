@@ -24,6 +24,8 @@
  *
  */
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "sensfusion6.h"
 #include "log.h"
@@ -294,9 +296,10 @@ float invSqrt(float x)
 {
   float halfx = 0.5f * x;
   float y = x;
-  long i = *(long*)&y;
+  int32_t i;
+  memcpy(&i, &y, sizeof(i)); // long is 64 bits on a host
   i = 0x5f3759df - (i>>1);
-  y = *(float*)&i;
+  memcpy(&y, &i, sizeof(y));
   y = y * (1.5f - (halfx * y * y));
   return y;
 }
@@ -33,6 +33,8 @@
 #include "trigger.h"
 #include "sitaw.h"
 #include "commander.h"
+#include "estimator.h"
+#include "estimator_kalman.h"
 
 /* Trigger object used to detect Free Fall situation. */
 static trigger_t sitAwFFAccWZ;
@@ -43,6 +45,10 @@ static trigger_t sitAwARAccZ;
 /* Trigger object used to detect Tumbled situation. */
 static trigger_t sitAwTuAngle;
 
+/* Trigger objects used to detect Poor Position Quality situations. */
+static trigger_t sitAwPQHold;
+static trigger_t sitAwPQLand;
+
 #if defined(SITAW_ENABLED)
 
 #if defined(SITAW_LOG_ENABLED) /* Enable the log group. */
@@ -59,10 +65,20 @@ LOG_ADD(LOG_UINT8, ARDetected, &sitAwARAccZ.released)
 LOG_ADD(LOG_UINT32, TuTestCounter, &sitAwTuAngle.testCounter)
 LOG_ADD(LOG_UINT8, TuDetected, &sitAwTuAngle.released)
 #endif
+#if defined(SITAW_PQ_LOG_ENABLED) /* Log trigger variables for Position Quality detection. */
+LOG_ADD(LOG_UINT32, PQHoldTestCounter, &sitAwPQHold.testCounter)
+LOG_ADD(LOG_UINT8, PQHoldDetected, &sitAwPQHold.released)
+LOG_ADD(LOG_UINT32, PQLandTestCounter, &sitAwPQLand.testCounter)
+LOG_ADD(LOG_UINT8, PQLandDetected, &sitAwPQLand.released)
+#endif
 #if defined(SITAW_LOG_ALL_DETECT_ENABLED) /* Log all the 'Detected' flags. */
 LOG_ADD(LOG_UINT8, FFAccWZDetected, &sitAwFFAccWZ.released)
 LOG_ADD(LOG_UINT8, ARDetected, &sitAwARAccZ.released)
 LOG_ADD(LOG_UINT8, TuDetected, &sitAwTuAngle.released)
+#if defined(SITAW_PQ_ENABLED)
+LOG_ADD(LOG_UINT8, PQHoldDetected, &sitAwPQHold.released)
+LOG_ADD(LOG_UINT8, PQLandDetected, &sitAwPQLand.released)
+#endif
 #endif
 LOG_GROUP_STOP(sitAw)
 #endif /* SITAW_LOG_ENABLED */
@@ -84,6 +100,13 @@ PARAM_ADD(PARAM_UINT8, TuActive, &sitAwTuAngle.active)
 PARAM_ADD(PARAM_UINT32, TuTriggerCount, &sitAwTuAngle.triggerCount)
 PARAM_ADD(PARAM_FLOAT, TuAngle, &sitAwTuAngle.threshold)
 #endif
+#if defined(SITAW_PQ_PARAM_ENABLED) /* Param variables for Position Quality detection. */
+PARAM_ADD(PARAM_UINT8, PQActive, &sitAwPQHold.active)
+PARAM_ADD(PARAM_UINT32, PQTriggerCount, &sitAwPQHold.triggerCount)
+PARAM_ADD(PARAM_FLOAT, PQHold, &sitAwPQHold.threshold)
+PARAM_ADD(PARAM_UINT8, PQLandActive, &sitAwPQLand.active)
+PARAM_ADD(PARAM_FLOAT, PQLand, &sitAwPQLand.threshold)
+#endif
 PARAM_GROUP_STOP(sitAw)
 #endif /* SITAW_PARAM_ENABLED */
 
@@ -123,6 +146,12 @@ static void sitAwPostStateUpdateCallOut(const sensorData_t *sensorData,
 /* Test values for At Rest detection. */
   sitAwARTest(sensorData->acc.x, sensorData->acc.y, sensorData->acc.z);
 #endif
+#ifdef SITAW_PQ_ENABLED
+  /* Test values for Position Quality detection, only the Kalman estimator provides a quality. */
+  if (getStateEstimator() == kalmanEstimator) {
+    sitAwPQTest(estimatorKalmanGetPositionQuality());
+  }
+#endif
 #endif
 }
 
@@ -151,6 +180,25 @@ static void sitAwPreThrustUpdateCallOut(setpoint_t *setpoint)
         setpoint->velocity.z = 0;
       }
 #endif
+
+#ifdef SITAW_PQ_ENABLED
+      /* Stop trusting the position if its quality is poor: hold the horizontal position
+         by commanding zero velocity, and descend if the quality gets even worse.
+         Only applies when the setpoint controls the position. */
+      bool isPositionControlled = (setpoint->mode.x != modeDisable) || (setpoint->mode.y != modeDisable);
+      if(isPositionControlled && sitAwPQHoldDetected() && !sitAwTuDetected()) {
+        setpoint->mode.x = modeVelocity;
+        setpoint->mode.y = modeVelocity;
+        setpoint->velocity.x = 0;
+        setpoint->velocity.y = 0;
+        setpoint->velocity_body = false;
+
+        if(sitAwPQLandDetected() && setpoint->mode.z != modeDisable) {
+          setpoint->mode.z = modeVelocity;
+          setpoint->velocity.z = -SITAW_PQ_LAND_VELOCITY;
+        }
+      }
+#endif
 #endif
 }
 
@@ -328,6 +376,58 @@ bool sitAwTuDetected(void)
   return sitAwTuAngle.released;
 }
 
+/**
+ * Initialize the Position Quality detection.
+ *
+ * See the sitAwPQTest() function for details.
+ */
+void sitAwPQInit(void)
+{
+  triggerInit(&sitAwPQHold, triggerFuncIsLE, SITAW_PQ_HOLD_THRESHOLD, SITAW_PQ_TRIGGER_COUNT);
+  triggerActivate(&sitAwPQHold, true);
+  triggerInit(&sitAwPQLand, triggerFuncIsLE, SITAW_PQ_LAND_THRESHOLD, SITAW_PQ_TRIGGER_COUNT);
+  triggerActivate(&sitAwPQLand, true);
+}
+
+/**
+ * Test values for a Poor Position Quality situation.
+ *
+ * The position quality (0-100) is provided by the Kalman estimator, based on
+ * the consistency of the measurement innovations, the covariance and the age
+ * of the aiding measurements. Two levels are detected: at or below
+ * SITAW_PQ_HOLD_THRESHOLD the position should no longer be tracked and at or
+ * below SITAW_PQ_LAND_THRESHOLD the crazyflie should land.
+ *
+ * @param positionQuality The position quality, 0 - 100.
+ *
+ * @return True if the hold situation has been detected, otherwise false.
+ */
+bool sitAwPQTest(uint8_t positionQuality)
+{
+  triggerTestValue(&sitAwPQLand, positionQuality);
+  return(triggerTestValue(&sitAwPQHold, positionQuality));
+}
+
+/**
+ * Check if a Poor Position Quality situation, where the position should be held, has been detected.
+ *
+ * @return True if the situation has been detected, otherwise false.
+ */
+bool sitAwPQHoldDetected(void)
+{
+  return sitAwPQHold.released;
+}
+
+/**
+ * Check if a Poor Position Quality situation, where the crazyflie should land, has been detected.
+ *
+ * @return True if the situation has been detected, otherwise false.
+ */
+bool sitAwPQLandDetected(void)
+{
+  return sitAwPQLand.released;
+}
+
 /**
  * Initialize the situation awareness subsystem.
  */
@@ -342,4 +442,7 @@ void sitAwInit(void)
 #ifdef SITAW_TU_ENABLED
   sitAwTuInit();
 #endif
+#ifdef SITAW_PQ_ENABLED
+  sitAwPQInit();
+#endif
 }
@@ -0,0 +1,262 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * spectrum.c - Averaged power spectra of the gyro and accelerometer
+ */
+
+#define DEBUG_MODULE "SPECTRUM"
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "config.h"
+#include "system.h"
+#include "debug.h"
+#include "param.h"
+#include "log.h"
+#include "arm_math.h"
+
+#include "spectrum.h"
+
+// Rate of the unfiltered IMU data from the sensor task
+#define SPECTRUM_SAMPLE_RATE 1000.0f
+#define SPECTRUM_MIN_SIZE    32
+#define SPECTRUM_BINS        (SPECTRUM_MAX_SIZE / 2)
+
+#define GROUP_GYRO 0
+#define GROUP_ACC  1
+
+static bool isInit = false;
+static xSemaphoreHandle windowReady;
+static arm_rfft_fast_instance_f32 fft;
+
+// Capture of one window, three axes of one group at a time to save RAM
+static float samples[3][SPECTRUM_MAX_SIZE];
+static volatile bool capturing = false;
+static volatile uint8_t captureGroup;
+static volatile uint16_t captureIndex;
+
+static float fftOut[SPECTRUM_MAX_SIZE];
+static float psd[SPECTRUM_AXES][SPECTRUM_BINS];
+
+static uint8_t state = spectrumStateIdle;
+static uint16_t size = SPECTRUM_MAX_SIZE;
+static uint16_t windowsTarget;
+static uint16_t windowsDone;
+
+// Parameters
+static uint8_t startMeasurement = 0;
+static uint16_t sizeParam = SPECTRUM_MAX_SIZE;
+static uint16_t windowsParam = 8;
+
+static void spectrumTask(void* param);
+
+void spectrumInit(void)
+{
+  if (isInit)
+  {
+    return;
+  }
+
+  windowReady = xSemaphoreCreateBinary();
+  xTaskCreate(spectrumTask, SPECTRUM_TASK_NAME, SPECTRUM_TASK_STACKSIZE, NULL, SPECTRUM_TASK_PRI, NULL);
+
+  isInit = true;
+}
+
+bool spectrumTest(void)
+{
+  return isInit;
+}
+
+void spectrumAddSample(const Axis3f* gyro, const Axis3f* acc)
+{
+  if (!capturing)
+  {
+    return;
+  }
+
+  const Axis3f* data = (captureGroup == GROUP_GYRO) ? gyro : acc;
+  const uint16_t index = captureIndex;
+
+  samples[0][index] = data->x;
+  samples[1][index] = data->y;
+  samples[2][index] = data->z;
+
+  if (index + 1 >= size)
+  {
+    capturing = false;
+    xSemaphoreGive(windowReady);
+  }
+  else
+  {
+    captureIndex = index + 1;
+  }
+}
+
+static void startCapture(uint8_t group)
+{
+  captureGroup = group;
+  captureIndex = 0;
+  capturing = true;
+}
+
+static void start(void)
+{
+  capturing = false;
+  // A window of an aborted measurement may be waiting
+  xSemaphoreTake(windowReady, 0);
+
+  if (sizeParam < SPECTRUM_MIN_SIZE || sizeParam > SPECTRUM_MAX_SIZE || (sizeParam & (sizeParam - 1)) != 0)
+  {
+    DEBUG_PRINT("Size %d not supported, using %d\n", sizeParam, SPECTRUM_MAX_SIZE);
+    sizeParam = SPECTRUM_MAX_SIZE;
+  }
+  size = sizeParam;
+  arm_rfft_fast_init_f32(&fft, size);
+
+  windowsTarget = (windowsParam > 0) ? windowsParam : 1;
+  windowsDone = 0;
+  memset(psd, 0, sizeof(psd));
+
+  state = spectrumStateMeasuring;
+  startCapture(GROUP_GYRO);
+}
+
+// Hann window, FFT and one sided power spectral density averaged into the result
+static void processWindow(uint8_t group)
+{
+  const int bins = size / 2;
+  float windowPower = 0.0f;
+
+  for (int n = 0; n < size; n++)
+  {
+    float w = 0.5f - 0.5f * arm_cos_f32(2.0f * PI * n / size);
+    windowPower += w * w;
+    samples[0][n] *= w;
+    samples[1][n] *= w;
+    samples[2][n] *= w;
+  }
+
+  const float scale = 2.0f / (SPECTRUM_SAMPLE_RATE * windowPower);
+  const float weight = 1.0f / (windowsDone + 1);
+
+  for (int axis = 0; axis < 3; axis++)
+  {
+    float* result = psd[group * 3 + axis];
+
+    // Real FFT output is DC and Nyquist followed by the complex bins
+    arm_rfft_fast_f32(&fft, samples[axis], fftOut, 0);
+
+    float power = 0.5f * scale * fftOut[0] * fftOut[0];
+    result[0] += weight * (power - result[0]);
+    for (int k = 1; k < bins; k++)
+    {
+      float re = fftOut[2 * k];
+      float im = fftOut[2 * k + 1];
+      power = scale * (re * re + im * im);
+      result[k] += weight * (power - result[k]);
+    }
+  }
+}
+
+static void spectrumTask(void* param)
+{
+  systemWaitStart();
+
+  while (1)
+  {
+    if (startMeasurement)
+    {
+      startMeasurement = 0;
+      start();
+    }
+
+    if (xSemaphoreTake(windowReady, M2T(100)) == pdTRUE && state == spectrumStateMeasuring)
+    {
+      uint8_t group = captureGroup;
+      processWindow(group);
+
+      if (group == GROUP_GYRO)
+      {
+        startCapture(GROUP_ACC);
+      }
+      else if (++windowsDone < windowsTarget)
+      {
+        startCapture(GROUP_GYRO);
+      }
+      else
+      {
+        state = spectrumStateDone;
+      }
+    }
+  }
+}
+
+bool spectrumReadMem(uint32_t memAddr, uint8_t readLen, uint8_t* dest)
+{
+  uint8_t header[SPECTRUM_HEADER_SIZE];
+  const uint16_t bins = size / 2;
+  const float sampleRate = SPECTRUM_SAMPLE_RATE;
+
+  if (memAddr > SPECTRUM_MEM_SIZE || readLen > SPECTRUM_MEM_SIZE - memAddr)
+  {
+    return false;
+  }
+
+  header[0] = SPECTRUM_MEM_VERSION;
+  header[1] = state;
+  memcpy(&header[2], &size, 2);
+  memcpy(&header[4], &windowsDone, 2);
+  memcpy(&header[6], &bins, 2);
+  memcpy(&header[8], &sampleRate, 4);
+
+  for (int i = 0; i < readLen; i++)
+  {
+    uint32_t addr = memAddr + i;
+    if (addr < SPECTRUM_HEADER_SIZE)
+    {
+      dest[i] = header[addr];
+    }
+    else
+    {
+      dest[i] = ((uint8_t*)psd)[addr - SPECTRUM_HEADER_SIZE];
+    }
+  }
+
+  return true;
+}
+
+PARAM_GROUP_START(spectrum)
+PARAM_ADD(PARAM_UINT8, start, &startMeasurement)
+PARAM_ADD(PARAM_UINT16, size, &sizeParam)
+PARAM_ADD(PARAM_UINT16, windows, &windowsParam)
+PARAM_GROUP_STOP(spectrum)
+
+LOG_GROUP_START(spectrum)
+LOG_ADD(LOG_UINT8, state, &state)
+LOG_ADD(LOG_UINT16, windows, &windowsDone)
+LOG_GROUP_STOP(spectrum)
@@ -43,6 +43,12 @@
 
 #include "estimator_kalman.h"
 #include "estimator.h"
+#include "lowpower.h"
+
+// Time after the last thrust for the stabilizer to be considered landed
+#define LANDED_TIMEOUT_MS 2000
+// Loop ticks per sensor read when idle, the tick keeps counting milliseconds
+#define IDLE_TICK_STEP (RATE_MAIN_LOOP / SENSORS_IDLE_RATE_HZ)
 
 static bool isInit;
 static bool emergencyStop = false;
@@ -50,6 +56,9 @@ static int emergencyStopTimeout = EMERGENCY_STOP_TIMEOUT_DISABLED;
 
 uint32_t inToOutLatency;
 
+// Tick of the last loop with thrust to the motors, 0 before the first flight
+static volatile uint32_t lastThrustTick;
+
 // State variables for the stabilizer
 static setpoint_t setpoint;
 static sensorData_t sensorData;
@@ -61,6 +70,15 @@ static ControllerType controllerType;
 
 static void stabilizerTask(void* param);
 
+static bool isIdle;
+
+static void updateFlightState(void)
+{
+  if (control.thrust > 0 && !emergencyStop) {
+    lastThrustTick = xTaskGetTickCount();
+  }
+}
+
 static void calcSensorToOutputLatency(const sensorData_t *sensorData)
 {
   uint64_t outTimestamp = usecTimestamp();
@@ -115,6 +133,10 @@ static void checkEmergencyStopTimeout()
 /* The stabilizer loop runs at 1kHz (stock) or 500Hz (kalman). It is the
  * responsibility of the different functions to run slower by skipping call
  * (ie. returning without modifying the output structure).
+ * Idle on the ground it follows the sensors down to SENSORS_IDLE_RATE_HZ,
+ * and the tick is aligned to and stepped by IDLE_TICK_STEP. The functions
+ * at rates with a period dividing IDLE_TICK_STEP, such as 500 and 100 Hz,
+ * then run on every loop.
  */
 
 static void stabilizerTask(void* param)
@@ -165,12 +187,28 @@ static void stabilizerTask(void* param)
     } else {
       powerDistribution(&control);
     }
+    updateFlightState();
 
     calcSensorToOutputLatency(&sensorData);
-    tick++;
+
+    if (lowPowerIsIdle() != isIdle) {
+      isIdle = !isIdle;
+      sensorsSetIdle(isIdle);
+    }
+    if (isIdle) {
+      tick = (tick / IDLE_TICK_STEP + 1) * IDLE_TICK_STEP;
+    } else {
+      tick++;
+    }
   }
 }
 
+bool stabilizerIsFlying(void)
+{
+  const uint32_t tick = lastThrustTick;
+  return tick != 0 && xTaskGetTickCount() - tick < M2T(LANDED_TIMEOUT_MS);
+}
+
 void stabilizerSetEmergencyStop()
 {
   emergencyStop = true;
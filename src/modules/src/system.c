@@ -61,6 +61,8 @@
 #include "buzzer.h"
 #include "sound.h"
 #include "sysload.h"
+#include "spectrum.h"
+#include "usec_time.h"
 #include "deck.h"
 #include "extrx.h"
 
@@ -164,6 +166,7 @@ void systemTask(void *arg)
   }
   soundInit();
   memInit();
+  spectrumInit();
 
 #ifdef PROXIMITY_ENABLED
   proximityInit();
@@ -178,6 +181,7 @@ void systemTask(void *arg)
   pass &= deckTest();
   pass &= soundTest();
   pass &= memTest();
+  pass &= spectrumTest();
   pass &= watchdogNormalStartTest();
 
   //Start the firmware
@@ -253,6 +257,12 @@ bool systemCanFly(void)
   return canFly;
 }
 
+void vApplicationTickHook( void )
+{
+  // Samples the cycle counter often enough to keep its 64-bit extension valid
+  cycleTimestamp();
+}
+
 void vApplicationIdleHook( void )
 {
   static uint32_t tickOfLatestWatchdogReset = M2T(0);
@@ -267,8 +277,12 @@ void vApplicationIdleHook( void )
 
   // Enter sleep mode. Does not work when debugging chip with SWD.
   // Currently saves about 20mA STM32F405 current consumption (~30%).
+  // On the ground the kernel suppresses the tick for longer idle periods
+  // after this, see lowpower.c
 #ifndef DEBUG
-  { __asm volatile ("wfi"); }
+  __asm volatile ("cpsid i");
+  usecTimerSleep();
+  __asm volatile ("cpsie i");
 #endif
 }
 
@@ -0,0 +1,152 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * trajectory_flash.c - Trajectories stored in a reserved flash sector
+ */
+
+#define DEBUG_MODULE "TRAJFLASH"
+
+#include <errno.h>
+
+#include "stm32fxxx.h"
+
+#include "debug.h"
+#include "motors.h"
+#include "crtp_commander_high_level.h"
+#include "trajectory_flash.h"
+
+#define TRAJECTORY_FLASH_SECTOR FLASH_Sector_11
+
+#define IWDG_KEY_RELOAD 0xAAAA
+
+static bool eraseSector(void);
+static bool programWord(uint32_t offset, uint32_t word);
+
+static bool isInit = false;
+static trajectoryStore_t store;
+static const trajectoryStoreFlash_t flash = {
+  .erase = eraseSector,
+  .program = programWord,
+};
+
+void trajectoryFlashInit(void)
+{
+  if (isInit) {
+    return;
+  }
+
+  trajectoryStoreInit(&store, (const uint8_t*)TRAJECTORY_FLASH_ADDRESS, TRAJECTORY_FLASH_SIZE, &flash);
+  if (trajectoryStoreIsValid(&store)) {
+    DEBUG_PRINT("%d stored trajectories\n", trajectoryStoreCount(&store));
+  }
+
+  isInit = true;
+}
+
+bool trajectoryFlashTest(void)
+{
+  return isInit;
+}
+
+const trajectoryStore_t* trajectoryFlashGetStore(void)
+{
+  return &store;
+}
+
+static bool isOnGround(void)
+{
+  if (!crtpCommanderHighLevelIsStopped()) {
+    return false;
+  }
+
+  for (int i = 0; i < NBR_OF_MOTORS; i++) {
+    if (motorsGetRatio(i) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool trajectoryFlashReadMem(uint32_t memAddr, uint8_t readLen, uint8_t* dest)
+{
+  return isInit && trajectoryStoreRead(&store, memAddr, readLen, dest);
+}
+
+uint8_t trajectoryFlashWriteMem(uint32_t memAddr, uint8_t writeLen, const uint8_t* src)
+{
+  if (!isInit) {
+    return EIO;
+  }
+  if (!isOnGround()) {
+    return EBUSY;
+  }
+
+  return trajectoryStoreWrite(&store, memAddr, src, writeLen);
+}
+
+// Runs from RAM with all interrupts off. Any flash access stalls the CPU
+// until the erase is done, this loop only touches registers and keeps the
+// watchdog fed meanwhile.
+__attribute__((section(".RAMtext"), noinline, long_call))
+static uint32_t eraseSectorFromRam(uint32_t sector)
+{
+  FLASH->CR &= ~(FLASH_CR_PSIZE | FLASH_CR_SNB);
+  FLASH->CR |= FLASH_PSIZE_WORD | FLASH_CR_SER | sector;
+  FLASH->CR |= FLASH_CR_STRT;
+
+  while (FLASH->SR & FLASH_SR_BSY) {
+    IWDG->KR = IWDG_KEY_RELOAD;
+  }
+
+  FLASH->CR &= ~(FLASH_CR_SER | FLASH_CR_SNB);
+  return FLASH->SR;
+}
+
+static bool eraseSector(void)
+{
+  FLASH_Unlock();
+  FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                  FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+  __disable_irq();
+  uint32_t status = eraseSectorFromRam(TRAJECTORY_FLASH_SECTOR);
+  __enable_irq();
+
+  FLASH_Lock();
+
+  // The data cache may still hold the old content
+  FLASH_DataCacheCmd(DISABLE);
+  FLASH_DataCacheReset();
+  FLASH_DataCacheCmd(ENABLE);
+
+  return (status & (FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGSERR)) == 0;
+}
+
+static bool programWord(uint32_t offset, uint32_t word)
+{
+  FLASH_Unlock();
+  FLASH_Status status = FLASH_ProgramWord(TRAJECTORY_FLASH_ADDRESS + offset, word);
+  FLASH_Lock();
+
+  return status == FLASH_COMPLETE;
+}
@@ -0,0 +1,62 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * adaptiveNoise.h - Online estimation of measurement noise from innovations
+ */
+
+#ifndef __ADAPTIVE_NOISE_H__
+#define __ADAPTIVE_NOISE_H__
+
+typedef struct {
+  float scale;    // Estimated measurement variance relative to the nominal variance
+  float rate;     // Adaptation rate, the weight of one innovation (0 - 1)
+  float minScale;
+  float maxScale;
+} adaptiveNoise_t;
+
+/**
+ * Initializes the estimator with scale 1 (nominal noise).
+ *
+ * @param rate The adaptation rate, the weight of one innovation (0 - 1)
+ * @param minScale The lower bound of the estimated variance relative to the nominal variance
+ * @param maxScale The upper bound of the estimated variance relative to the nominal variance
+ */
+void adaptiveNoiseInit(adaptiveNoise_t* this, float rate, float minScale, float maxScale);
+
+/**
+ * Updates the noise estimate with the innovation of one scalar update (covariance matching).
+ *
+ * @param innovation The measurement error (measured - predicted)
+ * @param hph The state uncertainty projected on the measurement, HPH'
+ * @param nominalVariance The measurement variance reported by the sensor
+ */
+void adaptiveNoiseUpdate(adaptiveNoise_t* this, float innovation, float hph, float nominalVariance);
+
+/**
+ * The measurement variance to use in the update, nominalVariance scaled by the estimate
+ */
+static inline float adaptiveNoiseGetVariance(const adaptiveNoise_t* this, float nominalVariance) {
+  return this->scale * nominalVariance;
+}
+
+#endif // __ADAPTIVE_NOISE_H__
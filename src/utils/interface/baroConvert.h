@@ -0,0 +1,98 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * baroConvert.h - Barometer conversions
+ *
+ * BMP388 pressure compensation in fixed point, bit exact with the integer
+ * reference implementation of the Bosch BMP3 driver. The temperature
+ * dependent part of the compensation polynomial is computed when a new
+ * temperature is set and reused for the following pressure samples.
+ *
+ * Pressure to altitude is interpolated in a table of the standard
+ * atmosphere formula used by the barometer drivers.
+ */
+
+#ifndef __BARO_CONVERT_H__
+#define __BARO_CONVERT_H__
+
+#include <stdint.h>
+
+// Length of the BMP388 calibration register block
+#define BMP388_CALIB_LEN 21
+
+// Pressure range covered by the altitude table, mbar
+#define BARO_ALT_TABLE_MIN_MBAR 300.0f
+#define BARO_ALT_TABLE_MAX_MBAR 1100.0f
+
+typedef struct
+{
+  // Calibration parameters as stored in the sensor
+  uint16_t parT1;
+  uint16_t parT2;
+  int8_t parT3;
+  int16_t parP1;
+  int16_t parP2;
+  int8_t parP3;
+  int8_t parP4;
+  uint16_t parP5;
+  uint16_t parP6;
+  int8_t parP7;
+  int8_t parP8;
+  int16_t parP9;
+  int8_t parP10;
+  int8_t parP11;
+
+  // Temperature dependent terms, updated by bmp388SetTemperature()
+  int64_t tLin;
+  int64_t offset;
+  int64_t sensitivity;
+  int64_t quadratic;
+} bmp388Calib_t;
+
+/**
+ * Parse the calibration register block (BMP388_CALIB_LEN bytes read from
+ * the first calibration register).
+ */
+void bmp388CalibInit(bmp388Calib_t* calib, const uint8_t* regs);
+
+/**
+ * Compensate a raw 24 bit temperature and update the temperature dependent
+ * pressure terms.
+ * @return Temperature in 1/100 degree Celsius
+ */
+int32_t bmp388SetTemperature(bmp388Calib_t* calib, uint32_t rawTemperature);
+
+/**
+ * Compensate a raw 24 bit pressure using the last temperature set.
+ * @return Pressure in 1/100 Pa
+ */
+uint32_t bmp388CompensatePressure(const bmp388Calib_t* calib, uint32_t rawPressure);
+
+/**
+ * Altitude above sea level in m for a pressure in mbar, with a fixed sea
+ * level pressure of 1015.7 mbar and temperature of 25 degree Celsius.
+ * Outside the table range the closest table segment is extrapolated.
+ */
+float baroPressureToAltitude(float pressure);
+
+#endif /* __BARO_CONVERT_H__ */
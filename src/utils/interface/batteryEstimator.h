@@ -0,0 +1,123 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * batteryEstimator.h - Battery state of charge and remaining flight time
+ *
+ * The battery is modelled as an open circuit voltage depending on the state
+ * of charge, a series resistance and one RC pair for the slower polarization:
+ *
+ *   v = ocv(soc) - v1 - r0 * i
+ *   d(soc)/dt = -i / capacity
+ *   d(v1)/dt = -v1 / (r1 * c1) + i / c1
+ *
+ * An extended Kalman filter estimates soc, v1 and r0 from the measured
+ * terminal voltage and current. The current is either measured or modelled
+ * from the motor commands. The state of charge is mostly integrated from the
+ * current where the ocv curve is flat, and follows the voltage where it is
+ * steep, while the voltage sag under load is explained by r0 and v1.
+ */
+
+#ifndef __BATTERY_ESTIMATOR_H__
+#define __BATTERY_ESTIMATOR_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BATTERY_ESTIMATOR_STATES 3
+
+typedef struct
+{
+  // Model
+  float capacity;              // Ah
+  float r1;                    // Ohm
+  float c1;                    // F
+  float voltageStdDev;         // V, measurement and model error of the terminal voltage
+  float currentStdDev;         // A, error of a measured current
+  float currentModelStdDev;    // Relative error of a modelled current
+
+  bool isInit;
+  float soc;                   // State of charge, 0 - 1
+  float v1;                    // V, over the RC pair
+  float r0;                    // Ohm
+  float P[BATTERY_ESTIMATOR_STATES][BATTERY_ESTIMATOR_STATES];
+
+  float current;               // A, last current
+  float flightCurrent;         // A, current averaged over the time the motors run
+} batteryEstimator_t;
+
+/**
+ * Open circuit voltage of a 1S LiPo cell at a state of charge (0 - 1).
+ */
+float batteryOcvFromSoc(float soc);
+
+/**
+ * State of charge (0 - 1) of a resting cell from its voltage.
+ */
+float batterySocFromOcv(float voltage);
+
+/**
+ * Current drawn by the motors, modelled from the mean PWM ratio (0 - 1).
+ * The power of a propeller grows with thrust^1.5, and the thrust about
+ * linearly with the ratio.
+ * @param idleCurrent Current with the motors stopped (electronics, decks) in A.
+ * @param fullCurrent Additional current with all motors at full ratio in A.
+ */
+float batteryMotorCurrent(float meanRatio, float idleCurrent, float fullCurrent);
+
+/**
+ * Initialize the model, the state is set from the first voltage.
+ * @param capacity Capacity in Ah.
+ * @param r0 Initial series resistance in Ohm.
+ * @param flightCurrent Initial guess of the current in flight in A.
+ */
+void batteryEstimatorInit(batteryEstimator_t* be, float capacity, float r0, float flightCurrent);
+
+/**
+ * Restart from the next voltage, after charging for instance.
+ */
+void batteryEstimatorReset(batteryEstimator_t* be);
+
+/**
+ * Run the filter one step.
+ * @param voltage Terminal voltage in V.
+ * @param current Discharge current in A.
+ * @param isCurrentMeasured True if the current is measured, false if modelled.
+ * @param isFlying True if the motors are running, used to learn the flight current.
+ * @param dt Time since the last update in s.
+ */
+void batteryEstimatorUpdate(batteryEstimator_t* be, float voltage, float current, bool isCurrentMeasured,
+                            bool isFlying, float dt);
+
+/**
+ * Open circuit voltage of the estimated state of charge, the battery voltage
+ * without the sag of the current load.
+ */
+float batteryEstimatorGetOcv(const batteryEstimator_t* be);
+
+/**
+ * Predicted flight time in s until the state of charge reaches the reserve,
+ * at the averaged flight current.
+ */
+float batteryEstimatorGetFlightTime(const batteryEstimator_t* be, float reserveSoc);
+
+#endif /* __BATTERY_ESTIMATOR_H__ */
@@ -41,4 +41,15 @@ uint64_t configblockGetRadioAddress(void);
 float configblockGetCalibPitch(void);
 float configblockGetCalibRoll(void);
 
+/**
+ * Magnetometer calibration, offset and the symmetric soft iron matrix as
+ * xx, yy, zz, xy, xz, yz.
+ * @return false if no calibration has been stored
+ */
+bool configblockGetMagCalibration(float offset[3], float softIron[6]);
+/**
+ * Store the magnetometer calibration in the eeprom. Blocks during the write.
+ */
+bool configblockSetMagCalibration(const float offset[3], const float softIron[6]);
+
 #endif //__CONFIGBLOCK_H__
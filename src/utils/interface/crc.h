@@ -106,6 +106,20 @@ void  crcInit(void);
  */
 crc   crcSlow(void * datas, int nBytes);
 
+/**
+ * Slow implementation of CRC, for a message handled a part at a time.
+ *
+ * Start with INITIAL_REMAINDER and pass the remainder after the last part
+ * to crcSlowFinalize() to get the CRC, as crcSlow() of the whole message.
+ *
+ * @param remainder INITIAL_REMAINDER or the result for the previous part.
+ * @param datas Pointer to the next part of the message.
+ * @param nBytes Number of bytes in the part.
+ * @return The remainder after the part.
+ */
+crc   crcSlowUpdate(crc remainder, void * datas, int nBytes);
+crc   crcSlowFinalize(crc remainder);
+
 /**
  * Fast implementation of CRC.
  * 
@@ -0,0 +1,97 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * dshot.h - DShot digital ESC protocol encoding
+ *
+ * A DShot frame is 16 bits sent MSB first: 11 bits throttle, 1 telemetry
+ * request bit and a 4 bit checksum. Every bit has the same period, a one is
+ * high for 3/4 of the period and a zero for 3/8. Values 1-47 are commands,
+ * 48-2047 is the throttle range and 0 stops the motor.
+ *
+ * With bidirectional DShot the signal is inverted, the checksum is inverted
+ * and the ESC answers every frame on the same wire with a GCR coded eRPM
+ * period.
+ */
+
+#ifndef __DSHOT_H__
+#define __DSHOT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DSHOT_FRAME_BITS      16
+#define DSHOT_CMD_MAX         47
+#define DSHOT_THROTTLE_MIN    48
+#define DSHOT_THROTTLE_MAX    2047
+
+// Bits in a bidirectional telemetry answer (start bit excluded)
+#define DSHOT_TELEMETRY_BITS  21
+// Returned as period when the motor is not turning
+#define DSHOT_TELEMETRY_STOPPED 0
+
+typedef enum
+{
+  DSHOT150 = 150,
+  DSHOT300 = 300,
+  DSHOT600 = 600,
+} dshotSpeed_t;
+
+/**
+ * Map a 16 bit motor ratio to a DShot throttle value. A ratio of 0 gives the
+ * motor stop value 0, anything else is scaled into 48-2047.
+ */
+uint16_t dshotThrottleFromRatio(uint16_t ratio);
+
+/**
+ * Build a 16 bit frame from an 11 bit value (throttle or command).
+ * @param inverted Invert the checksum, used for bidirectional DShot.
+ */
+uint16_t dshotEncodeFrame(uint16_t value, bool telemetry, bool inverted);
+
+/**
+ * Timer counts in one bit for a timer running at timerClockHz.
+ */
+uint32_t dshotBitPeriod(uint32_t timerClockHz, dshotSpeed_t speed);
+
+/**
+ * Expand a frame to timer compare values, one per bit MSB first.
+ * The values are written to out[0], out[stride], out[2*stride]... so that a
+ * buffer shared by several channels (timer DMA burst) can be filled in place.
+ */
+void dshotFrameToCompare(uint16_t frame, uint32_t bitPeriod, uint32_t* out, uint32_t stride);
+
+/**
+ * Decode a bidirectional telemetry answer.
+ * @param raw The 21 bits following the start bit as sampled on the wire.
+ * @param periodUs Set to the eRPM period in microseconds, or to
+ *                 DSHOT_TELEMETRY_STOPPED if the motor is not turning.
+ * @return false if the answer is not valid GCR or the checksum fails.
+ */
+bool dshotDecodeTelemetry(uint32_t raw, uint32_t* periodUs);
+
+/**
+ * Convert an eRPM period to mechanical rpm.
+ */
+uint32_t dshotPeriodToRpm(uint32_t periodUs, uint8_t motorPoles);
+
+#endif /* __DSHOT_H__ */
@@ -0,0 +1,105 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * dynNotch.h - Notch filters tracking the motor vibrations on three axes
+ *
+ * The notch frequencies come from the motor speeds when they are fed from
+ * ESC telemetry, otherwise from peaks in the spectrum of the unfiltered
+ * signal. The spectrum is a sliding DFT over the bins in the tracked range,
+ * updated every sample. Peak search and notch retuning is done for one axis
+ * per sample, which keeps the cost per sample bounded.
+ */
+
+#ifndef __DYN_NOTCH_H__
+#define __DYN_NOTCH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "filter.h"
+
+// Sliding DFT window in samples, the bin width is sampleFreq / DYN_NOTCH_SDFT_SIZE
+#define DYN_NOTCH_SDFT_SIZE    64
+#define DYN_NOTCH_SDFT_BINS    (DYN_NOTCH_SDFT_SIZE / 2)
+// Notches per axis, one per motor when tracking motor speeds
+#define DYN_NOTCH_MAX_NOTCHES  4
+
+typedef enum
+{
+  dynNotchSourceNone = 0,
+  dynNotchSourceSpectrum,
+  dynNotchSourceRpm,
+} dynNotchSource_t;
+
+typedef struct
+{
+  float sampleFreq;
+  float minFreq;
+  float maxFreq;
+  float q;
+  uint8_t peakCount;           // Notches per axis placed on spectrum peaks
+  float minPower;              // Bin power of the smallest tracked vibration
+
+  // Sliding DFT, bins firstBin..lastBin (tracked range plus three bins on each side)
+  uint8_t firstBin;
+  uint8_t lastBin;
+  uint8_t sampleIndex;
+  float samples[3][DYN_NOTCH_SDFT_SIZE];
+  float re[3][DYN_NOTCH_SDFT_BINS];
+  float im[3][DYN_NOTCH_SDFT_BINS];
+  float twiddleRe[DYN_NOTCH_SDFT_BINS];
+  float twiddleIm[DYN_NOTCH_SDFT_BINS];
+
+  // Tracking
+  uint8_t axis;                // Axis retuned next
+  uint16_t rpmTimeout;         // Samples left until the motor speeds are considered stale
+  uint8_t source;
+  float motorFreq[DYN_NOTCH_MAX_NOTCHES];
+  float centerFreq[3][DYN_NOTCH_MAX_NOTCHES];
+  uint16_t hold[3][DYN_NOTCH_MAX_NOTCHES];  // Retunes left until a notch without a peak is released
+  notchData notch[3][DYN_NOTCH_MAX_NOTCHES];
+} dynNotch_t;
+
+/**
+ * Initialize the tracker, all notches are off until a frequency is found.
+ * @param minFreq, maxFreq The range where notches are placed, maxFreq is
+ *                         limited to just below the Nyquist frequency.
+ * @param q Quality factor of the notches, bandwidth is center / q.
+ * @param peakCount Number of spectrum peaks tracked per axis.
+ * @param minAmplitude Smallest vibration amplitude tracked, in the unit of the signal.
+ */
+void dynNotchInit(dynNotch_t* dn, float sampleFreq, float minFreq, float maxFreq, float q, uint8_t peakCount, float minAmplitude);
+
+/**
+ * Feed the rotation frequency of a motor (Hz, 0 when stopped), for instance from
+ * ESC telemetry. While fed regularly the notches follow the motors instead of
+ * the spectrum.
+ */
+void dynNotchSetMotorFrequency(dynNotch_t* dn, uint8_t motor, float freq);
+
+/**
+ * Filter one sample of all three axes in place.
+ */
+void dynNotchApply(dynNotch_t* dn, float* xyz);
+
+#endif /* __DYN_NOTCH_H__ */
@@ -13,6 +13,7 @@
  */
 
 #include <stdarg.h>
+#include <stddef.h>
 
 #ifndef	__EPRINTF_H__
 #define __EPRINTF_H__
@@ -41,4 +42,27 @@ int eprintf(putc_t putcf, char * fmt, ...)
  */
 int evprintf(putc_t putcf, char * fmt, va_list ap);
 
+/**
+ * Light snprintf implementation, formats into a buffer
+ * @param[out] buffer Buffer to format into, always null terminated
+ * @param[in] size Size of the buffer
+ * @param[in] fmt Format string
+ * @param[in] ... Parameters to print
+ * @return the number of character the whole string has, without the null
+ *         character. If this is size or more the string was truncated.
+ */
+int esnprintf(char* buffer, size_t size, const char* fmt, ...)
+    __attribute__ (( format(printf, 3, 4) ));
+
+/**
+ * Light snprintf implementation, formats into a buffer
+ * @param[out] buffer Buffer to format into, always null terminated
+ * @param[in] size Size of the buffer
+ * @param[in] fmt Format string
+ * @param[in] ap Parameters to print
+ * @return the number of character the whole string has, without the null
+ *         character. If this is size or more the string was truncated.
+ */
+int evsnprintf(char* buffer, size_t size, const char* fmt, va_list ap);
+
 #endif //__EPRINTF_H__
@@ -46,5 +46,21 @@ void lpf2pSetCutoffFreq(lpf2pData* lpfData, float sample_freq, float cutoff_freq
 float lpf2pApply(lpf2pData* lpfData, float sample);
 float lpf2pReset(lpf2pData* lpfData, float sample);
 
+typedef struct {
+  float a1;
+  float a2;
+  float b0;
+  float b1;
+  float b2;
+  float x1;
+  float x2;
+  float y1;
+  float y2;
+} notchData;
+
+void notchInit(notchData* notch, float sample_freq, float center_freq, float q);
+void notchSetCenterFreq(notchData* notch, float sample_freq, float center_freq, float q);
+float notchApply(notchData* notch, float sample);
+
 
 #endif //FILTER_H_
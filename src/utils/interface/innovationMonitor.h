@@ -0,0 +1,88 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * innovationMonitor.h - Consistency statistics for Kalman filter innovations
+ */
+
+#ifndef __INNOVATION_MONITOR_H__
+#define __INNOVATION_MONITOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Histogram of the normalized innovation |e|/sqrt(HPH'+R) over a window, in
+ * bins of one standard deviation. The last bin holds everything above 3 sigma.
+ */
+#define INNOVATION_MONITOR_HISTOGRAM_BINS 4
+
+typedef struct {
+  // Configuration, set by innovationMonitorInit()
+  uint16_t windowSize;
+  float lowerBound; // Chi-square acceptance bounds for the NIS sum of a window
+  float upperBound;
+
+  // Statistics of the window being filled
+  uint16_t windowCount;
+  float windowSum;
+  uint16_t windowHistogram[INNOVATION_MONITOR_HISTOGRAM_BINS];
+
+  // Result of the last complete window
+  float nisMean;
+  bool isConsistent;
+  uint16_t histogram[INNOVATION_MONITOR_HISTOGRAM_BINS];
+
+  float nis;  // Normalized innovation squared of the last update
+  uint32_t updateCount;
+  uint32_t lastUpdateTick;
+} innovationMonitor_t;
+
+/**
+ * Initializes a monitor. A window of windowSize NIS samples is tested
+ * against the two-sided 95% chi-square bounds with windowSize degrees of
+ * freedom.
+ */
+void innovationMonitorInit(innovationMonitor_t* this, uint16_t windowSize);
+
+/**
+ * Adds the innovation of one scalar update.
+ *
+ * @param innovation The measurement error (measured - predicted)
+ * @param innovationVariance HPH' + R
+ * @param tick The current time in ticks
+ */
+void innovationMonitorAdd(innovationMonitor_t* this, float innovation, float innovationVariance, uint32_t tick);
+
+/**
+ * True if the monitor got an update within the last maxAge ticks
+ */
+bool innovationMonitorIsActive(const innovationMonitor_t* this, uint32_t tick, uint32_t maxAge);
+
+/**
+ * Consistency score 0 - 100 of the last complete window. 100 when the mean
+ * NIS is below the upper chi-square bound, lower the more the filter is
+ * over-confident compared to the measurements.
+ */
+uint8_t innovationMonitorGetScore(const innovationMonitor_t* this);
+
+#endif // __INNOVATION_MONITOR_H__
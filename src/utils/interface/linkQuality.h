@@ -0,0 +1,89 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * linkQuality.h - Radio link quality and telemetry rate control
+ *
+ * The quality combines what the radio link sees of the channel: the share
+ * of downlink packets that got an ACK to ride on before the send timed out,
+ * and the RSSI of the uplink packets reported by the radio. Both are
+ * filtered with exponential moving averages.
+ *
+ * The telemetry rate is the share of the periodic log packets that is sent.
+ * It is controlled AIMD style: halved when the link is poor or the downlink
+ * is backlogged, and increased in small steps when the link is good.
+ */
+
+#ifndef __LINK_QUALITY_H__
+#define __LINK_QUALITY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// RSSI is reported by the radio as -dBm
+#define LINK_QUALITY_RSSI_GOOD 50
+#define LINK_QUALITY_RSSI_BAD  85
+
+#define LINK_QUALITY_LOW  0.5f   // Below this the telemetry rate is decreased
+#define LINK_QUALITY_HIGH 0.8f   // Above this the telemetry rate is increased
+
+#define LINK_QUALITY_RATE_MIN      (1.0f / 16.0f)
+#define LINK_QUALITY_RATE_DECREASE 0.5f   // Factor
+#define LINK_QUALITY_RATE_INCREASE 0.05f  // Step
+
+typedef struct {
+  float ackRatio;  // 0 - 1
+  float rssi;      // -dBm
+  float quality;   // 0 - 1, of the last update
+  float rate;      // Telemetry rate, LINK_QUALITY_RATE_MIN - 1
+
+  uint32_t acks;   // Totals
+  uint32_t retries;
+} linkQuality_t;
+
+/**
+ * Initializes the estimator to a good link and the full telemetry rate.
+ */
+void linkQualityInit(linkQuality_t* this);
+
+/**
+ * Adds the outcome of one downlink send attempt.
+ *
+ * @param isAcked true if the packet got an ACK to ride on, false if the send
+ *                timed out and is retried
+ */
+void linkQualityAddSend(linkQuality_t* this, bool isAcked);
+
+/**
+ * Adds an RSSI sample from the radio.
+ */
+void linkQualityAddRssi(linkQuality_t* this, uint8_t rssi);
+
+/**
+ * Computes the quality and steps the telemetry rate, to be called
+ * periodically.
+ *
+ * @param isBacklogged true if the downlink queue is filling up
+ */
+void linkQualityUpdate(linkQuality_t* this, bool isBacklogged);
+
+#endif // __LINK_QUALITY_H__
@@ -0,0 +1,116 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * magCalib.h - Online hard and soft iron calibration of the magnetometer
+ *
+ * The samples are fitted to an ellipsoid by linear least squares. Only the
+ * normal equations of the fit are kept, so memory does not grow with the
+ * number of samples. Solving is split in small steps (one Cholesky column,
+ * one Jacobi sweep, ...) that can be run from a sensor loop without missing
+ * samples.
+ *
+ * The result maps the raw readings onto a sphere:
+ * calibrated = softIron * (raw - offset), with det(softIron) = 1 so the
+ * field magnitude is kept.
+ */
+
+#ifndef __MAG_CALIB_H__
+#define __MAG_CALIB_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Samples needed before the fit is attempted
+#define MAG_CALIB_MIN_SAMPLES   50
+// Largest accepted ratio between the longest and shortest ellipsoid axis
+#define MAG_CALIB_MAX_AXIS_RATIO 2.0f
+
+typedef enum
+{
+  magCalibIdle = 0,
+  magCalibCollecting,
+  magCalibSolving,
+  magCalibDone,
+  magCalibFailed,
+} magCalibState_t;
+
+typedef struct
+{
+  float offset[3];
+  float softIron[3][3];
+} magCalibration_t;
+
+typedef struct
+{
+  uint8_t state;
+  uint8_t step;                // Next solver step
+  uint16_t sampleCount;
+  float minSeparation;         // Smallest distance between accepted samples
+  float scale;                 // Samples are divided by this to keep the sums well conditioned
+  float last[3];               // Last accepted sample
+
+  // Normal equations of the fit, the lower triangle of D'D packed by rows and D'1.
+  // The Cholesky factor replaces D'D while solving.
+  float dtd[45];
+  float dt1[9];
+
+  float m[3][3];               // Quadric matrix, eigenvalues after the Jacobi sweeps
+  float v[3][3];               // Eigenvectors
+  magCalibration_t result;
+} magCalib_t;
+
+/**
+ * Set a calibration that leaves the readings unchanged.
+ */
+void magCalibSetIdentity(magCalibration_t* cal);
+
+/**
+ * Apply a calibration to one sample in place.
+ */
+void magCalibApply(const magCalibration_t* cal, float* xyz);
+
+/**
+ * Clear the accumulated samples and start collecting.
+ * @param minSeparation Samples closer than this to the last accepted sample
+ *                      are dropped, keeps a slow rotation from dominating the fit.
+ */
+void magCalibStart(magCalib_t* mc, float minSeparation);
+
+/**
+ * Feed one raw sample, ignored unless collecting.
+ * @return true if the sample was used in the fit
+ */
+bool magCalibAddSample(magCalib_t* mc, const float* xyz);
+
+/**
+ * Stop collecting and start solving, fails if there are too few samples.
+ */
+void magCalibSolve(magCalib_t* mc);
+
+/**
+ * Run one step of the solver. The result is valid when the state is magCalibDone.
+ * @return the state after the step
+ */
+magCalibState_t magCalibStep(magCalib_t* mc);
+
+#endif /* __MAG_CALIB_H__ */
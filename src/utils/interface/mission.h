@@ -0,0 +1,159 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * mission.h - Onboard mission of high-level commander steps
+ *
+ * A mission is a sequence of steps run without the ground station: takeoff,
+ * go to, trajectory, wait until a time and land. Times are in seconds of
+ * mission time, counted from the start of the mission. The mission file is
+ * little endian:
+ *   0: uint32  magic (MISSION_MAGIC)
+ *   4: uint16  version (MISSION_VERSION)
+ *   6: uint16  number of steps
+ *   8: uint32  CRC-32 of the steps
+ *  12: steps, see missionStep_t
+ *
+ * A step can have a condition, checked when the step is about to start. If
+ * it does not hold the step is skipped, or with MISSION_FLAG_ABORT the
+ * mission is aborted. An aborted mission lands from wherever it is. If the
+ * high-level commander is stopped while the mission is flying, for instance
+ * by an emergency stop, the mission is aborted as well.
+ */
+
+#ifndef __MISSION_H__
+#define __MISSION_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MISSION_MAGIC     0x4E53494D // "MISN"
+#define MISSION_VERSION   1
+#define MISSION_MAX_STEPS 32
+
+// Landing of an aborted mission
+#define MISSION_ABORT_LAND_HEIGHT   0.0f
+#define MISSION_ABORT_LAND_DURATION 3.0f
+
+typedef enum
+{
+  missionStepTakeoff = 0,    // To height z in time s
+  missionStepLand = 1,       // To height z in time s
+  missionStepGoTo = 2,       // To x, y, z, yaw in time s
+  missionStepTrajectory = 3, // Trajectory trajectoryId, with time as the timescale
+  missionStepWaitUntil = 4,  // Until the mission time is time
+} missionStepType_t;
+
+typedef enum
+{
+  missionConditionNone = 0,
+  missionConditionBatteryAbove = 1, // Battery rest voltage above value
+  missionConditionTimeBefore = 2,   // Mission time before value
+} missionCondition_t;
+
+#define MISSION_FLAG_RELATIVE 0x01 // Go to or trajectory relative to the current setpoint
+#define MISSION_FLAG_REVERSED 0x02 // Trajectory in reverse
+#define MISSION_FLAG_ABORT    0x04 // Abort rather than skip if the condition fails
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t crc;
+} __attribute__((packed)) missionHeader_t;
+
+typedef struct
+{
+  uint8_t type;          // One of missionStepType_t
+  uint8_t condition;     // One of missionCondition_t
+  uint8_t flags;
+  uint8_t trajectoryId;
+  float conditionValue;
+  float time;            // s, or timescale for trajectories
+  float x;               // m
+  float y;
+  float z;
+  float yaw;             // rad
+} __attribute__((packed)) missionStep_t;
+
+typedef struct
+{
+  int (*takeoff)(float height, float duration);
+  int (*land)(float height, float duration);
+  int (*goTo)(bool relative, float x, float y, float z, float yaw, float duration);
+  int (*startTrajectory)(uint8_t trajectoryId, float timescale, bool relative, bool reversed);
+  bool (*isTrajectoryFinished)(void);
+  bool (*isStopped)(void);
+  float (*batteryVoltage)(void); // At rest, the estimated open circuit voltage
+} missionOps_t;
+
+typedef enum
+{
+  missionStateEmpty = 0,
+  missionStateLoaded,
+  missionStateRunning,
+  missionStateDone,
+  missionStateAborted,
+} missionState_t;
+
+typedef struct
+{
+  const missionOps_t* ops;
+  missionState_t state;
+
+  uint16_t count;
+  missionStep_t steps[MISSION_MAX_STEPS];
+
+  uint16_t current;      // Step being run
+  bool isStepStarted;
+  float stepStart;       // Mission time
+  bool isFlying;         // Between a takeoff and the end of a landing
+  int error;             // Of the step that aborted the mission
+} mission_t;
+
+/**
+ * Initialize an empty mission.
+ */
+void missionInit(mission_t* mission, const missionOps_t* ops);
+
+/**
+ * Check and load a mission file, replacing the current mission unless it
+ * is running.
+ * @return 0, EINVAL for a malformed file, EIO for a CRC mismatch and EBUSY
+ * if a mission is running.
+ */
+int missionLoad(mission_t* mission, const uint8_t* data, uint32_t len);
+
+/**
+ * Start the loaded mission from its first step, at mission time 0.
+ * @return 0, ENOENT without a mission and EBUSY if it is running.
+ */
+int missionStart(mission_t* mission);
+
+/**
+ * Run the mission, to be called periodically.
+ * @param time Mission time, s
+ */
+void missionUpdate(mission_t* mission, float time);
+
+#endif /* __MISSION_H__ */
@@ -0,0 +1,79 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sleepStats.h - Statistics of the tickless idle sleeps
+ *
+ * The statistics are collected over windows of a fixed number of core clock
+ * cycles. The result of the last complete window is kept until the next one
+ * completes, so that it can be logged at any rate.
+ */
+
+#ifndef __SLEEP_STATS_H__
+#define __SLEEP_STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+  // Statistics of the window being filled
+  uint64_t windowStart;       // Cycle timestamp
+  uint32_t windowSleeps;
+  uint32_t windowTickWakeups;
+  uint64_t windowSleepCycles;
+  uint64_t windowLatencySum;
+  uint32_t windowLatencyMax;
+
+  // Result of the last complete window
+  float sleepRatio;           // Part of the window spent asleep, 0 - 1
+  uint32_t sleeps;
+  uint32_t meanSleep;         // Cycles
+  uint32_t meanLatency;       // Cycles, of the sleeps ended by the tick
+  uint32_t maxLatency;
+} sleepStats_t;
+
+/**
+ * Initializes the statistics and starts the first window.
+ *
+ * @param now The current cycle timestamp
+ */
+void sleepStatsInit(sleepStats_t* this, uint64_t now);
+
+/**
+ * Adds one sleep.
+ *
+ * @param sleepCycles The time from entering to leaving the sleep
+ * @param isTickWakeup True if the sleep ended at the expected RTOS tick,
+ *                     false if another interrupt woke the core earlier
+ * @param latencyCycles The time from the tick to the core running again,
+ *                      only used for tick wakeups
+ */
+void sleepStatsAdd(sleepStats_t* this, uint32_t sleepCycles, bool isTickWakeup, uint32_t latencyCycles);
+
+/**
+ * Completes the window if windowCycles have passed since it started.
+ *
+ * @return true if the result was updated
+ */
+bool sleepStatsUpdate(sleepStats_t* this, uint64_t now, uint32_t windowCycles);
+
+#endif // __SLEEP_STATS_H__
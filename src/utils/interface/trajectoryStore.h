@@ -0,0 +1,139 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * trajectoryStore.h - Trajectory image in a flash sector
+ *
+ * The store holds one image of trajectories, uploaded as a whole. The image
+ * is little endian and starts with a header and an index:
+ *   0: uint32  magic (TRAJECTORY_STORE_MAGIC)
+ *   4: uint16  version (TRAJECTORY_STORE_VERSION)
+ *   6: uint8   number of index entries
+ *   7: uint8   reserved
+ *   8: uint32  image size in bytes, header included
+ *  12: uint32  CRC-32 of the bytes from 16 to the end of the image
+ *  16: index entries, see trajectoryStoreEntry_t
+ * followed by the trajectory data. The data of an entry is word aligned, so
+ * that the pieces can be evaluated straight from the memory mapped flash.
+ *
+ * An upload starts with a write of at least the header at address 0, which
+ * erases the sector, and continues with writes in sequence. The flash is
+ * programmed a word at a time. The magic is programmed last, once the image
+ * is complete and its CRC is checked, so that an interrupted upload leaves
+ * no valid image behind. A host can read the header and the index to see if
+ * the image it has is already stored, and skip the upload.
+ */
+
+#ifndef __TRAJECTORY_STORE_H__
+#define __TRAJECTORY_STORE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRAJECTORY_STORE_MAGIC       0x464A5254 // "TRJF"
+#define TRAJECTORY_STORE_VERSION     1
+#define TRAJECTORY_STORE_MAX_ENTRIES 32
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint8_t count;
+  uint8_t reserved;
+  uint32_t size;
+  uint32_t crc;
+} __attribute__((packed)) trajectoryStoreHeader_t;
+
+typedef struct
+{
+  uint8_t trajectoryId;  // Id the trajectory is defined as in the high level commander
+  uint8_t type;          // One of TrajectoryType_e of the high level commander
+  uint8_t n_pieces;
+  uint8_t reserved;
+  uint32_t offset;       // From the start of the image
+  uint32_t size;         // Bytes
+  uint32_t crc;          // CRC-32 of the data
+} __attribute__((packed)) trajectoryStoreEntry_t;
+
+typedef enum
+{
+  trajectoryStoreEmpty = 0,
+  trajectoryStoreUploading,
+  trajectoryStoreValid,
+} trajectoryStoreState_t;
+
+// Flash operations, offsets are from the start of the sector
+typedef struct
+{
+  bool (*erase)(void);
+  bool (*program)(uint32_t offset, uint32_t word);
+} trajectoryStoreFlash_t;
+
+typedef struct
+{
+  const uint8_t* base;                 // Memory mapped sector
+  uint32_t capacity;                   // Bytes
+  const trajectoryStoreFlash_t* flash;
+
+  trajectoryStoreState_t state;
+  trajectoryStoreHeader_t header;      // Of the stored or uploaded image
+  uint32_t position;                   // Next byte of the upload
+  uint8_t word[4];                     // Uploaded bytes not programmed yet
+} trajectoryStore_t;
+
+/**
+ * Initialize the store and check the image in the sector.
+ */
+void trajectoryStoreInit(trajectoryStore_t* store, const uint8_t* base, uint32_t capacity,
+                         const trajectoryStoreFlash_t* flash);
+
+bool trajectoryStoreIsValid(const trajectoryStore_t* store);
+
+/**
+ * Upload part of an image, see above.
+ * @return 0, EINVAL for a bad header or a write out of sequence and EIO if
+ * the flash fails or the complete image does not check out.
+ */
+int trajectoryStoreWrite(trajectoryStore_t* store, uint32_t addr, const uint8_t* src, uint32_t len);
+
+/**
+ * Read the sector, whatever it holds.
+ */
+bool trajectoryStoreRead(const trajectoryStore_t* store, uint32_t addr, uint32_t len, uint8_t* dest);
+
+/**
+ * Number of trajectories in the index, 0 without a valid image.
+ */
+int trajectoryStoreCount(const trajectoryStore_t* store);
+
+/**
+ * Copy index entry i, 0 <= i < trajectoryStoreCount().
+ */
+bool trajectoryStoreGetEntry(const trajectoryStore_t* store, int i, trajectoryStoreEntry_t* entry);
+
+/**
+ * Pointer to size bytes of the image at offset, NULL without a valid image
+ * or if the range is outside of it.
+ */
+const void* trajectoryStoreGetData(const trajectoryStore_t* store, uint32_t offset, uint32_t size);
+
+#endif /* __TRAJECTORY_STORE_H__ */
@@ -0,0 +1,76 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * udFactor.h - UD factorized covariance for Kalman filters
+ *
+ * The covariance is stored as P = U*D*U', U unit upper triangular and D
+ * diagonal. Updates work on the factors (Bierman measurement update, Thornton
+ * time update) so P stays symmetric and positive definite in single precision.
+ */
+
+#ifndef __UD_FACTOR_H__
+#define __UD_FACTOR_H__
+
+#include <stdbool.h>
+
+/**
+ * Largest supported state dimension, sets the size of the internal work buffers
+ */
+#define UD_MAX_DIM 12
+
+/**
+ * Factorizes a symmetric matrix P into U and D. Only the upper triangle of P
+ * is used. All matrices are row major, n x n.
+ *
+ * @return false if P is not positive definite, U and D are then not valid
+ */
+bool udFactorize(const float* P, float* U, float* D, int n);
+
+/**
+ * Reconstructs P = U*D*U'
+ */
+void udToCovariance(const float* U, const float* D, float* P, int n);
+
+/**
+ * Scalar measurement update (Bierman). Updates U and D for the measurement
+ * z = h*x + v with var(v) = r and calculates the Kalman gain. The state update,
+ * x = x + K*(z - h*x), is left to the caller.
+ *
+ * @param h The measurement vector, n elements
+ * @param r The measurement variance, must be positive
+ * @param K Output, the Kalman gain, n elements
+ * @return The innovation variance, h*P*h' + r
+ */
+float udScalarUpdate(float* U, float* D, int n, const float* h, float r, float* K);
+
+/**
+ * Time update (Thornton, modified weighted Gram-Schmidt).
+ * Sets U and D to the factors of A*(U*D*U' + diag(q))*A'.
+ * Not reentrant, uses static work buffers.
+ *
+ * @param A The state transition, n x n, or NULL for identity
+ * @param q The diagonal process noise, n elements, or NULL for none
+ */
+void udPredict(float* U, float* D, int n, const float* A, const float* q);
+
+#endif // __UD_FACTOR_H__
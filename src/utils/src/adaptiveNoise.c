@@ -0,0 +1,66 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * adaptiveNoise.c - Online estimation of measurement noise from innovations
+ *
+ * Covariance matching: for a consistent filter E[e^2] = HPH' + R, so every
+ * innovation gives a one sample estimate of R, e^2 - HPH'. These are averaged
+ * with an exponential forgetting factor and the result is bounded relative to
+ * the nominal variance reported by the sensor.
+ */
+
+#include "adaptiveNoise.h"
+
+// Innovations larger than this, relative to the expected innovation variance, are
+// clipped so that a single outlier can not move the estimate far
+#define OUTLIER_GATE 9.0f
+
+void adaptiveNoiseInit(adaptiveNoise_t* this, float rate, float minScale, float maxScale) {
+  this->scale = 1.0f;
+  this->rate = rate;
+  this->minScale = minScale;
+  this->maxScale = maxScale;
+}
+
+void adaptiveNoiseUpdate(adaptiveNoise_t* this, float innovation, float hph, float nominalVariance) {
+  if (!(nominalVariance > 0.0f)) {
+    return;
+  }
+
+  float innovationSq = innovation * innovation;
+  const float expected = hph + this->scale * nominalVariance;
+  if (innovationSq > OUTLIER_GATE * expected) {
+    innovationSq = OUTLIER_GATE * expected;
+  }
+
+  const float sampleScale = (innovationSq - hph) / nominalVariance;
+  float scale = this->scale + this->rate * (sampleScale - this->scale);
+
+  if (scale < this->minScale) {
+    scale = this->minScale;
+  } else if (scale > this->maxScale) {
+    scale = this->maxScale;
+  }
+
+  this->scale = scale;
+}
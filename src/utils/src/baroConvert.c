@@ -0,0 +1,159 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * baroConvert.c - Barometer conversions
+ */
+
+#include "baroConvert.h"
+
+#define ALT_TABLE_STEP_MBAR 4.0f
+#define ALT_TABLE_SIZE 201
+
+// ((1015.7 / p)^0.1902630958 - 1) * (25 + 273.15) / 0.0065 for p = 300, 304 ... 1100 mbar
+static const float altitudeTable[ALT_TABLE_SIZE] =
+{
+  11979.4157f, 11833.8161f, 11690.4792f, 11549.3410f, 11410.3403f, 11273.4183f,
+  11138.5185f, 11005.5865f, 10874.5702f, 10745.4194f, 10618.0859f, 10492.5230f,
+  10368.6861f, 10246.5319f, 10126.0188f, 10007.1068f, 9889.7572f, 9773.9325f,
+  9659.5966f, 9546.7149f, 9435.2535f, 9325.1800f, 9216.4628f, 9109.0715f,
+  9002.9768f, 8898.1499f, 8794.5635f, 8692.1906f, 8591.0055f, 8490.9829f,
+  8392.0986f, 8294.3289f, 8197.6509f, 8102.0425f, 8007.4820f, 7913.9484f,
+  7821.4216f, 7729.8816f, 7639.3093f, 7549.6861f, 7460.9937f, 7373.2147f,
+  7286.3317f, 7200.3281f, 7115.1877f, 7030.8947f, 6947.4336f, 6864.7896f,
+  6782.9479f, 6701.8944f, 6621.6152f, 6542.0968f, 6463.3261f, 6385.2901f,
+  6307.9765f, 6231.3730f, 6155.4676f, 6080.2488f, 6005.7053f, 5931.8259f,
+  5858.5998f, 5786.0165f, 5714.0657f, 5642.7373f, 5572.0215f, 5501.9086f,
+  5432.3894f, 5363.4545f, 5295.0950f, 5227.3022f, 5160.0674f, 5093.3823f,
+  5027.2386f, 4961.6283f, 4896.5436f, 4831.9768f, 4767.9202f, 4704.3666f,
+  4641.3088f, 4578.7396f, 4516.6521f, 4455.0396f, 4393.8954f, 4333.2130f,
+  4272.9861f, 4213.2083f, 4153.8735f, 4094.9759f, 4036.5093f, 3978.4682f,
+  3920.8468f, 3863.6395f, 3806.8410f, 3750.4458f, 3694.4489f, 3638.8449f,
+  3583.6288f, 3528.7958f, 3474.3409f, 3420.2594f, 3366.5466f, 3313.1979f,
+  3260.2088f, 3207.5747f, 3155.2915f, 3103.3548f, 3051.7604f, 3000.5042f,
+  2949.5821f, 2898.9901f, 2848.7243f, 2798.7809f, 2749.1561f, 2699.8462f,
+  2650.8474f, 2602.1563f, 2553.7693f, 2505.6828f, 2457.8935f, 2410.3981f,
+  2363.1931f, 2316.2755f, 2269.6418f, 2223.2891f, 2177.2142f, 2131.4141f,
+  2085.8857f, 2040.6262f, 1995.6325f, 1950.9019f, 1906.4315f, 1862.2186f,
+  1818.2604f, 1774.5542f, 1731.0975f, 1687.8875f, 1644.9217f, 1602.1976f,
+  1559.7128f, 1517.4646f, 1475.4509f, 1433.6690f, 1392.1168f, 1350.7918f,
+  1309.6919f, 1268.8148f, 1228.1582f, 1187.7200f, 1147.4980f, 1107.4901f,
+  1067.6943f, 1028.1084f, 988.7305f, 949.5585f, 910.5905f, 871.8245f,
+  833.2586f, 794.8909f, 756.7195f, 718.7426f, 680.9585f, 643.3652f,
+  605.9610f, 568.7442f, 531.7131f, 494.8659f, 458.2011f, 421.7168f,
+  385.4116f, 349.2838f, 313.3318f, 277.5540f, 241.9489f, 206.5150f,
+  171.2507f, 136.1546f, 101.2252f, 66.4610f, 31.8607f, -2.5772f,
+  -36.8542f, -70.9715f, -104.9306f, -138.7327f, -172.3793f, -205.8716f,
+  -239.2109f, -272.3985f, -305.4357f, -338.3237f, -371.0637f, -403.6571f,
+  -436.1049f, -468.4084f, -500.5687f, -532.5871f, -564.4646f, -596.2024f,
+  -627.8016f, -659.2634f, -690.5888f,
+};
+
+static uint16_t concatBytes(uint8_t msb, uint8_t lsb)
+{
+  return ((uint16_t)msb << 8) | lsb;
+}
+
+void bmp388CalibInit(bmp388Calib_t* calib, const uint8_t* regs)
+{
+  calib->parT1 = concatBytes(regs[1], regs[0]);
+  calib->parT2 = concatBytes(regs[3], regs[2]);
+  calib->parT3 = (int8_t)regs[4];
+  calib->parP1 = (int16_t)concatBytes(regs[6], regs[5]);
+  calib->parP2 = (int16_t)concatBytes(regs[8], regs[7]);
+  calib->parP3 = (int8_t)regs[9];
+  calib->parP4 = (int8_t)regs[10];
+  calib->parP5 = concatBytes(regs[12], regs[11]);
+  calib->parP6 = concatBytes(regs[14], regs[13]);
+  calib->parP7 = (int8_t)regs[15];
+  calib->parP8 = (int8_t)regs[16];
+  calib->parP9 = (int16_t)concatBytes(regs[18], regs[17]);
+  calib->parP10 = (int8_t)regs[19];
+  calib->parP11 = (int8_t)regs[20];
+
+  calib->tLin = 0;
+  calib->offset = 0;
+  calib->sensitivity = 0;
+  calib->quadratic = 0;
+}
+
+// The divisions below are by powers of two and truncate like the reference
+// implementation, the compiler turns them into shifts.
+int32_t bmp388SetTemperature(bmp388Calib_t* calib, uint32_t rawTemperature)
+{
+  const int64_t dT = (int64_t)rawTemperature - 256 * (int64_t)calib->parT1;
+  const int64_t tLin = (dT * calib->parT2 * 262144 + dT * dT * calib->parT3) / 4294967296;
+
+  const int64_t tLin2 = tLin * tLin;
+  const int64_t tLin3 = ((tLin2 / 64) * tLin) / 256;
+
+  calib->tLin = tLin;
+  calib->offset = (calib->parP5 * 140737488355328
+                   + (calib->parP8 * tLin3) / 32
+                   + (calib->parP7 * tLin2) * 16
+                   + (calib->parP6 * tLin) * 4194304) / 4;
+  calib->sensitivity = ((calib->parP1 - 16384) * 70368744177664
+                        + (calib->parP4 * tLin3) / 32
+                        + (calib->parP3 * tLin2) * 4
+                        + (calib->parP2 - 16384) * tLin * 2097152) / 16777216;
+  calib->quadratic = calib->parP10 * tLin + 65536 * calib->parP9;
+
+  return (int32_t)((tLin * 25) / 16384);
+}
+
+// (x * y) / divisor, truncated, for a power of two divisor. Splitting x keeps
+// the intermediate product in range where the reference overflows (raw
+// pressures above about 8.4e6 for typical calibrations).
+static int64_t mulDiv(int64_t x, int64_t y, int64_t divisor)
+{
+  return (x / divisor) * y + ((x % divisor) * y) / divisor;
+}
+
+uint32_t bmp388CompensatePressure(const bmp388Calib_t* calib, uint32_t rawPressure)
+{
+  const int64_t p = rawPressure;
+
+  const int64_t linear = calib->sensitivity * p;
+  const int64_t quadratic = mulDiv((calib->quadratic * p) / 8192, p, 512);
+  const int64_t cubic = mulDiv((calib->parP11 * (p * p)) / 65536, p, 128);
+  const int64_t sum = calib->offset + linear + quadratic + cubic;
+
+  return (uint32_t)(((uint64_t)sum * 25) / 1099511627776);
+}
+
+float baroPressureToAltitude(float pressure)
+{
+  const float position = (pressure - BARO_ALT_TABLE_MIN_MBAR) * (1.0f / ALT_TABLE_STEP_MBAR);
+
+  int index = (int)position;
+  if (index < 0)
+  {
+    index = 0;
+  }
+  else if (index > ALT_TABLE_SIZE - 2)
+  {
+    index = ALT_TABLE_SIZE - 2;
+  }
+
+  const float fraction = position - (float)index;
+  return altitudeTable[index] + fraction * (altitudeTable[index + 1] - altitudeTable[index]);
+}
@@ -0,0 +1,290 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * batteryEstimator.c - Battery state of charge and remaining flight time
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "batteryEstimator.h"
+
+#define SOC 0
+#define V1 1
+#define R0 2
+
+// Open circuit voltage of a 1S LiPo at 0, 10, ... 100 % state of charge
+#define OCV_POINTS 11
+static const float ocvTable[OCV_POINTS] =
+{
+  3.00f, 3.78f, 3.83f, 3.87f, 3.89f, 3.92f, 3.96f, 4.00f, 4.04f, 4.10f, 4.20f
+};
+
+// Defaults for a small LiPo, r1 * c1 gives the 30 s settling of the voltage after a load change
+#define DEFAULT_R1 0.05f
+#define DEFAULT_C1 600.0f
+#define DEFAULT_VOLTAGE_STDDEV 0.02f
+#define DEFAULT_CURRENT_STDDEV 0.05f
+#define DEFAULT_CURRENT_MODEL_STDDEV 0.3f
+
+// Initial uncertainty, the first voltage may be under load
+#define INITIAL_SOC_STDDEV 0.1f
+#define INITIAL_V1_STDDEV 0.05f
+#define INITIAL_R0_STDDEV 0.05f
+
+// Random walks per sqrt(s), for the errors the current integration does not cover
+#define SOC_PROCESS_NOISE 0.0001f
+#define V1_PROCESS_NOISE 0.005f
+#define R0_PROCESS_NOISE 0.001f
+
+#define R0_MIN 0.01f
+#define R0_MAX 1.0f
+
+// Time (s) over which the error of the current is correlated, a modelled current is
+// off by about the same amount for the whole flight rather than by white noise
+#define CURRENT_ERROR_CORRELATION_TIME 60.0f
+
+// Time constant (s) of the averaging of the flight current
+#define FLIGHT_CURRENT_TAU 30.0f
+
+static float ocvSlope(float soc)
+{
+  int i = (int)(soc * (OCV_POINTS - 1));
+  if (i < 0)
+  {
+    i = 0;
+  }
+  else if (i > OCV_POINTS - 2)
+  {
+    i = OCV_POINTS - 2;
+  }
+
+  return (ocvTable[i + 1] - ocvTable[i]) * (OCV_POINTS - 1);
+}
+
+float batteryOcvFromSoc(float soc)
+{
+  if (soc <= 0.0f)
+  {
+    return ocvTable[0];
+  }
+  if (soc >= 1.0f)
+  {
+    return ocvTable[OCV_POINTS - 1];
+  }
+
+  float position = soc * (OCV_POINTS - 1);
+  int i = (int)position;
+  return ocvTable[i] + (position - i) * (ocvTable[i + 1] - ocvTable[i]);
+}
+
+float batterySocFromOcv(float voltage)
+{
+  if (voltage <= ocvTable[0])
+  {
+    return 0.0f;
+  }
+  if (voltage >= ocvTable[OCV_POINTS - 1])
+  {
+    return 1.0f;
+  }
+
+  int i = 0;
+  while (voltage > ocvTable[i + 1])
+  {
+    i++;
+  }
+
+  return (i + (voltage - ocvTable[i]) / (ocvTable[i + 1] - ocvTable[i])) / (OCV_POINTS - 1);
+}
+
+float batteryMotorCurrent(float meanRatio, float idleCurrent, float fullCurrent)
+{
+  if (meanRatio < 0.0f)
+  {
+    meanRatio = 0.0f;
+  }
+  else if (meanRatio > 1.0f)
+  {
+    meanRatio = 1.0f;
+  }
+
+  return idleCurrent + fullCurrent * meanRatio * sqrtf(meanRatio);
+}
+
+void batteryEstimatorInit(batteryEstimator_t* be, float capacity, float r0, float flightCurrent)
+{
+  memset(be, 0, sizeof(*be));
+  be->capacity = capacity;
+  be->r1 = DEFAULT_R1;
+  be->c1 = DEFAULT_C1;
+  be->voltageStdDev = DEFAULT_VOLTAGE_STDDEV;
+  be->currentStdDev = DEFAULT_CURRENT_STDDEV;
+  be->currentModelStdDev = DEFAULT_CURRENT_MODEL_STDDEV;
+  be->r0 = r0;
+  be->flightCurrent = flightCurrent;
+}
+
+void batteryEstimatorReset(batteryEstimator_t* be)
+{
+  be->isInit = false;
+}
+
+static void batteryEstimatorStart(batteryEstimator_t* be, float voltage, float current)
+{
+  // Take the sag of the series resistance into account, the polarization is unknown
+  be->soc = batterySocFromOcv(voltage + be->r0 * current);
+  be->v1 = 0.0f;
+
+  memset(be->P, 0, sizeof(be->P));
+  be->P[SOC][SOC] = INITIAL_SOC_STDDEV * INITIAL_SOC_STDDEV;
+  be->P[V1][V1] = INITIAL_V1_STDDEV * INITIAL_V1_STDDEV;
+  be->P[R0][R0] = INITIAL_R0_STDDEV * INITIAL_R0_STDDEV;
+
+  be->isInit = true;
+}
+
+static void batteryEstimatorPredict(batteryEstimator_t* be, float current, bool isCurrentMeasured, float dt)
+{
+  const float chargeScale = dt / (3600.0f * be->capacity);
+  const float a = expf(-dt / (be->r1 * be->c1));
+
+  be->soc -= current * chargeScale;
+  be->v1 = a * be->v1 + be->r1 * (1.0f - a) * current;
+
+  // P = F P F' with F = diag(1, a, 1)
+  for (int i = 0; i < BATTERY_ESTIMATOR_STATES; i++)
+  {
+    be->P[V1][i] *= a;
+    be->P[i][V1] *= a;
+  }
+
+  float currentStdDev = be->currentStdDev;
+  if (!isCurrentMeasured)
+  {
+    currentStdDev += be->currentModelStdDev * fabsf(current);
+  }
+
+  const float socNoise = currentStdDev * chargeScale;
+  be->P[SOC][SOC] += socNoise * socNoise * (CURRENT_ERROR_CORRELATION_TIME / dt) + SOC_PROCESS_NOISE * SOC_PROCESS_NOISE * dt;
+  // The error of the current also enters the polarization
+  const float v1Noise = currentStdDev * be->r1 * (1.0f - a);
+  be->P[V1][V1] += v1Noise * v1Noise + V1_PROCESS_NOISE * V1_PROCESS_NOISE * dt;
+  be->P[R0][R0] += R0_PROCESS_NOISE * R0_PROCESS_NOISE * dt;
+}
+
+static void batteryEstimatorCorrect(batteryEstimator_t* be, float voltage, float current)
+{
+  const float predicted = batteryOcvFromSoc(be->soc) - be->v1 - be->r0 * current;
+  const float h[BATTERY_ESTIMATOR_STATES] = {ocvSlope(be->soc), -1.0f, -current};
+
+  float ph[BATTERY_ESTIMATOR_STATES];
+  float s = be->voltageStdDev * be->voltageStdDev;
+  for (int i = 0; i < BATTERY_ESTIMATOR_STATES; i++)
+  {
+    ph[i] = 0.0f;
+    for (int j = 0; j < BATTERY_ESTIMATOR_STATES; j++)
+    {
+      ph[i] += be->P[i][j] * h[j];
+    }
+    s += h[i] * ph[i];
+  }
+
+  const float error = voltage - predicted;
+  float k[BATTERY_ESTIMATOR_STATES];
+  for (int i = 0; i < BATTERY_ESTIMATOR_STATES; i++)
+  {
+    k[i] = ph[i] / s;
+  }
+
+  be->soc += k[SOC] * error;
+  be->v1 += k[V1] * error;
+  be->r0 += k[R0] * error;
+
+  // P = P - K S K', keeps P symmetric
+  for (int i = 0; i < BATTERY_ESTIMATOR_STATES; i++)
+  {
+    for (int j = 0; j < BATTERY_ESTIMATOR_STATES; j++)
+    {
+      be->P[i][j] -= k[i] * s * k[j];
+    }
+  }
+
+  if (be->soc < 0.0f)
+  {
+    be->soc = 0.0f;
+  }
+  else if (be->soc > 1.0f)
+  {
+    be->soc = 1.0f;
+  }
+
+  if (be->r0 < R0_MIN)
+  {
+    be->r0 = R0_MIN;
+  }
+  else if (be->r0 > R0_MAX)
+  {
+    be->r0 = R0_MAX;
+  }
+}
+
+void batteryEstimatorUpdate(batteryEstimator_t* be, float voltage, float current, bool isCurrentMeasured,
+                            bool isFlying, float dt)
+{
+  be->current = current;
+
+  if (!be->isInit)
+  {
+    batteryEstimatorStart(be, voltage, current);
+    return;
+  }
+
+  batteryEstimatorPredict(be, current, isCurrentMeasured, dt);
+  batteryEstimatorCorrect(be, voltage, current);
+
+  if (isFlying)
+  {
+    float gain = dt / FLIGHT_CURRENT_TAU;
+    if (gain > 1.0f)
+    {
+      gain = 1.0f;
+    }
+    be->flightCurrent += gain * (current - be->flightCurrent);
+  }
+}
+
+float batteryEstimatorGetOcv(const batteryEstimator_t* be)
+{
+  return batteryOcvFromSoc(be->soc);
+}
+
+float batteryEstimatorGetFlightTime(const batteryEstimator_t* be, float reserveSoc)
+{
+  if (be->soc <= reserveSoc || be->flightCurrent <= 0.0f)
+  {
+    return 0.0f;
+  }
+
+  return (be->soc - reserveSoc) * be->capacity * 3600.0f / be->flightCurrent;
+}
@@ -35,6 +35,7 @@
 #include "i2cdev.h"
 #include "configblock.h"
 #include "eeprom.h"
+#include "crc.h"
 
 
 /* Internal format of the config block */
@@ -77,6 +78,9 @@ struct configblock_v1_s {
 typedef struct configblock_v1_s configblock_t;
 
 static configblock_t configblock;
+// The contents of the eeprom, writes only touch the pages that differ from it
+static configblock_t configblockStored;
+static bool isStoredValid = false;
 static configblock_t configblockDefault =
 {
     .magic = MAGIC,
@@ -95,8 +99,28 @@ static const uint32_t configblockSizes[] =
   sizeof(struct configblock_v1_s),
 };
 
+/* The magnetometer calibration is a separate record after the config block,
+ * so the config block layout stays readable by older firmware and host tools */
+#define MAG_CALIB_ADDR 0x0100
+#define MAG_CALIB_MAGIC 0x4D414731
+#define MAG_CALIB_VERSION 0
+
+struct magcalib_v0_s {
+  /* header */
+  uint32_t magic;
+  uint8_t  version;
+  /* Content */
+  float offset[3];
+  float softIron[6]; // xx, yy, zz, xy, xz, yz of the symmetric matrix
+  /* CRC-32 of the above, as crcSlow() */
+  uint32_t crc;
+} __attribute__((__packed__));
+
+static struct magcalib_v0_s magCalib;
+
 static bool isInit = false;
 static bool cb_ok = false;
+static bool magCalibOk = false;
 
 static bool configblockCheckMagic(configblock_t *configblock);
 static bool configblockCheckVersion(configblock_t *configblock);
@@ -104,6 +128,7 @@ static bool configblockCheckChecksum(configblock_t *configblock);
 static bool configblockCheckDataIntegrity(uint8_t *data, uint8_t version);
 static bool configblockWrite(configblock_t *configblock);
 static bool configblockCopyToNewVersion(configblock_t *configblockSaved, configblock_t *configblockNew);
+static bool configblockReadMagCalibration(void);
 
 static uint8_t calculate_cksum(void* data, size_t len)
 {
@@ -133,6 +158,9 @@ int configblockInit(void)
   {
     if (eepromReadBuffer((uint8_t *)&configblock, 0, sizeof(configblock)))
     {
+      memcpy((uint8_t *)&configblockStored, (uint8_t *)&configblock, sizeof(configblock));
+      isStoredValid = true;
+
       //Verify the config block
       if (configblockCheckMagic(&configblock))
       {
@@ -176,6 +204,8 @@ int configblockInit(void)
     }
   }
 
+  magCalibOk = configblockReadMagCalibration();
+
   if (cb_ok == false)
   {
     // Copy default data to used structure.
@@ -238,11 +268,25 @@ static bool configblockWrite(configblock_t *configblock)
 {
   // Write default configuration to eeprom
   configblock->cksum = calculate_cksum(configblock, sizeof(configblock_t) - 1);
-  if (!eepromWriteBuffer((uint8_t *)configblock, 0, sizeof(configblock_t)))
+
+  bool status;
+  if (isStoredValid)
+  {
+    status = eepromUpdateBuffer((uint8_t *)configblock, (uint8_t *)&configblockStored, 0, sizeof(configblock_t));
+  }
+  else
+  {
+    status = eepromWriteBuffer((uint8_t *)configblock, 0, sizeof(configblock_t));
+  }
+
+  // After a failed write the eeprom contents are unknown
+  isStoredValid = status;
+  if (!status)
   {
     return false;
   }
 
+  memcpy((uint8_t *)&configblockStored, (uint8_t *)configblock, sizeof(configblock_t));
   return true;
 }
 
@@ -271,6 +315,18 @@ static bool configblockCopyToNewVersion(configblock_t *configblockSaved, configb
   return true;
 }
 
+static bool configblockReadMagCalibration(void)
+{
+  if (!eepromReadBuffer((uint8_t *)&magCalib, MAG_CALIB_ADDR, sizeof(magCalib)))
+  {
+    return false;
+  }
+
+  return magCalib.magic == MAG_CALIB_MAGIC &&
+         magCalib.version == MAG_CALIB_VERSION &&
+         magCalib.crc == crcSlow(&magCalib, sizeof(magCalib) - sizeof(magCalib.crc));
+}
+
 /* Static accessors */
 int configblockGetRadioChannel(void)
 {
@@ -311,3 +367,33 @@ float configblockGetCalibRoll(void)
   else
     return 0;
 }
+
+bool configblockGetMagCalibration(float offset[3], float softIron[6])
+{
+  if (!magCalibOk)
+  {
+    return false;
+  }
+
+  memcpy(offset, magCalib.offset, sizeof(magCalib.offset));
+  memcpy(softIron, magCalib.softIron, sizeof(magCalib.softIron));
+  return true;
+}
+
+bool configblockSetMagCalibration(const float offset[3], const float softIron[6])
+{
+  if (!cb_ok)
+  {
+    return false;
+  }
+
+  magCalib.magic = MAG_CALIB_MAGIC;
+  magCalib.version = MAG_CALIB_VERSION;
+  memcpy(magCalib.offset, offset, sizeof(magCalib.offset));
+  memcpy(magCalib.softIron, softIron, sizeof(magCalib.softIron));
+  magCalib.crc = crcSlow(&magCalib, sizeof(magCalib) - sizeof(magCalib.crc));
+
+  // A failed write leaves the record unknown, it is not used until the next good write
+  magCalibOk = eepromWriteBuffer((uint8_t *)&magCalib, MAG_CALIB_ADDR, sizeof(magCalib));
+  return magCalibOk;
+}
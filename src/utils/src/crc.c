@@ -24,7 +24,7 @@
  * Derive parameters from the standard-specific parameters in crc.h.
  */
 #define WIDTH    (8 * sizeof(crc))
-#define TOPBIT   (1 << (WIDTH - 1))
+#define TOPBIT   ((crc)1 << (WIDTH - 1))
 
 #if (REFLECT_DATA == TRUE)
 #undef  REFLECT_DATA
@@ -69,7 +69,7 @@ static unsigned long reflect(unsigned long data, unsigned char nBits)
      */
     if (data & 0x01)
     {
-      reflection |= (1 << ((nBits - 1) - bit));
+      reflection |= (1UL << ((nBits - 1) - bit));
     }
 
     data = (data >> 1);
@@ -92,7 +92,24 @@ static unsigned long reflect(unsigned long data, unsigned char nBits)
  *********************************************************************/
 crc crcSlow(void * datas, int nBytes)
 {
-  crc remainder = INITIAL_REMAINDER;
+  return crcSlowFinalize(crcSlowUpdate(INITIAL_REMAINDER, datas, nBytes));
+
+} /* crcSlow() */
+
+/*********************************************************************
+ *
+ * Function:    crcSlowUpdate()
+ * 
+ * Description: Continue the CRC of a message with the next part of it.
+ *
+ * Notes:		Start with INITIAL_REMAINDER, the result is the CRC once
+ *				passed to crcSlowFinalize().
+ *
+ * Returns:		The remainder after the part.
+ *
+ *********************************************************************/
+crc crcSlowUpdate(crc remainder, void * datas, int nBytes)
+{
   unsigned char * message = datas;
   int byte;
   unsigned char bit;
@@ -105,7 +122,7 @@ crc crcSlow(void * datas, int nBytes)
     /*
      * Bring the next byte into the remainder.
      */
-    remainder ^= (REFLECT_DATA(message[byte]) << (WIDTH - 8));
+    remainder ^= ((crc)REFLECT_DATA(message[byte]) << (WIDTH - 8));
 
     /*
      * Perform modulo-2 division, a bit at a time.
@@ -126,12 +143,29 @@ crc crcSlow(void * datas, int nBytes)
     }
   }
 
+  return remainder;
+
+} /* crcSlowUpdate() */
+
+/*********************************************************************
+ *
+ * Function:    crcSlowFinalize()
+ * 
+ * Description: Compute the CRC from the remainder of crcSlowUpdate().
+ *
+ * Notes:		
+ *
+ * Returns:		The CRC of the message.
+ *
+ *********************************************************************/
+crc crcSlowFinalize(crc remainder)
+{
   /*
    * The final remainder is the CRC result.
    */
   return (REFLECT_REMAINDER(remainder) ^ FINAL_XOR_VALUE);
 
-} /* crcSlow() */
+} /* crcSlowFinalize() */
 
 #ifdef CRC_FAST
 static crc crcTable[256];
@@ -163,7 +197,7 @@ void crcInit(void)
     /*
      * Start with the dividend followed by zeros.
      */
-    remainder = dividend << (WIDTH - 8);
+    remainder = (crc)dividend << (WIDTH - 8);
 
     /*
      * Perform modulo-2 division, a bit at a time.
@@ -0,0 +1,130 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * dshot.c - DShot digital ESC protocol encoding
+ */
+
+#include "dshot.h"
+
+#define GCR_INVALID 0xFF
+
+// 5 bit GCR symbol to nibble, GCR_INVALID for symbols not used by the encoding
+static const uint8_t gcrDecode[32] =
+{
+  GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID,
+  GCR_INVALID, 0x9,         0xA,         0xB,         GCR_INVALID, 0xD,         0xE,         0xF,
+  GCR_INVALID, GCR_INVALID, 0x2,         0x3,         GCR_INVALID, 0x5,         0x6,         0x7,
+  GCR_INVALID, 0x0,         0x8,         0x1,         GCR_INVALID, 0x4,         0xC,         GCR_INVALID,
+};
+
+static uint16_t checksum(uint16_t packet)
+{
+  return (packet ^ (packet >> 4) ^ (packet >> 8)) & 0x0F;
+}
+
+uint16_t dshotThrottleFromRatio(uint16_t ratio)
+{
+  if (ratio == 0)
+  {
+    return 0;
+  }
+
+  return DSHOT_THROTTLE_MIN + (uint16_t)(((uint32_t)ratio * (DSHOT_THROTTLE_MAX - DSHOT_THROTTLE_MIN)) / UINT16_MAX);
+}
+
+uint16_t dshotEncodeFrame(uint16_t value, bool telemetry, bool inverted)
+{
+  uint16_t packet = ((value & 0x07FF) << 1) | (telemetry ? 1 : 0);
+  uint16_t csum = checksum(packet);
+
+  if (inverted)
+  {
+    csum = ~csum & 0x0F;
+  }
+
+  return (packet << 4) | csum;
+}
+
+uint32_t dshotBitPeriod(uint32_t timerClockHz, dshotSpeed_t speed)
+{
+  return timerClockHz / ((uint32_t)speed * 1000);
+}
+
+void dshotFrameToCompare(uint16_t frame, uint32_t bitPeriod, uint32_t* out, uint32_t stride)
+{
+  const uint32_t one = (bitPeriod * 3) / 4;
+  const uint32_t zero = (bitPeriod * 3) / 8;
+
+  for (int i = 0; i < DSHOT_FRAME_BITS; i++)
+  {
+    out[i * stride] = (frame & 0x8000) ? one : zero;
+    frame <<= 1;
+  }
+}
+
+bool dshotDecodeTelemetry(uint32_t raw, uint32_t* periodUs)
+{
+  // The ESC toggles the line for every GCR one, turn edges back into bits
+  uint32_t gcr = (raw ^ (raw >> 1)) & 0xFFFFF;
+  uint16_t value = 0;
+
+  for (int i = 0; i < 4; i++)
+  {
+    uint8_t nibble = gcrDecode[(gcr >> (15 - 5 * i)) & 0x1F];
+    if (nibble == GCR_INVALID)
+    {
+      return false;
+    }
+    value = (value << 4) | nibble;
+  }
+
+  // The answer checksum is always inverted
+  if (checksum(value >> 4) != (~value & 0x0F))
+  {
+    return false;
+  }
+
+  value >>= 4;
+  if (value == 0x0FFF)
+  {
+    *periodUs = DSHOT_TELEMETRY_STOPPED;
+  }
+  else
+  {
+    // 3 bits exponent, 9 bits mantissa
+    *periodUs = (uint32_t)(value & 0x01FF) << (value >> 9);
+  }
+
+  return true;
+}
+
+uint32_t dshotPeriodToRpm(uint32_t periodUs, uint8_t motorPoles)
+{
+  if (periodUs == DSHOT_TELEMETRY_STOPPED || motorPoles < 2)
+  {
+    return 0;
+  }
+
+  // eRPM = 60e6 / period, one electrical revolution per pole pair
+  return (60000000 / periodUs) / (motorPoles / 2);
+}
@@ -0,0 +1,303 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * dynNotch.c - Notch filters tracking the motor vibrations on three axes
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "dynNotch.h"
+
+#define TWO_PI_F 6.28318531f
+
+// Damping of the sliding DFT, keeps rounding errors from accumulating in the bins
+#define SDFT_DAMPING 0.9999f
+// Motor speeds not updated for this long (s) are stale
+#define RPM_TIMEOUT 0.1f
+// A spectrum peak must have this many times the median power of the tracked range
+#define PEAK_THRESHOLD 10.0f
+// and this many times the power two bins away on both sides, outside the main lobe of the window.
+// Rejects the leakage from strong motion below the tracked range.
+#define PEAK_PROMINENCE 4.0f
+// Low pass of the notch centers on spectrum peaks, per retune of the axis
+#define CENTER_SMOOTHING 0.3f
+// Time (s) a notch stays without a spectrum peak close to it
+#define NOTCH_HOLD 0.5f
+
+static float sdftDampingN;
+
+static void setCenterFreq(dynNotch_t* dn, int axis, int i, float freq)
+{
+  if (freq < dn->minFreq || freq > dn->maxFreq)
+  {
+    dn->centerFreq[axis][i] = 0.0f;
+    return;
+  }
+
+  if (dn->centerFreq[axis][i] == 0.0f)
+  {
+    notchInit(&dn->notch[axis][i], dn->sampleFreq, freq, dn->q);
+  }
+  else
+  {
+    notchSetCenterFreq(&dn->notch[axis][i], dn->sampleFreq, freq, dn->q);
+  }
+  dn->centerFreq[axis][i] = freq;
+}
+
+// Quickselect, partially reorders the values
+static float median(float* values, int n)
+{
+  int left = 0;
+  int right = n - 1;
+  const int middle = n / 2;
+
+  while (left < right)
+  {
+    float pivot = values[middle];
+    int i = left;
+    int j = right;
+    while (i <= j)
+    {
+      while (values[i] < pivot) i++;
+      while (values[j] > pivot) j--;
+      if (i <= j)
+      {
+        float tmp = values[i];
+        values[i++] = values[j];
+        values[j--] = tmp;
+      }
+    }
+    if (j < middle) left = i;
+    if (middle < i) right = j;
+  }
+
+  return values[middle];
+}
+
+// Strongest peaks of the Hann windowed spectrum
+static int findPeaks(const dynNotch_t* dn, int axis, float* peaks)
+{
+  // The bins next to the tracked range are only used to qualify peaks
+  const int start = dn->firstBin + 3;
+  const int end = dn->lastBin - 3;
+  const float binWidth = dn->sampleFreq / DYN_NOTCH_SDFT_SIZE;
+  // Static to keep them off the sensor task stack
+  static float power[DYN_NOTCH_SDFT_BINS];
+  static float sorted[DYN_NOTCH_SDFT_BINS];
+  float peakPower[DYN_NOTCH_MAX_NOTCHES];
+  int count = 0;
+
+  for (int k = start - 2; k <= end + 2; k++)
+  {
+    // Hann window applied in the frequency domain
+    float re = dn->re[axis][k] - 0.5f * (dn->re[axis][k - 1] + dn->re[axis][k + 1]);
+    float im = dn->im[axis][k] - 0.5f * (dn->im[axis][k - 1] + dn->im[axis][k + 1]);
+    power[k] = re * re + im * im;
+  }
+
+  memcpy(sorted, &power[start], (end - start + 1) * sizeof(float));
+  const float threshold = fmaxf(PEAK_THRESHOLD * median(sorted, end - start + 1), dn->minPower);
+
+  for (int k = start; k <= end; k++)
+  {
+    float below = power[k - 1];
+    float above = power[k + 1];
+
+    if (power[k] <= threshold || power[k] <= below || power[k] < above ||
+        power[k] <= PEAK_PROMINENCE * fmaxf(power[k - 2], power[k + 2]))
+    {
+      continue;
+    }
+
+    // Keep the strongest, sorted on power
+    if (count == dn->peakCount)
+    {
+      if (count == 0 || power[k] <= peakPower[count - 1])
+      {
+        continue;
+      }
+      count--;
+    }
+
+    // Interpolate between the bins on the magnitudes
+    float mBelow = sqrtf(below);
+    float m = sqrtf(power[k]);
+    float mAbove = sqrtf(above);
+    float denominator = mBelow - 2.0f * m + mAbove;
+    float delta = (denominator < 0.0f) ? 0.5f * (mBelow - mAbove) / denominator : 0.0f;
+    delta = fmaxf(-0.5f, fminf(0.5f, delta));
+
+    int i = count++;
+    while (i > 0 && peakPower[i - 1] < power[k])
+    {
+      peakPower[i] = peakPower[i - 1];
+      peaks[i] = peaks[i - 1];
+      i--;
+    }
+    peakPower[i] = power[k];
+    peaks[i] = (k + delta) * binWidth;
+  }
+
+  return count;
+}
+
+static void retune(dynNotch_t* dn, int axis)
+{
+  if (dn->rpmTimeout > 0)
+  {
+    dn->source = dynNotchSourceRpm;
+    for (int i = 0; i < DYN_NOTCH_MAX_NOTCHES; i++)
+    {
+      setCenterFreq(dn, axis, i, dn->motorFreq[i]);
+    }
+    return;
+  }
+
+  float peaks[DYN_NOTCH_MAX_NOTCHES];
+  int count = findPeaks(dn, axis, peaks);
+
+  if (count > 0)
+  {
+    dn->source = dynNotchSourceSpectrum;
+  }
+
+  for (int i = 0; i < DYN_NOTCH_MAX_NOTCHES; i++)
+  {
+    if (i >= dn->peakCount || dn->hold[axis][i] == 0)
+    {
+      dn->centerFreq[axis][i] = 0.0f;
+    }
+    else
+    {
+      dn->hold[axis][i]--;
+    }
+  }
+
+  // Every peak moves the closest notch, notches without a peak stay for a while
+  bool taken[DYN_NOTCH_MAX_NOTCHES] = {false};
+  for (int p = 0; p < count; p++)
+  {
+    int best = 0;
+    float bestDistance = INFINITY;
+
+    for (int i = 0; i < dn->peakCount; i++)
+    {
+      float current = dn->centerFreq[axis][i];
+      float distance = (current > 0.0f) ? fabsf(current - peaks[p]) : dn->sampleFreq;
+      if (!taken[i] && distance < bestDistance)
+      {
+        best = i;
+        bestDistance = distance;
+      }
+    }
+
+    float current = dn->centerFreq[axis][best];
+    float freq = (current > 0.0f) ? current + CENTER_SMOOTHING * (peaks[p] - current) : peaks[p];
+    freq = fmaxf(dn->minFreq, fminf(dn->maxFreq, freq));
+    taken[best] = true;
+    dn->hold[axis][best] = (uint16_t)(NOTCH_HOLD * dn->sampleFreq / 3);
+    setCenterFreq(dn, axis, best, freq);
+  }
+}
+
+void dynNotchInit(dynNotch_t* dn, float sampleFreq, float minFreq, float maxFreq, float q, uint8_t peakCount, float minAmplitude)
+{
+  const float binWidth = sampleFreq / DYN_NOTCH_SDFT_SIZE;
+
+  memset(dn, 0, sizeof(*dn));
+  dn->sampleFreq = sampleFreq;
+  dn->q = q;
+  // A tone of amplitude A gives A * N / 4 in its bin with the Hann window
+  dn->minPower = powf(minAmplitude * DYN_NOTCH_SDFT_SIZE / 4, 2);
+  dn->peakCount = (peakCount < DYN_NOTCH_MAX_NOTCHES) ? peakCount : DYN_NOTCH_MAX_NOTCHES;
+
+  int start = (int)ceilf(minFreq / binWidth);
+  int end = (int)floorf(maxFreq / binWidth);
+  start = (start < 3) ? 3 : start;
+  end = (end > DYN_NOTCH_SDFT_BINS - 4) ? DYN_NOTCH_SDFT_BINS - 4 : end;
+  end = (end < start) ? start : end;
+  dn->firstBin = start - 3;
+  dn->lastBin = end + 3;
+
+  dn->minFreq = minFreq;
+  dn->maxFreq = fminf(maxFreq, (end + 0.5f) * binWidth);
+
+  for (int k = dn->firstBin; k <= dn->lastBin; k++)
+  {
+    dn->twiddleRe[k] = cosf(TWO_PI_F * k / DYN_NOTCH_SDFT_SIZE);
+    dn->twiddleIm[k] = sinf(TWO_PI_F * k / DYN_NOTCH_SDFT_SIZE);
+  }
+
+  sdftDampingN = powf(SDFT_DAMPING, DYN_NOTCH_SDFT_SIZE);
+}
+
+void dynNotchSetMotorFrequency(dynNotch_t* dn, uint8_t motor, float freq)
+{
+  if (motor < DYN_NOTCH_MAX_NOTCHES)
+  {
+    dn->motorFreq[motor] = freq;
+    dn->rpmTimeout = (uint16_t)(RPM_TIMEOUT * dn->sampleFreq);
+  }
+}
+
+void dynNotchApply(dynNotch_t* dn, float* xyz)
+{
+  const int index = dn->sampleIndex;
+
+  // Sliding DFT of the unfiltered signal
+  for (int axis = 0; axis < 3; axis++)
+  {
+    float delta = xyz[axis] - sdftDampingN * dn->samples[axis][index];
+    dn->samples[axis][index] = xyz[axis];
+
+    for (int k = dn->firstBin; k <= dn->lastBin; k++)
+    {
+      float re = SDFT_DAMPING * dn->re[axis][k] + delta;
+      float im = SDFT_DAMPING * dn->im[axis][k];
+      dn->re[axis][k] = re * dn->twiddleRe[k] - im * dn->twiddleIm[k];
+      dn->im[axis][k] = re * dn->twiddleIm[k] + im * dn->twiddleRe[k];
+    }
+  }
+  dn->sampleIndex = (index + 1) % DYN_NOTCH_SDFT_SIZE;
+
+  if (dn->rpmTimeout > 0)
+  {
+    dn->rpmTimeout--;
+  }
+
+  retune(dn, dn->axis);
+  dn->axis = (dn->axis + 1) % 3;
+
+  for (int axis = 0; axis < 3; axis++)
+  {
+    for (int i = 0; i < DYN_NOTCH_MAX_NOTCHES; i++)
+    {
+      if (dn->centerFreq[axis][i] > 0.0f)
+      {
+        xyz[axis] = notchApply(&dn->notch[axis][i], xyz[axis]);
+      }
+    }
+  }
+}
@@ -1,6 +1,6 @@
 /**
- *    ||          ____  _ __                           
- * +------+      / __ )(_) /_______________ _____  ___ 
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
  * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
  * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
  *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
@@ -11,12 +11,18 @@
  *
  * eprintf.c: Memory-friendly ultra-limited embedded implementation of printf
  *
- * This implementation trades CPU cycle for data memory eficiency
- * (No malloc, no unecessary buffers, etc...)
+ * No malloc and no large buffers: each conversion is rendered into a small
+ * chunk on the stack, which is then copied to the caller buffer (esnprintf)
+ * or passed to the putc function (eprintf).
  *
- * Functionality: Implements %s, %d, %x, %X and %f without print size settings.
- * The float handling is verry limited and without exponential notation (ie.
- * works good for number around 0 and within int32 value range).
+ * Functionality: Implements %s, %c, %d, %i, %u, %x, %X, %f and %% with the
+ * l and ll length modifiers, the '-' and '0' flags, a field width and, for
+ * %f, a precision. Hex digits are always upper case.
+ *
+ * Integers are converted two decimal digits per step, with 32 bit divisions
+ * as long as the value fits. Floats are printed from their exact binary
+ * value, the fraction in fixed point, rounded to nearest with ties to even
+ * as printf does. Precisions above 9 are filled with zeros.
  *
  * To use this printf a 'putc' function shall be implemented with the prototype
  * 'int putc(int)'. Then a macro calling eprintf can be created. For example:
@@ -28,277 +34,460 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include <ctype.h>
+#include <string.h>
+
+// Fits a 64 bit integer, or the integer part of any float (39 digits)
+#define CHUNK_SIZE 40
+#define MAX_FRACTION_DIGITS 9
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+static const char decimalPairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const uint32_t powersOf10[MAX_FRACTION_DIGITS + 1] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+typedef struct
+{
+  putc_t putcf;  // Output to a putc function, or
+  char* buffer;  // to a caller buffer
+  int size;
+  int length;    // Characters produced, including those not fitting the buffer
+} output_t;
 
-static const char digit[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 
-                             'A', 'B', 'C', 'D', 'E', 'F'};
+typedef struct
+{
+  bool leftAlign;
+  char padChar;
+  int width;
+  int precision;
+} spec_t;
 
-static int getIntLen (long int value)
+static void emit(output_t* out, const char* chars, int count)
 {
-  int l = 1;
-  while(value > 9)
+  if (out->putcf)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      out->putcf(chars[i]);
+    }
+  }
+  else if (out->length < out->size)
   {
-    l++;
-    value /= 10;
+    int room = out->size - out->length;
+    memcpy(&out->buffer[out->length], chars, count < room ? count : room);
   }
-  return l;
+
+  out->length += count;
 }
 
-int power(int a, int b)
+static void emitRepeated(output_t* out, char c, int count)
 {
-  int i;
-  int x = a;
-
-  for (i = 1; i < b; i++)
+  if (count <= 0)
   {
-    x *= a;
+    return;
   }
 
-  return x;
+  char fill[8];
+  memset(fill, c, sizeof(fill));
+
+  while (count > 0)
+  {
+    int n = count < (int)sizeof(fill) ? count : (int)sizeof(fill);
+    emit(out, fill, n);
+    count -= n;
+  }
 }
 
-static int itoa10Unsigned(putc_t putcf, unsigned long long int num)
+// Emits sign and digits padded to the field width. Zero padding goes between
+// the sign and the digits.
+static void emitField(output_t* out, const spec_t* spec, char sign, const char* digits, int count)
 {
-  int len = 0;
+  int padding = spec->width - count - (sign ? 1 : 0);
 
-  if (num == 0)
+  if (!spec->leftAlign && spec->padChar == ' ')
+  {
+    emitRepeated(out, ' ', padding);
+  }
+  if (sign)
+  {
+    emit(out, &sign, 1);
+  }
+  if (!spec->leftAlign && spec->padChar == '0')
+  {
+    emitRepeated(out, '0', padding);
+  }
+  emit(out, digits, count);
+  if (spec->leftAlign)
   {
-    putcf('0');
-    return 1;
+    emitRepeated(out, ' ', padding);
   }
+}
 
-  unsigned long long int i = 1;
+// Writes the digits of num ending at end, returns the first digit
+static char* utoa10(char* end, uint32_t num)
+{
+  char* p = end;
 
-  while ((num / i) > 9)
+  while (num >= 100)
   {
-    i *= 10L;
+    uint32_t pair = (num % 100) * 2;
+    num /= 100;
+    *--p = decimalPairs[pair + 1];
+    *--p = decimalPairs[pair];
   }
 
-  do
+  if (num >= 10)
+  {
+    *--p = decimalPairs[num * 2 + 1];
+    *--p = decimalPairs[num * 2];
+  }
+  else
   {
-    putcf(digit[(num / i) % 10L]);
-    len++;
+    *--p = (char)('0' + num);
   }
-  while (i /= 10L);
 
-  return len;
+  return p;
 }
 
-static int itoa10(putc_t putcf, long long int num, int precision)
+// Exactly count digits, with leading zeros
+static void utoa10Fixed(char* end, uint32_t num, int count)
 {
-  int len = 0;
+  char* p = end;
 
-  if (num == 0)
+  for (; count >= 2; count -= 2)
   {
-    putcf('0');
-    return 1;
+    uint32_t pair = (num % 100) * 2;
+    num /= 100;
+    *--p = decimalPairs[pair + 1];
+    *--p = decimalPairs[pair];
   }
 
-  long long unsigned int n = num;
-  if (num < 0)
+  if (count)
   {
-    n = -num;
-    putcf('-');
-    len++;
+    *--p = (char)('0' + num % 10);
   }
+}
 
-  int numLenght = getIntLen(num);
-  if (numLenght < precision)
+static char* utoa10Long(char* end, uint64_t num)
+{
+  // 64 bit divisions are library calls, split into 8 digit groups
+  while (num > UINT32_MAX)
   {
-    int fillWithZero = precision - numLenght;
-    while (fillWithZero > 0)
-    {
-      putcf('0');
-      len++;
-      fillWithZero--;
-    }
+    uint64_t high = num / 100000000;
+    utoa10Fixed(end, (uint32_t)(num - high * 100000000), 8);
+    end -= 8;
+    num = high;
   }
 
-  return itoa10Unsigned(putcf, n);
+  return utoa10(end, (uint32_t)num);
+}
+
+static void formatDecimal(output_t* out, const spec_t* spec, uint64_t num, bool negative)
+{
+  char chunk[CHUNK_SIZE];
+  char* end = chunk + sizeof(chunk);
+  char* first = utoa10Long(end, num);
+
+  emitField(out, spec, negative ? '-' : 0, first, (int)(end - first));
 }
 
-static int itoa16(putc_t putcf, uint64_t num, int width, char padChar)
+static void formatSigned(output_t* out, const spec_t* spec, int64_t num)
 {
-  int len = 0;
-  bool foundFirst = false;
+  uint64_t magnitude = num < 0 ? -(uint64_t)num : (uint64_t)num;
+  formatDecimal(out, spec, magnitude, num < 0);
+}
+
+static void formatHex(output_t* out, const spec_t* spec, uint64_t num)
+{
+  char chunk[CHUNK_SIZE];
+  char* end = chunk + sizeof(chunk);
+  char* p = end;
 
-  for (int i = 15; i >= 0; i--)
+  do
   {
-    int shift = i * 4;
-    uint64_t mask = (uint64_t)0x0F << shift;
-    uint64_t val = (num & mask) >> shift;
+    *--p = hexDigits[num & 0x0F];
+    num >>= 4;
+  }
+  while (num);
 
-    if (val > 0)
+  emitField(out, spec, 0, p, (int)(end - p));
+}
+
+// Integer part of a float of 2^32 or more, m * 2^e as decimal digits by
+// doubling, most significant digit first
+static int largeFloatDigits(char* digits, uint32_t mantissa, int exponent)
+{
+  uint8_t value[CHUNK_SIZE]; // Least significant digit first
+  int count = 0;
+
+  for (; mantissa; mantissa /= 10)
+  {
+    value[count++] = mantissa % 10;
+  }
+
+  for (; exponent > 0; exponent--)
+  {
+    int carry = 0;
+    for (int i = 0; i < count; i++)
     {
-      foundFirst = true;
+      int d = value[i] * 2 + carry;
+      carry = d >= 10;
+      value[i] = (uint8_t)(carry ? d - 10 : d);
     }
-
-    if (foundFirst || i < width)
+    if (carry)
     {
-      if (foundFirst)
-      {
-        putcf(digit[val]);
-      }
-      else
-      {
-        putcf(padChar);
-      }
-
-      len++;
+      value[count++] = 1;
     }
   }
 
-  return len;
+  for (int i = 0; i < count; i++)
+  {
+    digits[i] = (char)('0' + value[count - 1 - i]);
+  }
+
+  return count;
 }
 
-static int handleLongLong(putc_t putcf, char** fmt, unsigned long long int val, int width, char padChar)
+static void formatFloat(output_t* out, const spec_t* spec, float num)
 {
-  int len = 0;
+  char chunk[CHUNK_SIZE + 1 + MAX_FRACTION_DIGITS];
+  uint32_t bits;
+  memcpy(&bits, &num, sizeof(bits));
+
+  char sign = (bits >> 31) ? '-' : 0;
+  int exponent = (int)((bits >> 23) & 0xFF);
+  uint32_t mantissa = bits & 0x007FFFFF;
 
-  switch(*((*fmt)++))
+  if (exponent == 0xFF)
   {
-    case 'i':
-    case 'd':
-      len = itoa10(putcf, (long long int)val, 0);
-      break;
-    case 'u':
-      len = itoa10Unsigned(putcf, val);
-      break;
-    case 'x':
-    case 'X':
-      len = itoa16(putcf, val, width, padChar);
-      break;
-    default:
-      // Nothing here
-      break;
+    spec_t special = *spec;
+    special.padChar = ' ';
+    emitField(out, &special, mantissa ? 0 : sign, mantissa ? "nan" : "inf", 3);
+    return;
   }
 
-  return len;
-}
+  if (exponent)
+  {
+    mantissa |= 0x00800000;
+  }
+  else
+  {
+    exponent = 1;
+  }
+  exponent -= 127 + 23; // num = mantissa * 2^exponent, exactly
 
-static int handleLong(putc_t putcf, char** fmt, unsigned long int val, int width, char padChar)
-{
-  int len = 0;
+  int precision = spec->precision;
+  int fractionDigits = precision < MAX_FRACTION_DIGITS ? precision : MAX_FRACTION_DIGITS;
+  uint32_t scale = powersOf10[fractionDigits];
+
+  char* end = chunk + CHUNK_SIZE;
+  char* first;
+  uint32_t fractionValue = 0;
 
-  switch(*((*fmt)++))
+  if (exponent > 8)
   {
-    case 'i':
-    case 'd':
-      len = itoa10(putcf, (long int)val, 0);
-      break;
-    case 'u':
-      len = itoa10Unsigned(putcf, val);
-      break;
-    case 'x':
-    case 'X':
-      len = itoa16(putcf, val, width, padChar);
-      break;
-    default:
-      // Nothing here
-      break;
+    // 2^32 or more, no fraction
+    first = chunk;
+    end = chunk + largeFloatDigits(chunk, mantissa, exponent);
+  }
+  else if (exponent >= 0)
+  {
+    first = utoa10(end, mantissa << exponent);
   }
+  else
+  {
+    // The fraction bits times 10^digits fit 54 bits, shift them down and
+    // round to nearest with ties to even
+    int shift = -exponent;
+    uint32_t integer = shift < 32 ? mantissa >> shift : 0;
+    uint32_t fraction = shift < 32 ? mantissa & ((1u << shift) - 1) : mantissa;
+    uint64_t scaled = (uint64_t)fraction * scale;
+
+    if (shift < 64)
+    {
+      uint64_t half = (uint64_t)1 << (shift - 1);
+      uint64_t remainder = scaled & ((half << 1) - 1);
+      fractionValue = (uint32_t)(scaled >> shift);
 
-  return len;
+      uint32_t last = fractionDigits ? fractionValue : integer;
+      if (remainder > half || (remainder == half && (last & 1)))
+      {
+        fractionValue++;
+        if (fractionValue == scale)
+        {
+          fractionValue = 0;
+          integer++;
+        }
+      }
+    }
+
+    first = utoa10(end, integer);
+  }
+
+  if (precision > 0)
+  {
+    *end++ = '.';
+    utoa10Fixed(end + fractionDigits, fractionValue, fractionDigits);
+    end += fractionDigits;
+  }
+
+  int length = (int)(end - first);
+  int zeros = precision - fractionDigits;
+  if (zeros > 0)
+  {
+    // Digits past the float precision, emitted after the chunk
+    spec_t field = *spec;
+    field.leftAlign = false;
+    field.width = spec->leftAlign ? 0 : spec->width - zeros;
+    emitField(out, &field, sign, first, length);
+    emitRepeated(out, '0', zeros);
+    if (spec->leftAlign)
+    {
+      emitRepeated(out, ' ', spec->width - length - zeros - (sign ? 1 : 0));
+    }
+  }
+  else
+  {
+    emitField(out, spec, sign, first, length);
+  }
 }
 
-int evprintf(putc_t putcf, char * fmt, va_list ap)
+static void formatString(output_t* out, const spec_t* spec, const char* str)
 {
-  int len=0;
-  float num;
-  char* str;
-  int precision;
-  int width;
-  char padChar;
+  spec_t field = *spec;
+  field.padChar = ' ';
+  emitField(out, &field, 0, str, (int)strlen(str));
+}
 
+static int format(output_t* out, const char* fmt, va_list ap)
+{
   while (*fmt)
   {
-    if (*fmt == '%')
+    // Text up to the next conversion in one go
+    const char* text = fmt;
+    while (*fmt && *fmt != '%')
     {
-      precision = 6;
-      padChar = ' ';
-      width = 0;
-
       fmt++;
-      while ('0' == *fmt)
-      {
-        padChar = '0';
-        fmt++;
-      }
+    }
+    if (fmt != text)
+    {
+      emit(out, text, (int)(fmt - text));
+    }
+    if (!*fmt)
+    {
+      break;
+    }
 
-			while(isdigit((unsigned)*fmt))
-			{
-				width *= 10;
-				width += *fmt - '0';
-				fmt++;
-			}
+    fmt++;
+    spec_t spec = {.leftAlign = false, .padChar = ' ', .width = 0, .precision = 6};
 
-      while (!isalpha((unsigned) *fmt))
+    for (;; fmt++)
+    {
+      if (*fmt == '-')
       {
-        if (*fmt == '.')
-        {
-          fmt++;
-          if (isdigit((unsigned)*fmt))
-          {
-            precision = *fmt - '0';
-            fmt++;
-          }
-        }
+        spec.leftAlign = true;
+      }
+      else if (*fmt == '0')
+      {
+        spec.padChar = '0';
       }
-      switch (*fmt++)
+      else
+      {
+        break;
+      }
+    }
+
+    while (*fmt >= '0' && *fmt <= '9')
+    {
+      spec.width = spec.width * 10 + (*fmt++ - '0');
+    }
+
+    if (*fmt == '.')
+    {
+      fmt++;
+      spec.precision = 0;
+      while (*fmt >= '0' && *fmt <= '9')
       {
-        case 'i':
-        case 'd':
-          len += itoa10(putcf, va_arg(ap, int), 0);
-          break;
-        case 'u':
-          len += itoa10Unsigned(putcf, va_arg(ap, unsigned int));
-          break;
-        case 'x':
-        case 'X':
-          len += itoa16(putcf, va_arg(ap, unsigned int), width, padChar);
-          break;
-        case 'l':
-          // Look ahead for ll
-          if (*fmt == 'l') {
-            fmt++;
-            len += handleLongLong(putcf, &fmt, va_arg(ap, unsigned long long int), width, padChar);
-          } else {
-            len += handleLong(putcf, &fmt, va_arg(ap, unsigned long int), width, padChar);
-          }
-
-          break;
-        case 'f':
-          num = va_arg(ap, double);
-          if(num<0)
-          {
-            putcf('-');
-            num = -num;
-            len++;
-          }
-          len += itoa10(putcf, (int)num, 0);
-          putcf('.'); len++;
-          len += itoa10(putcf, (num - (int)num) * power(10,precision), precision);
-          break;
-        case 's':
-          str = va_arg(ap, char* );
-          while(*str)
-          {
-            putcf(*str++);
-            len++;
-          }
-          break;
-        default:
-          break;
+        spec.precision = spec.precision * 10 + (*fmt++ - '0');
       }
     }
-    else
+
+    int longs = 0;
+    while (*fmt == 'l')
+    {
+      longs++;
+      fmt++;
+    }
+
+    char c;
+    switch (*fmt++)
     {
-      putcf(*fmt++);
-      len++;
+      case 'i':
+      case 'd':
+        if (longs >= 2)
+          formatSigned(out, &spec, va_arg(ap, long long int));
+        else if (longs == 1)
+          formatSigned(out, &spec, va_arg(ap, long int));
+        else
+          formatSigned(out, &spec, va_arg(ap, int));
+        break;
+      case 'u':
+        if (longs >= 2)
+          formatDecimal(out, &spec, va_arg(ap, unsigned long long int), false);
+        else if (longs == 1)
+          formatDecimal(out, &spec, va_arg(ap, unsigned long int), false);
+        else
+          formatDecimal(out, &spec, va_arg(ap, unsigned int), false);
+        break;
+      case 'x':
+      case 'X':
+        if (longs >= 2)
+          formatHex(out, &spec, va_arg(ap, unsigned long long int));
+        else if (longs == 1)
+          formatHex(out, &spec, va_arg(ap, unsigned long int));
+        else
+          formatHex(out, &spec, va_arg(ap, unsigned int));
+        break;
+      case 'f':
+        formatFloat(out, &spec, (float)va_arg(ap, double));
+        break;
+      case 's':
+        formatString(out, &spec, va_arg(ap, char*));
+        break;
+      case 'c':
+        c = (char)va_arg(ap, int);
+        emitField(out, &spec, 0, &c, 1);
+        break;
+      case '%':
+        emit(out, "%", 1);
+        break;
+      case '\0':
+        fmt--;
+        break;
+      default:
+        break;
     }
   }
-  
-  return len;
+
+  return out->length;
+}
+
+int evprintf(putc_t putcf, char * fmt, va_list ap)
+{
+  output_t out = {.putcf = putcf};
+  return format(&out, fmt, ap);
 }
 
 int eprintf(putc_t putcf, char * fmt, ...)
@@ -312,3 +501,28 @@ int eprintf(putc_t putcf, char * fmt, ...)
 
   return len;
 }
+
+int evsnprintf(char* buffer, size_t size, const char* fmt, va_list ap)
+{
+  output_t out = {.buffer = buffer, .size = size > 0 ? (int)size - 1 : 0};
+  int len = format(&out, fmt, ap);
+
+  if (size > 0)
+  {
+    buffer[len < out.size ? len : out.size] = '\0';
+  }
+
+  return len;
+}
+
+int esnprintf(char* buffer, size_t size, const char* fmt, ...)
+{
+  va_list ap;
+  int len;
+
+  va_start(ap, fmt);
+  len = evsnprintf(buffer, size, fmt, ap);
+  va_end(ap);
+
+  return len;
+}
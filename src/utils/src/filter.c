@@ -29,7 +29,9 @@
 
 #include "filter.h"
 
-#define M_PI_F (float)M_PI
+#ifndef M_PI_F
+#define M_PI_F (3.14159265358979323846f)
+#endif
 
 /**
  * IIR filter the samples.
@@ -109,3 +111,47 @@ float lpf2pReset(lpf2pData* lpfData, float sample)
   return lpf2pApply(lpfData, sample);
 }
 
+/**
+ * 2-Pole notch filter
+ */
+void notchInit(notchData* notch, float sample_freq, float center_freq, float q)
+{
+  if (notch == NULL || center_freq <= 0.0f) {
+    return;
+  }
+
+  notchSetCenterFreq(notch, sample_freq, center_freq, q);
+  notch->x1 = 0.0f;
+  notch->x2 = 0.0f;
+  notch->y1 = 0.0f;
+  notch->y2 = 0.0f;
+}
+
+// Only the coefficients are changed, the filter keeps running when the center moves
+void notchSetCenterFreq(notchData* notch, float sample_freq, float center_freq, float q)
+{
+  float omega = 2.0f*M_PI_F*center_freq/sample_freq;
+  float cs = cosf(omega);
+  float alpha = sinf(omega)/(2.0f*q);
+  float a0 = 1.0f+alpha;
+  notch->b0 = 1.0f/a0;
+  notch->b1 = -2.0f*cs/a0;
+  notch->b2 = notch->b0;
+  notch->a1 = notch->b1;
+  notch->a2 = (1.0f-alpha)/a0;
+}
+
+// Direct form 1, the state does not depend on the coefficients
+float notchApply(notchData* notch, float sample)
+{
+  float output = notch->b0*sample + notch->b1*notch->x1 + notch->b2*notch->x2 - notch->a1*notch->y1 - notch->a2*notch->y2;
+  if (!isfinite(output)) {
+    output = sample;
+  }
+
+  notch->x2 = notch->x1;
+  notch->x1 = sample;
+  notch->y2 = notch->y1;
+  notch->y1 = output;
+  return output;
+}
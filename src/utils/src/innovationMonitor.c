@@ -0,0 +1,110 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * innovationMonitor.c - Consistency statistics for Kalman filter innovations
+ *
+ * For a consistent filter the normalized innovation squared (NIS) of a scalar
+ * update, e^2/(HPH'+R), is chi-square distributed with one degree of freedom.
+ * The sum over a window of N updates is then chi-square with N degrees of
+ * freedom, which is used as a consistency test.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "innovationMonitor.h"
+
+// Standard normal quantile for a two-sided 95% test
+#define NORMAL_QUANTILE_975 1.959964f
+
+static float chiSquareQuantile(float dof, float normalQuantile);
+
+void innovationMonitorInit(innovationMonitor_t* this, uint16_t windowSize) {
+  memset(this, 0, sizeof(innovationMonitor_t));
+
+  if (windowSize == 0) {
+    windowSize = 1;
+  }
+
+  this->windowSize = windowSize;
+  this->lowerBound = chiSquareQuantile(windowSize, -NORMAL_QUANTILE_975);
+  this->upperBound = chiSquareQuantile(windowSize, NORMAL_QUANTILE_975);
+  this->isConsistent = true;
+}
+
+void innovationMonitorAdd(innovationMonitor_t* this, float innovation, float innovationVariance, uint32_t tick) {
+  if (!(innovationVariance > 0.0f)) {
+    return;
+  }
+
+  const float nis = innovation * innovation / innovationVariance;
+  this->nis = nis;
+  this->updateCount++;
+  this->lastUpdateTick = tick;
+
+  // |e|/sigma in [0,1) -> bin 0, [1,2) -> bin 1, ... Compared in the squared domain to avoid sqrt
+  int bin;
+  if (nis < 1.0f) {
+    bin = 0;
+  } else if (nis < 4.0f) {
+    bin = 1;
+  } else if (nis < 9.0f) {
+    bin = 2;
+  } else {
+    bin = 3;
+  }
+  this->windowHistogram[bin]++;
+
+  this->windowSum += nis;
+  this->windowCount++;
+  if (this->windowCount >= this->windowSize) {
+    this->nisMean = this->windowSum / this->windowCount;
+    this->isConsistent = (this->windowSum >= this->lowerBound) && (this->windowSum <= this->upperBound);
+    memcpy(this->histogram, this->windowHistogram, sizeof(this->histogram));
+    memset(this->windowHistogram, 0, sizeof(this->windowHistogram));
+    this->windowSum = 0.0f;
+    this->windowCount = 0;
+  }
+}
+
+bool innovationMonitorIsActive(const innovationMonitor_t* this, uint32_t tick, uint32_t maxAge) {
+  return (this->updateCount > 0) && ((tick - this->lastUpdateTick) <= maxAge);
+}
+
+uint8_t innovationMonitorGetScore(const innovationMonitor_t* this) {
+  const float upperMean = this->upperBound / this->windowSize;
+  if (this->nisMean <= upperMean) {
+    return 100;
+  }
+
+  return (uint8_t)(100.0f * upperMean / this->nisMean);
+}
+
+/**
+ * Wilson-Hilferty approximation of the chi-square quantile, accurate to a
+ * few percent already for a handful of degrees of freedom.
+ */
+static float chiSquareQuantile(float dof, float normalQuantile) {
+  const float a = 2.0f / (9.0f * dof);
+  const float b = 1.0f - a + normalQuantile * sqrtf(a);
+  return dof * b * b * b;
+}
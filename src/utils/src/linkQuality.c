@@ -0,0 +1,81 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * linkQuality.c - Radio link quality and telemetry rate control
+ */
+
+#include "linkQuality.h"
+
+// Weights of a new sample in the moving averages
+#define ACK_ALPHA  0.05f
+#define RSSI_ALPHA 0.1f
+
+static float clamp(float value, float min, float max)
+{
+  if (value < min) {
+    return min;
+  }
+  if (value > max) {
+    return max;
+  }
+  return value;
+}
+
+void linkQualityInit(linkQuality_t* this)
+{
+  this->ackRatio = 1.0f;
+  this->rssi = LINK_QUALITY_RSSI_GOOD;
+  this->quality = 1.0f;
+  this->rate = 1.0f;
+  this->acks = 0;
+  this->retries = 0;
+}
+
+void linkQualityAddSend(linkQuality_t* this, bool isAcked)
+{
+  if (isAcked) {
+    this->acks++;
+  } else {
+    this->retries++;
+  }
+
+  this->ackRatio += ACK_ALPHA * ((isAcked ? 1.0f : 0.0f) - this->ackRatio);
+}
+
+void linkQualityAddRssi(linkQuality_t* this, uint8_t rssi)
+{
+  this->rssi += RSSI_ALPHA * (rssi - this->rssi);
+}
+
+void linkQualityUpdate(linkQuality_t* this, bool isBacklogged)
+{
+  const float rssiScore = clamp((LINK_QUALITY_RSSI_BAD - this->rssi) / (LINK_QUALITY_RSSI_BAD - LINK_QUALITY_RSSI_GOOD),
+                                0.0f, 1.0f);
+  this->quality = this->ackRatio * rssiScore;
+
+  if (isBacklogged || this->quality < LINK_QUALITY_LOW) {
+    this->rate = clamp(this->rate * LINK_QUALITY_RATE_DECREASE, LINK_QUALITY_RATE_MIN, 1.0f);
+  } else if (this->quality > LINK_QUALITY_HIGH) {
+    this->rate = clamp(this->rate + LINK_QUALITY_RATE_INCREASE, LINK_QUALITY_RATE_MIN, 1.0f);
+  }
+}
@@ -0,0 +1,386 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * magCalib.c - Online hard and soft iron calibration of the magnetometer
+ *
+ * Each sample gives one row of the linear fit of the quadric
+ *   A x^2 + B y^2 + C z^2 + 2D xy + 2E xz + 2F yz + 2G x + 2H y + 2I z = 1
+ * The normal equations are solved by Cholesky decomposition, the center of
+ * the ellipsoid follows from the quadric and the soft iron matrix from the
+ * eigen decomposition of its shape matrix.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "magCalib.h"
+
+#define PARAMS 9
+// Index of element (i, j), j <= i, in the packed lower triangle
+#define PACKED(i, j) ((i) * ((i) + 1) / 2 + (j))
+
+// Solver steps: one Cholesky column per step, then the substitution,
+// then Jacobi sweeps until the shape matrix is diagonal
+#define STEP_SUBSTITUTION PARAMS
+#define STEP_FIRST_SWEEP  (STEP_SUBSTITUTION + 1)
+#define MAX_SWEEPS        10
+#define STEP_RESULT       (STEP_FIRST_SWEEP + MAX_SWEEPS)
+
+// Off diagonal magnitude, relative to the diagonal, where the sweeps stop
+#define JACOBI_TOLERANCE 1e-7f
+
+void magCalibSetIdentity(magCalibration_t* cal)
+{
+  memset(cal, 0, sizeof(*cal));
+  cal->softIron[0][0] = 1.0f;
+  cal->softIron[1][1] = 1.0f;
+  cal->softIron[2][2] = 1.0f;
+}
+
+void magCalibApply(const magCalibration_t* cal, float* xyz)
+{
+  float d[3];
+  for (int i = 0; i < 3; i++)
+  {
+    d[i] = xyz[i] - cal->offset[i];
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    xyz[i] = cal->softIron[i][0] * d[0] + cal->softIron[i][1] * d[1] + cal->softIron[i][2] * d[2];
+  }
+}
+
+void magCalibStart(magCalib_t* mc, float minSeparation)
+{
+  memset(mc, 0, sizeof(*mc));
+  mc->minSeparation = minSeparation;
+  magCalibSetIdentity(&mc->result);
+  mc->state = magCalibCollecting;
+}
+
+bool magCalibAddSample(magCalib_t* mc, const float* xyz)
+{
+  if (mc->state != magCalibCollecting)
+  {
+    return false;
+  }
+
+  if (mc->sampleCount == 0)
+  {
+    mc->scale = sqrtf(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]);
+    if (mc->scale == 0.0f)
+    {
+      return false;
+    }
+  }
+  else
+  {
+    float dx = xyz[0] - mc->last[0];
+    float dy = xyz[1] - mc->last[1];
+    float dz = xyz[2] - mc->last[2];
+    if (dx * dx + dy * dy + dz * dz < mc->minSeparation * mc->minSeparation)
+    {
+      return false;
+    }
+  }
+
+  if (mc->sampleCount == UINT16_MAX)
+  {
+    return false;
+  }
+
+  memcpy(mc->last, xyz, sizeof(mc->last));
+  mc->sampleCount++;
+
+  const float x = xyz[0] / mc->scale;
+  const float y = xyz[1] / mc->scale;
+  const float z = xyz[2] / mc->scale;
+  const float d[PARAMS] = {x * x, y * y, z * z, 2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z};
+
+  for (int i = 0; i < PARAMS; i++)
+  {
+    mc->dt1[i] += d[i];
+    for (int j = 0; j <= i; j++)
+    {
+      mc->dtd[PACKED(i, j)] += d[i] * d[j];
+    }
+  }
+
+  return true;
+}
+
+void magCalibSolve(magCalib_t* mc)
+{
+  if (mc->state != magCalibCollecting)
+  {
+    return;
+  }
+
+  mc->step = 0;
+  mc->state = (mc->sampleCount >= MAG_CALIB_MIN_SAMPLES) ? magCalibSolving : magCalibFailed;
+}
+
+// Column j of the in place Cholesky decomposition, columns before j are done
+static bool choleskyColumn(float* a, int j)
+{
+  float diag = a[PACKED(j, j)];
+  for (int k = 0; k < j; k++)
+  {
+    diag -= a[PACKED(j, k)] * a[PACKED(j, k)];
+  }
+
+  if (!(diag > 0.0f))
+  {
+    return false;
+  }
+
+  diag = sqrtf(diag);
+  a[PACKED(j, j)] = diag;
+
+  for (int i = j + 1; i < PARAMS; i++)
+  {
+    float sum = a[PACKED(i, j)];
+    for (int k = 0; k < j; k++)
+    {
+      sum -= a[PACKED(i, k)] * a[PACKED(j, k)];
+    }
+    a[PACKED(i, j)] = sum / diag;
+  }
+
+  return true;
+}
+
+// Solves for the quadric and moves its center to the result,
+// leaves the normalized shape matrix in m
+static bool solveQuadric(magCalib_t* mc)
+{
+  const float* l = mc->dtd;
+  float p[PARAMS];
+
+  // L y = D'1, then L' p = y
+  for (int i = 0; i < PARAMS; i++)
+  {
+    float sum = mc->dt1[i];
+    for (int k = 0; k < i; k++)
+    {
+      sum -= l[PACKED(i, k)] * p[k];
+    }
+    p[i] = sum / l[PACKED(i, i)];
+  }
+  for (int i = PARAMS - 1; i >= 0; i--)
+  {
+    float sum = p[i];
+    for (int k = i + 1; k < PARAMS; k++)
+    {
+      sum -= l[PACKED(k, i)] * p[k];
+    }
+    p[i] = sum / l[PACKED(i, i)];
+  }
+
+  const float m[3][3] = {{p[0], p[3], p[4]}, {p[3], p[1], p[5]}, {p[4], p[5], p[2]}};
+
+  // Center c = -inv(M) v, through the adjugate of M
+  const float adj[3][3] = {
+    {m[1][1] * m[2][2] - m[1][2] * m[2][1], m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][1] * m[1][2] - m[0][2] * m[1][1]},
+    {m[1][2] * m[2][0] - m[1][0] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][2] * m[1][0] - m[0][0] * m[1][2]},
+    {m[1][0] * m[2][1] - m[1][1] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1], m[0][0] * m[1][1] - m[0][1] * m[1][0]},
+  };
+  const float det = m[0][0] * adj[0][0] + m[0][1] * adj[1][0] + m[0][2] * adj[2][0];
+  if (fabsf(det) < 1e-12f)
+  {
+    return false;
+  }
+
+  float c[3];
+  for (int i = 0; i < 3; i++)
+  {
+    c[i] = -(adj[i][0] * p[6] + adj[i][1] * p[7] + adj[i][2] * p[8]) / det;
+  }
+
+  // (x - c)' M (x - c) = 1 + c' M c
+  float k = 1.0f;
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      k += c[i] * m[i][j] * c[j];
+    }
+  }
+  if (fabsf(k) < 1e-6f)
+  {
+    return false;
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    mc->result.offset[i] = c[i] * mc->scale;
+    for (int j = 0; j < 3; j++)
+    {
+      mc->m[i][j] = m[i][j] / k;
+      mc->v[i][j] = (i == j) ? 1.0f : 0.0f;
+    }
+  }
+
+  return true;
+}
+
+// One cyclic Jacobi sweep over the symmetric 3x3 matrix m, accumulating the rotations in v
+// @return true when m is diagonal
+static bool jacobiSweep(magCalib_t* mc)
+{
+  static const int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+  float (*a)[3] = mc->m;
+  float (*v)[3] = mc->v;
+
+  const float offDiagonal = fabsf(a[0][1]) + fabsf(a[0][2]) + fabsf(a[1][2]);
+  const float diagonal = fabsf(a[0][0]) + fabsf(a[1][1]) + fabsf(a[2][2]);
+  if (offDiagonal <= JACOBI_TOLERANCE * diagonal)
+  {
+    return true;
+  }
+
+  for (int n = 0; n < 3; n++)
+  {
+    const int p = pairs[n][0];
+    const int q = pairs[n][1];
+    if (a[p][q] == 0.0f)
+    {
+      continue;
+    }
+
+    const float theta = (a[q][q] - a[p][p]) / (2.0f * a[p][q]);
+    const float t = copysignf(1.0f, theta) / (fabsf(theta) + sqrtf(theta * theta + 1.0f));
+    const float c = 1.0f / sqrtf(t * t + 1.0f);
+    const float s = t * c;
+
+    for (int k = 0; k < 3; k++)
+    {
+      const float akp = a[k][p];
+      const float akq = a[k][q];
+      a[k][p] = c * akp - s * akq;
+      a[k][q] = s * akp + c * akq;
+    }
+    for (int k = 0; k < 3; k++)
+    {
+      const float apk = a[p][k];
+      const float aqk = a[q][k];
+      a[p][k] = c * apk - s * aqk;
+      a[q][k] = s * apk + c * aqk;
+    }
+    for (int k = 0; k < 3; k++)
+    {
+      const float vkp = v[k][p];
+      const float vkq = v[k][q];
+      v[k][p] = c * vkp - s * vkq;
+      v[k][q] = s * vkp + c * vkq;
+    }
+  }
+
+  return false;
+}
+
+// Soft iron matrix sqrt(M) scaled to unit determinant
+static bool computeSoftIron(magCalib_t* mc)
+{
+  float lambda[3];
+  float minLambda = INFINITY;
+  float maxLambda = 0.0f;
+  for (int i = 0; i < 3; i++)
+  {
+    lambda[i] = mc->m[i][i];
+    if (!(lambda[i] > 0.0f))
+    {
+      return false;
+    }
+    minLambda = fminf(minLambda, lambda[i]);
+    maxLambda = fmaxf(maxLambda, lambda[i]);
+  }
+
+  // The axis lengths are 1 / sqrt(lambda)
+  if (maxLambda > MAG_CALIB_MAX_AXIS_RATIO * MAG_CALIB_MAX_AXIS_RATIO * minLambda)
+  {
+    return false;
+  }
+
+  const float gain = 1.0f / cbrtf(sqrtf(lambda[0] * lambda[1] * lambda[2]));
+  float sqrtLambda[3];
+  for (int i = 0; i < 3; i++)
+  {
+    sqrtLambda[i] = sqrtf(lambda[i]) * gain;
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      float sum = 0.0f;
+      for (int k = 0; k < 3; k++)
+      {
+        sum += mc->v[i][k] * sqrtLambda[k] * mc->v[j][k];
+      }
+      mc->result.softIron[i][j] = sum;
+    }
+  }
+
+  return true;
+}
+
+magCalibState_t magCalibStep(magCalib_t* mc)
+{
+  if (mc->state != magCalibSolving)
+  {
+    return mc->state;
+  }
+
+  bool ok = true;
+  if (mc->step < STEP_SUBSTITUTION)
+  {
+    ok = choleskyColumn(mc->dtd, mc->step);
+    mc->step++;
+  }
+  else if (mc->step == STEP_SUBSTITUTION)
+  {
+    ok = solveQuadric(mc);
+    mc->step++;
+  }
+  else if (mc->step < STEP_RESULT)
+  {
+    mc->step = jacobiSweep(mc) ? STEP_RESULT : mc->step + 1;
+  }
+  else
+  {
+    ok = computeSoftIron(mc);
+    if (ok)
+    {
+      mc->state = magCalibDone;
+    }
+  }
+
+  if (!ok)
+  {
+    mc->state = magCalibFailed;
+  }
+
+  return mc->state;
+}
@@ -0,0 +1,248 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * mission.c - Onboard mission of high-level commander steps
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "mission.h"
+#include "crc.h"
+
+#define HEADER_SIZE sizeof(missionHeader_t)
+#define STEP_SIZE   sizeof(missionStep_t)
+
+#define KNOWN_FLAGS (MISSION_FLAG_RELATIVE | MISSION_FLAG_REVERSED | MISSION_FLAG_ABORT)
+
+static bool isStepValid(const missionStep_t* step)
+{
+  const float values[] = {step->conditionValue, step->time, step->x, step->y, step->z, step->yaw};
+  for (int i = 0; i < (int)(sizeof(values) / sizeof(values[0])); i++) {
+    if (!isfinite(values[i])) {
+      return false;
+    }
+  }
+
+  if (step->condition > missionConditionTimeBefore || (step->flags & ~KNOWN_FLAGS) != 0) {
+    return false;
+  }
+
+  switch (step->type) {
+    case missionStepTakeoff:
+    case missionStepLand:
+    case missionStepGoTo:
+    case missionStepTrajectory:
+      // Durations and timescales of zero can not be planned
+      return step->time > 0.0f;
+    case missionStepWaitUntil:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void missionInit(mission_t* mission, const missionOps_t* ops)
+{
+  memset(mission, 0, sizeof(*mission));
+  mission->ops = ops;
+  mission->state = missionStateEmpty;
+}
+
+int missionLoad(mission_t* mission, const uint8_t* data, uint32_t len)
+{
+  if (mission->state == missionStateRunning) {
+    return EBUSY;
+  }
+
+  missionHeader_t header;
+  if (len < HEADER_SIZE) {
+    return EINVAL;
+  }
+  memcpy(&header, data, HEADER_SIZE);
+  if (header.magic != MISSION_MAGIC
+      || header.version != MISSION_VERSION
+      || header.count > MISSION_MAX_STEPS
+      || len != HEADER_SIZE + header.count * STEP_SIZE) {
+    return EINVAL;
+  }
+
+  if (crcSlow((void*)(data + HEADER_SIZE), header.count * STEP_SIZE) != header.crc) {
+    return EIO;
+  }
+
+  for (int i = 0; i < header.count; i++) {
+    missionStep_t step;
+    memcpy(&step, data + HEADER_SIZE + i * STEP_SIZE, STEP_SIZE);
+    if (!isStepValid(&step)) {
+      return EINVAL;
+    }
+  }
+
+  memcpy(mission->steps, data + HEADER_SIZE, header.count * STEP_SIZE);
+  mission->count = header.count;
+  mission->state = missionStateLoaded;
+  return 0;
+}
+
+int missionStart(mission_t* mission)
+{
+  if (mission->state == missionStateEmpty) {
+    return ENOENT;
+  }
+  if (mission->state == missionStateRunning) {
+    return EBUSY;
+  }
+
+  mission->current = 0;
+  mission->isStepStarted = false;
+  mission->isFlying = false;
+  mission->error = 0;
+  mission->state = missionStateRunning;
+  return 0;
+}
+
+static void abortMission(mission_t* mission, int error)
+{
+  if (mission->isFlying) {
+    mission->ops->land(MISSION_ABORT_LAND_HEIGHT, MISSION_ABORT_LAND_DURATION);
+    mission->isFlying = false;
+  }
+
+  mission->error = error;
+  mission->state = missionStateAborted;
+}
+
+static bool isConditionMet(const mission_t* mission, const missionStep_t* step, float time)
+{
+  switch (step->condition) {
+    case missionConditionBatteryAbove:
+      return mission->ops->batteryVoltage() > step->conditionValue;
+    case missionConditionTimeBefore:
+      return time < step->conditionValue;
+    default:
+      return true;
+  }
+}
+
+static int startStep(mission_t* mission, const missionStep_t* step)
+{
+  const bool isRelative = (step->flags & MISSION_FLAG_RELATIVE) != 0;
+  const bool isReversed = (step->flags & MISSION_FLAG_REVERSED) != 0;
+
+  // Setpoints are planned from the current one, which only exists in flight
+  if (step->type != missionStepTakeoff && step->type != missionStepWaitUntil && !mission->isFlying) {
+    return EINVAL;
+  }
+
+  int result = 0;
+  switch (step->type) {
+    case missionStepTakeoff:
+      result = mission->ops->takeoff(step->z, step->time);
+      break;
+    case missionStepLand:
+      result = mission->ops->land(step->z, step->time);
+      break;
+    case missionStepGoTo:
+      result = mission->ops->goTo(isRelative, step->x, step->y, step->z, step->yaw, step->time);
+      break;
+    case missionStepTrajectory:
+      result = mission->ops->startTrajectory(step->trajectoryId, step->time, isRelative, isReversed);
+      break;
+    default:
+      break;
+  }
+
+  if (result == 0 && step->type == missionStepTakeoff) {
+    mission->isFlying = true;
+  }
+  return result;
+}
+
+static bool isStepDone(mission_t* mission, const missionStep_t* step, float time)
+{
+  const float elapsed = time - mission->stepStart;
+
+  switch (step->type) {
+    case missionStepLand:
+      // The planner stops by itself at the end of the landing
+      if (elapsed >= step->time || mission->ops->isStopped()) {
+        mission->isFlying = false;
+        return true;
+      }
+      return false;
+    case missionStepTrajectory:
+      return mission->ops->isTrajectoryFinished();
+    case missionStepWaitUntil:
+      return time >= step->time;
+    default:
+      return elapsed >= step->time;
+  }
+}
+
+void missionUpdate(mission_t* mission, float time)
+{
+  // Steps that are done right away, such as a wait until a past time, do
+  // not hold up the next one
+  while (mission->state == missionStateRunning) {
+    if (mission->current >= mission->count) {
+      mission->state = missionStateDone;
+      return;
+    }
+
+    const missionStep_t* step = &mission->steps[mission->current];
+
+    if (mission->isFlying && step->type != missionStepLand && mission->ops->isStopped()) {
+      // Stopped from elsewhere, do not fly again
+      mission->isFlying = false;
+      abortMission(mission, ECANCELED);
+      return;
+    }
+
+    if (!mission->isStepStarted) {
+      if (!isConditionMet(mission, step, time)) {
+        if (step->flags & MISSION_FLAG_ABORT) {
+          abortMission(mission, ECANCELED);
+          return;
+        }
+        mission->current++;
+        continue;
+      }
+
+      int result = startStep(mission, step);
+      if (result != 0) {
+        abortMission(mission, result);
+        return;
+      }
+      mission->isStepStarted = true;
+      mission->stepStart = time;
+    }
+
+    if (!isStepDone(mission, step, time)) {
+      return;
+    }
+    mission->current++;
+    mission->isStepStarted = false;
+  }
+}
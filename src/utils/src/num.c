@@ -26,6 +26,7 @@
 
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "num.h"
 
@@ -34,55 +35,106 @@
  * To not use the GCC implementation, uint16_t is used to carry fp16 values
  *
  * FP16 or Half precision floating points is specified by IEEE 754 as binary 16.
- * (float is specified as binary 32). This implementation is NOT GUARANTEED to
- * be conform to the ieee 754 specification, it is 'just' good enough for the
- * Crazyflie usage. For more info about fp16 see
+ * (float is specified as binary 32). For more info about fp16 see
  * http://en.wikipedia.org/wiki/Half-precision_floating-point_format
  *
- * The current implementation has the following limitation:
- *  * No subnormalized number generation
- *  * Rounding seems to give at least 11 bits precision
- *  * Faster and smaller than the GCC implementation
+ * The conversions follow IEEE 754: round to nearest, ties to even, subnormal
+ * halves are generated and converted back, overflow gives +/- inf and NaN
+ * stays NaN with the sign and the top bits of the payload, quieted. This is
+ * what the VCVTB instructions of the Cortex-M4F FPU do, with the default
+ * FPSCR (IEEE half, no flush to zero, default rounding), and they are used
+ * when the FPU has them. Elsewhere, for instance in the unit tests on a host,
+ * the bits are shuffled with the exceptional cases as the only branches.
  */
 
+#if defined(__ARM_FP) && (__ARM_FP & 2)
+
+uint16_t single2half(float number)
+{
+  float half;
+  __asm__ ("vcvtb.f16.f32 %0, %1" : "=t" (half) : "t" (number));
+
+  uint32_t bits;
+  memcpy(&bits, &half, sizeof(bits));
+  return (uint16_t)bits;
+}
+
+float half2single(uint16_t number)
+{
+  float half;
+  uint32_t bits = number;
+  memcpy(&half, &bits, sizeof(half));
+
+  float single;
+  __asm__ ("vcvtb.f32.f16 %0, %1" : "=t" (single) : "t" (half));
+  return single;
+}
+
+#else
+
 uint16_t single2half(float number)
 {
-    uint32_t num = *((uint32_t*)&number);
-    uint32_t s = num>>31;
-    uint32_t e = (num>>23)&0x0FF;
-
-    if ((e==255) && (num&0x007fffff))
-        return 0x7E00; // NaN
-    if (e>(127+15))
-        return s?0xFC00:0x7C00;  //+/- inf
-    if (e<(127-15))
-        return 0; //Do not handle generating subnormalised representation
-
-    return (s<<15) | ((e-127+15)<<10) | (((num>>13)&0x3FF)+((num>>12)&0x01));
+  uint32_t num;
+  memcpy(&num, &number, sizeof(num));
+
+  const uint32_t sign = (num >> 16) & 0x8000;
+  num &= 0x7FFFFFFF;
+
+  uint32_t half;
+  if (num >= 0x47800000) // |number| >= 2^16, inf or NaN
+  {
+    half = (num > 0x7F800000) ? 0x7E00 | ((num >> 13) & 0x03FF) : 0x7C00;
+  }
+  else if (num < 0x38800000) // |number| < 2^-14, subnormal or zero
+  {
+    // Adding 0.5 aligns the subnormal mantissa with the last bits of the float,
+    // the FPU does the rounding
+    float aligned;
+    memcpy(&aligned, &num, sizeof(aligned));
+    aligned += 0.5f;
+    memcpy(&half, &aligned, sizeof(half));
+    half -= 0x3F000000;
+  }
+  else
+  {
+    // Rebias the exponent and round to nearest even, a carry out of the
+    // mantissa increments the exponent, up to inf
+    const uint32_t odd = (num >> 13) & 1;
+    half = (num + ((uint32_t)(15 - 127) << 23) + 0x0FFF + odd) >> 13;
+  }
+
+  return (uint16_t)(sign | half);
 }
 
 float half2single(uint16_t number)
 {
-    uint32_t fp32;
-    uint32_t s = number>>15;
-    uint32_t e = (number>>10)&0x01F;
-
-    //All binary16 can be mapped in a binary32
-    if(e==0)
-        e=15-127;
-    if (e==0x1F)
-    {
-        if (number&0x03FF)
-            fp32 = 0x7FC00000; // NaN
-        else
-            fp32 = s?0xFF800000:0x7F800000;  //+/- inf
-    }
-    else
-        fp32 = (s<<31) | ((e+127-15)<<23) | ((number&0x3ff)<<13);
-
-    return *(float*)&fp32;
+  uint32_t fp32 = (uint32_t)(number & 0x7FFF) << 13;
+  const uint32_t e = fp32 & 0x0F800000;
+
+  fp32 += (uint32_t)(127 - 15) << 23;
+  if (e == 0x0F800000) // inf or NaN
+  {
+    fp32 += (uint32_t)(128 - 16) << 23;
+    if (fp32 & 0x007FFFFF)
+      fp32 |= 0x00400000; // quiet NaN
+  }
+  else if (e == 0) // subnormal or zero, normalized by the FPU
+  {
+    float single;
+    fp32 += 1 << 23;
+    memcpy(&single, &fp32, sizeof(single));
+    single -= 6.103515625e-05f; // 2^-14
+    memcpy(&fp32, &single, sizeof(fp32));
+  }
+
+  fp32 |= (uint32_t)(number & 0x8000) << 16;
+
+  float single;
+  memcpy(&single, &fp32, sizeof(single));
+  return single;
 }
 
+#endif
 
 /*****************************************************************************/
 
@@ -0,0 +1,82 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * sleepStats.c - Statistics of the tickless idle sleeps
+ */
+
+#include <string.h>
+
+#include "sleepStats.h"
+
+static void startWindow(sleepStats_t* this, uint64_t now)
+{
+  this->windowStart = now;
+  this->windowSleeps = 0;
+  this->windowTickWakeups = 0;
+  this->windowSleepCycles = 0;
+  this->windowLatencySum = 0;
+  this->windowLatencyMax = 0;
+}
+
+void sleepStatsInit(sleepStats_t* this, uint64_t now)
+{
+  memset(this, 0, sizeof(*this));
+  startWindow(this, now);
+}
+
+void sleepStatsAdd(sleepStats_t* this, uint32_t sleepCycles, bool isTickWakeup, uint32_t latencyCycles)
+{
+  this->windowSleeps++;
+  this->windowSleepCycles += sleepCycles;
+
+  if (isTickWakeup) {
+    this->windowTickWakeups++;
+    this->windowLatencySum += latencyCycles;
+    if (latencyCycles > this->windowLatencyMax) {
+      this->windowLatencyMax = latencyCycles;
+    }
+  }
+}
+
+bool sleepStatsUpdate(sleepStats_t* this, uint64_t now, uint32_t windowCycles)
+{
+  const uint64_t elapsed = now - this->windowStart;
+  if (elapsed < windowCycles || elapsed == 0) {
+    return false;
+  }
+
+  // A sleep in progress when the window started is counted in full
+  uint64_t sleepCycles = this->windowSleepCycles;
+  if (sleepCycles > elapsed) {
+    sleepCycles = elapsed;
+  }
+
+  this->sleepRatio = (float)sleepCycles / (float)elapsed;
+  this->sleeps = this->windowSleeps;
+  this->meanSleep = this->windowSleeps ? (uint32_t)(this->windowSleepCycles / this->windowSleeps) : 0;
+  this->meanLatency = this->windowTickWakeups ? (uint32_t)(this->windowLatencySum / this->windowTickWakeups) : 0;
+  this->maxLatency = this->windowLatencyMax;
+
+  startWindow(this, now);
+  return true;
+}
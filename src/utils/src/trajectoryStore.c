@@ -0,0 +1,221 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * trajectoryStore.c - Trajectory image in a flash sector
+ */
+
+#include <string.h>
+#include <errno.h>
+
+#include "trajectoryStore.h"
+#include "crc.h"
+
+#define HEADER_SIZE sizeof(trajectoryStoreHeader_t)
+#define ENTRY_SIZE  sizeof(trajectoryStoreEntry_t)
+
+static bool isInImage(uint32_t offset, uint32_t size, uint32_t imageSize)
+{
+  return offset <= imageSize && size <= imageSize - offset;
+}
+
+static uint32_t crcOf(const uint8_t* data, uint32_t len)
+{
+  return crcSlow((void*)data, len);
+}
+
+// Everything but the magic, which is checked by the caller
+static bool isHeaderValid(const trajectoryStore_t* store, const trajectoryStoreHeader_t* header)
+{
+  return header->version == TRAJECTORY_STORE_VERSION
+      && header->count <= TRAJECTORY_STORE_MAX_ENTRIES
+      && header->size >= HEADER_SIZE + header->count * ENTRY_SIZE
+      && header->size <= store->capacity;
+}
+
+// Checks the image in flash against the header
+static bool isImageValid(const trajectoryStore_t* store, const trajectoryStoreHeader_t* header)
+{
+  if (crcOf(store->base + HEADER_SIZE, header->size - HEADER_SIZE) != header->crc) {
+    return false;
+  }
+
+  const uint32_t dataStart = HEADER_SIZE + header->count * ENTRY_SIZE;
+  for (int i = 0; i < header->count; i++) {
+    trajectoryStoreEntry_t entry;
+    memcpy(&entry, store->base + HEADER_SIZE + i * ENTRY_SIZE, ENTRY_SIZE);
+
+    if (entry.offset < dataStart
+        || (entry.offset % sizeof(uint32_t)) != 0
+        || !isInImage(entry.offset, entry.size, header->size)
+        || crcOf(store->base + entry.offset, entry.size) != entry.crc) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void trajectoryStoreInit(trajectoryStore_t* store, const uint8_t* base, uint32_t capacity,
+                         const trajectoryStoreFlash_t* flash)
+{
+  memset(store, 0, sizeof(*store));
+  store->base = base;
+  store->capacity = capacity;
+  store->flash = flash;
+
+  memcpy(&store->header, base, HEADER_SIZE);
+  if (store->header.magic == TRAJECTORY_STORE_MAGIC
+      && isHeaderValid(store, &store->header)
+      && isImageValid(store, &store->header)) {
+    store->state = trajectoryStoreValid;
+  } else {
+    store->state = trajectoryStoreEmpty;
+  }
+}
+
+bool trajectoryStoreIsValid(const trajectoryStore_t* store)
+{
+  return store->state == trajectoryStoreValid;
+}
+
+// Programs the bytes of the upload word ending at the current position. The
+// first word holds the magic, programmed when the image is complete.
+static bool programWord(trajectoryStore_t* store)
+{
+  uint32_t offset = (store->position - 1) & ~(uint32_t)3;
+  uint32_t word;
+  memcpy(&word, store->word, sizeof(word));
+  memset(store->word, 0xFF, sizeof(store->word));
+
+  if (offset == 0) {
+    return true;
+  }
+  return store->flash->program(offset, word);
+}
+
+static int finishUpload(trajectoryStore_t* store)
+{
+  if ((store->position % sizeof(uint32_t)) != 0 && !programWord(store)) {
+    return EIO;
+  }
+
+  if (!isImageValid(store, &store->header) || !store->flash->program(0, TRAJECTORY_STORE_MAGIC)) {
+    return EIO;
+  }
+
+  store->state = trajectoryStoreValid;
+  return 0;
+}
+
+static int startUpload(trajectoryStore_t* store, const uint8_t* src, uint32_t len)
+{
+  trajectoryStoreHeader_t header;
+  if (len < HEADER_SIZE) {
+    return EINVAL;
+  }
+  memcpy(&header, src, HEADER_SIZE);
+  if (header.magic != TRAJECTORY_STORE_MAGIC || !isHeaderValid(store, &header)) {
+    return EINVAL;
+  }
+
+  store->state = trajectoryStoreEmpty;
+  if (!store->flash->erase()) {
+    return EIO;
+  }
+
+  store->header = header;
+  store->position = 0;
+  memset(store->word, 0xFF, sizeof(store->word));
+  store->state = trajectoryStoreUploading;
+  return 0;
+}
+
+int trajectoryStoreWrite(trajectoryStore_t* store, uint32_t addr, const uint8_t* src, uint32_t len)
+{
+  if (addr == 0) {
+    int result = startUpload(store, src, len);
+    if (result != 0) {
+      return result;
+    }
+  } else if (store->state != trajectoryStoreUploading || addr != store->position) {
+    return EINVAL;
+  }
+
+  if (!isInImage(addr, len, store->header.size)) {
+    store->state = trajectoryStoreEmpty;
+    return EINVAL;
+  }
+
+  for (uint32_t i = 0; i < len; i++) {
+    store->word[store->position % sizeof(uint32_t)] = src[i];
+    store->position++;
+    if ((store->position % sizeof(uint32_t)) == 0 && !programWord(store)) {
+      store->state = trajectoryStoreEmpty;
+      return EIO;
+    }
+  }
+
+  if (store->position == store->header.size) {
+    int result = finishUpload(store);
+    if (result != 0) {
+      store->state = trajectoryStoreEmpty;
+    }
+    return result;
+  }
+
+  return 0;
+}
+
+bool trajectoryStoreRead(const trajectoryStore_t* store, uint32_t addr, uint32_t len, uint8_t* dest)
+{
+  if (!isInImage(addr, len, store->capacity)) {
+    return false;
+  }
+
+  memcpy(dest, store->base + addr, len);
+  return true;
+}
+
+int trajectoryStoreCount(const trajectoryStore_t* store)
+{
+  return trajectoryStoreIsValid(store) ? store->header.count : 0;
+}
+
+bool trajectoryStoreGetEntry(const trajectoryStore_t* store, int i, trajectoryStoreEntry_t* entry)
+{
+  if (i < 0 || i >= trajectoryStoreCount(store)) {
+    return false;
+  }
+
+  memcpy(entry, store->base + HEADER_SIZE + i * ENTRY_SIZE, ENTRY_SIZE);
+  return true;
+}
+
+const void* trajectoryStoreGetData(const trajectoryStore_t* store, uint32_t offset, uint32_t size)
+{
+  if (!trajectoryStoreIsValid(store) || !isInImage(offset, size, store->header.size)) {
+    return NULL;
+  }
+
+  return store->base + offset;
+}
@@ -0,0 +1,162 @@
+/**
+ *    ||          ____  _ __
+ * +------+      / __ )(_) /_______________ _____  ___
+ * | 0xBC |     / __  / / __/ ___/ ___/ __ `/_  / / _ \
+ * +------+    / /_/ / / /_/ /__/ /  / /_/ / / /_/  __/
+ *  ||  ||    /_____/_/\__/\___/_/   \__,_/ /___/\___/
+ *
+ * Crazyflie control firmware
+ *
+ * Copyright (C) 2018 Bitcraze AB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, in version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * udFactor.c - UD factorized covariance for Kalman filters
+ *
+ * References:
+ * G. J. Bierman, Factorization Methods for Discrete Sequential Estimation, 1977
+ * C. L. Thornton, Triangular Covariance Factorizations for Kalman Filtering, 1976
+ */
+
+#include <stddef.h>
+
+#include "udFactor.h"
+
+// Work buffers for udPredict(), W = [A*U A] and its weights [D q]
+static float W[UD_MAX_DIM][2 * UD_MAX_DIM];
+static float Dw[2 * UD_MAX_DIM];
+
+bool udFactorize(const float* P, float* U, float* D, int n) {
+  for (int j = n - 1; j >= 0; j--) {
+    float d = P[j * n + j];
+    for (int k = j + 1; k < n; k++) {
+      d -= D[k] * U[j * n + k] * U[j * n + k];
+    }
+    if (!(d > 0.0f)) {
+      return false;
+    }
+    D[j] = d;
+
+    U[j * n + j] = 1.0f;
+    for (int i = 0; i < j; i++) {
+      float p = P[i * n + j];
+      for (int k = j + 1; k < n; k++) {
+        p -= D[k] * U[i * n + k] * U[j * n + k];
+      }
+      U[i * n + j] = p / d;
+      U[j * n + i] = 0.0f;
+    }
+  }
+
+  return true;
+}
+
+void udToCovariance(const float* U, const float* D, float* P, int n) {
+  for (int i = 0; i < n; i++) {
+    for (int j = i; j < n; j++) {
+      // U is upper triangular, only k >= j contributes
+      float p = 0.0f;
+      for (int k = j; k < n; k++) {
+        p += U[i * n + k] * D[k] * U[j * n + k];
+      }
+      P[i * n + j] = p;
+      P[j * n + i] = p;
+    }
+  }
+}
+
+float udScalarUpdate(float* U, float* D, int n, const float* h, float r, float* K) {
+  // f = U'h, v = Df, the gain is accumulated unnormalized in K
+  float alpha = r;
+  for (int j = 0; j < n; j++) {
+    float f = h[j];
+    for (int i = 0; i < j; i++) {
+      f += U[i * n + j] * h[i];
+    }
+    const float v = D[j] * f;
+
+    const float alphaPrev = alpha;
+    alpha += f * v;
+    D[j] *= alphaPrev / alpha;
+
+    const float lambda = -f / alphaPrev;
+    for (int i = 0; i < j; i++) {
+      const float u = U[i * n + j];
+      U[i * n + j] = u + K[i] * lambda;
+      K[i] += u * v;
+    }
+    K[j] = v;
+  }
+
+  for (int i = 0; i < n; i++) {
+    K[i] /= alpha;
+  }
+
+  return alpha;
+}
+
+void udPredict(float* U, float* D, int n, const float* A, const float* q) {
+  const int m = (q != NULL) ? 2 * n : n;
+
+  // W*diag(Dw)*W' = A*(U*D*U' + diag(q))*A' for W = [A*U A], U is unit upper triangular.
+  // The noise goes through A as well, it is the noise added since the previous prediction.
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      float w;
+      if (A != NULL) {
+        w = A[i * n + j];
+        for (int k = 0; k < j; k++) {
+          w += A[i * n + k] * U[k * n + j];
+        }
+      } else {
+        w = (j >= i) ? U[i * n + j] : 0.0f;
+      }
+      W[i][j] = w;
+
+      if (q != NULL) {
+        W[i][n + j] = (A != NULL) ? A[i * n + j] : (float)(i == j);
+      }
+    }
+  }
+  for (int k = 0; k < n; k++) {
+    Dw[k] = D[k];
+    if (q != NULL) {
+      Dw[n + k] = q[k];
+    }
+  }
+
+  // Orthogonalize the rows of W, last to first, in the Dw weighted inner product
+  for (int j = n - 1; j >= 0; j--) {
+    float d = 0.0f;
+    for (int k = 0; k < m; k++) {
+      d += Dw[k] * W[j][k] * W[j][k];
+    }
+    D[j] = d;
+
+    U[j * n + j] = 1.0f;
+    for (int i = 0; i < j; i++) {
+      float u = 0.0f;
+      if (d > 0.0f) {
+        for (int k = 0; k < m; k++) {
+          u += Dw[k] * W[i][k] * W[j][k];
+        }
+        u /= d;
+        for (int k = 0; k < m; k++) {
+          W[i][k] -= u * W[j][k];
+        }
+      }
+      U[i * n + j] = u;
+      U[j * n + i] = 0.0f;
+    }
+  }
+}
@@ -0,0 +1,47 @@
+// Benchmarks of crc.c, the table driven version is only built with CRC_FAST
+// (rake bench DEFINES="-DCRC_FAST")
+#include "bench.h"
+#include "crc.h"
+
+// A radio packet and a memory read block
+static uint8_t packet[32];
+static uint8_t block[1024];
+
+static void benchCrcSlowPacket() {
+  benchSink = crcSlow(packet, sizeof(packet));
+}
+
+static void benchCrcSlowBlock() {
+  benchSink = crcSlow(block, sizeof(block));
+}
+
+#ifdef CRC_FAST
+static void benchCrcFastPacket() {
+  benchSink = crcFast(packet, sizeof(packet));
+}
+
+static void benchCrcFastBlock() {
+  benchSink = crcFast(block, sizeof(block));
+}
+#endif
+
+int main() {
+  for (uint32_t i = 0; i < sizeof(block); i++) {
+    block[i] = (uint8_t)(i * 7 + 3);
+  }
+  for (uint32_t i = 0; i < sizeof(packet); i++) {
+    packet[i] = block[i];
+  }
+
+  benchRun("crc.slow32", benchCrcSlowPacket, 10000);
+  benchRun("crc.slow1024", benchCrcSlowBlock, 500);
+
+#ifdef CRC_FAST
+  crcInit();
+
+  benchRun("crc.fast32", benchCrcFastPacket, 100000);
+  benchRun("crc.fast1024", benchCrcFastBlock, 1000);
+#endif
+
+  return 0;
+}
@@ -0,0 +1,52 @@
+// Benchmarks of eprintf.c
+#include "bench.h"
+#include "eprintf.h"
+
+static char buffer[128];
+static uint32_t position;
+static int counter;
+
+static int putcBuffer(int c) {
+  buffer[position++ % sizeof(buffer)] = (char)c;
+  return c;
+}
+
+static void benchEprintfDebugLine() {
+  position = 0;
+  counter++;
+  benchSink = eprintf(putcBuffer, "[%s]: task %d at %d, 0x%x\n", "SYS", counter, counter * 13, (unsigned)counter);
+}
+
+static void benchEprintfFloat() {
+  position = 0;
+  counter++;
+  benchSink = eprintf(putcBuffer, "vbat %f\n", (double)counter * 0.001);
+}
+
+static void benchEprintfIntegers() {
+  position = 0;
+  counter++;
+  benchSink = eprintf(putcBuffer, "%d %u %ld %lld\n", -counter * 7919, (unsigned)counter * 104729u,
+                      (long)counter * 15485863L, (long long)counter * 2147483647LL);
+}
+
+static void benchEprintfFloatPrecision() {
+  position = 0;
+  counter++;
+  benchSink = eprintf(putcBuffer, "%.3f %.3f %.3f\n", (double)counter * 0.017, -(double)counter * 1.3, 9.80665);
+}
+
+static void benchEsnprintfDebugLine() {
+  counter++;
+  benchSink = esnprintf(buffer, sizeof(buffer), "[%s]: task %d at %d, 0x%x\n", "SYS", counter, counter * 13, (unsigned)counter);
+}
+
+int main() {
+  benchRun("eprintf.debugLine", benchEprintfDebugLine, 10000);
+  benchRun("eprintf.float", benchEprintfFloat, 10000);
+  benchRun("eprintf.integers", benchEprintfIntegers, 10000);
+  benchRun("eprintf.floatPrecision", benchEprintfFloatPrecision, 10000);
+  benchRun("esnprintf.debugLine", benchEsnprintfDebugLine, 10000);
+
+  return 0;
+}
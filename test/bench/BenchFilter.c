@@ -0,0 +1,53 @@
+// Benchmarks of filter.c and dynNotch.c
+#include "bench.h"
+#include "filter.h"
+#include "dynNotch.h"
+
+#define SAMPLE_COUNT 1024
+
+static float samples[SAMPLE_COUNT];
+static uint32_t index;
+
+static lpf2pData lpf;
+static notchData notch;
+static dynNotch_t dynNotch;
+
+static float nextSample() {
+  index = (index + 1) % SAMPLE_COUNT;
+  return samples[index];
+}
+
+static void benchLpf2pApply() {
+  float out = lpf2pApply(&lpf, nextSample());
+  benchSink = (uint32_t)out;
+}
+
+static void benchNotchApply() {
+  float out = notchApply(&notch, nextSample());
+  benchSink = (uint32_t)out;
+}
+
+static void benchDynNotchApply() {
+  float xyz[3] = {nextSample(), nextSample(), nextSample()};
+  dynNotchApply(&dynNotch, xyz);
+  benchSink = (uint32_t)xyz[0];
+}
+
+int main() {
+  // Gyro like signal, a slow motion and a motor vibration
+  uint32_t seed = 1;
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    seed = seed * 1664525 + 1013904223;
+    samples[i] = 100.0f * (float)(i % 200) / 200.0f + 20.0f * ((i % 4) - 1.5f) + (float)(seed >> 24) / 64.0f;
+  }
+
+  lpf2pInit(&lpf, 1000.0f, 80.0f);
+  notchInit(&notch, 1000.0f, 250.0f, 3.0f);
+  dynNotchInit(&dynNotch, 1000.0f, 80.0f, 450.0f, 3.0f, 3, 1.0f);
+
+  benchRun("filter.lpf2pApply", benchLpf2pApply, 100000);
+  benchRun("filter.notchApply", benchNotchApply, 100000);
+  benchRun("dynNotch.apply", benchDynNotchApply, 10000);
+
+  return 0;
+}
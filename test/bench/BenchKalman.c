@@ -0,0 +1,195 @@
+// Benchmarks of estimator_kalman.c, one prediction and one scalar measurement
+// update, each with the finalization of the state that follows it.
+// Build with DEFINES="-DKALMAN_USE_UD" for the UD factorized covariance.
+// File under test estimator_kalman.c
+// File under test udFactor.c
+// File under test arm_mat_mult_f32.c
+// File under test arm_mat_trans_f32.c
+// File under test arm_sin_f32.c
+// File under test arm_cos_f32.c
+// File under test arm_common_tables.c
+#define _GNU_SOURCE
+#include "bench.h"
+#include "estimator_kalman.h"
+#include "innovationMonitor.h"
+#include "adaptiveNoise.h"
+#include "sensors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#define BENCH_MAX_QUEUES 10
+#define BENCH_SCS_BASE 0xE000E000UL
+#define BENCH_SCS_SIZE 0x1000
+
+// Hovering, as the estimator sees it at the prediction rate
+#define HOVER_THRUST 36000.0f
+#define HEIGHT 1.0f
+#define PREDICT_TICKS 10
+
+static TickType_t tickCount;
+static bool isImuPending;
+static uint32_t seed = 1;
+
+static sensorData_t sensorData;
+static state_t state;
+static control_t control = {.thrust = HOVER_THRUST};
+
+static void benchKalmanPredict() {
+  tickCount += PREDICT_TICKS;
+  isImuPending = true;
+  estimatorKalman(&state, &sensorData, &control, tickCount);
+  benchSink = (uint32_t)state.position.z;
+}
+
+static void benchKalmanUpdate() {
+  heightMeasurement_t height = {.height = HEIGHT, .stdDev = 0.01f};
+  estimatorKalmanEnqueueAsoluteHeight(&height);
+  estimatorKalman(&state, &sensorData, &control, tickCount);
+  benchSink = (uint32_t)state.position.z;
+}
+
+// The estimator reads SCB->ICSR to check for interrupt context when a
+// measurement is enqueued, a zeroed System Control Space reads as thread mode
+static bool mapSystemControlSpace(void) {
+  void* scs = mmap((void*)BENCH_SCS_BASE, BENCH_SCS_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  return scs == (void*)BENCH_SCS_BASE;
+}
+
+int main() {
+  if (!mapSystemControlSpace()) {
+    fprintf(stderr, "Can not map the System Control Space\n");
+    return 1;
+  }
+
+  estimatorKalmanInit();
+
+  // Settle the filter before timing
+  for (int i = 0; i < 100; i++) {
+    benchKalmanPredict();
+    benchKalmanUpdate();
+  }
+
+  // Without measurements the covariance grows every prediction, a run is
+  // 18000 predictions, three minutes of flight
+  benchRun("kalman.predict", benchKalmanPredict, 1000);
+  benchRun("kalman.updateScalar", benchKalmanUpdate, 10000);
+
+  return 0;
+}
+
+// Sensor noise, uniform in [-scale, scale]. The estimator needs a non zero
+// rotation in every prediction, as from the real gyro.
+static float noise(float scale) {
+  seed = seed * 1664525 + 1013904223;
+  return scale * ((float)(seed >> 8) / (float)(1 << 23) - 1.0f);
+}
+
+// Stubs for the sensors, a level and still Crazyflie
+
+bool sensorsReadAcc(Axis3f* acc, uint64_t* timestamp) {
+  if (!isImuPending) {
+    return false;
+  }
+  *acc = (Axis3f){.x = noise(0.01f), .y = noise(0.01f), .z = 1.0f + noise(0.01f)};
+  *timestamp = (uint64_t)tickCount * 1000;
+  return true;
+}
+
+bool sensorsReadGyro(Axis3f* gyro, uint64_t* timestamp) {
+  if (!isImuPending) {
+    return false;
+  }
+  *gyro = (Axis3f){.x = noise(0.5f), .y = noise(0.5f), .z = noise(0.5f)};
+  *timestamp = (uint64_t)tickCount * 1000;
+  isImuPending = false;
+  return true;
+}
+
+bool sensorsReadMag(Axis3f* mag, uint64_t* timestamp) {
+  return false;
+}
+
+bool sensorsReadBaro(baro_t* baro, uint64_t* timestamp) {
+  return false;
+}
+
+// Stubs for the FreeRTOS functions used by the estimator
+
+typedef struct {
+  uint8_t* items;
+  UBaseType_t itemSize;
+  UBaseType_t length;
+  UBaseType_t count;
+  UBaseType_t head;
+} benchQueue_t;
+
+static benchQueue_t queues[BENCH_MAX_QUEUES];
+static int queueCount;
+
+void assertFail(char* exp, char* file, int line) {
+  fprintf(stderr, "Assert failed %s:%d (%s)\n", file, line, exp);
+  abort();
+}
+
+uint64_t usecTimestamp(void) {
+  return (uint64_t)tickCount * 1000;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return tickCount;
+}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType) {
+  if (queueCount == BENCH_MAX_QUEUES) {
+    return NULL;
+  }
+
+  benchQueue_t* queue = &queues[queueCount++];
+  queue->itemSize = uxItemSize;
+  queue->length = uxQueueLength;
+  queue->items = malloc(uxQueueLength * uxItemSize);
+  return (QueueHandle_t)queue;
+}
+
+BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue) {
+  ((benchQueue_t*)xQueue)->count = 0;
+  return pdPASS;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition) {
+  benchQueue_t* queue = (benchQueue_t*)xQueue;
+  if (queue->count == queue->length) {
+    return errQUEUE_FULL;
+  }
+
+  const int index = (queue->head + queue->count) % queue->length;
+  memcpy(&queue->items[index * queue->itemSize], pvItemToQueue, queue->itemSize);
+  queue->count++;
+  return pdTRUE;
+}
+
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t xQueue, const void* const pvItemToQueue, BaseType_t* const pxHigherPriorityTaskWoken, const BaseType_t xCopyPosition) {
+  return xQueueGenericSend(xQueue, pvItemToQueue, 0, xCopyPosition);
+}
+
+BaseType_t xQueueGenericReceive(QueueHandle_t xQueue, void* const pvBuffer, TickType_t xTicksToWait, const BaseType_t xJustPeek) {
+  benchQueue_t* queue = (benchQueue_t*)xQueue;
+  if (queue->count == 0) {
+    return pdFALSE;
+  }
+
+  memcpy(pvBuffer, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+  if (!xJustPeek) {
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+  }
+  return pdTRUE;
+}
@@ -0,0 +1,172 @@
+// Benchmarks of log.c, the packing of a log block into a packet
+// File under test log.c
+#include "bench.h"
+#include "log.h"
+#include "crtp.h"
+#include "crc.h"
+#include "num.h"
+#include "eprintf.h"
+
+#include <setjmp.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "timers.h"
+
+#define BLOCK_ID 1
+
+static float benchFloat[3] = {0.12f, -3.4f, 9.81f};
+static int16_t benchInt16 = -1234;
+static uint8_t benchUint8 = 42;
+static uint32_t benchUint32 = 123456;
+
+// The table is placed in the .log section by hand, see test/fuzz/sections.ld
+static const struct log_s benchLogs[] __attribute__((section(".log"), used)) = {
+  LOG_ADD_GROUP(LOG_GROUP | LOG_START, bench, 0x0)
+  LOG_ADD(LOG_FLOAT, f0, &benchFloat[0])
+  LOG_ADD(LOG_FLOAT, f1, &benchFloat[1])
+  LOG_ADD(LOG_FLOAT, f2, &benchFloat[2])
+  LOG_ADD(LOG_INT16, i16, &benchInt16)
+  LOG_ADD(LOG_UINT8, u8, &benchUint8)
+  LOG_ADD(LOG_UINT32, u32, &benchUint32)
+  LOG_ADD_GROUP(LOG_GROUP | LOG_STOP, stop_bench, 0x0)
+};
+
+// The log task, run up to its next receive for every control packet
+static TaskFunction_t logTaskFunction;
+static const CRTPPacket* pendingPacket;
+static jmp_buf taskBlocked;
+
+// The block started with a period of 0, as handed to the worker
+static void* block;
+
+static char queueDummy;
+static char timerDummy;
+
+static void sendControl(const uint8_t* data, uint8_t size) {
+  CRTPPacket packet;
+  memset(&packet, 0, sizeof(packet));
+  packet.port = CRTP_PORT_LOG;
+  packet.channel = 1;
+  packet.size = size;
+  memcpy(packet.data, data, size);
+
+  pendingPacket = &packet;
+  if (setjmp(taskBlocked) == 0) {
+    logTaskFunction(NULL);
+  }
+}
+
+static void benchLogRunBlock() {
+  logRunBlock(block);
+}
+
+int main() {
+  logInit();
+
+  // A typical block, full: three floats, the same floats as FP16 and three integers
+  const uint8_t createBlock[] = {0, BLOCK_ID, LOG_FLOAT, 0, LOG_FLOAT, 1, LOG_FLOAT, 2, LOG_FP16, 0, LOG_FP16, 1,
+                                 LOG_FP16, 2, LOG_INT16, 3, LOG_UINT8, 4, LOG_UINT32, 5};
+  const uint8_t startBlock[] = {3, BLOCK_ID, 0};
+  sendControl(createBlock, sizeof(createBlock));
+  sendControl(startBlock, sizeof(startBlock));
+
+  if (block == NULL) {
+    return 1;
+  }
+
+  benchRun("log.runBlock", benchLogRunBlock, 100000);
+
+  return 0;
+}
+
+// Stubs for the CRTP and FreeRTOS functions used by log.c
+
+void crtpInitTaskQueue(CRTPPort portId) {
+}
+
+int crtpReceivePacketBlock(CRTPPort taskId, CRTPPacket* p) {
+  if (pendingPacket == NULL) {
+    longjmp(taskBlocked, 1);
+  }
+
+  *p = *pendingPacket;
+  pendingPacket = NULL;
+  return pdTRUE;
+}
+
+int crtpSendPacket(CRTPPacket* p) {
+  benchSink += p->size;
+  return pdTRUE;
+}
+
+bool crtpIsConnected(void) {
+  return true;
+}
+
+int crtpGetFreeTxQueuePackets(void) {
+  return 60;
+}
+
+float crtpGetTelemetryRate(void) {
+  return 1.0f;
+}
+
+int crtpReset(void) {
+  return 0;
+}
+
+void assertFail(char* exp, char* file, int line) {
+}
+
+int consolePutchar(int ch) {
+  return ch;
+}
+
+int consolePrintf(const char* fmt, ...) {
+  return 0;
+}
+
+int workerSchedule(void (*function)(void*), void* arg) {
+  block = arg;
+  return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return 1234;
+}
+
+BaseType_t xTaskGenericCreate(TaskFunction_t pxTaskCode, const char* const pcName, const uint16_t usStackDepth,
+                              void* const pvParameters, UBaseType_t uxPriority, TaskHandle_t* const pxCreatedTask,
+                              StackType_t* const puxStackBuffer, const MemoryRegion_t* const xRegions) {
+  logTaskFunction = pxTaskCode;
+  return pdPASS;
+}
+
+QueueHandle_t xQueueCreateMutex(const uint8_t ucQueueType) {
+  return (QueueHandle_t)&queueDummy;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition) {
+  return pdTRUE;
+}
+
+BaseType_t xQueueGenericReceive(QueueHandle_t xQueue, void* const pvBuffer, TickType_t xTicksToWait, const BaseType_t xJustPeek) {
+  return pdTRUE;
+}
+
+TimerHandle_t xTimerCreate(const char* const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload,
+                           void* const pvTimerID, TimerCallbackFunction_t pxCallbackFunction) {
+  return (TimerHandle_t)&timerDummy;
+}
+
+BaseType_t xTimerGenericCommand(TimerHandle_t xTimer, const BaseType_t xCommandID, const TickType_t xOptionalValue,
+                                BaseType_t* const pxHigherPriorityTaskWoken, const TickType_t xTicksToWait) {
+  return pdPASS;
+}
+
+void* pvTimerGetTimerID(const TimerHandle_t xTimer) {
+  return NULL;
+}
@@ -0,0 +1,32 @@
+// Benchmarks of num.c
+#include "bench.h"
+#include "num.h"
+
+#define SAMPLE_COUNT 1024
+
+static float singles[SAMPLE_COUNT];
+static uint16_t halves[SAMPLE_COUNT];
+static uint32_t index;
+
+static void benchSingle2half() {
+  index = (index + 1) % SAMPLE_COUNT;
+  benchSink = single2half(singles[index]);
+}
+
+static void benchHalf2single() {
+  index = (index + 1) % SAMPLE_COUNT;
+  benchSink = (uint32_t)half2single(halves[index]);
+}
+
+int main() {
+  // Log variable like values, a few outside the half range
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    singles[i] = ((i % 3) - 1) * (float)(i * i) / 7.0f + 1.0f / (i + 1);
+    halves[i] = (uint16_t)(i * 61);
+  }
+
+  benchRun("num.single2half", benchSingle2half, 100000);
+  benchRun("num.half2single", benchHalf2single, 100000);
+
+  return 0;
+}
@@ -0,0 +1,49 @@
+// Benchmarks of pid.c, as run by the attitude rate controller
+// File under test pid.c
+#include "bench.h"
+#include "pid.h"
+#include "filter.h"
+#include "num.h"
+
+#define SAMPLE_COUNT 1024
+#define RATE 500.0f
+
+static float samples[SAMPLE_COUNT];
+static uint32_t index;
+
+static PidObject pid;
+static PidObject pidFiltered;
+
+static float nextSample() {
+  index = (index + 1) % SAMPLE_COUNT;
+  return samples[index];
+}
+
+static void benchPidUpdate() {
+  float out = pidUpdate(&pid, nextSample(), true);
+  benchSink = (uint32_t)out;
+}
+
+static void benchPidUpdateDFilter() {
+  float out = pidUpdate(&pidFiltered, nextSample(), true);
+  benchSink = (uint32_t)out;
+}
+
+int main() {
+  // Roll rate like signal around the desired rate, deg/s
+  uint32_t seed = 1;
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    seed = seed * 1664525 + 1013904223;
+    samples[i] = 50.0f * (float)(i % 100) / 100.0f + (float)(seed >> 24) / 32.0f - 4.0f;
+  }
+
+  pidInit(&pid, 20.0f, PID_ROLL_RATE_KP, PID_ROLL_RATE_KI, PID_ROLL_RATE_KD, 1.0f / RATE, RATE, 30.0f, false);
+  pidSetIntegralLimit(&pid, PID_ROLL_RATE_INTEGRATION_LIMIT);
+  pidInit(&pidFiltered, 20.0f, PID_ROLL_RATE_KP, PID_ROLL_RATE_KI, PID_ROLL_RATE_KD, 1.0f / RATE, RATE, 30.0f, true);
+  pidSetIntegralLimit(&pidFiltered, PID_ROLL_RATE_INTEGRATION_LIMIT);
+
+  benchRun("pid.update", benchPidUpdate, 100000);
+  benchRun("pid.updateDFilter", benchPidUpdateDFilter, 100000);
+
+  return 0;
+}
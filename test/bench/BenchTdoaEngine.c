@@ -0,0 +1,77 @@
+// Benchmarks of tdoaEngine.c, the TDoA3 packet path of the tag
+#include "bench.h"
+#include "tdoaEngine.h"
+#include "tdoaStorage.h"
+#include "tdoaStats.h"
+#include "outlierFilter.h"
+#include "clockCorrectionEngine.h"
+
+#include <math.h>
+
+#define ANCHOR_COUNT 8
+#define LOCODECK_TS_FREQ (499.2e6 * 128)
+#define SLOT_TICKS ((int64_t)(LOCODECK_TS_FREQ / 1000)) // One packet per ms
+#define TIMESTAMP_MASK 0x00FFFFFFFFFFll
+#define SPEED_OF_LIGHT_TICKS (299792458.0 / LOCODECK_TS_FREQ)
+
+static tdoaEngineState_t engine;
+
+static const float anchors[ANCHOR_COUNT][3] = {
+  {0, 0, 0}, {4, 0, 0}, {4, 4, 0}, {0, 4, 0},
+  {0, 0, 3}, {4, 0, 3}, {4, 4, 3}, {0, 4, 3},
+};
+static const float tag[3] = {1.7f, 2.2f, 1.1f};
+
+static int64_t lastTx[ANCHOR_COUNT];
+static uint8_t lastSeqNr[ANCHOR_COUNT];
+static int64_t now;
+static uint32_t packetCount;
+
+static int64_t flightTicks(const float* from, const float* to) {
+  float dx = to[0] - from[0];
+  float dy = to[1] - from[1];
+  float dz = to[2] - from[2];
+  return (int64_t)(sqrtf(dx * dx + dy * dy + dz * dz) / SPEED_OF_LIGHT_TICKS);
+}
+
+static void sendTdoaToEstimator(tdoaMeasurement_t* tdoa) {
+  benchSink += (uint32_t)tdoa->distanceDiff;
+}
+
+// One packet from the next anchor, as decoded by the TDoA3 tag
+static void benchProcessPacket() {
+  const uint8_t id = packetCount % ANCHOR_COUNT;
+  const uint8_t seqNr = (uint8_t)((packetCount / ANCHOR_COUNT) & 0x7f);
+  packetCount++;
+
+  now += SLOT_TICKS;
+  const int64_t tx = now;
+  const int64_t rx = now + flightTicks(anchors[id], tag);
+  const uint32_t now_ms = (uint32_t)(now / SLOT_TICKS);
+
+  tdoaAnchorContext_t anchorCtx;
+  tdoaEngineGetAnchorCtxForPacketProcessing(&engine, id, now_ms, &anchorCtx);
+
+  for (uint8_t remote = 0; remote < ANCHOR_COUNT; remote++) {
+    if (remote != id && lastTx[remote] != 0) {
+      const int64_t tof = flightTicks(anchors[remote], anchors[id]);
+      tdoaStorageSetRemoteRxTime(&anchorCtx, remote, (lastTx[remote] + tof) & TIMESTAMP_MASK, lastSeqNr[remote]);
+      tdoaStorageSetTimeOfFlight(&anchorCtx, remote, tof);
+    }
+  }
+  tdoaStorageSetAnchorPosition(&anchorCtx, anchors[id][0], anchors[id][1], anchors[id][2]);
+
+  tdoaEngineProcessPacket(&engine, &anchorCtx, tx & TIMESTAMP_MASK, rx & TIMESTAMP_MASK);
+  tdoaStorageSetRxTxData(&anchorCtx, rx & TIMESTAMP_MASK, tx & TIMESTAMP_MASK, seqNr);
+
+  lastTx[id] = tx;
+  lastSeqNr[id] = seqNr;
+}
+
+int main() {
+  tdoaEngineInit(&engine, 0, sendTdoaToEstimator, LOCODECK_TS_FREQ);
+
+  benchRun("tdoaEngine.processPacket", benchProcessPacket, 10000);
+
+  return 0;
+}
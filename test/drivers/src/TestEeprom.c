@@ -0,0 +1,160 @@
+// File under test eeprom.c
+#include "eeprom.h"
+
+#include <string.h>
+#include "unity.h"
+#include "eepromSim.h"
+
+// The debug output of the driver is formatted with eprintf
+#include "eprintf.h"
+
+static uint8_t data[EEPROM_SIM_SIZE];
+
+void setUp(void) {
+  eepromSimReset();
+  eepromInit(0);
+
+  for (int i = 0; i < EEPROM_SIM_SIZE; i++) {
+    data[i] = (uint8_t)(i * 7 + 3);
+  }
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatWriteBufferWritesTheData() {
+  // Fixture
+  uint8_t actual[50];
+
+  // Test
+  bool result = eepromWriteBuffer(data, 20, 50);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_TRUE(eepromReadBuffer(actual, 20, 50));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, actual, 50);
+  TEST_ASSERT_EQUAL_UINT8(0xff, eepromSimMemory()[19]);
+  TEST_ASSERT_EQUAL_UINT8(0xff, eepromSimMemory()[70]);
+}
+
+void testThatWriteBufferUsesOneWriteCyclePerPage() {
+  // Fixture
+  // Bytes 20 - 69 are in the pages starting at 0, 32 and 64
+
+  // Test
+  eepromWriteBuffer(data, 20, 50);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(3, eepromSimWriteCycleCount());
+}
+
+void testThatWriteBufferWaitsForTheWriteCycleByPolling() {
+  // Fixture
+  uint8_t actual;
+
+  // Test
+  eepromWriteBuffer(data, 0, 64);
+
+  // Assert
+  // The device was polled while busy, and is ready when the write returns
+  TEST_ASSERT_TRUE(eepromSimNackCount() > 0);
+  TEST_ASSERT_TRUE(eepromReadBuffer(&actual, 0, 1));
+}
+
+void testThatWritingAConfigBlockSizedBufferIsFast() {
+  // Fixture
+  // Single byte writes with a 6 ms delay took 384 ms for 64 bytes
+
+  // Test
+  eepromWriteBuffer(data, 0, 64);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(2, eepromSimWriteCycleCount());
+  TEST_ASSERT_TRUE(eepromSimTicks() <= 2 * (EEPROM_SIM_WRITE_CYCLE_TICKS + 1));
+}
+
+void testThatWriteOutsideOfTheMemoryIsRejected() {
+  // Fixture
+  // Test
+  bool result = eepromWriteBuffer(data, EEPROM_SIZE - 4, 8);
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+  TEST_ASSERT_EQUAL_UINT32(0, eepromSimWriteCycleCount());
+}
+
+void testThatWritePageWritesOnePage() {
+  // Fixture
+  // Test
+  bool result = eepromWritePage(data, 2 * EEPROM_PAGE_SIZE);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(1, eepromSimWriteCycleCount());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &eepromSimMemory()[2 * EEPROM_PAGE_SIZE], EEPROM_PAGE_SIZE);
+}
+
+void testThatWritePageRejectsUnalignedAddress() {
+  // Fixture
+  // Test
+  bool result = eepromWritePage(data, 5);
+
+  // Assert
+  TEST_ASSERT_FALSE(result);
+  TEST_ASSERT_EQUAL_UINT32(0, eepromSimWriteCycleCount());
+}
+
+void testThatUpdateBufferDoesNotWriteUnchangedData() {
+  // Fixture
+  eepromWriteBuffer(data, 0, 100);
+  uint32_t writeCyclesBefore = eepromSimWriteCycleCount();
+
+  // Test
+  bool result = eepromUpdateBuffer(data, data, 0, 100);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(writeCyclesBefore, eepromSimWriteCycleCount());
+}
+
+void testThatUpdateBufferCombinesChangesInOnePage() {
+  // Fixture
+  uint8_t current[100];
+  eepromWriteBuffer(data, 0, 100);
+  memcpy(current, data, sizeof(current));
+  uint32_t writeCyclesBefore = eepromSimWriteCycleCount();
+
+  data[40] ^= 0xff;
+  data[45] ^= 0xff;
+  data[50] ^= 0xff;
+
+  // Test
+  bool result = eepromUpdateBuffer(data, current, 0, 100);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(writeCyclesBefore + 1, eepromSimWriteCycleCount());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, eepromSimMemory(), 100);
+}
+
+void testThatUpdateBufferOnlyWritesChangedPages() {
+  // Fixture
+  uint8_t current[200];
+  eepromWriteBuffer(data, 10, 200);
+  memcpy(current, data, sizeof(current));
+  uint32_t writeCyclesBefore = eepromSimWriteCycleCount();
+
+  // Change the last byte of one page and the first byte of the next, and one byte far away
+  data[21] ^= 0xff;
+  data[22] ^= 0xff;
+  data[150] ^= 0xff;
+
+  // Test
+  bool result = eepromUpdateBuffer(data, current, 10, 200);
+
+  // Assert
+  TEST_ASSERT_TRUE(result);
+  TEST_ASSERT_EQUAL_UINT32(writeCyclesBefore + 3, eepromSimWriteCycleCount());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &eepromSimMemory()[10], 200);
+}
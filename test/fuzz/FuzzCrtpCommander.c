@@ -0,0 +1,53 @@
+// Fuzz target for the setpoint ports, crtp_commander.c with the rpyt and generic decoders
+// File under test crtp_commander.c
+// File under test crtp_commander_rpyt.c
+// File under test crtp_commander_generic.c
+#include "fuzz.h"
+#include "crtp_commander.h"
+#include "commander.h"
+
+#include <string.h>
+
+static uint32_t setpointCount;
+
+void fuzzSetup(void) {
+  crtpCommanderInit();
+}
+
+void fuzzAddSeeds(void) {
+  const uint8_t stop[] = {0};
+  const uint8_t velocity[1 + 4 * 4] = {1};
+  const uint8_t zDistance[1 + 4 * 4] = {2};
+  const uint8_t cppm[1 + 9 + 2 * 2] = {3, 2, 0xdc, 0x05, 0xdc, 0x05, 0xdc, 0x05, 0xe8, 0x03, 0xd0, 0x07, 0xe8, 0x03};
+  const uint8_t altHold[1 + 4 * 4] = {4};
+  const uint8_t hover[1 + 4 * 4] = {5};
+  const uint8_t fullState[1 + 9 * 2 + 4 + 3 * 2] = {6};
+  const uint8_t position[1 + 4 * 4] = {7};
+  const uint8_t rpyt[3 * 4 + 2] = {[12] = 0x10, [13] = 0x27};
+
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, stop, sizeof(stop));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, velocity, sizeof(velocity));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, zDistance, sizeof(zDistance));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, cppm, sizeof(cppm));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, altHold, sizeof(altHold));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, hover, sizeof(hover));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, fullState, sizeof(fullState));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_GENERIC, 0, position, sizeof(position));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT, 0, rpyt, sizeof(rpyt));
+}
+
+// Stubs for the commander
+void commanderSetSetpoint(setpoint_t *setpoint, int priority) {
+  setpointCount++;
+}
+
+int commanderGetActivePriority(void) {
+  return COMMANDER_PRIORITY_CRTP;
+}
+
+void crtpInit(void) {
+}
@@ -0,0 +1,125 @@
+// Fuzz target for the high level commander port, including the evaluation of
+// the trajectories that it starts
+// File under test crtp_commander_high_level.c
+// File under test planner.c
+// File under test pptraj.c
+// File under test trajectoryStore.c
+// File under test crc.c
+#include "fuzz.h"
+#include "crtp_commander_high_level.h"
+#include "trajectory_flash.h"
+#include "mission_executor.h"
+#include "pptraj.h"
+#include "crc.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "timers.h"
+
+static setpoint_t setpoint;
+static state_t state;
+
+// A stored image with one trajectory, defined as id 2 at startup
+#define FUZZ_STORED_TRAJECTORY_ID 2
+#define FUZZ_STORED_DATA_OFFSET (sizeof(trajectoryStoreHeader_t) + sizeof(trajectoryStoreEntry_t))
+static uint8_t trajectoryFlash[FUZZ_STORED_DATA_OFFSET + 2 * sizeof(struct poly4d)] __attribute__((aligned(4)));
+static trajectoryStore_t trajectoryStore;
+
+static void storeTrajectory(const struct poly4d* pieces, uint8_t n_pieces);
+
+// Evaluates the current setpoint for every packet, as the stabilizer loop does
+static void setpointTimer(xTimerHandle timer) {
+  crtpCommanderHighLevelGetSetpoint(&setpoint, &state);
+}
+
+void fuzzSetup(void) {
+  struct poly4d stored[2] = {
+    poly4d_linear(1.0f, mkvec(0, 0, 0.5f), mkvec(0, 1.0f, 0.5f), 0, 0),
+    poly4d_linear(1.0f, mkvec(0, 1.0f, 0.5f), mkvec(0, 1.0f, 1.0f), 0, 1.0f),
+  };
+  storeTrajectory(stored, 2);
+
+  crtpCommanderHighLevelInit();
+
+  xTimerHandle timer = xTimerCreate("fuzzSetpoint", M2T(10), pdTRUE, NULL, setpointTimer);
+  xTimerStart(timer, 0);
+
+  // A straight line, as uploaded through the memory port
+  struct poly4d piece = poly4d_linear(2.0f, mkvec(0, 0, 0.5f), mkvec(1.0f, 0, 0.5f), 0, 0);
+  memcpy(trajectories_memory, &piece, sizeof(piece));
+}
+
+void fuzzAddSeeds(void) {
+  const uint8_t setGroupMask[] = {0, 0x01};
+  const uint8_t takeoff[] = {1, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x00, 0x40};
+  const uint8_t land[] = {2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40};
+  const uint8_t stop[] = {3, 0x00};
+  const uint8_t goTo[] = {4, 0x00, 0x01, 0x00, 0x00, 0x80, 0x3f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                          0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t defineTrajectory[] = {6, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
+  const uint8_t startTrajectory[] = {5, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t startReversed[] = {5, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x40};
+  const uint8_t startStored[] = {5, 0x00, 0x01, 0x00, FUZZ_STORED_TRAJECTORY_ID, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t defineFlash[] = {6, 0x03, 0x02, 0x00, 0x20, 0x00, 0x00, 0x00, 0x01};
+  const uint8_t startFlash[] = {5, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t startMission[] = {7, 0x00};
+
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, setGroupMask, sizeof(setGroupMask));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, takeoff, sizeof(takeoff));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, goTo, sizeof(goTo));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, land, sizeof(land));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, takeoff, sizeof(takeoff));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, defineTrajectory, sizeof(defineTrajectory));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, startTrajectory, sizeof(startTrajectory));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, startReversed, sizeof(startReversed));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, stop, sizeof(stop));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, takeoff, sizeof(takeoff));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, startStored, sizeof(startStored));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, defineFlash, sizeof(defineFlash));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, startFlash, sizeof(startFlash));
+  fuzzSeedAddPacket(CRTP_PORT_SETPOINT_HL, 0, startMission, sizeof(startMission));
+}
+
+// The flash is read only here, uploads are covered by FuzzMem.c
+void trajectoryFlashInit(void) {
+  trajectoryStoreInit(&trajectoryStore, trajectoryFlash, sizeof(trajectoryFlash), NULL);
+}
+
+const trajectoryStore_t* trajectoryFlashGetStore(void) {
+  return &trajectoryStore;
+}
+
+// No uSD card, so never a mission to start
+int missionExecutorStart(void) {
+  return ENOENT;
+}
+
+static void storeTrajectory(const struct poly4d* pieces, uint8_t n_pieces) {
+  uint32_t size = n_pieces * sizeof(struct poly4d);
+  memcpy(&trajectoryFlash[FUZZ_STORED_DATA_OFFSET], pieces, size);
+
+  trajectoryStoreEntry_t entry = {
+    .trajectoryId = FUZZ_STORED_TRAJECTORY_ID,
+    .type = 0,
+    .n_pieces = n_pieces,
+    .offset = FUZZ_STORED_DATA_OFFSET,
+    .size = size,
+    .crc = crcSlow(&trajectoryFlash[FUZZ_STORED_DATA_OFFSET], size),
+  };
+  memcpy(&trajectoryFlash[sizeof(trajectoryStoreHeader_t)], &entry, sizeof(entry));
+
+  trajectoryStoreHeader_t header = {
+    .magic = TRAJECTORY_STORE_MAGIC,
+    .version = TRAJECTORY_STORE_VERSION,
+    .count = 1,
+    .size = FUZZ_STORED_DATA_OFFSET + size,
+  };
+  header.crc = crcSlow(&trajectoryFlash[sizeof(header)], header.size - sizeof(header));
+  memcpy(trajectoryFlash, &header, sizeof(header));
+}
@@ -0,0 +1,63 @@
+// Fuzz target for the localization port
+// File under test crtp_localization_service.c
+#include "fuzz.h"
+#include "crtp_localization_service.h"
+#include "stabilizer.h"
+#include "estimator.h"
+#include "estimator_kalman.h"
+
+#include <string.h>
+
+#define RADIO_ADDRESS 0xE7E7E7E7E7ULL
+
+static uint8_t lppShortData[30];
+static uint32_t positionCount;
+
+void fuzzSetup(void) {
+  locSrvInit();
+}
+
+void fuzzAddSeeds(void) {
+  const struct CrtpExtPosition position = {.x = 1.0f, .y = 2.0f, .z = 0.5f};
+  const uint8_t lppShort[] = {LPS_SHORT_LPP_PACKET, 0x03, 0xf0, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t emergencyStop[] = {EMERGENCY_STOP};
+  const uint8_t emergencyStopWatchdog[] = {EMERGENCY_STOP_WATCHDOG};
+  const uint8_t packedPositions[] = {
+    0x01, 0xe8, 0x03, 0xd0, 0x07, 0xf4, 0x01,
+    RADIO_ADDRESS & 0xff, 0xe8, 0x03, 0xd0, 0x07, 0xf4, 0x01,
+  };
+
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_LOCALIZATION, 0, &position, sizeof(position));
+  fuzzSeedAddPacket(CRTP_PORT_LOCALIZATION, 2, packedPositions, sizeof(packedPositions));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_LOCALIZATION, 1, lppShort, sizeof(lppShort));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_LOCALIZATION, 1, emergencyStopWatchdog, sizeof(emergencyStopWatchdog));
+  fuzzSeedAddPacket(CRTP_PORT_LOCALIZATION, 1, emergencyStop, sizeof(emergencyStop));
+}
+
+// Stubs for the modules used by the localization service
+uint64_t configblockGetRadioAddress(void) {
+  return RADIO_ADDRESS;
+}
+
+bool lpsSendLppShort(uint8_t destId, void* data, size_t length) {
+  memcpy(lppShortData, data, length);
+  return true;
+}
+
+void stabilizerSetEmergencyStop() {
+}
+
+void stabilizerSetEmergencyStopTimeout(int timeout) {
+}
+
+StateEstimatorType getStateEstimator(void) {
+  return kalmanEstimator;
+}
+
+bool estimatorKalmanEnqueuePosition(positionMeasurement_t *pos) {
+  positionCount++;
+  return true;
+}
@@ -0,0 +1,63 @@
+// Fuzz target for the log port, the blocks are run by the timers of the harness
+// File under test log.c
+#include "fuzz.h"
+#include "log.h"
+#include "crc.h"
+#include "num.h"
+#include "eprintf.h"
+
+#include <string.h>
+
+static uint8_t fuzzUint8;
+static int16_t fuzzInt16;
+static uint32_t fuzzUint32;
+static float fuzzFloat = 1.5f;
+
+// The table is placed in the .log section by hand, see sections.ld
+static const struct log_s fuzzLogs[] FUZZ_SECTION(".log") = {
+  LOG_ADD_GROUP(LOG_GROUP | LOG_START, fuzz, 0x0)
+  LOG_ADD(LOG_UINT8, u8, &fuzzUint8)
+  LOG_ADD(LOG_INT16, i16, &fuzzInt16)
+  LOG_ADD(LOG_UINT32, u32, &fuzzUint32)
+  LOG_ADD(LOG_FLOAT, f, &fuzzFloat)
+  LOG_ADD_GROUP(LOG_GROUP | LOG_STOP, stop_fuzz, 0x0)
+};
+
+void fuzzSetup(void) {
+  logInit();
+}
+
+void fuzzAddSeeds(void) {
+  const uint8_t getInfo[] = {1};
+  const uint8_t getItem[] = {0, 3};
+  const uint8_t getInfoV2[] = {3};
+  const uint8_t getItemV2[] = {2, 1, 0};
+  const uint8_t reset[] = {5};
+  const uint8_t createBlock[] = {0, 1, LOG_UINT8, 0, LOG_FP16, 3, LOG_INT32, 2};
+  const uint8_t appendBlock[] = {1, 1, LOG_FLOAT, 1};
+  const uint8_t createMemoryBlock[] = {0, 2, (LOG_UINT16 << 4) | LOG_FLOAT, 255, 0x00, 0x00, 0x00, 0x20};
+  const uint8_t createBlockV2[] = {6, 3, LOG_FLOAT, 3, 0, LOG_UINT8, 0, 0};
+  const uint8_t appendBlockV2[] = {7, 3, LOG_INT16, 1, 0};
+  const uint8_t startBlock[] = {3, 1, 10};
+  const uint8_t startBlockOnce[] = {3, 3, 0};
+  const uint8_t stopBlock[] = {4, 1};
+  const uint8_t deleteBlock[] = {2, 1};
+
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 0, getInfo, sizeof(getInfo));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 0, getItem, sizeof(getItem));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 0, getInfoV2, sizeof(getInfoV2));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 0, getItemV2, sizeof(getItemV2));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, reset, sizeof(reset));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, createBlock, sizeof(createBlock));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, appendBlock, sizeof(appendBlock));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, startBlock, sizeof(startBlock));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, stopBlock, sizeof(stopBlock));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, deleteBlock, sizeof(deleteBlock));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, createMemoryBlock, sizeof(createMemoryBlock));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, createBlockV2, sizeof(createBlockV2));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, appendBlockV2, sizeof(appendBlockV2));
+  fuzzSeedAddPacket(CRTP_PORT_LOG, 1, startBlockOnce, sizeof(startBlockOnce));
+}
@@ -0,0 +1,180 @@
+// Fuzz target for the memory port. The memories are stubbed by the harness, with
+// the sizes of the real ones, so that reads and writes outside them are caught.
+// File under test mem_cf2.c
+// File under test mem_window.c
+// File under test trajectoryStore.c
+// File under test crc.c
+#include "fuzz.h"
+#include "mem.h"
+#include "mem_window.h"
+#include "ow.h"
+#include "spectrum.h"
+#include "trajectory_flash.h"
+#include "crtp_commander_high_level.h"
+#include "stabilizer_types.h"
+
+#include <string.h>
+
+// Sizes from eeprom.h and ledring12.h, the headers are not included to keep
+// the drivers out of the build
+#define FUZZ_EEPROM_SIZE 0x1FFF
+#define FUZZ_LEDRING_SIZE (12 * 2)
+#define FUZZ_OW_MEMS 2
+
+uint8_t ledringmem[FUZZ_LEDRING_SIZE];
+uint8_t trajectories_memory[TRAJECTORY_MEMORY_SIZE];
+
+static uint8_t eeprom[FUZZ_EEPROM_SIZE];
+static uint8_t owMems[FUZZ_OW_MEMS][OW_MAX_SIZE];
+static uint8_t spectrum[SPECTRUM_MEM_SIZE];
+static uint8_t trajectoryFlash[TRAJECTORY_FLASH_SIZE] __attribute__((aligned(4)));
+static trajectoryStore_t trajectoryStore;
+
+static bool trajectoryFlashErase(void);
+static bool trajectoryFlashProgram(uint32_t offset, uint32_t word);
+
+static const trajectoryStoreFlash_t trajectoryFlashOps = {
+  .erase = trajectoryFlashErase,
+  .program = trajectoryFlashProgram,
+};
+
+void fuzzSetup(void) {
+  memset(trajectoryFlash, 0xFF, sizeof(trajectoryFlash));
+  trajectoryStoreInit(&trajectoryStore, trajectoryFlash, sizeof(trajectoryFlash), &trajectoryFlashOps);
+  memInit();
+}
+
+void fuzzAddSeeds(void) {
+  const uint8_t getNbr[] = {MEM_CMD_GET_NBR};
+  const uint8_t getInfoEeprom[] = {MEM_CMD_GET_INFO, 0};
+  const uint8_t getInfoOw[] = {MEM_CMD_GET_INFO, 6};
+  const uint8_t readEeprom[] = {0, 0x00, 0x00, 0x00, 0x00, 20};
+  const uint8_t writeEeprom[] = {0, 0x10, 0x00, 0x00, 0x00, 0xbc, 0xcf, 0x01};
+  const uint8_t writeLed[] = {1, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00, 0xff, 0x00};
+  const uint8_t readLocoInfo[] = {2, 0x00, 0x00, 0x00, 0x00, 1};
+  const uint8_t readLocoAnchor[] = {2, 0x00, 0x11, 0x00, 0x00, 13};
+  const uint8_t writeTrajectory[] = {3, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t readTrajectory[] = {3, 0x00, 0x01, 0x00, 0x00, 24};
+  const uint8_t readSpectrum[] = {4, 0x00, 0x00, 0x00, 0x00, 12};
+  const uint8_t readTrajectoryFlash[] = {5, 0x00, 0x00, 0x00, 0x00, 16};
+  // An image without trajectories, only the header
+  const uint8_t writeTrajectoryFlash[] = {5, 0x00, 0x00, 0x00, 0x00, 0x54, 0x52, 0x4a, 0x46, 0x01, 0x00, 0x00, 0x00,
+                                          0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  const uint8_t readOw[] = {6, 0x00, 0x00, 0x00, 0x00, 16};
+  const uint8_t writeOw[] = {7, 0x20, 0x00, 0x00, 0x00, 0x01, 0x02};
+  const uint8_t windowWriteStart[] = {MEM_WINDOW_CMD_WRITE_START, 3, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 2};
+  const uint8_t windowWriteData[] = {MEM_WINDOW_CMD_WRITE_DATA, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t windowWriteData2[] = {MEM_WINDOW_CMD_WRITE_DATA, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40};
+  const uint8_t windowSync[] = {MEM_WINDOW_CMD_SYNC};
+  const uint8_t windowReadStart[] = {MEM_WINDOW_CMD_READ_START, 0, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 2};
+  const uint8_t windowRead[] = {MEM_WINDOW_CMD_READ_WINDOW, 0x19, 0x00, 0x00, 0x00};
+
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_SETTINGS_CH, getNbr, sizeof(getNbr));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_SETTINGS_CH, getInfoEeprom, sizeof(getInfoEeprom));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_SETTINGS_CH, getInfoOw, sizeof(getInfoOw));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WRITE_CH, writeEeprom, sizeof(writeEeprom));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_READ_CH, readEeprom, sizeof(readEeprom));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WRITE_CH, writeLed, sizeof(writeLed));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_READ_CH, readLocoInfo, sizeof(readLocoInfo));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_READ_CH, readLocoAnchor, sizeof(readLocoAnchor));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_READ_CH, readSpectrum, sizeof(readSpectrum));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WRITE_CH, writeTrajectoryFlash, sizeof(writeTrajectoryFlash));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_READ_CH, readTrajectoryFlash, sizeof(readTrajectoryFlash));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WRITE_CH, writeTrajectory, sizeof(writeTrajectory));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_READ_CH, readTrajectory, sizeof(readTrajectory));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_READ_CH, readOw, sizeof(readOw));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WRITE_CH, writeOw, sizeof(writeOw));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WINDOW_CH, windowWriteStart, sizeof(windowWriteStart));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WINDOW_CH, windowWriteData, sizeof(windowWriteData));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WINDOW_CH, windowSync, sizeof(windowSync));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WINDOW_CH, windowWriteData2, sizeof(windowWriteData2));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WINDOW_CH, windowReadStart, sizeof(windowReadStart));
+  fuzzSeedAddPacket(CRTP_PORT_MEM, MEM_WINDOW_CH, windowRead, sizeof(windowRead));
+}
+
+// Stubs for the memories, accesses outside them are caught by the sanitizer
+bool eepromReadBuffer(uint8_t* buffer, uint16_t readAddr, uint16_t len) {
+  memcpy(buffer, &eeprom[readAddr], len);
+  return true;
+}
+
+bool eepromWriteBuffer(uint8_t* buffer, uint16_t writeAddr, uint16_t len) {
+  memcpy(&eeprom[writeAddr], buffer, len);
+  return true;
+}
+
+bool owScan(uint8_t *nMem) {
+  *nMem = FUZZ_OW_MEMS;
+  return true;
+}
+
+bool owGetinfo(uint8_t selectMem, OwSerialNum *serialNum) {
+  if (selectMem >= FUZZ_OW_MEMS) {
+    return false;
+  }
+
+  memset(serialNum, selectMem, sizeof(*serialNum));
+  return true;
+}
+
+bool owRead(uint8_t selectMem, uint16_t address, uint8_t length, uint8_t *data) {
+  if (selectMem >= FUZZ_OW_MEMS) {
+    return false;
+  }
+
+  memcpy(data, &owMems[selectMem][address], length);
+  return true;
+}
+
+bool owWrite(uint8_t selectMem, uint16_t address, uint8_t length, uint8_t *data) {
+  if (selectMem >= FUZZ_OW_MEMS) {
+    return false;
+  }
+
+  memcpy(&owMems[selectMem][address], data, length);
+  return true;
+}
+
+bool spectrumReadMem(uint32_t memAddr, uint8_t readLen, uint8_t* dest) {
+  if (memAddr > SPECTRUM_MEM_SIZE || readLen > SPECTRUM_MEM_SIZE - memAddr) {
+    return false;
+  }
+
+  memcpy(dest, &spectrum[memAddr], readLen);
+  return true;
+}
+
+// The trajectory store runs on a sector in RAM, as trajectory_flash.c does
+// on the flash
+bool trajectoryFlashErase(void) {
+  memset(trajectoryFlash, 0xFF, sizeof(trajectoryFlash));
+  return true;
+}
+
+bool trajectoryFlashProgram(uint32_t offset, uint32_t word) {
+  uint32_t current;
+  memcpy(&current, &trajectoryFlash[offset], sizeof(current));
+  current &= word;
+  memcpy(&trajectoryFlash[offset], &current, sizeof(current));
+  return true;
+}
+
+bool trajectoryFlashReadMem(uint32_t memAddr, uint8_t readLen, uint8_t* dest) {
+  return trajectoryStoreRead(&trajectoryStore, memAddr, readLen, dest);
+}
+
+uint8_t trajectoryFlashWriteMem(uint32_t memAddr, uint8_t writeLen, const uint8_t* src) {
+  return trajectoryStoreWrite(&trajectoryStore, memAddr, src, writeLen);
+}
+
+bool locoDeckGetAnchorPosition(const uint8_t anchorId, point_t* position) {
+  memset(position, 0, sizeof(*position));
+  position->x = anchorId;
+  position->timestamp = 1;
+  return true;
+}
@@ -0,0 +1,57 @@
+// Fuzz target for the parameter port
+// File under test param.c
+#include "fuzz.h"
+#include "param.h"
+#include "crc.h"
+#include "eprintf.h"
+
+#include <string.h>
+
+static uint8_t fuzzUint8;
+static int16_t fuzzInt16;
+static float fuzzFloat;
+static uint32_t fuzzReadOnly;
+static uint64_t fuzzUint64;
+
+// The table is placed in the .param section by hand, see sections.ld
+static const struct param_s fuzzParams[] FUZZ_SECTION(".param") = {
+  PARAM_ADD_GROUP(PARAM_GROUP | PARAM_START, fuzz, 0x0)
+  PARAM_ADD(PARAM_UINT8, u8, &fuzzUint8)
+  PARAM_ADD(PARAM_INT16, i16, &fuzzInt16)
+  PARAM_ADD(PARAM_FLOAT, f, &fuzzFloat)
+  PARAM_ADD(PARAM_UINT32 | PARAM_RONLY, ro, &fuzzReadOnly)
+  PARAM_ADD(PARAM_8BYTES | PARAM_TYPE_INT | PARAM_UNSIGNED, u64, &fuzzUint64)
+  PARAM_ADD_GROUP(PARAM_GROUP | PARAM_STOP, stop_fuzz, 0x0)
+  PARAM_ADD_GROUP(PARAM_GROUP | PARAM_START, other, 0x0)
+  PARAM_ADD(PARAM_UINT8, u8, &fuzzUint8)
+  PARAM_ADD_GROUP(PARAM_GROUP | PARAM_STOP, stop_other, 0x0)
+};
+
+void fuzzSetup(void) {
+  paramInit();
+}
+
+void fuzzAddSeeds(void) {
+  const uint8_t getInfo[] = {1};
+  const uint8_t getItem[] = {0, 2};
+  const uint8_t getInfoV2[] = {3};
+  const uint8_t getItemV2[] = {2, 4, 0};
+  const uint8_t read[] = {2};
+  const uint8_t write[] = {1, 0x34, 0x12};
+  const uint8_t readV2[] = {4, 0};
+  const uint8_t writeV2[] = {2, 0, 0x00, 0x00, 0x80, 0x3f};
+  const uint8_t setByName[] = {0, 'f', 'u', 'z', 'z', 0, 'u', '8', 0, PARAM_UINT8, 42};
+
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 0, getInfo, sizeof(getInfo));
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 0, getItem, sizeof(getItem));
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 1, read, sizeof(read));
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 2, write, sizeof(write));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 0, getInfoV2, sizeof(getInfoV2));
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 0, getItemV2, sizeof(getItemV2));
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 1, readV2, sizeof(readV2));
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 2, writeV2, sizeof(writeV2));
+  fuzzSeedBegin();
+  fuzzSeedAddPacket(CRTP_PORT_PARAM, 3, setByName, sizeof(setByName));
+}
@@ -0,0 +1,368 @@
+// File under test mem_window.c
+// File under test crc.c
+#include "mem_window.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "crc.h"
+#include "unity.h"
+
+#define MEM_ID 3
+#define MEMORY_SIZE 512
+#define MAX_SENT 64
+
+static uint8_t memory[MEMORY_SIZE];
+static bool isWriteFailing;
+
+typedef struct {
+  uint8_t data[MEM_WINDOW_PACKET_SIZE];
+  uint8_t size;
+} packet_t;
+
+static packet_t sent[MAX_SENT];
+static int sentCount;
+
+static uint8_t readMemory(uint8_t memId, uint32_t addr, uint8_t len, uint8_t* dest) {
+  if (memId != MEM_ID || addr > MEMORY_SIZE || len > MEMORY_SIZE - addr) {
+    return EIO;
+  }
+  memcpy(dest, &memory[addr], len);
+  return 0;
+}
+
+static uint8_t writeMemory(uint8_t memId, uint32_t addr, uint8_t len, const uint8_t* src) {
+  if (memId != MEM_ID || addr > MEMORY_SIZE || len > MEMORY_SIZE - addr || isWriteFailing) {
+    return EIO;
+  }
+  memcpy(&memory[addr], src, len);
+  return 0;
+}
+
+static void send(const uint8_t* data, uint8_t size) {
+  TEST_ASSERT_TRUE(size <= MEM_WINDOW_PACKET_SIZE);
+  TEST_ASSERT_TRUE(sentCount < MAX_SENT);
+  memcpy(sent[sentCount].data, data, size);
+  sent[sentCount].size = size;
+  sentCount++;
+}
+
+static const memWindowOps_t ops = {
+  .read = readMemory,
+  .write = writeMemory,
+  .send = send,
+};
+
+static memWindow_t mw;
+static uint8_t source[MEMORY_SIZE];
+
+static void start(uint8_t command, uint32_t addr, uint32_t len, uint8_t window);
+static void writeData(uint32_t offset, uint8_t len);
+static void readWindow(uint32_t offset);
+static void assertAck(const packet_t* packet, uint8_t command, uint8_t status, uint32_t offset, uint32_t crc);
+
+void setUp(void) {
+  memset(memory, 0, sizeof(memory));
+  for (int i = 0; i < MEMORY_SIZE; i++) {
+    source[i] = (uint8_t)(i * 7 + 3);
+  }
+  isWriteFailing = false;
+  sentCount = 0;
+
+  memWindowInit(&mw, &ops);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatWriteStartIsAcknowledged() {
+  // Fixture
+  // Test
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 100, 4);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(2, sent[0].size);
+  TEST_ASSERT_EQUAL_UINT8(MEM_WINDOW_CMD_WRITE_START, sent[0].data[0]);
+  TEST_ASSERT_EQUAL_UINT8(0, sent[0].data[1]);
+}
+
+void testThatBadWindowIsRejected() {
+  // Fixture
+  // Test
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 100, 0);
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 100, MEM_WINDOW_MAX_PACKETS + 1);
+  start(MEM_WINDOW_CMD_READ_START, 0xFFFFFFF0, 0x20, 4);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[0].data[1]);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[1].data[1]);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[2].data[1]);
+}
+
+void testThatShortStartIsRejected() {
+  // Fixture
+  uint8_t packet[] = {MEM_WINDOW_CMD_WRITE_START, MEM_ID, 0, 0, 0, 0};
+
+  // Test
+  memWindowHandlePacket(&mw, packet, sizeof(packet));
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[0].data[1]);
+}
+
+void testThatWindowOfWritesGetsOneAck() {
+  // Fixture
+  start(MEM_WINDOW_CMD_WRITE_START, 16, 200, 4);
+  sentCount = 0;
+
+  // Test
+  for (int i = 0; i < 4; i++) {
+    writeData(i * MEM_WINDOW_MAX_DATA, MEM_WINDOW_MAX_DATA);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  assertAck(&sent[0], MEM_WINDOW_CMD_WRITE_ACK, 0, 4 * MEM_WINDOW_MAX_DATA, crcSlow(source, 4 * MEM_WINDOW_MAX_DATA));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(source, &memory[16], 4 * MEM_WINDOW_MAX_DATA);
+}
+
+void testThatCompleteWriteIsAcknowledged() {
+  // Fixture
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 60, 8);
+  sentCount = 0;
+
+  // Test
+  writeData(0, 25);
+  writeData(25, 25);
+  writeData(50, 10);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  assertAck(&sent[0], MEM_WINDOW_CMD_WRITE_ACK, 0, 60, crcSlow(source, 60));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(source, memory, 60);
+}
+
+void testThatWritesAfterAGapAreDropped() {
+  // Fixture
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 200, 4);
+  sentCount = 0;
+
+  // Test
+  writeData(0, 25);
+  writeData(25, 25);
+  writeData(75, 25);
+  writeData(100, 25);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  assertAck(&sent[0], MEM_WINDOW_CMD_WRITE_ACK, 0, 50, crcSlow(source, 50));
+  TEST_ASSERT_EQUAL_HEX8(0, memory[75]);
+}
+
+void testThatWriteContinuesFromTheAck() {
+  // Fixture
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 100, 4);
+  writeData(0, 25);
+  writeData(50, 25);
+  writeData(75, 25);
+  writeData(75, 25);
+  sentCount = 0;
+
+  // Test
+  writeData(25, 25);
+  writeData(50, 25);
+  writeData(75, 25);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  assertAck(&sent[0], MEM_WINDOW_CMD_WRITE_ACK, 0, 100, crcSlow(source, 100));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(source, memory, 100);
+}
+
+void testThatSyncIsAnsweredWithAnAck() {
+  // Fixture
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 100, 4);
+  writeData(0, 25);
+  sentCount = 0;
+  uint8_t sync[] = {MEM_WINDOW_CMD_SYNC};
+
+  // Test
+  memWindowHandlePacket(&mw, sync, sizeof(sync));
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  assertAck(&sent[0], MEM_WINDOW_CMD_WRITE_ACK, 0, 25, crcSlow(source, 25));
+}
+
+void testThatSyncWithoutWriteIsRejected() {
+  // Fixture
+  uint8_t sync[] = {MEM_WINDOW_CMD_SYNC};
+
+  // Test
+  memWindowHandlePacket(&mw, sync, sizeof(sync));
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(MEM_WINDOW_CMD_WRITE_ACK, sent[0].data[0]);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[0].data[1]);
+}
+
+void testThatFailedWriteStopsTheTransfer() {
+  // Fixture
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 100, 4);
+  writeData(0, 25);
+  isWriteFailing = true;
+  sentCount = 0;
+
+  // Test
+  writeData(25, 25);
+  isWriteFailing = false;
+  writeData(25, 25);
+  writeData(50, 25);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  assertAck(&sent[0], MEM_WINDOW_CMD_WRITE_ACK, EIO, 25, crcSlow(source, 25));
+  TEST_ASSERT_EQUAL_HEX8(0, memory[25]);
+}
+
+void testThatWritePastTheRangeIsRejected() {
+  // Fixture
+  start(MEM_WINDOW_CMD_WRITE_START, 0, 30, 4);
+  sentCount = 0;
+
+  // Test
+  writeData(0, 25);
+  writeData(25, 25);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[0].data[1]);
+  TEST_ASSERT_EQUAL_HEX8(0, memory[25]);
+}
+
+void testThatWriteDataWithoutStartIsIgnored() {
+  // Fixture
+  // Test
+  writeData(0, 25);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, sentCount);
+  TEST_ASSERT_EQUAL_HEX8(0, memory[0]);
+}
+
+void testThatReadStreamsAWindow() {
+  // Fixture
+  memcpy(&memory[8], source, 100);
+  start(MEM_WINDOW_CMD_READ_START, 8, 100, 3);
+  sentCount = 0;
+
+  // Test
+  readWindow(0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(4, sentCount);
+  for (int i = 0; i < 3; i++) {
+    uint32_t offset;
+    memcpy(&offset, &sent[i].data[1], 4);
+    TEST_ASSERT_EQUAL_UINT8(MEM_WINDOW_CMD_READ_DATA, sent[i].data[0]);
+    TEST_ASSERT_EQUAL_UINT32(i * MEM_WINDOW_MAX_DATA, offset);
+    TEST_ASSERT_EQUAL_UINT8(MEM_WINDOW_PACKET_SIZE, sent[i].size);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&source[offset], &sent[i].data[MEM_WINDOW_DATA_HEADER], MEM_WINDOW_MAX_DATA);
+  }
+  assertAck(&sent[3], MEM_WINDOW_CMD_READ_END, 0, 75, crcSlow(source, 75));
+}
+
+void testThatReadEndsAtTheRange() {
+  // Fixture
+  memcpy(memory, source, 100);
+  start(MEM_WINDOW_CMD_READ_START, 0, 100, 3);
+  sentCount = 0;
+
+  // Test
+  readWindow(60);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(3, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(MEM_WINDOW_DATA_HEADER + 15, sent[1].size);
+  assertAck(&sent[2], MEM_WINDOW_CMD_READ_END, 0, 100, crcSlow(&source[60], 40));
+}
+
+void testThatFailedReadEndsTheWindow() {
+  // Fixture
+  start(MEM_WINDOW_CMD_READ_START, MEMORY_SIZE - 30, 100, 4);
+  sentCount = 0;
+
+  // Test
+  readWindow(0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(2, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(MEM_WINDOW_CMD_READ_END, sent[1].data[0]);
+  TEST_ASSERT_EQUAL_UINT8(EIO, sent[1].data[1]);
+}
+
+void testThatReadWindowWithoutStartIsRejected() {
+  // Fixture
+  // Test
+  readWindow(0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(MEM_WINDOW_CMD_READ_END, sent[0].data[0]);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[0].data[1]);
+}
+
+void testThatReadWindowPastTheRangeIsRejected() {
+  // Fixture
+  start(MEM_WINDOW_CMD_READ_START, 0, 100, 4);
+  sentCount = 0;
+
+  // Test
+  readWindow(101);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, sentCount);
+  TEST_ASSERT_EQUAL_UINT8(EINVAL, sent[0].data[1]);
+}
+
+// Helpers ////////////////////////////////////////////////////////////////
+
+static void start(uint8_t command, uint32_t addr, uint32_t len, uint8_t window) {
+  uint8_t packet[11] = {command, MEM_ID};
+  memcpy(&packet[2], &addr, 4);
+  memcpy(&packet[6], &len, 4);
+  packet[10] = window;
+  memWindowHandlePacket(&mw, packet, sizeof(packet));
+}
+
+// Writes len bytes of the source at offset
+static void writeData(uint32_t offset, uint8_t len) {
+  uint8_t packet[MEM_WINDOW_PACKET_SIZE] = {MEM_WINDOW_CMD_WRITE_DATA};
+  memcpy(&packet[1], &offset, 4);
+  memcpy(&packet[MEM_WINDOW_DATA_HEADER], &source[offset], len);
+  memWindowHandlePacket(&mw, packet, MEM_WINDOW_DATA_HEADER + len);
+}
+
+static void readWindow(uint32_t offset) {
+  uint8_t packet[5] = {MEM_WINDOW_CMD_READ_WINDOW};
+  memcpy(&packet[1], &offset, 4);
+  memWindowHandlePacket(&mw, packet, sizeof(packet));
+}
+
+static void assertAck(const packet_t* packet, uint8_t command, uint8_t status, uint32_t offset, uint32_t crc) {
+  uint32_t actualOffset;
+  uint32_t actualCrc;
+  memcpy(&actualOffset, &packet->data[2], 4);
+  memcpy(&actualCrc, &packet->data[6], 4);
+
+  TEST_ASSERT_EQUAL_UINT8(10, packet->size);
+  TEST_ASSERT_EQUAL_UINT8(command, packet->data[0]);
+  TEST_ASSERT_EQUAL_UINT8(status, packet->data[1]);
+  TEST_ASSERT_EQUAL_UINT32(offset, actualOffset);
+  TEST_ASSERT_EQUAL_HEX32(crc, actualCrc);
+}
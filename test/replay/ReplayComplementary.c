@@ -0,0 +1,28 @@
+// Replay of a flight through the complementary filter
+// File under test estimator_complementary.c
+// File under test sensfusion6.c
+// File under test position_estimator_altitude.c
+// File under test num.c
+#include "replay.h"
+#include "estimator_complementary.h"
+
+// The complementary filter only estimates the height, from the z-ranger. The
+// altitude estimator takes a range measurement only when it is in the same
+// tick as a position update, and corrects the attitude with the accelerometer
+// alone, which sees the rotor drag.
+const replayScenario_t replayScenarios[] = {
+  {.name = "default", .maxPositionRms = 0.0f, .maxHeightRms = 0.3f, .maxAttitudeRms = 3.0f},
+};
+const int replayScenarioCount = sizeof(replayScenarios) / sizeof(replayScenarios[0]);
+
+static sensorData_t sensorData;
+
+void replayInit(void) {
+  sensorData = (sensorData_t){0};
+  estimatorComplementaryInit();
+}
+
+void replayStep(const replaySample_t* sample, bool isNewSample, state_t* state, const uint32_t tick) {
+  control_t control = {.thrust = sample->thrust};
+  estimatorComplementary(state, &sensorData, &control, tick);
+}
@@ -0,0 +1,61 @@
+// Replay of a flight through the Kalman filter
+// File under test estimator_kalman.c
+// File under test udFactor.c
+#include "replay.h"
+#include "estimator_kalman.h"
+#include "innovationMonitor.h"
+#include "adaptiveNoise.h"
+
+#include <math.h>
+
+// Measurement noise model of the z-ranger, see zranger.c
+#define ZRANGE_POINT_A 1.0f
+#define ZRANGE_STD_A 0.0025f
+#define ZRANGE_POINT_B 1.3f
+#define ZRANGE_STD_B 0.2f
+
+// As the localization service does for an external position
+#define EXT_POSITION_STD_DEV 0.01f
+
+// The synthetic flight has rotor drag, without the drag model the filter
+// takes the horizontal drag for a tilt, hence the attitude limits
+const replayScenario_t replayScenarios[] = {
+  {.name = "default", .maxPositionRms = 0.02f, .maxHeightRms = 0.01f, .maxAttitudeRms = 3.0f},
+  {.name = "adaptive", .params = {"kalman.adaptive=1"}, .maxPositionRms = 0.02f, .maxHeightRms = 0.01f, .maxAttitudeRms = 3.0f},
+  {.name = "dragModel", .params = {"kalman.dragModel=1"}, .maxPositionRms = 0.02f, .maxHeightRms = 0.01f, .maxAttitudeRms = 3.0f},
+  {.name = "thrustModel", .params = {"kalman.thrustModel=1"}, .maxPositionRms = 0.02f, .maxHeightRms = 0.03f, .maxAttitudeRms = 3.0f},
+  {.name = "mag", .params = {"kalman.useMag=1"}, .maxPositionRms = 0.02f, .maxHeightRms = 0.01f, .maxAttitudeRms = 3.0f},
+};
+const int replayScenarioCount = sizeof(replayScenarios) / sizeof(replayScenarios[0]);
+
+static sensorData_t sensorData;
+
+void replayInit(void) {
+  sensorData = (sensorData_t){0};
+  estimatorKalmanInit();
+}
+
+void replayStep(const replaySample_t* sample, bool isNewSample, state_t* state, const uint32_t tick) {
+  if (isNewSample && sample->isNewZrange) {
+    const float coeff = logf(ZRANGE_STD_B / ZRANGE_STD_A) / (ZRANGE_POINT_B - ZRANGE_POINT_A);
+    tofMeasurement_t tof = {
+      .timestamp = tick,
+      .distance = sample->zrange,
+      .stdDev = ZRANGE_STD_A * (1.0f + expf(coeff * (sample->zrange - ZRANGE_POINT_A))),
+    };
+    estimatorKalmanEnqueueTOF(&tof);
+  }
+
+  if (isNewSample && sample->isNewExtPosition) {
+    positionMeasurement_t position = {
+      .x = sample->extPosition.x,
+      .y = sample->extPosition.y,
+      .z = sample->extPosition.z,
+      .stdDev = EXT_POSITION_STD_DEV,
+    };
+    estimatorKalmanEnqueuePosition(&position);
+  }
+
+  control_t control = {.thrust = sample->thrust};
+  estimatorKalman(state, &sensorData, &control, tick);
+}
@@ -0,0 +1,54 @@
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+// FreeRTOS port definitions for running firmware modules on the host in the
+// replays. Used instead of portable/GCC/ARM_CM4F/portmacro.h, with the same
+// types, but without the Cortex-M4 instructions. There is no scheduler, so
+// yielding and the critical sections do nothing.
+
+#include <stdint.h>
+
+#define portCHAR		char
+#define portFLOAT		float
+#define portDOUBLE		double
+#define portLONG		long
+#define portSHORT		short
+#define portSTACK_TYPE	uint32_t
+#define portBASE_TYPE	long
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if( configUSE_16_BIT_TICKS == 1 )
+	typedef uint16_t TickType_t;
+	#define portMAX_DELAY ( TickType_t ) 0xffff
+#else
+	typedef uint32_t TickType_t;
+	#define portMAX_DELAY ( TickType_t ) 0xffffffffUL
+	#define portTICK_TYPE_IS_ATOMIC 1
+#endif
+
+#define portSTACK_GROWTH			( -1 )
+#define portTICK_PERIOD_MS			( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define portBYTE_ALIGNMENT			8
+
+#define portYIELD()
+#define portEND_SWITCHING_ISR( xSwitchRequired ) ( void ) ( xSwitchRequired )
+#define portYIELD_FROM_ISR( x ) portEND_SWITCHING_ISR( x )
+
+#define portSET_INTERRUPT_MASK_FROM_ISR()		0
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)	( void ) ( x )
+#define portDISABLE_INTERRUPTS()
+#define portENABLE_INTERRUPTS()
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
+
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+
+#define portNOP()
+
+#endif /* PORTMACRO_H */
@@ -0,0 +1,47 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+volatile uint32_t benchSink;
+
+static double nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compareDouble(const void* a, const void* b) {
+  const double da = *(const double*)a;
+  const double db = *(const double*)b;
+  return (da > db) - (da < db);
+}
+
+static double runRepetition(benchFunction_t function, uint32_t calls) {
+  const double start = nowNs();
+  for (uint32_t i = 0; i < calls; i++) {
+    function();
+  }
+  return (nowNs() - start) / calls;
+}
+
+void benchRun(const char* name, benchFunction_t function, uint32_t calls) {
+  double nsPerCall[BENCH_REPETITIONS];
+
+  for (int i = 0; i < BENCH_WARMUP_REPETITIONS; i++) {
+    runRepetition(function, calls);
+  }
+
+  for (int i = 0; i < BENCH_REPETITIONS; i++) {
+    nsPerCall[i] = runRepetition(function, calls);
+  }
+
+  qsort(nsPerCall, BENCH_REPETITIONS, sizeof(nsPerCall[0]), compareDouble);
+
+  printf("{\"name\": \"%s\", \"ns\": %.3f, \"nsMin\": %.3f, \"calls\": %u, \"repetitions\": %d}\n",
+         name, nsPerCall[BENCH_REPETITIONS / 2], nsPerCall[0], (unsigned)calls, BENCH_REPETITIONS);
+  fflush(stdout);
+}
@@ -0,0 +1,21 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+
+// Micro benchmark harness used by the Bench*.c files, run with 'rake bench'.
+// Each benchmark is warmed up and then timed over a number of repetitions. The
+// median and minimum time per call are printed as one JSON object per line.
+
+#define BENCH_WARMUP_REPETITIONS 3
+#define BENCH_REPETITIONS 15
+
+typedef void (*benchFunction_t)(void);
+
+// Store results here so the compiler can not remove the work
+extern volatile uint32_t benchSink;
+
+// Time function, called calls times per repetition
+void benchRun(const char* name, benchFunction_t function, uint32_t calls);
+
+#endif // __BENCH_H__
@@ -0,0 +1,97 @@
+#include "eepromSim.h"
+
+#include <string.h>
+#include "i2cdev.h"
+#include "console.h"
+
+#define EEPROM_SIM_I2C_ADDR 0x50
+
+static uint8_t memory[EEPROM_SIM_SIZE];
+static uint32_t ticks;
+static uint32_t busyUntil;
+static uint32_t writeCycleCount;
+static uint32_t nackCount;
+
+void eepromSimReset() {
+  memset(memory, 0xff, sizeof(memory));
+  ticks = 0;
+  busyUntil = 0;
+  writeCycleCount = 0;
+  nackCount = 0;
+}
+
+uint8_t* eepromSimMemory() {
+  return memory;
+}
+
+uint32_t eepromSimWriteCycleCount() {
+  return writeCycleCount;
+}
+
+uint32_t eepromSimNackCount() {
+  return nackCount;
+}
+
+uint32_t eepromSimTicks() {
+  return ticks;
+}
+
+static bool isAcknowledged(uint8_t devAddress) {
+  if (devAddress != EEPROM_SIM_I2C_ADDR) {
+    return false;
+  }
+
+  if (ticks < busyUntil) {
+    nackCount++;
+    return false;
+  }
+
+  return true;
+}
+
+bool i2cdevRead16(I2C_Dev *dev, uint8_t devAddress, uint16_t memAddress, uint16_t len, uint8_t *data) {
+  if (!isAcknowledged(devAddress)) {
+    return false;
+  }
+
+  // Sequential read wraps around at the end of the memory
+  for (uint16_t i = 0; i < len; i++) {
+    data[i] = memory[(memAddress + i) % EEPROM_SIM_SIZE];
+  }
+
+  return true;
+}
+
+bool i2cdevWrite16(I2C_Dev *dev, uint8_t devAddress, uint16_t memAddress, uint16_t len, uint8_t *data) {
+  if (!isAcknowledged(devAddress)) {
+    return false;
+  }
+
+  // Page write, the address wraps around within the page
+  const uint16_t pageStart = (memAddress % EEPROM_SIM_SIZE) & ~(EEPROM_SIM_PAGE_SIZE - 1);
+  for (uint16_t i = 0; i < len; i++) {
+    memory[pageStart + ((memAddress + i) % EEPROM_SIM_PAGE_SIZE)] = data[i];
+  }
+
+  busyUntil = ticks + EEPROM_SIM_WRITE_CYCLE_TICKS;
+  writeCycleCount++;
+  return true;
+}
+
+// FreeRTOS and console functions used by the driver
+
+void vTaskDelay(const uint32_t xTicksToDelay) {
+  ticks += xTicksToDelay;
+}
+
+uint32_t xTaskGetTickCount() {
+  return ticks;
+}
+
+int consolePutchar(int ch) {
+  return ch;
+}
+
+int consolePrintf(const char* fmt, ...) {
+  return 0;
+}
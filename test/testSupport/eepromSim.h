@@ -0,0 +1,28 @@
+#ifndef __EEPROM_SIM_H__
+#define __EEPROM_SIM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Simulated 24AA64F eeprom on the I2C bus, implements the i2cdev functions used by the eeprom driver.
+// Time is simulated in ticks (ms) and advanced by vTaskDelay() and by each bus transfer.
+
+#define EEPROM_SIM_SIZE 8192
+#define EEPROM_SIM_PAGE_SIZE 32
+#define EEPROM_SIM_WRITE_CYCLE_TICKS 5
+
+void eepromSimReset();
+
+// The memory contents
+uint8_t* eepromSimMemory();
+
+// Number of started write cycles, one per write transfer
+uint32_t eepromSimWriteCycleCount();
+
+// Number of transfers that were not acknowledged since the device was busy
+uint32_t eepromSimNackCount();
+
+// The simulated time
+uint32_t eepromSimTicks();
+
+#endif // __EEPROM_SIM_H__
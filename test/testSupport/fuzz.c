@@ -0,0 +1,533 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "fuzz.h"
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "timers.h"
+#include "cfassert.h"
+
+#if defined(__has_include)
+#if __has_include(<sanitizer/common_interface_defs.h>)
+#include <sanitizer/common_interface_defs.h>
+#define FUZZ_HAS_SANITIZER_CALLBACK
+#endif
+#endif
+
+#define FUZZ_CRTP_PORTS 16
+#define FUZZ_CRTP_TX_QUEUE_SIZE 60 // As in crtp.c, always empty
+#define FUZZ_MAX_TASKS 4
+#define FUZZ_MAX_TIMERS 20
+#define FUZZ_DEFAULT_RUNS 100000
+#define FUZZ_MAX_MUTATIONS 8
+#define FUZZ_CRASH_FILE "fuzz-crash.bin"
+
+uint32_t fuzzSentPackets;
+CRTPPacket fuzzLastSentPacket;
+
+typedef struct {
+  TaskFunction_t function;
+  void* parameters;
+  int port; // -1 until the task has initialized its queue
+} fuzzTask_t;
+
+typedef struct {
+  bool isUsed;
+  bool isActive;
+  void* id;
+  TimerCallbackFunction_t callback;
+} fuzzTimer_t;
+
+static CrtpCallback callbacks[FUZZ_CRTP_PORTS];
+
+static fuzzTask_t tasks[FUZZ_MAX_TASKS];
+static int taskCount;
+static fuzzTask_t* runningTask;
+static const CRTPPacket* pendingPacket;
+static jmp_buf taskBlocked;
+
+static fuzzTimer_t timers[FUZZ_MAX_TIMERS];
+static TickType_t tickCount;
+static char queueDummy;
+
+static uint8_t seeds[FUZZ_MAX_SEEDS][FUZZ_MAX_INPUT_SIZE];
+static size_t seedSizes[FUZZ_MAX_SEEDS];
+static int seedCount;
+
+static const uint8_t* currentInput;
+static size_t currentInputSize;
+
+static void dumpCurrentInput(void) {
+  if (currentInput == NULL) {
+    return;
+  }
+
+  fprintf(stderr, "Input (%d bytes):", (int)currentInputSize);
+  for (size_t i = 0; i < currentInputSize; i++) {
+    fprintf(stderr, " %02x", currentInput[i]);
+  }
+  fprintf(stderr, "\n");
+
+  FILE* file = fopen(FUZZ_CRASH_FILE, "wb");
+  if (file) {
+    fwrite(currentInput, 1, currentInputSize, file);
+    fclose(file);
+    fprintf(stderr, "Written to " FUZZ_CRASH_FILE "\n");
+  }
+}
+
+static void fuzzCrash(const char* reason) {
+  fprintf(stderr, "Fuzz crash: %s\n", reason);
+  dumpCurrentInput();
+  abort();
+}
+
+// Runs a task until it blocks waiting for the next packet
+static void runTask(fuzzTask_t* task, const CRTPPacket* packet) {
+  runningTask = task;
+  pendingPacket = packet;
+  if (setjmp(taskBlocked) == 0) {
+    task->function(task->parameters);
+    fuzzCrash("task returned");
+  }
+  runningTask = NULL;
+}
+
+static void runTimers(void) {
+  for (int i = 0; i < FUZZ_MAX_TIMERS; i++) {
+    if (timers[i].isUsed && timers[i].isActive) {
+      timers[i].callback((TimerHandle_t)&timers[i]);
+    }
+  }
+}
+
+static void deliverPacket(const CRTPPacket* packet) {
+  tickCount++;
+
+  for (int i = 0; i < taskCount; i++) {
+    if (tasks[i].port == packet->port) {
+      runTask(&tasks[i], packet);
+    }
+  }
+
+  if (callbacks[packet->port]) {
+    CRTPPacket copy = *packet;
+    callbacks[packet->port](&copy);
+  }
+
+  runTimers();
+}
+
+static void initialize(void) {
+  static bool isInit = false;
+  if (isInit) {
+    return;
+  }
+
+#ifdef FUZZ_HAS_SANITIZER_CALLBACK
+  __sanitizer_set_death_callback(dumpCurrentInput);
+#endif
+
+  fuzzSetup();
+
+  // Let the tasks run up to their first receive
+  for (int i = 0; i < taskCount; i++) {
+    runTask(&tasks[i], NULL);
+  }
+
+  fuzzAddSeeds();
+  isInit = true;
+}
+
+void fuzzRunInput(const uint8_t* data, size_t size) {
+  currentInput = data;
+  currentInputSize = size;
+
+  size_t i = 0;
+  while (i + 2 <= size) {
+    CRTPPacket packet;
+    memset(&packet, 0, sizeof(packet));
+
+    packet.header = data[i];
+    size_t length = data[i + 1] % (CRTP_MAX_DATA_SIZE + 1);
+    i += 2;
+    if (length > size - i) {
+      length = size - i;
+    }
+
+    packet.size = (uint8_t)length;
+    memcpy(packet.data, &data[i], length);
+    i += length;
+
+    deliverPacket(&packet);
+  }
+
+  currentInput = NULL;
+}
+
+void fuzzSeedBegin(void) {
+  ASSERT(seedCount < FUZZ_MAX_SEEDS);
+  seedCount++;
+}
+
+void fuzzSeedAddPacket(uint8_t port, uint8_t channel, const void* data, uint8_t size) {
+  uint8_t* seed = seeds[seedCount - 1];
+  size_t* seedSize = &seedSizes[seedCount - 1];
+  ASSERT(size <= CRTP_MAX_DATA_SIZE);
+  ASSERT(*seedSize + 2 + size <= FUZZ_MAX_INPUT_SIZE);
+
+  seed[(*seedSize)++] = CRTP_HEADER(port, channel);
+  seed[(*seedSize)++] = size;
+  memcpy(&seed[*seedSize], data, size);
+  *seedSize += size;
+}
+
+static int writeCorpus(const char* directory) {
+  mkdir(directory, 0755);
+
+  for (int i = 0; i < seedCount; i++) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/seed-%02d", directory, i);
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+      fprintf(stderr, "Can not write %s\n", path);
+      return 1;
+    }
+    fwrite(seeds[i], 1, seedSizes[i], file);
+    fclose(file);
+  }
+
+  printf("Wrote %d seeds to %s\n", seedCount, directory);
+  return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  initialize();
+  fuzzRunInput(data, size);
+  return 0;
+}
+
+#ifdef FUZZ_LIBFUZZER
+
+int LLVMFuzzerInitialize(int* argc, char*** argv) {
+  initialize();
+
+  const char* key = "-write_corpus=";
+  for (int i = 1; i < *argc; i++) {
+    if (strncmp((*argv)[i], key, strlen(key)) == 0) {
+      exit(writeCorpus((*argv)[i] + strlen(key)));
+    }
+  }
+
+  return 0;
+}
+
+#else
+
+static uint32_t randomState = 1;
+
+// xorshift32
+static uint32_t randomNext(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static size_t mutate(uint8_t* data, size_t size) {
+  static const uint8_t interestingBytes[] = {0, 1, 0x7f, 0x80, 0xff, CRTP_MAX_DATA_SIZE, CRTP_MAX_DATA_SIZE + 1};
+  static const uint32_t interestingWords[] = {0, 0x7fffffff, 0x80000000, 0xfffffff0, 0xffffffff};
+
+  const int mutations = 1 + randomNext() % FUZZ_MAX_MUTATIONS;
+  for (int m = 0; m < mutations; m++) {
+    const size_t position = size > 0 ? randomNext() % size : 0;
+
+    switch (randomNext() % 7) {
+      case 0:
+        if (size > 0) {
+          data[position] ^= (uint8_t)(1 << (randomNext() % 8));
+        }
+        break;
+      case 1:
+        if (size > 0) {
+          data[position] = (uint8_t)randomNext();
+        }
+        break;
+      case 2:
+        if (size > 0) {
+          data[position] = interestingBytes[randomNext() % sizeof(interestingBytes)];
+        }
+        break;
+      case 3:
+        if (size < FUZZ_MAX_INPUT_SIZE) {
+          memmove(&data[position + 1], &data[position], size - position);
+          data[position] = (uint8_t)randomNext();
+          size++;
+        }
+        break;
+      case 4:
+        if (size > 0) {
+          memmove(&data[position], &data[position + 1], size - position - 1);
+          size--;
+        }
+        break;
+      case 5:
+        if (size >= 4) {
+          const uint32_t word = interestingWords[randomNext() % (sizeof(interestingWords) / sizeof(interestingWords[0]))];
+          memcpy(&data[randomNext() % (size - 3)], &word, sizeof(word));
+        }
+        break;
+      case 6:
+        {
+          // Append the start of another seed
+          const int other = randomNext() % seedCount;
+          size_t length = randomNext() % (seedSizes[other] + 1);
+          if (length > FUZZ_MAX_INPUT_SIZE - size) {
+            length = FUZZ_MAX_INPUT_SIZE - size;
+          }
+          memcpy(&data[size], seeds[other], length);
+          size += length;
+        }
+        break;
+    }
+  }
+
+  return size;
+}
+
+static void replayFile(const char* path) {
+  static uint8_t data[FUZZ_MAX_INPUT_SIZE];
+
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Can not read %s\n", path);
+    exit(1);
+  }
+  size_t size = fread(data, 1, sizeof(data), file);
+  fclose(file);
+
+  fuzzRunInput(data, size);
+}
+
+static double nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Usage: FuzzX [-runs=N] [-seed=N] [-write_corpus=DIR] [input files]
+int main(int argc, char** argv) {
+  uint32_t runs = FUZZ_DEFAULT_RUNS;
+  const char* corpusDirectory = NULL;
+  int files = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "-runs=", 6) == 0) {
+      runs = strtoul(argv[i] + 6, NULL, 0);
+    } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+      randomState = strtoul(argv[i] + 6, NULL, 0) | 1;
+    } else if (strncmp(argv[i], "-write_corpus=", 14) == 0) {
+      corpusDirectory = argv[i] + 14;
+    } else {
+      files++;
+    }
+  }
+
+  initialize();
+
+  if (corpusDirectory) {
+    return writeCorpus(corpusDirectory);
+  }
+
+  if (files > 0) {
+    for (int i = 1; i < argc; i++) {
+      if (argv[i][0] != '-') {
+        replayFile(argv[i]);
+      }
+    }
+    printf("Replayed %d inputs\n", files);
+    return 0;
+  }
+
+  static uint8_t input[FUZZ_MAX_INPUT_SIZE];
+  const double start = nowNs();
+
+  for (int i = 0; i < seedCount; i++) {
+    memcpy(input, seeds[i], seedSizes[i]);
+    fuzzRunInput(input, seedSizes[i]);
+  }
+
+  for (uint32_t run = 0; run < runs; run++) {
+    const int seed = randomNext() % seedCount;
+    memcpy(input, seeds[seed], seedSizes[seed]);
+    const size_t size = mutate(input, seedSizes[seed]);
+    fuzzRunInput(input, size);
+  }
+
+  const double nsPerRun = (nowNs() - start) / (runs + seedCount);
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+  printf("{\"name\": \"%.*s\", \"runs\": %u, \"ns\": %.1f, \"execsPerSec\": %.0f, \"sentPackets\": %u}\n",
+         (int)strcspn(name, "."), name, (unsigned)runs, nsPerRun, 1e9 / nsPerRun, (unsigned)fuzzSentPackets);
+
+  return 0;
+}
+
+#endif
+
+// Stubs for the CRTP and FreeRTOS functions used by the modules under test
+
+void crtpRegisterPortCB(int port, CrtpCallback cb) {
+  ASSERT(port < FUZZ_CRTP_PORTS);
+  callbacks[port] = cb;
+}
+
+void crtpInitTaskQueue(CRTPPort portId) {
+  ASSERT(runningTask != NULL);
+  runningTask->port = portId;
+}
+
+int crtpReceivePacketBlock(CRTPPort taskId, CRTPPacket* p) {
+  if (pendingPacket == NULL) {
+    longjmp(taskBlocked, 1);
+  }
+
+  *p = *pendingPacket;
+  pendingPacket = NULL;
+  return pdTRUE;
+}
+
+int crtpSendPacket(CRTPPacket* p) {
+  // The radio link asserts on this
+  if (p->size > CRTP_MAX_DATA_SIZE) {
+    fuzzCrash("packet sent with too large size");
+  }
+
+  fuzzSentPackets++;
+  fuzzLastSentPacket = *p;
+  return pdTRUE;
+}
+
+int crtpSendPacketBlock(CRTPPacket* p) {
+  return crtpSendPacket(p);
+}
+
+bool crtpIsConnected(void) {
+  return true;
+}
+
+int crtpGetFreeTxQueuePackets(void) {
+  return FUZZ_CRTP_TX_QUEUE_SIZE;
+}
+
+float crtpGetTelemetryRate(void) {
+  return 1.0f;
+}
+
+int crtpReset(void) {
+  return 0;
+}
+
+void assertFail(char* exp, char* file, int line) {
+  fprintf(stderr, "Assert failed %s:%d (%s)\n", file, line, exp);
+  fuzzCrash("assert");
+}
+
+int consolePutchar(int ch) {
+  return ch;
+}
+
+int consolePrintf(const char* fmt, ...) {
+  return 0;
+}
+
+int workerSchedule(void (*function)(void*), void* arg) {
+  function(arg);
+  return pdTRUE;
+}
+
+uint64_t usecTimestamp(void) {
+  return (uint64_t)tickCount * 1000;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return tickCount;
+}
+
+BaseType_t xTaskGenericCreate(TaskFunction_t pxTaskCode, const char* const pcName, const uint16_t usStackDepth,
+                              void* const pvParameters, UBaseType_t uxPriority, TaskHandle_t* const pxCreatedTask,
+                              StackType_t* const puxStackBuffer, const MemoryRegion_t* const xRegions) {
+  ASSERT(taskCount < FUZZ_MAX_TASKS);
+  tasks[taskCount].function = pxTaskCode;
+  tasks[taskCount].parameters = pvParameters;
+  tasks[taskCount].port = -1;
+  taskCount++;
+  return pdPASS;
+}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType) {
+  return (QueueHandle_t)&queueDummy;
+}
+
+QueueHandle_t xQueueCreateMutex(const uint8_t ucQueueType) {
+  return (QueueHandle_t)&queueDummy;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition) {
+  return pdTRUE;
+}
+
+BaseType_t xQueueGenericReceive(QueueHandle_t xQueue, void* const pvBuffer, TickType_t xTicksToWait, const BaseType_t xJustPeek) {
+  return pdTRUE;
+}
+
+TimerHandle_t xTimerCreate(const char* const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload,
+                           void* const pvTimerID, TimerCallbackFunction_t pxCallbackFunction) {
+  for (int i = 0; i < FUZZ_MAX_TIMERS; i++) {
+    if (!timers[i].isUsed) {
+      timers[i].isUsed = true;
+      timers[i].isActive = false;
+      timers[i].id = pvTimerID;
+      timers[i].callback = pxCallbackFunction;
+      return (TimerHandle_t)&timers[i];
+    }
+  }
+
+  return NULL;
+}
+
+BaseType_t xTimerGenericCommand(TimerHandle_t xTimer, const BaseType_t xCommandID, const TickType_t xOptionalValue,
+                                BaseType_t* const pxHigherPriorityTaskWoken, const TickType_t xTicksToWait) {
+  fuzzTimer_t* timer = (fuzzTimer_t*)xTimer;
+  ASSERT(timer != NULL && timer->isUsed);
+
+  switch (xCommandID) {
+    case tmrCOMMAND_START:
+    case tmrCOMMAND_RESET:
+    case tmrCOMMAND_CHANGE_PERIOD:
+      timer->isActive = true;
+      break;
+    case tmrCOMMAND_STOP:
+      timer->isActive = false;
+      break;
+    case tmrCOMMAND_DELETE:
+      timer->isUsed = false;
+      break;
+  }
+
+  return pdPASS;
+}
+
+void* pvTimerGetTimerID(const TimerHandle_t xTimer) {
+  return ((fuzzTimer_t*)xTimer)->id;
+}
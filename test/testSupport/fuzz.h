@@ -0,0 +1,52 @@
+#ifndef __FUZZ_H__
+#define __FUZZ_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crtp.h"
+
+// Fuzz harness support used by the Fuzz*.c files, run with 'rake fuzz'.
+//
+// A fuzz input is a sequence of CRTP packets, each encoded as the header byte,
+// a size byte and the data. Sizes are limited to CRTP_MAX_DATA_SIZE, which is
+// what the radio link delivers. The packets are passed to the callback or the
+// task that the module under test registered for the port, as crtp.c does.
+//
+// Each harness implements fuzzSetup(), initializing the module under test,
+// and fuzzAddSeeds(), adding valid packet sequences to the seed corpus. The
+// stand alone driver in fuzz.c mutates the seeds, or replays files given on
+// the command line. With FUZZ_LIBFUZZER the harness is instead linked with
+// libFuzzer, using LLVMFuzzerTestOneInput().
+//
+// Failed asserts, packets sent with a size larger than CRTP_MAX_DATA_SIZE and
+// tasks that return are reported as crashes.
+
+#define FUZZ_MAX_INPUT_SIZE 512
+#define FUZZ_MAX_SEEDS 64
+
+// Places a parameter or log table in a section collected by sections.ld. The
+// table must not be padded by the address sanitizer since the module under
+// test walks the section as one array.
+#ifdef __clang__
+#define FUZZ_SECTION(NAME) __attribute__((section(NAME), used, no_sanitize("address")))
+#else
+#define FUZZ_SECTION(NAME) __attribute__((section(NAME), used))
+#endif
+
+// Implemented by the harness
+void fuzzSetup(void);
+void fuzzAddSeeds(void);
+
+// Seed corpus
+void fuzzSeedBegin(void);
+void fuzzSeedAddPacket(uint8_t port, uint8_t channel, const void* data, uint8_t size);
+
+// Runs one input through the module under test
+void fuzzRunInput(const uint8_t* data, size_t size);
+
+// Packets sent by the module under test, the last one is kept
+extern uint32_t fuzzSentPackets;
+extern CRTPPacket fuzzLastSentPacket;
+
+#endif // __FUZZ_H__
@@ -0,0 +1,800 @@
+#define _DEFAULT_SOURCE
+
+#include "replay.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "param.h"
+#include "sensors.h"
+#include "usdLog.h"
+
+#define REPLAY_MAX_QUEUES 8
+
+// The estimators converge after a reset, the first second is not part of the errors
+#define REPLAY_SETTLE_TICKS 1000
+
+// The estimate is compared to the reference every 100 ms
+#define REPLAY_REFERENCE_PERIOD 100
+#define REPLAY_REFERENCE_POSITION_TOLERANCE 0.005f // m
+#define REPLAY_REFERENCE_ATTITUDE_TOLERANCE 0.05f // deg
+
+// Synthetic flight: on the ground, take off to 1 m, fly a circle while
+// yawing, land. The sensors are logged at 500 Hz, the z-ranger at 42 Hz
+// and an external position (motion capture) at 100 Hz.
+#define FLIGHT_START_TICK 2000
+#define FLIGHT_DURATION 20.0 // s
+#define FLIGHT_LOG_PERIOD 2 // ticks
+#define FLIGHT_ZRANGE_PERIOD 24
+#define FLIGHT_EXT_POS_PERIOD 10
+#define FLIGHT_HEIGHT 1.0
+#define FLIGHT_CIRCLE_RADIUS 0.5
+#define FLIGHT_CIRCLE_PERIOD 5.0 // s
+#define FLIGHT_YAW_AMPLITUDE 30.0 // deg
+#define FLIGHT_DRAG 0.35 // s^-1, rotor drag
+#define FLIGHT_GROUND_HEIGHT 1e-6 // m, below it the quad is on the ground
+#define FLIGHT_MASS 27.0 // grams
+#define FLIGHT_ASL 120.0 // m
+
+#define GRAVITY 9.81
+#define DEG_TO_RAD (M_PI / 180.0)
+#define RAD_TO_DEG (180.0 / M_PI)
+
+// System Control Space of the Cortex-M4, read by code that checks if it runs in an interrupt
+#define REPLAY_SCS_BASE 0xE000E000UL
+#define REPLAY_SCS_SIZE 0x1000
+
+typedef struct {
+  int itemSize;
+  int length;
+  int count;
+  int head;
+  uint8_t* items;
+} replayQueue_t;
+
+typedef struct {
+  char scenario[32];
+  uint32_t tick;
+  float values[6];
+} referenceEntry_t;
+
+extern struct param_s _param_start;
+extern struct param_s _param_stop;
+
+static replaySample_t* samples;
+static int sampleCount;
+static bool hasReference;
+
+static replayQueue_t queues[REPLAY_MAX_QUEUES];
+static int queueCount;
+static TickType_t tickCount;
+
+static const replaySample_t* currentSample;
+static bool isAccPending;
+static bool isGyroPending;
+static bool isMagPending;
+static bool isBaroPending;
+
+static referenceEntry_t* reference;
+static int referenceCount;
+
+static uint8_t* paramDefaults;
+
+static uint32_t randomState = 1;
+
+// xorshift32
+static uint32_t randomNext(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+// Gaussian noise, Box-Muller
+static double noise(double stdDev) {
+  const double u1 = (randomNext() + 1.0) / 4294967297.0;
+  const double u2 = (randomNext() + 1.0) / 4294967297.0;
+  return stdDev * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// Smooth step with continuous first and second derivatives
+static double smoothStep(double x) {
+  if (x <= 0.0) {
+    return 0.0;
+  }
+  if (x >= 1.0) {
+    return 1.0;
+  }
+  return x * x * x * (x * (x * 6.0 - 15.0) + 10.0);
+}
+
+static void flightTrajectory(double t, double position[3], double* yaw) {
+  const double height = FLIGHT_HEIGHT * (smoothStep((t - 2.0) / 2.0) - smoothStep((t - 15.0) / 2.0));
+  const double envelope = smoothStep((t - 4.0) / 1.5) - smoothStep((t - 12.5) / 1.5);
+  const double angle = 2.0 * M_PI * (t - 4.0) / FLIGHT_CIRCLE_PERIOD;
+
+  position[0] = envelope * FLIGHT_CIRCLE_RADIUS * sin(angle);
+  position[1] = envelope * FLIGHT_CIRCLE_RADIUS * (1.0 - cos(angle));
+  position[2] = height;
+  *yaw = envelope * FLIGHT_YAW_AMPLITUDE * DEG_TO_RAD * sin(2.0 * M_PI * t / 8.0);
+}
+
+static void cross(const double a[3], const double b[3], double out[3]) {
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static void normalize(double v[3]) {
+  const double norm = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  for (int i = 0; i < 3; i++) {
+    v[i] /= norm;
+  }
+}
+
+// Attitude of a quadrotor following the trajectory. The thrust, along the
+// body z axis, and the rotor drag give the acceleration. R[i][j] rotates body
+// axis j into world axis i.
+static void flightAttitude(double t, double R[3][3], double acceleration[3], double velocity[3]) {
+  const double h = 1e-3;
+  double p0[3], p1[3], p2[3], yaw, unused;
+  flightTrajectory(t - h, p0, &unused);
+  flightTrajectory(t + h, p2, &unused);
+  flightTrajectory(t, p1, &yaw);
+
+  for (int i = 0; i < 3; i++) {
+    velocity[i] = (p2[i] - p0[i]) / (2.0 * h);
+    acceleration[i] = (p2[i] - 2.0 * p1[i] + p0[i]) / (h * h);
+  }
+
+  // The drag depends on the attitude, iterate from the attitude without drag
+  double drag[3] = {0};
+  const double dragCoeff = p1[2] > FLIGHT_GROUND_HEIGHT ? FLIGHT_DRAG : 0.0;
+  for (int iteration = 0; iteration < 4; iteration++) {
+    double zb[3] = {acceleration[0] - drag[0], acceleration[1] - drag[1], acceleration[2] + GRAVITY - drag[2]};
+    normalize(zb);
+    const double xc[3] = {cos(yaw), sin(yaw), 0.0};
+    double yb[3], xb[3];
+    cross(zb, xc, yb);
+    normalize(yb);
+    cross(yb, zb, xb);
+
+    for (int i = 0; i < 3; i++) {
+      R[i][0] = xb[i];
+      R[i][1] = yb[i];
+      R[i][2] = zb[i];
+    }
+
+    const double bodyDrag[2] = {
+      -dragCoeff * (R[0][0] * velocity[0] + R[1][0] * velocity[1] + R[2][0] * velocity[2]),
+      -dragCoeff * (R[0][1] * velocity[0] + R[1][1] * velocity[1] + R[2][1] * velocity[2]),
+    };
+    for (int i = 0; i < 3; i++) {
+      drag[i] = R[i][0] * bodyDrag[0] + R[i][1] * bodyDrag[1];
+    }
+  }
+}
+
+static bool generateFlight(const char* path) {
+  static const char* const names[] = {
+    "acc.x", "acc.y", "acc.z", "gyro.x", "gyro.y", "gyro.z", "mag.x", "mag.y", "mag.z",
+    "baro.asl", "stabilizer.thrust", "range.zrange", "ext_pos.X", "ext_pos.Y", "ext_pos.Z",
+    "stateEstimate.x", "stateEstimate.y", "stateEstimate.z", "stabilizer.roll", "stabilizer.pitch", "stabilizer.yaw",
+  };
+  static const char types[] = "ffffffffffHHfffffffff";
+  const int count = sizeof(names) / sizeof(names[0]);
+  const double magneticField[3] = {0.2, 0.0, -0.45}; // gauss, world frame
+
+  usdLog_t log;
+  if (!usdLogCreate(&log, path, names, types, count)) {
+    return false;
+  }
+
+  float values[sizeof(names) / sizeof(names[0])];
+  double zrange = 0.0;
+  double extPosition[3] = {0};
+
+  for (uint32_t tick = 0; tick <= FLIGHT_DURATION * 1000; tick += FLIGHT_LOG_PERIOD) {
+    const double t = tick / 1000.0;
+    double R[3][3], acceleration[3], velocity[3], position[3], yaw;
+    flightAttitude(t, R, acceleration, velocity);
+    flightTrajectory(t, position, &yaw);
+    const bool isFlying = position[2] > FLIGHT_GROUND_HEIGHT;
+
+    // Body rates from the change of attitude, W = R' * dR/dt
+    const double h = 1e-3;
+    double R0[3][3], R2[3][3], unused[3];
+    flightAttitude(t - h, R0, unused, unused);
+    flightAttitude(t + h, R2, unused, unused);
+    double W[3][3];
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+        W[i][j] = 0.0;
+        for (int k = 0; k < 3; k++) {
+          W[i][j] += R[k][i] * (R2[k][j] - R0[k][j]) / (2.0 * h);
+        }
+      }
+    }
+    const double rates[3] = {W[2][1], W[0][2], W[1][0]};
+
+    // Specific force in the body frame, the thrust and the rotor drag
+    const double force[3] = {acceleration[0], acceleration[1], acceleration[2] + GRAVITY};
+    double bodyForce[3], bodyField[3];
+    for (int i = 0; i < 3; i++) {
+      bodyForce[i] = R[0][i] * force[0] + R[1][i] * force[1] + R[2][i] * force[2];
+      bodyField[i] = R[0][i] * magneticField[0] + R[1][i] * magneticField[1] + R[2][i] * magneticField[2];
+    }
+    const double thrust = isFlying ? bodyForce[2] * FLIGHT_MASS * 65536.0 / (GRAVITY * 60.0) : 0.0;
+
+    if (tick % FLIGHT_ZRANGE_PERIOD == 0) {
+      zrange = fmax(0.0, position[2] / R[2][2] + noise(0.002));
+    }
+    if (tick % FLIGHT_EXT_POS_PERIOD == 0) {
+      for (int i = 0; i < 3; i++) {
+        extPosition[i] = position[i] + noise(0.002);
+      }
+    }
+
+    for (int i = 0; i < 3; i++) {
+      values[i] = (float)(bodyForce[i] / GRAVITY + noise(0.01));
+      values[3 + i] = (float)(rates[i] * RAD_TO_DEG + noise(0.1));
+      values[6 + i] = (float)(bodyField[i] + noise(0.005));
+      values[12 + i] = (float)extPosition[i];
+      values[15 + i] = (float)position[i];
+    }
+    values[9] = (float)(FLIGHT_ASL + position[2] + noise(0.2));
+    values[10] = (float)thrust;
+    values[11] = (float)(zrange * 1000.0);
+
+    // Legacy CF2 body coordinate system, as state_t
+    values[18] = (float)(atan2(R[2][1], R[2][2]) * RAD_TO_DEG);
+    values[19] = (float)(asin(R[2][0]) * RAD_TO_DEG);
+    values[20] = (float)(atan2(R[1][0], R[0][0]) * RAD_TO_DEG);
+
+    usdLogWrite(&log, FLIGHT_START_TICK + tick, values);
+  }
+
+  usdLogFinish(&log);
+  return true;
+}
+
+static float column(const float* values, int index) {
+  return index >= 0 ? values[index] : 0.0f;
+}
+
+static bool loadFlight(const char* path) {
+  usdLog_t log;
+  if (!usdLogOpen(&log, path)) {
+    fprintf(stderr, "Can not read the uSD log %s\n", path);
+    return false;
+  }
+
+  int acc[3], gyro[3], mag[3], extPosition[3], position[3], attitude[3];
+  static const char* const axes[] = {"x", "y", "z"};
+  static const char* const extAxes[] = {"X", "Y", "Z"};
+  static const char* const angles[] = {"roll", "pitch", "yaw"};
+  for (int i = 0; i < 3; i++) {
+    char name[USD_LOG_MAX_NAME_LENGTH];
+    snprintf(name, sizeof(name), "acc.%s", axes[i]);
+    acc[i] = usdLogFindColumn(&log, name);
+    snprintf(name, sizeof(name), "gyro.%s", axes[i]);
+    gyro[i] = usdLogFindColumn(&log, name);
+    snprintf(name, sizeof(name), "mag.%s", axes[i]);
+    mag[i] = usdLogFindColumn(&log, name);
+    snprintf(name, sizeof(name), "ext_pos.%s", extAxes[i]);
+    extPosition[i] = usdLogFindColumn(&log, name);
+    snprintf(name, sizeof(name), "stateEstimate.%s", axes[i]);
+    position[i] = usdLogFindColumn(&log, name);
+    snprintf(name, sizeof(name), "stabilizer.%s", angles[i]);
+    attitude[i] = usdLogFindColumn(&log, name);
+  }
+  const int asl = usdLogFindColumn(&log, "baro.asl");
+  const int thrust = usdLogFindColumn(&log, "stabilizer.thrust");
+  const int zrange = usdLogFindColumn(&log, "range.zrange");
+
+  if (acc[0] < 0 || acc[1] < 0 || acc[2] < 0 || gyro[0] < 0 || gyro[1] < 0 || gyro[2] < 0) {
+    fprintf(stderr, "The uSD log %s has no acc and gyro columns\n", path);
+    usdLogClose(&log);
+    return false;
+  }
+  hasReference = position[2] >= 0 && attitude[0] >= 0 && attitude[1] >= 0 && attitude[2] >= 0;
+
+  int capacity = 1024;
+  samples = malloc(capacity * sizeof(replaySample_t));
+  sampleCount = 0;
+
+  float values[USD_LOG_MAX_COLUMNS];
+  uint32_t tick;
+  while (usdLogNext(&log, &tick, values)) {
+    if (sampleCount == capacity) {
+      capacity *= 2;
+      samples = realloc(samples, capacity * sizeof(replaySample_t));
+    }
+
+    replaySample_t* sample = &samples[sampleCount];
+    const replaySample_t* previous = sampleCount > 0 ? &samples[sampleCount - 1] : NULL;
+    memset(sample, 0, sizeof(*sample));
+
+    sample->tick = tick;
+    for (int i = 0; i < 3; i++) {
+      sample->acc.axis[i] = column(values, acc[i]);
+      sample->gyro.axis[i] = column(values, gyro[i]);
+      sample->mag.axis[i] = column(values, mag[i]);
+    }
+    sample->asl = column(values, asl);
+    sample->thrust = (uint16_t)column(values, thrust);
+
+    // A new measurement is detected by a changed value
+    sample->zrange = column(values, zrange) / 1000.0f;
+    sample->isNewZrange = zrange >= 0 && (previous == NULL || sample->zrange != previous->zrange);
+    sample->extPosition.x = column(values, extPosition[0]);
+    sample->extPosition.y = column(values, extPosition[1]);
+    sample->extPosition.z = column(values, extPosition[2]);
+    sample->isNewExtPosition = extPosition[0] >= 0 && extPosition[1] >= 0 && extPosition[2] >= 0 &&
+      (previous == NULL || memcmp(&sample->extPosition, &previous->extPosition, sizeof(point_t)) != 0);
+
+    sample->position.x = column(values, position[0]);
+    sample->position.y = column(values, position[1]);
+    sample->position.z = column(values, position[2]);
+    sample->attitude.roll = column(values, attitude[0]);
+    sample->attitude.pitch = column(values, attitude[1]);
+    sample->attitude.yaw = column(values, attitude[2]);
+
+    // The logger may skip a sample, but never goes back in time
+    if (previous == NULL || tick > previous->tick) {
+      sampleCount++;
+    }
+  }
+
+  const uint32_t crcErrors = log.crcErrors;
+  usdLogClose(&log);
+
+  if (crcErrors > 0) {
+    fprintf(stderr, "The uSD log %s has %u crc errors\n", path, (unsigned)crcErrors);
+    return false;
+  }
+  if (sampleCount == 0) {
+    fprintf(stderr, "The uSD log %s has no samples\n", path);
+    return false;
+  }
+
+  return true;
+}
+
+static bool loadReference(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Can not read the reference %s\n", path);
+    return false;
+  }
+
+  int capacity = 256;
+  reference = malloc(capacity * sizeof(referenceEntry_t));
+  referenceCount = 0;
+
+  referenceEntry_t entry;
+  unsigned tick;
+  while (fscanf(file, "%31s %u %f %f %f %f %f %f", entry.scenario, &tick, &entry.values[0], &entry.values[1],
+                &entry.values[2], &entry.values[3], &entry.values[4], &entry.values[5]) == 8) {
+    if (referenceCount == capacity) {
+      capacity *= 2;
+      reference = realloc(reference, capacity * sizeof(referenceEntry_t));
+    }
+    entry.tick = tick;
+    reference[referenceCount++] = entry;
+  }
+
+  fclose(file);
+  return true;
+}
+
+static const referenceEntry_t* findReference(const char* scenario, uint32_t tick) {
+  for (int i = 0; i < referenceCount; i++) {
+    if (reference[i].tick == tick && strcmp(reference[i].scenario, scenario) == 0) {
+      return &reference[i];
+    }
+  }
+
+  return NULL;
+}
+
+static int paramSize(const struct param_s* param) {
+  return 1 << (param->type & PARAM_BYTES_MASK);
+}
+
+static void saveParamDefaults(void) {
+  const int count = &_param_stop - &_param_start;
+  paramDefaults = calloc(count, 8);
+  for (int i = 0; i < count; i++) {
+    const struct param_s* param = &(&_param_start)[i];
+    if (!(param->type & PARAM_GROUP)) {
+      memcpy(&paramDefaults[i * 8], param->address, paramSize(param));
+    }
+  }
+}
+
+static void restoreParamDefaults(void) {
+  const int count = &_param_stop - &_param_start;
+  for (int i = 0; i < count; i++) {
+    const struct param_s* param = &(&_param_start)[i];
+    if (!(param->type & PARAM_GROUP)) {
+      memcpy(param->address, &paramDefaults[i * 8], paramSize(param));
+    }
+  }
+}
+
+// Sets a parameter from a "group.name=value" string
+static bool setParam(const char* assignment) {
+  char group[32];
+  char name[32];
+  char value[32];
+  if (sscanf(assignment, "%31[^.].%31[^=]=%31s", group, name, value) != 3) {
+    return false;
+  }
+
+  const int count = &_param_stop - &_param_start;
+  bool isInGroup = false;
+  for (int i = 0; i < count; i++) {
+    const struct param_s* param = &(&_param_start)[i];
+    if (param->type & PARAM_GROUP) {
+      isInGroup = (param->type & PARAM_START) && strcmp(param->name, group) == 0;
+      continue;
+    }
+    if (!isInGroup || strcmp(param->name, name) != 0) {
+      continue;
+    }
+
+    if (param->type & PARAM_TYPE_FLOAT) {
+      const float floatValue = strtof(value, NULL);
+      memcpy(param->address, &floatValue, sizeof(floatValue));
+    } else {
+      // Little endian, the low bytes hold the value
+      const int64_t intValue = strtoll(value, NULL, 0);
+      memcpy(param->address, &intValue, paramSize(param));
+    }
+    return true;
+  }
+
+  return false;
+}
+
+static double nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static float angleDifference(float a, float b) {
+  float difference = fmodf(a - b, 360.0f);
+  if (difference > 180.0f) {
+    difference -= 360.0f;
+  } else if (difference < -180.0f) {
+    difference += 360.0f;
+  }
+  return difference;
+}
+
+static bool runScenario(const char* replayName, const replayScenario_t* scenario, bool isSynthetic, FILE* referenceOut) {
+  restoreParamDefaults();
+  for (int i = 0; i < REPLAY_MAX_PARAMS && scenario->params[i]; i++) {
+    if (!setParam(scenario->params[i])) {
+      fprintf(stderr, "%s: unknown parameter %s\n", scenario->name, scenario->params[i]);
+      return false;
+    }
+  }
+
+  for (int i = 0; i < queueCount; i++) {
+    queues[i].count = 0;
+  }
+
+  tickCount = samples[0].tick;
+  replayInit();
+
+  state_t state;
+  memset(&state, 0, sizeof(state));
+
+  double totalNs = 0.0;
+  double maxNs = 0.0;
+  double positionSquares = 0.0;
+  double heightSquares = 0.0;
+  double attitudeSquares = 0.0;
+  int errorCount = 0;
+  float referencePositionDiff = 0.0f;
+  float referenceAttitudeDiff = 0.0f;
+  bool isReferenceMissing = false;
+
+  const uint32_t firstTick = samples[0].tick;
+  const uint32_t lastTick = samples[sampleCount - 1].tick;
+  int next = 0;
+  for (uint32_t tick = firstTick; tick <= lastTick; tick++) {
+    tickCount = tick;
+
+    const bool isNewSample = samples[next].tick == tick;
+    if (isNewSample) {
+      currentSample = &samples[next];
+      isAccPending = true;
+      isGyroPending = true;
+      isMagPending = true;
+      isBaroPending = true;
+      next++;
+    }
+
+    const double start = nowNs();
+    replayStep(currentSample, isNewSample, &state, tick);
+    const double ns = nowNs() - start;
+    totalNs += ns;
+    if (ns > maxNs) {
+      maxNs = ns;
+    }
+
+    if (isNewSample && hasReference && tick - firstTick >= REPLAY_SETTLE_TICKS) {
+      const float dx = state.position.x - currentSample->position.x;
+      const float dy = state.position.y - currentSample->position.y;
+      const float dz = state.position.z - currentSample->position.z;
+      const float droll = angleDifference(state.attitude.roll, currentSample->attitude.roll);
+      const float dpitch = angleDifference(state.attitude.pitch, currentSample->attitude.pitch);
+      const float dyaw = angleDifference(state.attitude.yaw, currentSample->attitude.yaw);
+      positionSquares += dx * dx + dy * dy;
+      heightSquares += dz * dz;
+      attitudeSquares += (droll * droll + dpitch * dpitch + dyaw * dyaw) / 3.0f;
+      errorCount++;
+    }
+
+    if (isSynthetic && (tick - firstTick) % REPLAY_REFERENCE_PERIOD == 0) {
+      const float values[6] = {state.position.x, state.position.y, state.position.z,
+                               state.attitude.roll, state.attitude.pitch, state.attitude.yaw};
+      if (referenceOut) {
+        fprintf(referenceOut, "%s %u %.6f %.6f %.6f %.4f %.4f %.4f\n", scenario->name, (unsigned)tick,
+                values[0], values[1], values[2], values[3], values[4], values[5]);
+      }
+      if (reference) {
+        const referenceEntry_t* entry = findReference(scenario->name, tick);
+        if (entry == NULL) {
+          isReferenceMissing = true;
+        } else {
+          for (int i = 0; i < 3; i++) {
+            referencePositionDiff = fmaxf(referencePositionDiff, fabsf(values[i] - entry->values[i]));
+            referenceAttitudeDiff = fmaxf(referenceAttitudeDiff, fabsf(angleDifference(values[3 + i], entry->values[3 + i])));
+          }
+        }
+      }
+    }
+  }
+
+  const uint32_t ticks = lastTick - firstTick + 1;
+  const float positionRms = errorCount > 0 ? sqrt(positionSquares / errorCount) : 0.0f;
+  const float heightRms = errorCount > 0 ? sqrt(heightSquares / errorCount) : 0.0f;
+  const float attitudeRms = errorCount > 0 ? sqrt(attitudeSquares / errorCount) : 0.0f;
+
+  bool pass = true;
+  if (errorCount > 0) {
+    pass &= scenario->maxPositionRms <= 0.0f || positionRms <= scenario->maxPositionRms;
+    pass &= heightRms <= scenario->maxHeightRms;
+    pass &= attitudeRms <= scenario->maxAttitudeRms;
+  }
+  if (reference) {
+    pass &= !isReferenceMissing;
+    pass &= referencePositionDiff <= REPLAY_REFERENCE_POSITION_TOLERANCE;
+    pass &= referenceAttitudeDiff <= REPLAY_REFERENCE_ATTITUDE_TOLERANCE;
+  }
+
+  printf("{\"name\": \"%s.%s\", \"ticks\": %u, \"ns\": %.1f, \"maxNs\": %.1f, "
+         "\"positionRms\": %.4f, \"heightRms\": %.4f, \"attitudeRms\": %.3f, "
+         "\"referencePositionDiff\": %.6f, \"referenceAttitudeDiff\": %.4f, \"pass\": %s}\n",
+         replayName, scenario->name, (unsigned)ticks, totalNs / ticks, maxNs,
+         positionRms, heightRms, attitudeRms, referencePositionDiff, referenceAttitudeDiff,
+         pass ? "true" : "false");
+  if (isReferenceMissing) {
+    fprintf(stderr, "%s: no reference, write it with -write_reference\n", scenario->name);
+  }
+
+  return pass;
+}
+
+// Code under test reads SCB->ICSR to check for interrupt context, a zeroed
+// System Control Space reads as thread mode
+static bool mapSystemControlSpace(void) {
+  void* scs = mmap((void*)REPLAY_SCS_BASE, REPLAY_SCS_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  return scs == (void*)REPLAY_SCS_BASE;
+}
+
+// Usage: ReplayX [-log=FILE] [-synthetic=FILE] [-reference=FILE] [-write_reference=FILE]
+//
+// Replays the uSD log FILE, or generates the synthetic flight into the
+// -synthetic file (default replay-flight.bin) and replays it.
+int main(int argc, char** argv) {
+  const char* logPath = NULL;
+  const char* syntheticPath = "replay-flight.bin";
+  const char* referencePath = NULL;
+  const char* writeReferencePath = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "-log=", 5) == 0) {
+      logPath = argv[i] + 5;
+    } else if (strncmp(argv[i], "-synthetic=", 11) == 0) {
+      syntheticPath = argv[i] + 11;
+    } else if (strncmp(argv[i], "-reference=", 11) == 0) {
+      referencePath = argv[i] + 11;
+    } else if (strncmp(argv[i], "-write_reference=", 17) == 0) {
+      writeReferencePath = argv[i] + 17;
+    } else {
+      fprintf(stderr, "Unknown argument %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  if (!mapSystemControlSpace()) {
+    fprintf(stderr, "Can not map the System Control Space\n");
+    return 1;
+  }
+
+  const bool isSynthetic = (logPath == NULL);
+  if (isSynthetic) {
+    if (!generateFlight(syntheticPath)) {
+      fprintf(stderr, "Can not write %s\n", syntheticPath);
+      return 1;
+    }
+    logPath = syntheticPath;
+  }
+
+  if (!loadFlight(logPath)) {
+    return 1;
+  }
+  if (isSynthetic && referencePath && !writeReferencePath && !loadReference(referencePath)) {
+    return 1;
+  }
+
+  FILE* referenceOut = NULL;
+  if (isSynthetic && writeReferencePath) {
+    referenceOut = fopen(writeReferencePath, "w");
+    if (referenceOut == NULL) {
+      fprintf(stderr, "Can not write %s\n", writeReferencePath);
+      return 1;
+    }
+  }
+
+  const char* name = strrchr(argv[0], '/');
+  name = name ? name + 1 : argv[0];
+  char replayName[64];
+  snprintf(replayName, sizeof(replayName), "%.*s", (int)strcspn(name, "."), name);
+
+  saveParamDefaults();
+
+  bool pass = true;
+  for (int i = 0; i < replayScenarioCount; i++) {
+    pass &= runScenario(replayName, &replayScenarios[i], isSynthetic, referenceOut);
+  }
+
+  if (referenceOut) {
+    fclose(referenceOut);
+    printf("Reference written to %s\n", writeReferencePath);
+  }
+
+  return pass ? 0 : 1;
+}
+
+// Stubs for the sensors, fed from the log
+
+bool sensorsReadAcc(Axis3f* acc, uint64_t* timestamp) {
+  if (!isAccPending) {
+    return false;
+  }
+  *acc = currentSample->acc;
+  *timestamp = (uint64_t)currentSample->tick * 1000;
+  isAccPending = false;
+  return true;
+}
+
+bool sensorsReadGyro(Axis3f* gyro, uint64_t* timestamp) {
+  if (!isGyroPending) {
+    return false;
+  }
+  *gyro = currentSample->gyro;
+  *timestamp = (uint64_t)currentSample->tick * 1000;
+  isGyroPending = false;
+  return true;
+}
+
+bool sensorsReadMag(Axis3f* mag, uint64_t* timestamp) {
+  if (!isMagPending) {
+    return false;
+  }
+  *mag = currentSample->mag;
+  *timestamp = (uint64_t)currentSample->tick * 1000;
+  isMagPending = false;
+  return true;
+}
+
+bool sensorsReadBaro(baro_t* baro, uint64_t* timestamp) {
+  if (!isBaroPending) {
+    return false;
+  }
+  baro->asl = currentSample->asl;
+  *timestamp = (uint64_t)currentSample->tick * 1000;
+  isBaroPending = false;
+  return true;
+}
+
+void sensorsAcquire(sensorData_t* sensors, const uint32_t tick) {
+  sensorsReadGyro(&sensors->gyro, &sensors->gyroTimestamp);
+  sensorsReadAcc(&sensors->acc, &sensors->accTimestamp);
+  sensorsReadMag(&sensors->mag, &sensors->magTimestamp);
+  sensorsReadBaro(&sensors->baro, &sensors->baroTimestamp);
+
+  if (currentSample->tick == tick && currentSample->isNewZrange) {
+    sensors->zrange.distance = currentSample->zrange;
+    sensors->zrange.timestamp = tick;
+  }
+}
+
+// Stubs for the FreeRTOS functions used by the estimators
+
+void assertFail(char* exp, char* file, int line) {
+  fprintf(stderr, "Assert failed %s:%d (%s) at tick %u\n", file, line, exp, (unsigned)tickCount);
+  abort();
+}
+
+uint64_t usecTimestamp(void) {
+  return (uint64_t)tickCount * 1000;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return tickCount;
+}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType) {
+  if (queueCount == REPLAY_MAX_QUEUES) {
+    return NULL;
+  }
+
+  replayQueue_t* queue = &queues[queueCount++];
+  queue->itemSize = uxItemSize;
+  queue->length = uxQueueLength;
+  queue->count = 0;
+  queue->head = 0;
+  queue->items = malloc(uxQueueLength * uxItemSize);
+  return (QueueHandle_t)queue;
+}
+
+BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue) {
+  ((replayQueue_t*)xQueue)->count = 0;
+  return pdPASS;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition) {
+  replayQueue_t* queue = (replayQueue_t*)xQueue;
+  if (queue->count == queue->length) {
+    return errQUEUE_FULL;
+  }
+
+  const int index = (queue->head + queue->count) % queue->length;
+  memcpy(&queue->items[index * queue->itemSize], pvItemToQueue, queue->itemSize);
+  queue->count++;
+  return pdTRUE;
+}
+
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t xQueue, const void* const pvItemToQueue, BaseType_t* const pxHigherPriorityTaskWoken, const BaseType_t xCopyPosition) {
+  return xQueueGenericSend(xQueue, pvItemToQueue, 0, xCopyPosition);
+}
+
+BaseType_t xQueueGenericReceive(QueueHandle_t xQueue, void* const pvBuffer, TickType_t xTicksToWait, const BaseType_t xJustPeek) {
+  replayQueue_t* queue = (replayQueue_t*)xQueue;
+  if (queue->count == 0) {
+    return pdFALSE;
+  }
+
+  memcpy(pvBuffer, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+  if (!xJustPeek) {
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+  }
+  return pdTRUE;
+}
@@ -0,0 +1,69 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stabilizer_types.h"
+
+// Estimator replay support used by the Replay*.c files, run with 'rake replay'.
+//
+// A replay feeds a flight logged with the uSD card deck through an estimator,
+// tick by tick as the stabilizer loop does, and checks the estimate against
+// a reference. The sensors are read from these columns of the log:
+//   acc.x/y/z, gyro.x/y/z, mag.x/y/z, baro.asl, stabilizer.thrust,
+//   range.zrange and ext_pos.X/Y/Z
+// and the estimate is compared to stateEstimate.x/y/z and
+// stabilizer.roll/pitch/yaw, the estimate logged on board.
+//
+// Without a log file a synthetic flight is generated, written as a uSD log
+// and replayed. Its stateEstimate and stabilizer columns hold the true state,
+// so the estimation error is measured. For the synthetic flight the estimate
+// is also compared to a golden reference, so that a change that should be
+// numerically equivalent (a factorization, an optimization) can be verified.
+//
+// Each replay runs a number of scenarios, setting parameters before the
+// estimator is initialized. Per scenario one JSON object is printed with the
+// cost per estimator call and the errors. The replay fails if an error is
+// over the limit of the scenario or the estimate deviates from the reference.
+
+#define REPLAY_MAX_PARAMS 8
+
+typedef struct {
+  uint32_t tick;
+  Axis3f acc;       // Gs
+  Axis3f gyro;      // deg/s
+  Axis3f mag;       // gauss
+  float asl;        // m
+  uint16_t thrust;
+  float zrange;     // m
+  bool isNewZrange; // A new range measurement in this sample
+  point_t extPosition;
+  bool isNewExtPosition;
+
+  // Reference, attitude in the legacy CF2 body coordinate system as state_t
+  point_t position;
+  attitude_t attitude;
+} replaySample_t;
+
+typedef struct {
+  const char* name;
+  const char* params[REPLAY_MAX_PARAMS]; // "group.name=value"
+  float maxPositionRms; // m, 0 if the estimator does not estimate x and y
+  float maxHeightRms;   // m
+  float maxAttitudeRms; // deg
+} replayScenario_t;
+
+// Implemented by the replay
+extern const replayScenario_t replayScenarios[];
+extern const int replayScenarioCount;
+
+// Initializes the estimator, called for each scenario after the parameters
+// are set and with the tick count at the start of the flight
+void replayInit(void);
+
+// One stabilizer loop. sample is the latest sample of the log, isNewSample
+// is set in the tick it was logged. The sensor reads return the new sample.
+void replayStep(const replaySample_t* sample, bool isNewSample, state_t* state, const uint32_t tick);
+
+#endif // __REPLAY_H__
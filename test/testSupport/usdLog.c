@@ -0,0 +1,260 @@
+#include "usdLog.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc_bosch.h"
+
+static crc crcTable[256];
+static bool isCrcTableInit = false;
+
+// The crc as usddeck.c writes it
+static uint32_t blockCrc(const uint8_t* data, size_t size) {
+  if (!isCrcTableInit) {
+    crcTableInit(crcTable);
+    isCrcTableInit = true;
+  }
+
+  crc value = crcByByte(data, size, INITIAL_REMAINDER, 0, crcTable);
+  return (uint32_t)~(value ^ FINAL_XOR_VALUE);
+}
+
+static int typeSize(char type) {
+  switch (type) {
+    case 'B': case 'b': return 1;
+    case 'H': case 'h': return 2;
+    case 'I': case 'i': case 'f': return 4;
+    default: return 0;
+  }
+}
+
+static bool parseHeader(usdLog_t* log) {
+  if (log->size < 1) {
+    return false;
+  }
+
+  log->columnCount = log->data[0];
+  if (log->columnCount < 1 || log->columnCount > USD_LOG_MAX_COLUMNS) {
+    return false;
+  }
+
+  size_t i = 1;
+  log->sampleSize = 0;
+  for (int column = 0; column < log->columnCount; column++) {
+    const uint8_t* end = memchr(&log->data[i], ',', log->size - i);
+    if (end == NULL) {
+      return false;
+    }
+
+    // "group.name(T)"
+    const size_t length = end - &log->data[i];
+    if (length < 4 || length - 3 >= USD_LOG_MAX_NAME_LENGTH || log->data[i + length - 3] != '(') {
+      return false;
+    }
+    memcpy(log->names[column], &log->data[i], length - 3);
+    log->names[column][length - 3] = '\0';
+    log->types[column] = (char)log->data[i + length - 2];
+
+    const int size = typeSize(log->types[column]);
+    if (size == 0) {
+      return false;
+    }
+    log->sampleSize += size;
+    i += length + 1;
+  }
+
+  if (strcmp(log->names[0], "tick") != 0 || log->types[0] != 'I' || i + 4 > log->size) {
+    return false;
+  }
+
+  uint32_t storedCrc;
+  memcpy(&storedCrc, &log->data[i], 4);
+  if (storedCrc != blockCrc(log->data, i)) {
+    log->crcErrors++;
+  }
+
+  log->offset = i + 4;
+  log->samplesLeftInBlock = 0;
+  return true;
+}
+
+bool usdLogOpen(usdLog_t* log, const char* path) {
+  memset(log, 0, sizeof(*log));
+
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  const long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  log->data = malloc(size > 0 ? size : 1);
+  log->size = fread(log->data, 1, size > 0 ? size : 0, file);
+  fclose(file);
+
+  if (!parseHeader(log)) {
+    usdLogClose(log);
+    return false;
+  }
+
+  return true;
+}
+
+int usdLogFindColumn(const usdLog_t* log, const char* name) {
+  for (int i = 0; i < log->columnCount; i++) {
+    if (strcmp(log->names[i], name) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static bool startBlock(usdLog_t* log) {
+  if (log->offset + 1 > log->size) {
+    return false;
+  }
+
+  const int count = log->data[log->offset];
+  const size_t blockSize = 1 + (size_t)count * log->sampleSize;
+  if (count == 0 || log->offset + blockSize + 4 > log->size) {
+    return false;
+  }
+
+  uint32_t storedCrc;
+  memcpy(&storedCrc, &log->data[log->offset + blockSize], 4);
+  if (storedCrc != blockCrc(&log->data[log->offset], blockSize)) {
+    log->crcErrors++;
+    return false;
+  }
+
+  log->offset++;
+  log->samplesLeftInBlock = count;
+  return true;
+}
+
+bool usdLogNext(usdLog_t* log, uint32_t* tick, float* values) {
+  if (log->data == NULL) {
+    return false;
+  }
+
+  if (log->samplesLeftInBlock == 0 && !startBlock(log)) {
+    return false;
+  }
+
+  const uint8_t* sample = &log->data[log->offset];
+  for (int column = 0; column < log->columnCount; column++) {
+    float value = 0.0f;
+    switch (log->types[column]) {
+      case 'B': { uint8_t v; memcpy(&v, sample, 1); value = v; break; }
+      case 'b': { int8_t v; memcpy(&v, sample, 1); value = v; break; }
+      case 'H': { uint16_t v; memcpy(&v, sample, 2); value = v; break; }
+      case 'h': { int16_t v; memcpy(&v, sample, 2); value = v; break; }
+      case 'I': { uint32_t v; memcpy(&v, sample, 4); value = (float)v; if (column == 0) { *tick = v; } break; }
+      case 'i': { int32_t v; memcpy(&v, sample, 4); value = (float)v; break; }
+      case 'f': { memcpy(&value, sample, 4); break; }
+    }
+    values[column] = value;
+    sample += typeSize(log->types[column]);
+  }
+
+  log->offset += log->sampleSize;
+  log->samplesLeftInBlock--;
+  if (log->samplesLeftInBlock == 0) {
+    log->offset += 4; // Block crc
+  }
+
+  return true;
+}
+
+void usdLogClose(usdLog_t* log) {
+  free(log->data);
+  log->data = NULL;
+  log->size = 0;
+}
+
+bool usdLogCreate(usdLog_t* log, const char* path, const char* const* names, const char* types, int count) {
+  memset(log, 0, sizeof(*log));
+  if (count + 1 > USD_LOG_MAX_COLUMNS) {
+    return false;
+  }
+
+  log->file = fopen(path, "wb");
+  if (log->file == NULL) {
+    return false;
+  }
+
+  static uint8_t header[1 + USD_LOG_MAX_COLUMNS * (USD_LOG_MAX_NAME_LENGTH + 4)];
+  size_t size = 0;
+  header[size++] = (uint8_t)(count + 1);
+
+  log->columnCount = count + 1;
+  strcpy(log->names[0], "tick");
+  log->types[0] = 'I';
+  log->sampleSize = 4;
+  for (int i = 0; i < count; i++) {
+    strncpy(log->names[i + 1], names[i], USD_LOG_MAX_NAME_LENGTH - 1);
+    log->types[i + 1] = types[i];
+    log->sampleSize += typeSize(types[i]);
+  }
+
+  for (int i = 0; i < log->columnCount; i++) {
+    size += sprintf((char*)&header[size], "%s(%c),", log->names[i], log->types[i]);
+  }
+
+  const uint32_t headerCrc = blockCrc(header, size);
+  fwrite(header, 1, size, log->file);
+  fwrite(&headerCrc, 4, 1, log->file);
+  return true;
+}
+
+static void writeBlock(usdLog_t* log) {
+  if (log->blockSamples == 0) {
+    return;
+  }
+
+  log->block[0] = (uint8_t)log->blockSamples;
+  const uint32_t crcValue = blockCrc(log->block, log->blockSize);
+  fwrite(log->block, 1, log->blockSize, log->file);
+  fwrite(&crcValue, 4, 1, log->file);
+  log->blockSamples = 0;
+}
+
+void usdLogWrite(usdLog_t* log, uint32_t tick, const float* values) {
+  if (log->blockSamples == 0) {
+    log->blockSize = 1;
+  }
+
+  uint8_t* sample = &log->block[log->blockSize];
+  memcpy(sample, &tick, 4);
+  sample += 4;
+
+  for (int column = 1; column < log->columnCount; column++) {
+    const float value = values[column - 1];
+    switch (log->types[column]) {
+      case 'B': { uint8_t v = (uint8_t)lrintf(value); memcpy(sample, &v, 1); break; }
+      case 'b': { int8_t v = (int8_t)lrintf(value); memcpy(sample, &v, 1); break; }
+      case 'H': { uint16_t v = (uint16_t)lrintf(value); memcpy(sample, &v, 2); break; }
+      case 'h': { int16_t v = (int16_t)lrintf(value); memcpy(sample, &v, 2); break; }
+      case 'I': { uint32_t v = (uint32_t)llrintf(value); memcpy(sample, &v, 4); break; }
+      case 'i': { int32_t v = (int32_t)lrintf(value); memcpy(sample, &v, 4); break; }
+      case 'f': { memcpy(sample, &value, 4); break; }
+    }
+    sample += typeSize(log->types[column]);
+  }
+
+  log->blockSize += log->sampleSize;
+  log->blockSamples++;
+  if (log->blockSamples == USD_LOG_BLOCK_SAMPLES) {
+    writeBlock(log);
+  }
+}
+
+void usdLogFinish(usdLog_t* log) {
+  writeBlock(log);
+  fclose(log->file);
+  log->file = NULL;
+}
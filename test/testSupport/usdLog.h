@@ -0,0 +1,62 @@
+#ifndef __USD_LOG_H__
+#define __USD_LOG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Reads and writes the binary log files of the uSD card deck, as written by
+// usddeck.c and decoded by tools/usdlog/CF_functions.py.
+//
+// The file starts with a header: the number of columns (one byte), the
+// column names formatted as "group.name(T)," where T is the type character
+// (B, b, H, h, I, i or f) and a crc32. The first column is always
+// "tick(I)". The samples follow in blocks: the number of samples in the
+// block (one byte), the samples packed without padding and a crc32.
+
+#define USD_LOG_MAX_COLUMNS 40
+#define USD_LOG_MAX_NAME_LENGTH 32
+#define USD_LOG_BLOCK_SAMPLES 10
+
+typedef struct {
+  int columnCount; // Including the tick
+  char names[USD_LOG_MAX_COLUMNS][USD_LOG_MAX_NAME_LENGTH];
+  char types[USD_LOG_MAX_COLUMNS];
+  int sampleSize; // Bytes, including the tick
+
+  // Reading
+  uint8_t* data;
+  size_t size;
+  size_t offset;
+  int samplesLeftInBlock;
+  uint32_t crcErrors;
+
+  // Writing
+  FILE* file;
+  uint8_t block[1 + USD_LOG_BLOCK_SAMPLES * 4 * USD_LOG_MAX_COLUMNS];
+  int blockSamples;
+  size_t blockSize;
+} usdLog_t;
+
+// Reads a log file and its header. Returns false if the file can not be
+// read or the header is invalid.
+bool usdLogOpen(usdLog_t* log, const char* path);
+
+// Index of the column named "group.name", or -1
+int usdLogFindColumn(const usdLog_t* log, const char* name);
+
+// Decodes the next sample into values, one per column with the tick in
+// values[0]. Returns false at the end of the log, or at the first block that
+// is truncated or fails the crc check (counted in crcErrors).
+bool usdLogNext(usdLog_t* log, uint32_t* tick, float* values);
+
+void usdLogClose(usdLog_t* log);
+
+// Creates a log file with the columns in names/types, the tick column is
+// added first. usdLogWrite() takes one value per column in names, converted
+// to the column type.
+bool usdLogCreate(usdLog_t* log, const char* path, const char* const* names, const char* types, int count);
+void usdLogWrite(usdLog_t* log, uint32_t tick, const float* values);
+void usdLogFinish(usdLog_t* log);
+
+#endif // __USD_LOG_H__
@@ -0,0 +1,158 @@
+// File under test adaptiveNoise.c
+#include "adaptiveNoise.h"
+
+#include <math.h>
+#include "unity.h"
+
+static adaptiveNoise_t noise;
+
+// Deterministic standard normal samples (Box-Muller on a linear congruential generator)
+static uint32_t seed;
+static float uniform() {
+  seed = seed * 1664525 + 1013904223;
+  return ((seed >> 8) + 0.5f) / 16777216.0f;
+}
+static float gaussian() {
+  return sqrtf(-2.0f * logf(uniform())) * cosf(6.2831853f * uniform());
+}
+
+static float runRandomWalkFilter(float trueMeasStdDev, float nominalMeasStdDev, bool adaptive);
+
+void setUp(void) {
+  seed = 4711;
+  adaptiveNoiseInit(&noise, 0.01f, 0.1f, 100.0f);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatScaleIsOneAfterInit() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, noise.scale);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, adaptiveNoiseGetVariance(&noise, 2.0f));
+}
+
+void testThatEstimateConvergesToTheActualNoise() {
+  // Fixture
+  const float nominalVariance = 0.01f;
+  const float actualStdDev = 0.3f;
+  const float hph = 0.001f;
+
+  // Test
+  for (int i = 0; i < 5000; i++) {
+    // Innovation variance is HPH' + R
+    float innovation = sqrtf(hph + actualStdDev * actualStdDev) * gaussian();
+    adaptiveNoiseUpdate(&noise, innovation, hph, nominalVariance);
+  }
+
+  // Assert
+  float expected = actualStdDev * actualStdDev / nominalVariance;
+  TEST_ASSERT_FLOAT_WITHIN(expected * 0.25f, expected, noise.scale);
+}
+
+void testThatOneOutlierHasBoundedInfluence() {
+  // Fixture
+  const float nominalVariance = 1.0f;
+
+  // Test
+  adaptiveNoiseUpdate(&noise, 1000.0f, 0.0f, nominalVariance);
+
+  // Assert
+  // At most the gate (9 times the expected innovation variance) weighted by the rate
+  TEST_ASSERT_LESS_OR_EQUAL(1.0f + 0.01f * 9.0f, noise.scale);
+}
+
+void testThatScaleIsBoundedBelow() {
+  // Fixture
+  const float nominalVariance = 1.0f;
+
+  // Test
+  for (int i = 0; i < 5000; i++) {
+    adaptiveNoiseUpdate(&noise, 0.0f, 1.0f, nominalVariance);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.1f, noise.scale);
+}
+
+void testThatScaleIsBoundedAbove() {
+  // Fixture
+  const float nominalVariance = 1.0f;
+
+  // Test
+  for (int i = 0; i < 50000; i++) {
+    adaptiveNoiseUpdate(&noise, 1000.0f, 0.0f, nominalVariance);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(100.0f, noise.scale);
+}
+
+void testThatInvalidNominalVarianceIsIgnored() {
+  // Fixture
+  // Test
+  adaptiveNoiseUpdate(&noise, 10.0f, 0.0f, 0.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, noise.scale);
+}
+
+void testThatAdaptiveNoiseReducesErrorOfMistunedFilter() {
+  // Fixture
+  // The sensor is five times noisier than reported
+  const float trueStdDev = 0.5f;
+  const float nominalStdDev = 0.1f;
+
+  // Test
+  float rmsFixed = runRandomWalkFilter(trueStdDev, nominalStdDev, false);
+  float rmsAdaptive = runRandomWalkFilter(trueStdDev, nominalStdDev, true);
+  float rmsIdeal = runRandomWalkFilter(trueStdDev, trueStdDev, false);
+
+  // Assert
+  TEST_ASSERT_LESS_THAN(rmsFixed * 0.85f, rmsAdaptive);
+  TEST_ASSERT_FLOAT_WITHIN(rmsIdeal * 0.1f, rmsIdeal, rmsAdaptive);
+}
+
+/**
+ * Scalar Kalman filter tracking a random walk, returns the RMS estimation error
+ */
+static float runRandomWalkFilter(float trueMeasStdDev, float nominalMeasStdDev, bool adaptive) {
+  const float processStdDev = 0.05f;
+  const int warmup = 2000;
+  const int count = 20000;
+
+  seed = 4711;
+  adaptiveNoiseInit(&noise, 0.01f, 0.1f, 100.0f);
+
+  float x = 0.0f;
+  float estimate = 0.0f;
+  float p = 1.0f;
+  float errorSqSum = 0.0f;
+
+  for (int i = 0; i < warmup + count; i++) {
+    x += processStdDev * gaussian();
+    p += processStdDev * processStdDev;
+
+    const float z = x + trueMeasStdDev * gaussian();
+    const float nominalVariance = nominalMeasStdDev * nominalMeasStdDev;
+    const float r = adaptive ? adaptiveNoiseGetVariance(&noise, nominalVariance) : nominalVariance;
+    const float innovation = z - estimate;
+
+    if (adaptive) {
+      adaptiveNoiseUpdate(&noise, innovation, p, nominalVariance);
+    }
+
+    const float k = p / (p + r);
+    estimate += k * innovation;
+    p = (1.0f - k) * p;
+
+    if (i >= warmup) {
+      errorSqSum += (x - estimate) * (x - estimate);
+    }
+  }
+
+  return sqrtf(errorSqSum / count);
+}
@@ -0,0 +1,236 @@
+// File under test baroConvert.c
+#include "baroConvert.h"
+
+#include <math.h>
+
+#include "unity.h"
+
+// Calibration register block of a BMP388
+static const uint8_t calibRegs[BMP388_CALIB_LEN] =
+{
+  0x71, 0x6B, // T1 27505
+  0xA3, 0x4A, // T2 19107
+  0xF9,       // T3 -7
+  0xD1, 0xFA, // P1 -1327
+  0xD3, 0xF3, // P2 -3117
+  0x23,       // P3 35
+  0x01,       // P4 1
+  0xC0, 0x62, // P5 25280
+  0x08, 0x76, // P6 30216
+  0x04,       // P7 4
+  0xFB,       // P8 -5
+  0xFA, 0x3F, // P9 16378
+  0x0A,       // P10 10
+  0xC4,       // P11 -60
+};
+
+static bmp388Calib_t calib;
+
+static int64_t referenceTemperature(uint32_t rawTemperature, int64_t* tLin);
+static uint64_t referencePressure(uint32_t rawPressure, int64_t tLin);
+static float referenceFloatTemperature(uint32_t rawTemperature);
+static float referenceFloatPressure(uint32_t rawPressure, float tLin);
+
+void setUp(void) {
+  bmp388CalibInit(&calib, calibRegs);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatCalibrationRegistersAreParsed() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(27505, calib.parT1);
+  TEST_ASSERT_EQUAL_INT8(-7, calib.parT3);
+  TEST_ASSERT_EQUAL_INT16(-1327, calib.parP1);
+  TEST_ASSERT_EQUAL_UINT16(30216, calib.parP6);
+  TEST_ASSERT_EQUAL_INT16(16378, calib.parP9);
+  TEST_ASSERT_EQUAL_INT8(-60, calib.parP11);
+}
+
+void testThatTemperatureMatchesIntegerReference() {
+  // Fixture
+  for (uint32_t raw = 6500000; raw < 9500000; raw += 12345) {
+    int64_t tLin;
+    int64_t expected = referenceTemperature(raw, &tLin);
+
+    // Test
+    int32_t actual = bmp388SetTemperature(&calib, raw);
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT32(expected, actual);
+  }
+}
+
+void testThatPressureMatchesIntegerReference() {
+  // Fixture
+  for (uint32_t rawTemp = 6500000; rawTemp < 9500000; rawTemp += 250000) {
+    int64_t tLin;
+    referenceTemperature(rawTemp, &tLin);
+    bmp388SetTemperature(&calib, rawTemp);
+
+    // The reference overflows above raw pressures of about 8.4e6
+    for (uint32_t rawPress = 4000000; rawPress < 8200000; rawPress += 7919) {
+      uint64_t expected = referencePressure(rawPress, tLin);
+
+      // Test
+      uint32_t actual = bmp388CompensatePressure(&calib, rawPress);
+
+      // Assert
+      TEST_ASSERT_EQUAL_UINT32((uint32_t)expected, actual);
+    }
+  }
+}
+
+void testThatCompensationIsCloseToFloatReference() {
+  // Fixture
+  for (uint32_t rawTemp = 6500000; rawTemp < 9500000; rawTemp += 250000) {
+    float tLin = referenceFloatTemperature(rawTemp);
+    int32_t temperature = bmp388SetTemperature(&calib, rawTemp);
+
+    // Assert
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, tLin, temperature / 100.0f);
+
+    for (uint32_t rawPress = 4000000; rawPress < 8500000; rawPress += 100003) {
+      float expected = referenceFloatPressure(rawPress, tLin);
+
+      // Test
+      float actual = bmp388CompensatePressure(&calib, rawPress) / 100.0f;
+
+      // Assert
+      // Single precision has a resolution of about 0.01 Pa at 1000 mbar
+      TEST_ASSERT_FLOAT_WITHIN(0.1f, expected, actual);
+    }
+  }
+}
+
+void testThatNominalReadingIsAtSeaLevelPressure() {
+  // Fixture
+  int32_t temperature = bmp388SetTemperature(&calib, 8500000);
+
+  // Test
+  uint32_t pressure = bmp388CompensatePressure(&calib, 6000000);
+
+  // Assert
+  TEST_ASSERT_INT_WITHIN(100, 2590, temperature);
+  TEST_ASSERT_UINT32_WITHIN(10000, 10930000, pressure);
+}
+
+void testThatAltitudeMatchesFormulaInFlightRange() {
+  // Fixture
+  for (float pressure = 700.0f; pressure <= 1080.0f; pressure += 0.37f) {
+    float expected = ((powf((1015.7f / pressure), 0.1902630958f) - 1.0f) * (25.0f + 273.15f)) / 0.0065f;
+
+    // Test
+    float actual = baroPressureToAltitude(pressure);
+
+    // Assert
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, expected, actual);
+  }
+}
+
+void testThatAltitudeMatchesFormulaInWholeTable() {
+  // Fixture
+  for (float pressure = BARO_ALT_TABLE_MIN_MBAR; pressure <= BARO_ALT_TABLE_MAX_MBAR; pressure += 1.3f) {
+    float expected = ((powf((1015.7f / pressure), 0.1902630958f) - 1.0f) * (25.0f + 273.15f)) / 0.0065f;
+
+    // Test
+    float actual = baroPressureToAltitude(pressure);
+
+    // Assert
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, expected, actual);
+  }
+}
+
+void testThatAltitudeIsExactAtTablePoints() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 136.1549f, baroPressureToAltitude(1000.0f));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, baroPressureToAltitude(300.0f) - 11979.4157f);
+}
+
+void testThatAltitudeIsZeroAtReferencePressure() {
+  // Fixture
+  // Test
+  float actual = baroPressureToAltitude(1015.7f);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, actual);
+}
+
+void testThatAltitudeIsExtrapolatedOutsideTable() {
+  // Fixture
+  float slope = baroPressureToAltitude(1100.0f) - baroPressureToAltitude(1099.0f);
+
+  // Test
+  float actual = baroPressureToAltitude(1110.0f);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, baroPressureToAltitude(1100.0f) + 10.0f * slope, actual);
+  TEST_ASSERT_TRUE(baroPressureToAltitude(250.0f) > baroPressureToAltitude(300.0f));
+}
+
+// Reference implementations, the integer and floating point compensation of the
+// Bosch BMP3 driver (with signed temperature difference)
+
+static int64_t referenceTemperature(uint32_t rawTemperature, int64_t* tLin) {
+  int64_t partial_data1 = (int64_t)rawTemperature - (256 * (int64_t)27505);
+  int64_t partial_data2 = 19107 * partial_data1;
+  int64_t partial_data3 = partial_data1 * partial_data1;
+  int64_t partial_data4 = partial_data3 * -7;
+  int64_t partial_data5 = (partial_data2 * 262144) + partial_data4;
+  int64_t partial_data6 = partial_data5 / 4294967296;
+  *tLin = partial_data6;
+  return (partial_data6 * 25) / 16384;
+}
+
+static uint64_t referencePressure(uint32_t rawPressure, int64_t t_lin) {
+  const int64_t par_p1 = -1327, par_p2 = -3117, par_p3 = 35, par_p4 = 1, par_p5 = 25280,
+                par_p6 = 30216, par_p7 = 4, par_p8 = -5, par_p9 = 16378, par_p10 = 10, par_p11 = -60;
+  int64_t partial_data1, partial_data2, partial_data3, partial_data4, partial_data5, partial_data6;
+  int64_t offset, sensitivity;
+
+  partial_data1 = t_lin * t_lin;
+  partial_data2 = partial_data1 / 64;
+  partial_data3 = (partial_data2 * t_lin) / 256;
+  partial_data4 = (par_p8 * partial_data3) / 32;
+  partial_data5 = (par_p7 * partial_data1) * 16;
+  partial_data6 = (par_p6 * t_lin) * 4194304;
+  offset = (par_p5 * 140737488355328) + partial_data4 + partial_data5 + partial_data6;
+
+  partial_data2 = (par_p4 * partial_data3) / 32;
+  partial_data4 = (par_p3 * partial_data1) * 4;
+  partial_data5 = (par_p2 - 16384) * t_lin * 2097152;
+  sensitivity = ((par_p1 - 16384) * 70368744177664) + partial_data2 + partial_data4 + partial_data5;
+
+  partial_data1 = (sensitivity / 16777216) * rawPressure;
+  partial_data2 = par_p10 * t_lin;
+  partial_data3 = partial_data2 + (65536 * par_p9);
+  partial_data4 = (partial_data3 * rawPressure) / 8192;
+  partial_data5 = (partial_data4 * rawPressure) / 512;
+  partial_data6 = (int64_t)((uint64_t)rawPressure * (uint64_t)rawPressure);
+  partial_data2 = (par_p11 * partial_data6) / 65536;
+  partial_data3 = (partial_data2 * rawPressure) / 128;
+  partial_data4 = (offset / 4) + partial_data1 + partial_data5 + partial_data3;
+  return ((uint64_t)partial_data4 * 25) / (uint64_t)1099511627776;
+}
+
+static float referenceFloatTemperature(uint32_t rawTemperature) {
+  double partial_data1 = (double)rawTemperature - 27505 / 0.00390625;
+  return (float)(partial_data1 * (19107 / 1073741824.0) + partial_data1 * partial_data1 * (-7 / 281474976710656.0));
+}
+
+static float referenceFloatPressure(uint32_t rawPressure, float tLin) {
+  const double t = tLin;
+  const double p = rawPressure;
+  double out1 = 25280 / 0.125 + 30216 / 64.0 * t + 4 / 256.0 * t * t + -5 / 32768.0 * t * t * t;
+  double out2 = p * ((-1327 - 16384) / 1048576.0 + (-3117 - 16384) / 536870912.0 * t
+                     + 35 / 4294967296.0 * t * t + 1 / 137438953472.0 * t * t * t);
+  double out3 = p * p * (16378 / 281474976710656.0 + 10 / 281474976710656.0 * t)
+                + p * p * p * (-60 / 36893488147419103232.0);
+  return (float)(out1 + out2 + out3);
+}
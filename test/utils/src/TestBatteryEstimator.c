@@ -0,0 +1,170 @@
+// File under test batteryEstimator.c
+#include "batteryEstimator.h"
+
+#include <math.h>
+
+#include "unity.h"
+
+#define DT 0.1f
+#define CAPACITY 0.25f
+
+static batteryEstimator_t be;
+
+// Simulated battery
+typedef struct {
+  float soc;
+  float v1;
+  float r0;
+} battery_t;
+
+static battery_t battery;
+
+static float simulate(float current, float seconds, float currentFactor, bool isCurrentMeasured);
+
+void setUp(void) {
+  batteryEstimatorInit(&be, CAPACITY, 0.15f, 2.0f);
+  battery = (battery_t){.soc = 0.9f, .v1 = 0.0f, .r0 = 0.2f};
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatOcvAndSocAreInverse() {
+  // Fixture
+  for (float soc = 0.0f; soc <= 1.0f; soc += 0.013f) {
+    // Test
+    float actual = batterySocFromOcv(batteryOcvFromSoc(soc));
+
+    // Assert
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, soc, actual);
+  }
+}
+
+void testThatOcvIsLimitedOutsideTable() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, batterySocFromOcv(2.5f));
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, batterySocFromOcv(4.35f));
+  TEST_ASSERT_EQUAL_FLOAT(4.2f, batteryOcvFromSoc(1.2f));
+}
+
+void testThatMotorCurrentGrowsWithRatio() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.1f, batteryMotorCurrent(0.0f, 0.1f, 8.0f));
+  TEST_ASSERT_EQUAL_FLOAT(8.1f, batteryMotorCurrent(1.0f, 0.1f, 8.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.1f + 8.0f * 0.125f, batteryMotorCurrent(0.25f, 0.1f, 8.0f));
+  TEST_ASSERT_EQUAL_FLOAT(8.1f, batteryMotorCurrent(1.5f, 0.1f, 8.0f));
+}
+
+void testThatStateIsTakenFromFirstVoltage() {
+  // Fixture
+  // Test
+  batteryEstimatorUpdate(&be, batteryOcvFromSoc(0.65f), 0.0f, true, false, DT);
+
+  // Assert
+  TEST_ASSERT_TRUE(be.isInit);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.65f, be.soc);
+}
+
+void testThatVoltageSagDoesNotLowerStateOfCharge() {
+  // Fixture
+  simulate(0.1f, 10.0f, 1.0f, true);
+  simulate(2.5f, 60.0f, 1.0f, true);
+
+  // Test
+  float voltage = simulate(7.0f, 5.0f, 1.0f, true);
+
+  // Assert
+  // The loaded voltage alone is far off
+  TEST_ASSERT_TRUE(fabsf(batterySocFromOcv(voltage) - battery.soc) > 0.2f);
+  TEST_ASSERT_FLOAT_WITHIN(0.03f, battery.soc, be.soc);
+}
+
+void testThatStateOfChargeIsTrackedWithBiasedCurrentModel() {
+  // Fixture
+  simulate(0.1f, 10.0f, 1.0f, false);
+
+  // Test
+  // The model under estimates the current by 20 %
+  for (int i = 0; i < 10; i++) {
+    simulate(2.5f, 25.0f, 0.8f, false);
+    simulate(4.0f, 2.0f, 0.8f, false);
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(battery.soc < 0.25f);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, battery.soc, be.soc);
+}
+
+void testThatSeriesResistanceIsLearned() {
+  // Fixture
+  simulate(0.1f, 10.0f, 1.0f, true);
+
+  // Test
+  for (int i = 0; i < 20; i++) {
+    simulate(1.5f, 3.0f, 1.0f, true);
+    simulate(4.0f, 3.0f, 1.0f, true);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, battery.r0, be.r0);
+}
+
+void testThatFlightCurrentIsAveragedWhileFlying() {
+  // Fixture
+  simulate(0.1f, 10.0f, 1.0f, true);
+
+  // Test
+  simulate(3.0f, 150.0f, 1.0f, true);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 3.0f, be.flightCurrent);
+}
+
+void testThatFlightTimeIsRemainingChargeOverFlightCurrent() {
+  // Fixture
+  be.soc = 0.5f;
+  be.flightCurrent = 2.0f;
+
+  // Test
+  float actual = batteryEstimatorGetFlightTime(&be, 0.1f);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.4f * CAPACITY * 3600.0f / 2.0f, actual);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, batteryEstimatorGetFlightTime(&be, 0.6f));
+}
+
+void testThatResetRestartsFromNextVoltage() {
+  // Fixture
+  simulate(0.1f, 10.0f, 1.0f, true);
+  batteryEstimatorReset(&be);
+
+  // Test
+  batteryEstimatorUpdate(&be, batteryOcvFromSoc(1.0f), 0.0f, true, false, DT);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 1.0f, be.soc);
+}
+
+// Run the simulated battery and the estimator, the estimator sees the current times currentFactor.
+// Returns the last terminal voltage.
+static float simulate(float current, float seconds, float currentFactor, bool isCurrentMeasured) {
+  const float r1 = 0.05f;
+  const float c1 = 600.0f;
+  const float a = expf(-DT / (r1 * c1));
+  float voltage = 0.0f;
+
+  for (int i = 0; i < (int)(seconds / DT + 0.5f); i++) {
+    battery.soc -= current * DT / (3600.0f * CAPACITY);
+    battery.v1 = a * battery.v1 + r1 * (1.0f - a) * current;
+    voltage = batteryOcvFromSoc(battery.soc) - battery.v1 - battery.r0 * current;
+
+    batteryEstimatorUpdate(&be, voltage, current * currentFactor, isCurrentMeasured, current > 1.0f, DT);
+  }
+
+  return voltage;
+}
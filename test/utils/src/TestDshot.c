@@ -0,0 +1,187 @@
+// File under test dshot.c
+#include "dshot.h"
+
+#include "unity.h"
+
+#define BIT_PERIOD 140
+
+static const uint8_t gcrEncode[16] =
+{
+  0x19, 0x1B, 0x12, 0x13, 0x1D, 0x15, 0x16, 0x17,
+  0x1A, 0x09, 0x0A, 0x0B, 0x1E, 0x0D, 0x0E, 0x0F
+};
+
+static uint32_t escTelemetryAnswer(uint16_t eperiod);
+
+void setUp(void) {
+  // Empty
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatZeroRatioStopsTheMotor() {
+  // Fixture
+  // Test
+  uint16_t actual = dshotThrottleFromRatio(0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(0, actual);
+}
+
+void testThatRatioIsScaledToTheThrottleRange() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16(DSHOT_THROTTLE_MIN, dshotThrottleFromRatio(1));
+  TEST_ASSERT_EQUAL_UINT16(DSHOT_THROTTLE_MAX, dshotThrottleFromRatio(UINT16_MAX));
+  TEST_ASSERT_UINT16_WITHIN(1, 1047, dshotThrottleFromRatio(UINT16_MAX / 2));
+}
+
+void testThatFrameContainsValueTelemetryBitAndChecksum() {
+  // Fixture
+  // 1046 = 0b10000010110, packet with telemetry bit 0b100000101101
+  // checksum 0b1000 ^ 0b0010 ^ 0b1101 = 0b0111
+  uint16_t expected = 0x82D7;
+
+  // Test
+  uint16_t actual = dshotEncodeFrame(1046, true, false);
+
+  // Assert
+  TEST_ASSERT_EQUAL_HEX16(expected, actual);
+}
+
+void testThatStopFrameHasZeroChecksum() {
+  // Fixture
+  // Test
+  uint16_t actual = dshotEncodeFrame(0, false, false);
+
+  // Assert
+  TEST_ASSERT_EQUAL_HEX16(0x0000, actual);
+}
+
+void testThatBidirectionalFrameHasInvertedChecksum() {
+  // Fixture
+  uint16_t normal = dshotEncodeFrame(1046, false, false);
+
+  // Test
+  uint16_t actual = dshotEncodeFrame(1046, false, true);
+
+  // Assert
+  TEST_ASSERT_EQUAL_HEX16(normal & 0xFFF0, actual & 0xFFF0);
+  TEST_ASSERT_EQUAL_HEX16(~normal & 0x000F, actual & 0x000F);
+}
+
+void testThatValueIsTruncatedTo11Bits() {
+  // Fixture
+  // Test
+  uint16_t actual = dshotEncodeFrame(0x0800 | 100, false, false);
+
+  // Assert
+  TEST_ASSERT_EQUAL_HEX16(dshotEncodeFrame(100, false, false), actual);
+}
+
+void testThatBitPeriodMatchesSpeed() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(140, dshotBitPeriod(84000000, DSHOT600));
+  TEST_ASSERT_EQUAL_UINT32(280, dshotBitPeriod(84000000, DSHOT300));
+  TEST_ASSERT_EQUAL_UINT32(560, dshotBitPeriod(84000000, DSHOT150));
+}
+
+void testThatFrameIsExpandedMsbFirstWithStride() {
+  // Fixture
+  uint32_t buffer[DSHOT_FRAME_BITS * 4] = {0};
+  uint16_t frame = 0x82D7;
+
+  // Test
+  dshotFrameToCompare(frame, BIT_PERIOD, &buffer[2], 4);
+
+  // Assert
+  for (int i = 0; i < DSHOT_FRAME_BITS; i++) {
+    uint32_t expected = (frame & (0x8000 >> i)) ? 105 : 52;
+    TEST_ASSERT_EQUAL_UINT32(expected, buffer[i * 4 + 2]);
+    TEST_ASSERT_EQUAL_UINT32(0, buffer[i * 4]);
+    TEST_ASSERT_EQUAL_UINT32(0, buffer[i * 4 + 1]);
+    TEST_ASSERT_EQUAL_UINT32(0, buffer[i * 4 + 3]);
+  }
+}
+
+void testThatTelemetryAnswerIsDecoded() {
+  // Fixture
+  // exponent 2, mantissa 300 -> 1200 us
+  uint32_t raw = escTelemetryAnswer((2 << 9) | 300);
+  uint32_t actual = 0;
+
+  // Test
+  bool valid = dshotDecodeTelemetry(raw, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(valid);
+  TEST_ASSERT_EQUAL_UINT32(1200, actual);
+}
+
+void testThatStoppedMotorIsDecodedAsZeroPeriod() {
+  // Fixture
+  uint32_t raw = escTelemetryAnswer(0x0FFF);
+  uint32_t actual = 1;
+
+  // Test
+  bool valid = dshotDecodeTelemetry(raw, &actual);
+
+  // Assert
+  TEST_ASSERT_TRUE(valid);
+  TEST_ASSERT_EQUAL_UINT32(DSHOT_TELEMETRY_STOPPED, actual);
+}
+
+void testThatCorruptedTelemetryIsRejected() {
+  // Fixture
+  uint32_t raw = escTelemetryAnswer((2 << 9) | 300);
+  uint32_t period = 0;
+  int accepted = 0;
+
+  // Test
+  for (int bit = 0; bit < DSHOT_TELEMETRY_BITS - 1; bit++) {
+    if (dshotDecodeTelemetry(raw ^ (1 << bit), &period)) {
+      accepted++;
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, accepted);
+}
+
+void testThatPeriodIsConvertedToRpm() {
+  // Fixture
+  // 1200 us -> 50000 eRPM, 14 poles -> 7 pole pairs
+  // Test
+  uint32_t actual = dshotPeriodToRpm(1200, 14);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(7142, actual);
+  TEST_ASSERT_EQUAL_UINT32(0, dshotPeriodToRpm(DSHOT_TELEMETRY_STOPPED, 14));
+}
+
+// Encode a 12 bit eRPM period the way the ESC puts it on the wire
+static uint32_t escTelemetryAnswer(uint16_t eperiod) {
+  uint16_t csum = ~(eperiod ^ (eperiod >> 4) ^ (eperiod >> 8)) & 0x0F;
+  uint16_t value = (eperiod << 4) | csum;
+
+  uint32_t gcr = 0;
+  for (int i = 0; i < 4; i++) {
+    gcr = (gcr << 5) | gcrEncode[(value >> (12 - 4 * i)) & 0x0F];
+  }
+
+  // A one in the GCR code is a level change on the wire
+  uint32_t raw = 0;
+  uint32_t level = 1;
+  raw |= level << 20;
+  for (int bit = 19; bit >= 0; bit--) {
+    level ^= (gcr >> bit) & 1;
+    raw |= level << bit;
+  }
+
+  return raw;
+}
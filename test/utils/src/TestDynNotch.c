@@ -0,0 +1,233 @@
+// File under test dynNotch.c
+#include "dynNotch.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+#include "filter.h"
+
+#define SAMPLE_FREQ 1000.0f
+#define TWO_PI_F 6.28318531f
+
+static dynNotch_t dn;
+
+// Deterministic noise in [-1, 1)
+static uint32_t seed;
+static float noise() {
+  seed = seed * 1664525 + 1013904223;
+  return ((float)(seed >> 8) / 8388608.0f) - 1.0f;
+}
+
+static float runTone(int axis, int samples, float freq1, float amp1, float freq2, float amp2, float* rmsOut);
+
+void setUp(void) {
+  seed = 17;
+  dynNotchInit(&dn, SAMPLE_FREQ, 80.0f, 450.0f, 3.0f, 3, 0.1f);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatNoNotchIsActiveAfterInit() {
+  // Fixture
+  // Test
+  // Assert
+  for (int axis = 0; axis < 3; axis++) {
+    for (int i = 0; i < DYN_NOTCH_MAX_NOTCHES; i++) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, dn.centerFreq[axis][i]);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT8(dynNotchSourceNone, dn.source);
+}
+
+void testThatNotchIsPlacedOnAVibrationPeak() {
+  // Fixture
+  // Test
+  runTone(0, 1000, 210.0f, 1.0f, 0.0f, 0.0f, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(dynNotchSourceSpectrum, dn.source);
+  TEST_ASSERT_FLOAT_WITHIN(4.0f, 210.0f, dn.centerFreq[0][0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, dn.centerFreq[1][0]);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, dn.centerFreq[2][0]);
+}
+
+void testThatVibrationIsAttenuated() {
+  // Fixture
+  float inputRms = 1.0f / sqrtf(2.0f);
+  runTone(1, 1000, 210.0f, 1.0f, 0.0f, 0.0f, 0);
+
+  // Test
+  float outputRms;
+  runTone(1, 500, 210.0f, 1.0f, 0.0f, 0.0f, &outputRms);
+
+  // Assert
+  TEST_ASSERT_LESS_THAN(0.1f * inputRms, outputRms);
+}
+
+void testThatLowFrequencyMotionPassesThrough() {
+  // Fixture
+  runTone(2, 1000, 210.0f, 1.0f, 0.0f, 0.0f, 0);
+
+  // Test
+  // A 10 Hz attitude change, the vibration stays
+  float outputRms;
+  runTone(2, 1000, 210.0f, 1.0f, 10.0f, 1.0f, &outputRms);
+
+  // Assert
+  float notchedRms;
+  runTone(2, 1000, 210.0f, 1.0f, 0.0f, 0.0f, &notchedRms);
+  float motionRms = sqrtf(outputRms * outputRms - notchedRms * notchedRms);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.0f / sqrtf(2.0f), motionRms);
+}
+
+void testThatTwoPeaksGetOneNotchEach() {
+  // Fixture
+  // Test
+  runTone(0, 1000, 150.0f, 1.0f, 330.0f, 0.7f, 0);
+
+  // Assert
+  float low = fminf(dn.centerFreq[0][0], dn.centerFreq[0][1]);
+  float high = fmaxf(dn.centerFreq[0][0], dn.centerFreq[0][1]);
+  TEST_ASSERT_FLOAT_WITHIN(4.0f, 150.0f, low);
+  TEST_ASSERT_FLOAT_WITHIN(4.0f, 330.0f, high);
+}
+
+void testThatNotchFollowsChangingMotorSpeed() {
+  // Fixture
+  float phase = 0.0f;
+
+  // Test
+  // Ramp from 150 to 250 Hz in one second, then hold
+  for (int n = 0; n < 1500; n++) {
+    float freq = (n < 1000) ? 150.0f + 0.1f * n : 250.0f;
+    phase += TWO_PI_F * freq / SAMPLE_FREQ;
+    float xyz[3] = {sinf(phase), 0.0f, 0.0f};
+    dynNotchApply(&dn, xyz);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(5.0f, 250.0f, dn.centerFreq[0][0]);
+}
+
+void testThatPeaksOutsideTheRangeAreIgnored() {
+  // Fixture
+  // Test
+  // Strong motion below the range, its leakage must not be taken as peaks
+  runTone(0, 1000, 40.0f, 10.0f, 0.0f, 0.0f, 0);
+
+  // Assert
+  for (int i = 0; i < DYN_NOTCH_MAX_NOTCHES; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, dn.centerFreq[0][i]);
+  }
+}
+
+void testThatVibrationIsFoundInNoise() {
+  // Fixture
+  // Test
+  for (int n = 0; n < 1000; n++) {
+    float xyz[3] = {0.5f * sinf(TWO_PI_F * 260.0f * n / SAMPLE_FREQ) + noise(), 0.0f, 0.0f};
+    dynNotchApply(&dn, xyz);
+  }
+
+  // Assert
+  bool found = false;
+  for (int i = 0; i < 3; i++) {
+    found |= fabsf(dn.centerFreq[0][i] - 260.0f) < 8.0f;
+  }
+  TEST_ASSERT_TRUE(found);
+}
+
+void testThatMotorFrequenciesOverrideTheSpectrum() {
+  // Fixture
+  const float motorFreq[4] = {180.0f, 190.0f, 0.0f, 210.0f};
+  runTone(0, 500, 300.0f, 1.0f, 0.0f, 0.0f, 0);
+
+  // Test
+  for (int n = 0; n < 3; n++) {
+    for (int m = 0; m < 4; m++) {
+      dynNotchSetMotorFrequency(&dn, m, motorFreq[m]);
+    }
+    float xyz[3] = {0};
+    dynNotchApply(&dn, xyz);
+  }
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(dynNotchSourceRpm, dn.source);
+  for (int axis = 0; axis < 3; axis++) {
+    TEST_ASSERT_EQUAL_FLOAT(180.0f, dn.centerFreq[axis][0]);
+    TEST_ASSERT_EQUAL_FLOAT(190.0f, dn.centerFreq[axis][1]);
+    // Stopped motor has no notch
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, dn.centerFreq[axis][2]);
+    TEST_ASSERT_EQUAL_FLOAT(210.0f, dn.centerFreq[axis][3]);
+  }
+}
+
+void testThatNotchIsReleasedWhenTheVibrationStops() {
+  // Fixture
+  runTone(0, 1000, 210.0f, 1.0f, 0.0f, 0.0f, 0);
+
+  // Test
+  runTone(0, 1000, 0.0f, 0.0f, 0.0f, 0.0f, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, dn.centerFreq[0][0]);
+}
+
+void testThatSpectrumIsUsedWhenMotorFrequenciesAreStale() {
+  // Fixture
+  for (int m = 0; m < 4; m++) {
+    dynNotchSetMotorFrequency(&dn, m, 180.0f);
+  }
+
+  // Test
+  runTone(0, 1000, 300.0f, 1.0f, 0.0f, 0.0f, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(dynNotchSourceSpectrum, dn.source);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, dn.centerFreq[0][3]);
+  bool found = false;
+  for (int i = 0; i < 3; i++) {
+    found |= fabsf(dn.centerFreq[0][i] - 300.0f) < 4.0f;
+  }
+  TEST_ASSERT_TRUE(found);
+}
+
+void testThatNotchRemovesCenterFrequency() {
+  // Fixture
+  notchData notch;
+  notchInit(&notch, SAMPLE_FREQ, 200.0f, 3.0f);
+  float sumSquares = 0.0f;
+
+  // Test
+  for (int n = 0; n < 1000; n++) {
+    float out = notchApply(&notch, sinf(TWO_PI_F * 200.0f * n / SAMPLE_FREQ));
+    if (n >= 500) {
+      sumSquares += out * out;
+    }
+  }
+
+  // Assert
+  TEST_ASSERT_LESS_THAN(1e-4f, sumSquares / 500);
+}
+
+// Feed a sum of two tones (and a little noise) to one axis, optionally measure the output RMS
+static float runTone(int axis, int samples, float freq1, float amp1, float freq2, float amp2, float* rmsOut) {
+  static int n = 0;
+  float sumSquares = 0.0f;
+
+  for (int i = 0; i < samples; i++, n++) {
+    float xyz[3] = {0.0f, 0.0f, 0.0f};
+    xyz[axis] = amp1 * sinf(TWO_PI_F * freq1 * n / SAMPLE_FREQ) +
+                amp2 * sinf(TWO_PI_F * freq2 * n / SAMPLE_FREQ) +
+                0.01f * noise();
+    dynNotchApply(&dn, xyz);
+    sumSquares += xyz[axis] * xyz[axis];
+  }
+
+  if (rmsOut) {
+    *rmsOut = sqrtf(sumSquares / samples);
+  }
+  return sumSquares;
+}
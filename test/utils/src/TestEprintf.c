@@ -27,7 +27,9 @@
 #include "unity.h"
 #include "eprintf.h"
 
+#include <math.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 
 static int putcMock(int c);
@@ -244,6 +246,96 @@ void testThatAllIntTypesArePrinted() {
   verify("FFFFFFFFFFFFFFFF", "%llX", (uint64_t)0xFFFFFFFFFFFFFFFF);
 }
 
+void testThatZeroIsPrintedInHex() {
+  // Fixture
+  // Test
+  // Assert
+  verifyStdio("Some %x %X %4X %02x text", 0, 0, 0, 0);
+}
+
+void testThatMinimumIntsArePrinted() {
+  // Fixture
+  // Test
+  // Assert
+  verifyStdio("%d %ld %lld", INT32_MIN, (long int)INT32_MIN, (long long int)INT64_MIN);
+}
+
+void testThatFieldWidthsArePrinted() {
+  // Fixture
+  // Test
+  // Assert
+  verifyStdio("[%5d] [%-5d] [%05d] [%05i] [%3d]", 42, 42, 42, -42, 123456);
+  verifyStdio("[%8s] [%-8s] [%2s]", "abc", "abc", "abcdef");
+  verifyStdio("[%10.3f] [%-10.3f] [%010.3f] [%010.3f]", 3.25, 3.25, 3.25, -3.25);
+  verifyStdio("[%5u] [%-6X] [%c] [%3c] [%%]", 7u, 0xABu, 'x', 'y');
+}
+
+void testThatFloatsAreRoundedToNearestEven() {
+  // Fixture
+  // Test
+  // Assert
+  verifyStdio("%.0f %.0f %.0f %.0f %.0f", 0.5, 1.5, 2.5, -0.5, 3.5);
+  verifyStdio("%.2f %.2f %.1f %.1f", 0.125, 0.375, 0.25, 0.75);
+  verifyStdio("%.3f %.1f %.0f", (double)9.9995f, (double)9.95f, 999999.5);
+}
+
+void testThatFloatsMatchStdio() {
+  // Fixture
+  char expected[80];
+  char actual[80];
+
+  // Every 397021st bit pattern over the positive floats, up to the largest.
+  // The floats are passed as double, so stdio prints the same value.
+  for (uint32_t bits = 0; bits < 0x7F800000; bits += 4093 * 97) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    for (int precision = 0; precision <= 9; precision++) {
+      // Test
+      snprintf(expected, sizeof(expected), "%.*f", precision, (double)value);
+      char format[8];
+      snprintf(format, sizeof(format), "%%.%df", precision);
+      esnprintf(actual, sizeof(actual), format, (double)value);
+
+      // Assert
+      TEST_ASSERT_EQUAL_STRING(expected, actual);
+    }
+  }
+}
+
+void testThatSpecialFloatsArePrinted() {
+  // Fixture
+  // Test
+  // Assert
+  verify("inf -inf nan 0.000000 -0.000000", "%f %f %f %f %f", (double)INFINITY, (double)-INFINITY, (double)NAN, 0.0, -0.0);
+  verifyStdio("%f %.2f", (double)3.4028235e38f, (double)1.0e20f);
+}
+
+void testThatSnprintfTruncatesAndReturnsTheFullLength() {
+  // Fixture
+  char buffer[8];
+  memset(buffer, 'x', sizeof(buffer));
+
+  // Test
+  int length = esnprintf(buffer, 6, "%s %d", "text", 1234);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(9, length);
+  TEST_ASSERT_EQUAL_STRING("text ", buffer);
+  TEST_ASSERT_EQUAL_HEX8('x', buffer[6]);
+}
+
+void testThatSnprintfFormatsIntoBuffer() {
+  // Fixture
+  char buffer[40];
+
+  // Test
+  int length = esnprintf(buffer, sizeof(buffer), "%s=%d 0x%04X %.2f", "v", -5, 0x1Fu, 1.005);
+
+  // Assert
+  TEST_ASSERT_EQUAL_STRING("v=-5 0x001F 1.00", buffer);
+  TEST_ASSERT_EQUAL_INT(16, length);
+}
+
 //////////////////////////////
 
 static int putcMock(int c) {
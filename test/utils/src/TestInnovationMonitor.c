@@ -0,0 +1,172 @@
+// File under test innovationMonitor.c
+#include "innovationMonitor.h"
+
+#include <math.h>
+#include "unity.h"
+
+#define WINDOW_SIZE 50
+
+static innovationMonitor_t monitor;
+
+// Deterministic standard normal samples (Box-Muller on a linear congruential generator)
+static uint32_t seed;
+static float uniform() {
+  seed = seed * 1664525 + 1013904223;
+  return ((seed >> 8) + 0.5f) / 16777216.0f;
+}
+static float gaussian() {
+  return sqrtf(-2.0f * logf(uniform())) * cosf(6.2831853f * uniform());
+}
+
+void setUp(void) {
+  seed = 4711;
+  innovationMonitorInit(&monitor, WINDOW_SIZE);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatChiSquareBoundsAreComputedOnInit() {
+  // Fixture
+  // Reference values from chi-square tables, 50 degrees of freedom
+  float expectedLower = 32.357f;
+  float expectedUpper = 71.420f;
+
+  // Test
+  // Done in setUp
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, expectedLower, monitor.lowerBound);
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, expectedUpper, monitor.upperBound);
+  TEST_ASSERT_TRUE(monitor.isConsistent);
+}
+
+void testThatNisIsNormalizedWithTheInnovationVariance() {
+  // Fixture
+  float expected = 4.0f;
+
+  // Test
+  innovationMonitorAdd(&monitor, 1.0f, 0.25f, 0);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, expected, monitor.nis);
+  TEST_ASSERT_EQUAL_UINT32(1, monitor.updateCount);
+}
+
+void testThatUpdatesWithInvalidVarianceAreIgnored() {
+  // Fixture
+
+  // Test
+  innovationMonitorAdd(&monitor, 1.0f, 0.0f, 0);
+  innovationMonitorAdd(&monitor, 1.0f, -1.0f, 0);
+  innovationMonitorAdd(&monitor, 1.0f, NAN, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(0, monitor.updateCount);
+}
+
+void testThatHistogramBinsAreOneSigmaWide() {
+  // Fixture
+  uint16_t expected[INNOVATION_MONITOR_HISTOGRAM_BINS] = {2, 1, 1, 2};
+  innovationMonitorInit(&monitor, 6);
+
+  // Test
+  innovationMonitorAdd(&monitor, 0.1f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, -0.9f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, 1.5f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, -2.5f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, 3.5f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, -30.0f, 1.0f, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, monitor.histogram, INNOVATION_MONITOR_HISTOGRAM_BINS);
+}
+
+void testThatConsistentInnovationsPassTheTest() {
+  // Fixture
+  const float sigma = 0.3f;
+
+  // Test
+  for (int i = 0; i < WINDOW_SIZE; i++) {
+    innovationMonitorAdd(&monitor, sigma * gaussian(), sigma * sigma, i);
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(monitor.isConsistent);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 1.0f, monitor.nisMean);
+  TEST_ASSERT_EQUAL_UINT8(100, innovationMonitorGetScore(&monitor));
+}
+
+void testThatOverConfidentFilterFailsTheTest() {
+  // Fixture
+  // The actual noise is three times larger than what the filter believes
+  const float sigma = 0.3f;
+
+  // Test
+  for (int i = 0; i < WINDOW_SIZE; i++) {
+    innovationMonitorAdd(&monitor, 3.0f * sigma * gaussian(), sigma * sigma, i);
+  }
+
+  // Assert
+  TEST_ASSERT_FALSE(monitor.isConsistent);
+  TEST_ASSERT_LESS_THAN(50, innovationMonitorGetScore(&monitor));
+}
+
+void testThatUnderConfidentFilterFailsTheTest() {
+  // Fixture
+  const float sigma = 0.3f;
+
+  // Test
+  for (int i = 0; i < WINDOW_SIZE; i++) {
+    innovationMonitorAdd(&monitor, 0.2f * sigma * gaussian(), sigma * sigma, i);
+  }
+
+  // Assert
+  TEST_ASSERT_FALSE(monitor.isConsistent);
+}
+
+void testThatHistogramIsOfTheLastCompleteWindow() {
+  // Fixture
+  uint16_t expected[INNOVATION_MONITOR_HISTOGRAM_BINS] = {0, 0, 0, 2};
+  innovationMonitorInit(&monitor, 2);
+  innovationMonitorAdd(&monitor, 0.1f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, 0.2f, 1.0f, 0);
+
+  // Test
+  innovationMonitorAdd(&monitor, 5.0f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, 6.0f, 1.0f, 0);
+  innovationMonitorAdd(&monitor, 0.1f, 1.0f, 0);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(expected, monitor.histogram, INNOVATION_MONITOR_HISTOGRAM_BINS);
+}
+
+void testThatResultIsNotUpdatedBeforeWindowIsComplete() {
+  // Fixture
+
+  // Test
+  for (int i = 0; i < WINDOW_SIZE - 1; i++) {
+    innovationMonitorAdd(&monitor, 10.0f, 1.0f, i);
+  }
+
+  // Assert
+  TEST_ASSERT_TRUE(monitor.isConsistent);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, monitor.nisMean);
+}
+
+void testThatMonitorIsActiveOnlyAfterRecentUpdate() {
+  // Fixture
+  const uint32_t maxAge = 500;
+
+  // Test
+  bool activeBeforeUpdate = innovationMonitorIsActive(&monitor, 1000, maxAge);
+  innovationMonitorAdd(&monitor, 1.0f, 1.0f, 1000);
+  bool activeAfterUpdate = innovationMonitorIsActive(&monitor, 1400, maxAge);
+  bool activeWhenOld = innovationMonitorIsActive(&monitor, 1501, maxAge);
+
+  // Assert
+  TEST_ASSERT_FALSE(activeBeforeUpdate);
+  TEST_ASSERT_TRUE(activeAfterUpdate);
+  TEST_ASSERT_FALSE(activeWhenOld);
+}
@@ -0,0 +1,168 @@
+// File under test linkQuality.c
+#include "linkQuality.h"
+
+#include "unity.h"
+
+static linkQuality_t link;
+
+static void addSends(int count, bool isAcked);
+static void addRssi(int count, uint8_t rssi);
+
+void setUp(void) {
+  linkQualityInit(&link);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatNewLinkIsGood() {
+  // Fixture
+  // Test
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, link.quality);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, link.rate);
+}
+
+void testThatRetriesLowerTheQuality() {
+  // Fixture
+  addSends(100, false);
+
+  // Test
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_TRUE(link.quality < 0.01f);
+  TEST_ASSERT_EQUAL_UINT32(100, link.retries);
+  TEST_ASSERT_EQUAL_UINT32(0, link.acks);
+}
+
+void testThatWeakRssiLowersTheQuality() {
+  // Fixture
+  addRssi(100, LINK_QUALITY_RSSI_BAD);
+
+  // Test
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_TRUE(link.quality < 0.01f);
+}
+
+void testThatRssiBetweenLimitsGivesPartialQuality() {
+  // Fixture
+  addRssi(200, (LINK_QUALITY_RSSI_GOOD + LINK_QUALITY_RSSI_BAD) / 2);
+
+  // Test
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.02f, 0.5f, link.quality);
+}
+
+void testThatStrongRssiIsLimitedToFullQuality() {
+  // Fixture
+  addRssi(100, 20);
+
+  // Test
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, link.quality);
+}
+
+void testThatPoorLinkHalvesTheRate() {
+  // Fixture
+  addSends(100, false);
+
+  // Test
+  linkQualityUpdate(&link, false);
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.25f, link.rate);
+}
+
+void testThatBacklogHalvesTheRateOnGoodLink() {
+  // Fixture
+  // Test
+  linkQualityUpdate(&link, true);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, link.rate);
+}
+
+void testThatRateIsLimitedToMinimum() {
+  // Fixture
+  // Test
+  for (int i = 0; i < 10; i++) {
+    linkQualityUpdate(&link, true);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, LINK_QUALITY_RATE_MIN, link.rate);
+}
+
+void testThatGoodLinkIncreasesTheRateInSteps() {
+  // Fixture
+  linkQualityUpdate(&link, true);
+
+  // Test
+  linkQualityUpdate(&link, false);
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f + 2 * LINK_QUALITY_RATE_INCREASE, link.rate);
+}
+
+void testThatRateIsLimitedToOne() {
+  // Fixture
+  // Test
+  for (int i = 0; i < 10; i++) {
+    linkQualityUpdate(&link, false);
+  }
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, link.rate);
+}
+
+void testThatRateIsHeldOnFairLink() {
+  // Fixture
+  linkQualityUpdate(&link, true);
+  addRssi(200, (LINK_QUALITY_RSSI_GOOD + LINK_QUALITY_RSSI_BAD) / 2 - 5);
+
+  // Test
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_TRUE(link.quality > LINK_QUALITY_LOW && link.quality < LINK_QUALITY_HIGH);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f, link.rate);
+}
+
+void testThatRateRecoversWhenTheLinkDoes() {
+  // Fixture
+  addSends(100, false);
+  linkQualityUpdate(&link, false);
+
+  // Test
+  addSends(200, true);
+  linkQualityUpdate(&link, false);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.5f + LINK_QUALITY_RATE_INCREASE, link.rate);
+}
+
+// Helpers ////////////////////////////////////////////////////////////////
+
+static void addSends(int count, bool isAcked) {
+  for (int i = 0; i < count; i++) {
+    linkQualityAddSend(&link, isAcked);
+  }
+}
+
+static void addRssi(int count, uint8_t rssi) {
+  for (int i = 0; i < count; i++) {
+    linkQualityAddRssi(&link, rssi);
+  }
+}
@@ -0,0 +1,205 @@
+// File under test magCalib.c
+#include "magCalib.h"
+
+#include <math.h>
+
+#include "unity.h"
+
+#define PI_F 3.14159265f
+#define SAMPLE_COUNT 200
+
+static magCalib_t mc;
+
+static void distortedSample(int i, const float distortion[3][3], const float* offset, float* xyz);
+static void collect(const float distortion[3][3], const float* offset);
+static int solve();
+
+static const float identity[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+static const float noOffset[3] = {0, 0, 0};
+
+void setUp(void) {
+  magCalibStart(&mc, 0.01f);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatIdentityCalibrationDoesNotChangeSample() {
+  // Fixture
+  magCalibration_t cal;
+  magCalibSetIdentity(&cal);
+  float xyz[3] = {0.1f, -0.2f, 0.3f};
+
+  // Test
+  magCalibApply(&cal, xyz);
+
+  // Assert
+  TEST_ASSERT_EQUAL_FLOAT(0.1f, xyz[0]);
+  TEST_ASSERT_EQUAL_FLOAT(-0.2f, xyz[1]);
+  TEST_ASSERT_EQUAL_FLOAT(0.3f, xyz[2]);
+}
+
+void testThatHardIronOffsetIsFound() {
+  // Fixture
+  const float offset[3] = {0.3f, -0.2f, 0.45f};
+  collect(identity, offset);
+
+  // Test
+  solve();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(magCalibDone, mc.state);
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, offset[i], mc.result.offset[i]);
+    for (int j = 0; j < 3; j++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-3f, identity[i][j], mc.result.softIron[i][j]);
+    }
+  }
+}
+
+void testThatSoftIronDistortionIsRemoved() {
+  // Fixture
+  const float distortion[3][3] = {{0.55f, 0.05f, -0.02f}, {0.05f, 0.42f, 0.03f}, {-0.02f, 0.03f, 0.48f}};
+  const float offset[3] = {-0.15f, 0.25f, 0.1f};
+  collect(distortion, offset);
+
+  // Test
+  solve();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(magCalibDone, mc.state);
+  float expected = 0.0f;
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    float xyz[3];
+    distortedSample(i, distortion, offset, xyz);
+    magCalibApply(&mc.result, xyz);
+    float norm = sqrtf(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]);
+    if (i == 0) {
+      expected = norm;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, expected, norm);
+  }
+}
+
+void testThatFieldMagnitudeIsKept() {
+  // Fixture
+  const float distortion[3][3] = {{0.6f, 0, 0}, {0, 0.4f, 0}, {0, 0, 0.5f}};
+  collect(distortion, noOffset);
+
+  // Test
+  solve();
+
+  // Assert
+  float xyz[3];
+  distortedSample(17, distortion, noOffset, xyz);
+  magCalibApply(&mc.result, xyz);
+  // Geometric mean of the axis lengths
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, cbrtf(0.6f * 0.4f * 0.5f), sqrtf(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]));
+}
+
+void testThatSolverFinishesInBoundedNumberOfSteps() {
+  // Fixture
+  const float distortion[3][3] = {{0.55f, 0.05f, -0.02f}, {0.05f, 0.42f, 0.03f}, {-0.02f, 0.03f, 0.48f}};
+  collect(distortion, noOffset);
+
+  // Test
+  int steps = solve();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(magCalibDone, mc.state);
+  TEST_ASSERT_TRUE(steps <= 21);
+}
+
+void testThatCloseSamplesAreDropped() {
+  // Fixture
+  const float first[3] = {0.5f, 0.0f, 0.0f};
+  const float close[3] = {0.505f, 0.0f, 0.0f};
+  const float far[3] = {0.48f, 0.1f, 0.0f};
+
+  // Test
+  bool firstUsed = magCalibAddSample(&mc, first);
+  bool closeUsed = magCalibAddSample(&mc, close);
+  bool farUsed = magCalibAddSample(&mc, far);
+
+  // Assert
+  TEST_ASSERT_TRUE(firstUsed);
+  TEST_ASSERT_FALSE(closeUsed);
+  TEST_ASSERT_TRUE(farUsed);
+  TEST_ASSERT_EQUAL_UINT16(2, mc.sampleCount);
+}
+
+void testThatTooFewSamplesFail() {
+  // Fixture
+  float xyz[3];
+  for (int i = 0; i < MAG_CALIB_MIN_SAMPLES - 1; i++) {
+    distortedSample(i, identity, noOffset, xyz);
+    magCalibAddSample(&mc, xyz);
+  }
+
+  // Test
+  magCalibSolve(&mc);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(magCalibFailed, mc.state);
+}
+
+void testThatSamplesInAPlaneFail() {
+  // Fixture
+  // Rotation around z only, the fit is under determined
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    float angle = 2.0f * PI_F * i / SAMPLE_COUNT;
+    float xyz[3] = {0.4f * cosf(angle), 0.4f * sinf(angle), 0.2f};
+    magCalibAddSample(&mc, xyz);
+  }
+
+  // Test
+  solve();
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(magCalibFailed, mc.state);
+}
+
+void testThatSamplesAreIgnoredWhenNotCollecting() {
+  // Fixture
+  collect(identity, noOffset);
+  solve();
+  uint16_t count = mc.sampleCount;
+  const float xyz[3] = {1.0f, 1.0f, 1.0f};
+
+  // Test
+  bool used = magCalibAddSample(&mc, xyz);
+
+  // Assert
+  TEST_ASSERT_FALSE(used);
+  TEST_ASSERT_EQUAL_UINT16(count, mc.sampleCount);
+}
+
+// Sample i of directions spread evenly over the sphere, distorted and offset
+static void distortedSample(int i, const float distortion[3][3], const float* offset, float* xyz) {
+  const float golden = PI_F * (3.0f - sqrtf(5.0f));
+  float z = 1.0f - 2.0f * (i + 0.5f) / SAMPLE_COUNT;
+  float r = sqrtf(1.0f - z * z);
+  float u[3] = {r * cosf(golden * i), r * sinf(golden * i), z};
+
+  for (int j = 0; j < 3; j++) {
+    xyz[j] = distortion[j][0] * u[0] + distortion[j][1] * u[1] + distortion[j][2] * u[2] + offset[j];
+  }
+}
+
+static void collect(const float distortion[3][3], const float* offset) {
+  for (int i = 0; i < SAMPLE_COUNT; i++) {
+    float xyz[3];
+    distortedSample(i, distortion, offset, xyz);
+    magCalibAddSample(&mc, xyz);
+  }
+}
+
+static int solve() {
+  int steps = 0;
+  magCalibSolve(&mc);
+  while (magCalibStep(&mc) == magCalibSolving) {
+    steps++;
+  }
+  return steps + 1;
+}
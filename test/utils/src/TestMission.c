@@ -0,0 +1,440 @@
+// File under test mission.c
+// File under test crc.c
+#include "mission.h"
+
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+
+#include "crc.h"
+#include "unity.h"
+
+// Fake high-level commander
+static int takeoffCount;
+static int landCount;
+static int goToCount;
+static int trajectoryCount;
+static float lastHeight;
+static float lastDuration;
+static uint8_t lastTrajectoryId;
+static bool lastRelative;
+static bool lastReversed;
+static int commandResult;
+static bool isTrajectoryFinishedValue;
+static bool isStoppedValue;
+static float batteryVoltageValue;
+
+static int takeoff(float height, float duration) {
+  takeoffCount++;
+  lastHeight = height;
+  lastDuration = duration;
+  isStoppedValue = false;
+  return commandResult;
+}
+
+static int land(float height, float duration) {
+  landCount++;
+  lastHeight = height;
+  lastDuration = duration;
+  return commandResult;
+}
+
+static int goTo(bool relative, float x, float y, float z, float yaw, float duration) {
+  goToCount++;
+  lastRelative = relative;
+  lastDuration = duration;
+  return commandResult;
+}
+
+static int startTrajectory(uint8_t trajectoryId, float timescale, bool relative, bool reversed) {
+  trajectoryCount++;
+  lastTrajectoryId = trajectoryId;
+  lastRelative = relative;
+  lastReversed = reversed;
+  isTrajectoryFinishedValue = false;
+  return commandResult;
+}
+
+static bool isTrajectoryFinished(void) {
+  return isTrajectoryFinishedValue;
+}
+
+static bool isStopped(void) {
+  return isStoppedValue;
+}
+
+static float batteryVoltage(void) {
+  return batteryVoltageValue;
+}
+
+static const missionOps_t ops = {
+  .takeoff = takeoff,
+  .land = land,
+  .goTo = goTo,
+  .startTrajectory = startTrajectory,
+  .isTrajectoryFinished = isTrajectoryFinished,
+  .isStopped = isStopped,
+  .batteryVoltage = batteryVoltage,
+};
+
+static mission_t mission;
+
+static uint8_t file[sizeof(missionHeader_t) + MISSION_MAX_STEPS * sizeof(missionStep_t)];
+static uint32_t fileSize;
+static missionStep_t steps[MISSION_MAX_STEPS];
+
+static void buildFile(int count);
+static void loadAndStart(int count);
+
+void setUp(void) {
+  takeoffCount = 0;
+  landCount = 0;
+  goToCount = 0;
+  trajectoryCount = 0;
+  commandResult = 0;
+  isTrajectoryFinishedValue = false;
+  isStoppedValue = true;
+  batteryVoltageValue = 4.0f;
+
+  memset(steps, 0, sizeof(steps));
+  missionInit(&mission, &ops);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatValidFileIsLoaded() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 2.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepLand, .time = 2.0f};
+  buildFile(2);
+
+  // Test
+  int actual = missionLoad(&mission, file, fileSize);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_EQUAL_INT(missionStateLoaded, mission.state);
+  TEST_ASSERT_EQUAL_UINT16(2, mission.count);
+}
+
+void testThatFileWithBadCrcIsRejected() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 2.0f, .z = 1.0f};
+  buildFile(1);
+  file[fileSize - 1] ^= 0x01;
+
+  // Test
+  int actual = missionLoad(&mission, file, fileSize);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EIO, actual);
+  TEST_ASSERT_EQUAL_INT(missionStateEmpty, mission.state);
+}
+
+void testThatTruncatedFileIsRejected() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 2.0f, .z = 1.0f};
+  buildFile(1);
+
+  // Test
+  int actual = missionLoad(&mission, file, fileSize - 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+}
+
+void testThatTooManyStepsAreRejected() {
+  // Fixture
+  buildFile(MISSION_MAX_STEPS);
+  missionHeader_t header;
+  memcpy(&header, file, sizeof(header));
+  header.count = MISSION_MAX_STEPS + 1;
+  memcpy(file, &header, sizeof(header));
+
+  // Test
+  int actual = missionLoad(&mission, file, sizeof(header) + (MISSION_MAX_STEPS + 1) * sizeof(missionStep_t));
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+}
+
+void testThatUnknownStepTypeIsRejected() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = 17, .time = 2.0f};
+  buildFile(1);
+
+  // Test
+  int actual = missionLoad(&mission, file, fileSize);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+}
+
+void testThatZeroDurationIsRejected() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepGoTo, .time = 0.0f};
+  buildFile(1);
+
+  // Test
+  int actual = missionLoad(&mission, file, fileSize);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+}
+
+void testThatNonFiniteValueIsRejected() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepGoTo, .time = 1.0f, .x = NAN};
+  buildFile(1);
+
+  // Test
+  int actual = missionLoad(&mission, file, fileSize);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+}
+
+void testThatStartWithoutMissionFails() {
+  // Fixture
+  // Test
+  int actual = missionStart(&mission);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(ENOENT, actual);
+}
+
+void testThatStepsRunInSequence() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 2.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepGoTo, .time = 3.0f, .x = 1.0f, .z = 1.0f};
+  steps[2] = (missionStep_t){.type = missionStepLand, .time = 2.0f};
+  loadAndStart(3);
+
+  // Test
+  missionUpdate(&mission, 0.0f);
+  missionUpdate(&mission, 1.9f);
+  int goToAfterTakeoff = goToCount;
+  missionUpdate(&mission, 2.0f);
+  missionUpdate(&mission, 5.0f);
+  missionUpdate(&mission, 6.0f);
+  missionUpdate(&mission, 7.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, takeoffCount);
+  TEST_ASSERT_EQUAL_INT(0, goToAfterTakeoff);
+  TEST_ASSERT_EQUAL_INT(1, goToCount);
+  TEST_ASSERT_EQUAL_INT(1, landCount);
+  TEST_ASSERT_EQUAL_INT(missionStateDone, mission.state);
+}
+
+void testThatWaitUntilHoldsTheNextStep() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepWaitUntil, .time = 10.0f};
+  steps[2] = (missionStep_t){.type = missionStepGoTo, .time = 1.0f};
+  loadAndStart(3);
+
+  // Test
+  missionUpdate(&mission, 0.0f);
+  missionUpdate(&mission, 1.0f);
+  missionUpdate(&mission, 9.9f);
+  int goToBeforeTime = goToCount;
+  missionUpdate(&mission, 10.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, goToBeforeTime);
+  TEST_ASSERT_EQUAL_INT(1, goToCount);
+}
+
+void testThatPassedWaitDoesNotHoldTheMission() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepWaitUntil, .time = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  loadAndStart(2);
+
+  // Test
+  missionUpdate(&mission, 5.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(1, takeoffCount);
+}
+
+void testThatTrajectoryStepWaitsForTheTrajectory() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepTrajectory, .time = 1.0f, .trajectoryId = 3,
+                             .flags = MISSION_FLAG_RELATIVE | MISSION_FLAG_REVERSED};
+  steps[2] = (missionStep_t){.type = missionStepLand, .time = 1.0f};
+  loadAndStart(3);
+  missionUpdate(&mission, 0.0f);
+  missionUpdate(&mission, 1.0f);
+
+  // Test
+  missionUpdate(&mission, 100.0f);
+  int landWhileRunning = landCount;
+  isTrajectoryFinishedValue = true;
+  missionUpdate(&mission, 101.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT8(3, lastTrajectoryId);
+  TEST_ASSERT_TRUE(lastRelative);
+  TEST_ASSERT_TRUE(lastReversed);
+  TEST_ASSERT_EQUAL_INT(0, landWhileRunning);
+  TEST_ASSERT_EQUAL_INT(1, landCount);
+}
+
+void testThatFailedConditionSkipsTheStep() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepGoTo, .time = 1.0f,
+                             .condition = missionConditionTimeBefore, .conditionValue = 0.5f};
+  steps[2] = (missionStep_t){.type = missionStepLand, .time = 1.0f};
+  loadAndStart(3);
+  missionUpdate(&mission, 0.0f);
+
+  // Test
+  missionUpdate(&mission, 1.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, goToCount);
+  TEST_ASSERT_EQUAL_INT(1, landCount);
+}
+
+void testThatFailedConditionCanAbortAndLand() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepGoTo, .time = 1.0f, .flags = MISSION_FLAG_ABORT,
+                             .condition = missionConditionBatteryAbove, .conditionValue = 3.6f};
+  loadAndStart(2);
+  missionUpdate(&mission, 0.0f);
+  batteryVoltageValue = 3.5f;
+
+  // Test
+  missionUpdate(&mission, 1.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(missionStateAborted, mission.state);
+  TEST_ASSERT_EQUAL_INT(0, goToCount);
+  TEST_ASSERT_EQUAL_INT(1, landCount);
+  TEST_ASSERT_EQUAL_FLOAT(MISSION_ABORT_LAND_DURATION, lastDuration);
+}
+
+void testThatGoToOnTheGroundAborts() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepGoTo, .time = 1.0f};
+  loadAndStart(1);
+
+  // Test
+  missionUpdate(&mission, 0.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(missionStateAborted, mission.state);
+  TEST_ASSERT_EQUAL_INT(EINVAL, mission.error);
+  TEST_ASSERT_EQUAL_INT(0, goToCount);
+  TEST_ASSERT_EQUAL_INT(0, landCount);
+}
+
+void testThatFailedCommandAborts() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepTrajectory, .time = 1.0f};
+  loadAndStart(2);
+  missionUpdate(&mission, 0.0f);
+  commandResult = ENOENT;
+
+  // Test
+  missionUpdate(&mission, 1.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(missionStateAborted, mission.state);
+  TEST_ASSERT_EQUAL_INT(ENOENT, mission.error);
+  TEST_ASSERT_EQUAL_INT(1, landCount);
+}
+
+void testThatStopFromElsewhereAbortsWithoutFlying() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepGoTo, .time = 1.0f};
+  loadAndStart(2);
+  missionUpdate(&mission, 0.0f);
+  isStoppedValue = true;
+
+  // Test
+  missionUpdate(&mission, 1.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(missionStateAborted, mission.state);
+  TEST_ASSERT_EQUAL_INT(0, goToCount);
+  TEST_ASSERT_EQUAL_INT(0, landCount);
+}
+
+void testThatLandingEndsWhenThePlannerStops() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepLand, .time = 2.0f};
+  steps[2] = (missionStep_t){.type = missionStepWaitUntil, .time = 10.0f};
+  loadAndStart(3);
+  missionUpdate(&mission, 0.0f);
+  missionUpdate(&mission, 1.0f);
+
+  // Test
+  isStoppedValue = true;
+  missionUpdate(&mission, 2.9f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(missionStateRunning, mission.state);
+  TEST_ASSERT_EQUAL_UINT16(2, mission.current);
+  TEST_ASSERT_FALSE(mission.isFlying);
+}
+
+void testThatMissionCanBeRestarted() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  steps[1] = (missionStep_t){.type = missionStepLand, .time = 1.0f};
+  loadAndStart(2);
+  missionUpdate(&mission, 0.0f);
+  missionUpdate(&mission, 1.0f);
+  missionUpdate(&mission, 2.0f);
+
+  // Test
+  int actual = missionStart(&mission);
+  missionUpdate(&mission, 0.0f);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_EQUAL_INT(2, takeoffCount);
+}
+
+void testThatRunningMissionIsNotReplaced() {
+  // Fixture
+  steps[0] = (missionStep_t){.type = missionStepTakeoff, .time = 1.0f, .z = 1.0f};
+  loadAndStart(1);
+
+  // Test
+  int actual = missionLoad(&mission, file, fileSize);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EBUSY, actual);
+}
+
+// Helpers ////////////////////////////////////////////////////////////////
+
+static void buildFile(int count) {
+  missionHeader_t header = {
+    .magic = MISSION_MAGIC,
+    .version = MISSION_VERSION,
+    .count = count,
+    .crc = crcSlow(steps, count * sizeof(missionStep_t)),
+  };
+  memcpy(file, &header, sizeof(header));
+  memcpy(&file[sizeof(header)], steps, count * sizeof(missionStep_t));
+  fileSize = sizeof(header) + count * sizeof(missionStep_t);
+}
+
+static void loadAndStart(int count) {
+  buildFile(count);
+  TEST_ASSERT_EQUAL_INT(0, missionLoad(&mission, file, fileSize));
+  TEST_ASSERT_EQUAL_INT(0, missionStart(&mission));
+}
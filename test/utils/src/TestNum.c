@@ -1,6 +1,10 @@
 #include "unity.h"
 #include "num.h"
 
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
 
 void testThatLimitUint16NotLimitInRange() {
   // Fixture
@@ -136,3 +140,149 @@ void testThatDeadbandOutsideDeadbandNegative() {
   // Assert
   TEST_ASSERT_EQUAL_FLOAT(expected, actual);
 }
+
+
+// FP16 conversion, checked against the values of IEEE 754 binary16 computed
+// in double precision
+
+static uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static bool isHalfNan(uint16_t half) {
+  return (half & 0x7C00) == 0x7C00 && (half & 0x03FF) != 0;
+}
+
+static double referenceHalfValue(uint16_t half) {
+  const int e = (half >> 10) & 0x1F;
+  const int m = half & 0x03FF;
+  const double sign = (half & 0x8000) ? -1.0 : 1.0;
+  if (e == 0x1F) {
+    return m ? NAN : sign * INFINITY;
+  }
+  if (e == 0) {
+    return sign * ldexp(m, -24);
+  }
+  return sign * ldexp(1024 + m, e - 25);
+}
+
+static uint16_t referenceSingle2half(float value) {
+  const uint16_t sign = signbit(value) ? 0x8000 : 0;
+  const double magnitude = fabs((double)value);
+  if (magnitude < ldexp(1.0, -14)) {
+    // Subnormal, can round up to the smallest normal which has the next code
+    return sign | (uint16_t)nearbyint(magnitude * ldexp(1.0, 24));
+  }
+
+  int e;
+  frexp(magnitude, &e); // magnitude = [0.5, 1) * 2^e
+  double mantissa = nearbyint(ldexp(magnitude, 11 - e)); // [1024, 2048]
+  if (mantissa == 2048.0) {
+    mantissa = 1024.0;
+    e++;
+  }
+  if (e - 1 + 15 >= 0x1F) {
+    return sign | 0x7C00;
+  }
+  return sign | (uint16_t)(((e - 1 + 15) << 10) | ((uint16_t)mantissa - 1024));
+}
+
+void testThatHalf2singleConvertsAllHalves() {
+  for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+    // Fixture
+    const uint16_t half = (uint16_t)i;
+    const double expected = referenceHalfValue(half);
+
+    // Test
+    const float actual = half2single(half);
+
+    // Assert
+    if (isHalfNan(half)) {
+      TEST_ASSERT_TRUE_MESSAGE(isnan(actual), "NaN");
+      TEST_ASSERT_EQUAL_UINT32((uint32_t)(half & 0x8000) << 16, floatBits(actual) & 0x80000000);
+    } else {
+      TEST_ASSERT_EQUAL_HEX32(floatBits((float)expected), floatBits(actual));
+    }
+  }
+}
+
+void testThatSingle2halfRoundTripsAllHalves() {
+  for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+    // Fixture
+    const uint16_t half = (uint16_t)i;
+
+    // Test
+    const uint16_t actual = single2half(half2single(half));
+
+    // Assert
+    if (isHalfNan(half)) {
+      TEST_ASSERT_TRUE(isHalfNan(actual));
+      TEST_ASSERT_EQUAL_HEX16(half | 0x0200, actual); // quieted, payload kept
+    } else {
+      TEST_ASSERT_EQUAL_HEX16(half, actual);
+    }
+  }
+}
+
+void testThatSingle2halfRoundsTiesToEven() {
+  for (uint32_t i = 0; i < 0x7C00; i++) {
+    // Fixture
+    // Half way between two halves, exact in a float
+    const uint16_t half = (uint16_t)i;
+    const float tie = (float)((referenceHalfValue(half) + referenceHalfValue(half + 1)) / 2.0);
+    const uint16_t expected = (half & 1) ? half + 1 : half;
+
+    // Test
+    const uint16_t actual = single2half(tie);
+    const uint16_t actualNegative = single2half(-tie);
+
+    // Assert
+    TEST_ASSERT_EQUAL_HEX16(expected, actual);
+    TEST_ASSERT_EQUAL_HEX16(expected | 0x8000, actualNegative);
+  }
+}
+
+void testThatSingle2halfConvertsSampledSingles() {
+  // Every 65521st bit pattern, covers all exponents with varying mantissas
+  for (uint64_t bits = 0; bits <= UINT32_MAX; bits += 65521) {
+    // Fixture
+    const float value = bitsFloat((uint32_t)bits);
+
+    // Test
+    const uint16_t actual = single2half(value);
+
+    // Assert
+    if (isnan(value)) {
+      TEST_ASSERT_TRUE(isHalfNan(actual));
+    } else {
+      TEST_ASSERT_EQUAL_HEX16(referenceSingle2half(value), actual);
+    }
+  }
+}
+
+void testThatSingle2halfHandlesSpecialValues() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_EQUAL_HEX16(0x0000, single2half(0.0f));
+  TEST_ASSERT_EQUAL_HEX16(0x8000, single2half(-0.0f));
+  TEST_ASSERT_EQUAL_HEX16(0x3C00, single2half(1.0f));
+  TEST_ASSERT_EQUAL_HEX16(0x7BFF, single2half(65504.0f));
+  TEST_ASSERT_EQUAL_HEX16(0x7BFF, single2half(65519.99f));
+  TEST_ASSERT_EQUAL_HEX16(0x7C00, single2half(65520.0f));
+  TEST_ASSERT_EQUAL_HEX16(0xFC00, single2half(-1e10f));
+  TEST_ASSERT_EQUAL_HEX16(0x7C00, single2half(INFINITY));
+  TEST_ASSERT_EQUAL_HEX16(0x0001, single2half(5.9604645e-08f)); // 2^-24
+  TEST_ASSERT_EQUAL_HEX16(0x0000, single2half(2.9802322e-08f)); // 2^-25, tie to even
+  TEST_ASSERT_EQUAL_HEX16(0x0001, single2half(2.9802326e-08f)); // just above the tie
+  TEST_ASSERT_EQUAL_HEX16(0x0400, single2half(6.1035156e-05f)); // 2^-14
+  TEST_ASSERT_TRUE(isHalfNan(single2half(NAN)));
+}
@@ -0,0 +1,121 @@
+// File under test sleepStats.c
+#include "sleepStats.h"
+
+#include "unity.h"
+
+#define WINDOW 1000000
+#define START 5000
+
+static sleepStats_t stats;
+
+void setUp(void) {
+  sleepStatsInit(&stats, START);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatWindowIsNotCompletedEarly() {
+  // Fixture
+  sleepStatsAdd(&stats, 1000, true, 10);
+
+  // Test
+  bool actual = sleepStatsUpdate(&stats, START + WINDOW - 1, WINDOW);
+
+  // Assert
+  TEST_ASSERT_FALSE(actual);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.sleeps);
+}
+
+void testThatSleepRatioIsComputed() {
+  // Fixture
+  sleepStatsAdd(&stats, 200000, false, 0);
+  sleepStatsAdd(&stats, 300000, true, 10);
+
+  // Test
+  bool actual = sleepStatsUpdate(&stats, START + WINDOW, WINDOW);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.5f, stats.sleepRatio);
+  TEST_ASSERT_EQUAL_UINT32(2, stats.sleeps);
+  TEST_ASSERT_EQUAL_UINT32(250000, stats.meanSleep);
+}
+
+void testThatRatioIsOverTheActualWindowLength() {
+  // Fixture
+  sleepStatsAdd(&stats, 500000, false, 0);
+
+  // Test
+  sleepStatsUpdate(&stats, START + 2 * WINDOW, WINDOW);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.25f, stats.sleepRatio);
+}
+
+void testThatRatioIsLimitedToOne() {
+  // Fixture
+  sleepStatsAdd(&stats, WINDOW + 1000, false, 0);
+
+  // Test
+  sleepStatsUpdate(&stats, START + WINDOW, WINDOW);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 1.0f, stats.sleepRatio);
+}
+
+void testThatLatencyIsOnlyTakenFromTickWakeups() {
+  // Fixture
+  sleepStatsAdd(&stats, 1000, true, 20);
+  sleepStatsAdd(&stats, 1000, false, 5000);
+  sleepStatsAdd(&stats, 1000, true, 40);
+
+  // Test
+  sleepStatsUpdate(&stats, START + WINDOW, WINDOW);
+
+  // Assert
+  TEST_ASSERT_EQUAL_UINT32(30, stats.meanLatency);
+  TEST_ASSERT_EQUAL_UINT32(40, stats.maxLatency);
+}
+
+void testThatWindowWithoutSleepsGivesZeros() {
+  // Fixture
+  // Test
+  bool actual = sleepStatsUpdate(&stats, START + WINDOW, WINDOW);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.sleepRatio);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.meanSleep);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.meanLatency);
+}
+
+void testThatNextWindowStartsEmpty() {
+  // Fixture
+  sleepStatsAdd(&stats, 400000, true, 50);
+  sleepStatsUpdate(&stats, START + WINDOW, WINDOW);
+  sleepStatsAdd(&stats, 100000, true, 10);
+
+  // Test
+  sleepStatsUpdate(&stats, START + 2 * WINDOW, WINDOW);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.1f, stats.sleepRatio);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.sleeps);
+  TEST_ASSERT_EQUAL_UINT32(10, stats.maxLatency);
+}
+
+void testThatResultIsKeptUntilNextWindow() {
+  // Fixture
+  sleepStatsAdd(&stats, 400000, true, 50);
+  sleepStatsUpdate(&stats, START + WINDOW, WINDOW);
+  sleepStatsAdd(&stats, 100000, true, 10);
+
+  // Test
+  sleepStatsUpdate(&stats, START + WINDOW + 10, WINDOW);
+
+  // Assert
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.4f, stats.sleepRatio);
+  TEST_ASSERT_EQUAL_UINT32(50, stats.maxLatency);
+}
@@ -0,0 +1,358 @@
+// File under test trajectoryStore.c
+// File under test crc.c
+#include "trajectoryStore.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "crc.h"
+#include "unity.h"
+
+#define CAPACITY 2048
+// As much as fits in a memory write packet
+#define CHUNK 25
+
+// Emulated flash sector, programming can only clear bits
+static uint8_t sector[CAPACITY] __attribute__((aligned(4)));
+static int eraseCount;
+static int programCount;
+static bool isProgramOk;
+// Set for a word that is misaligned, outside of the sector or programmed twice
+static bool isProgramInvalid;
+
+static bool erase(void) {
+  memset(sector, 0xFF, sizeof(sector));
+  eraseCount++;
+  return true;
+}
+
+static bool program(uint32_t offset, uint32_t word) {
+  if ((offset % 4) != 0 || offset + 4 > CAPACITY) {
+    isProgramInvalid = true;
+    return false;
+  }
+
+  uint32_t current;
+  memcpy(&current, &sector[offset], 4);
+  if (current != 0xFFFFFFFF) {
+    isProgramInvalid = true;
+  }
+  current &= word;
+  memcpy(&sector[offset], &current, 4);
+
+  programCount++;
+  return isProgramOk;
+}
+
+static const trajectoryStoreFlash_t flash = {
+  .erase = erase,
+  .program = program,
+};
+
+static trajectoryStore_t store;
+
+static uint8_t image[CAPACITY] __attribute__((aligned(4)));
+static uint32_t imageSize;
+
+static void buildImage(int count, uint32_t dataSize);
+static int upload(uint32_t len, uint32_t chunk);
+
+void setUp(void) {
+  memset(sector, 0xFF, sizeof(sector));
+  eraseCount = 0;
+  programCount = 0;
+  isProgramOk = true;
+  isProgramInvalid = false;
+
+  trajectoryStoreInit(&store, sector, CAPACITY, &flash);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatErasedSectorHasNoImage() {
+  // Fixture
+  // Test
+  // Assert
+  TEST_ASSERT_FALSE(trajectoryStoreIsValid(&store));
+  TEST_ASSERT_EQUAL_INT(0, trajectoryStoreCount(&store));
+  TEST_ASSERT_NULL(trajectoryStoreGetData(&store, 0, 4));
+}
+
+void testThatUploadedImageIsValid() {
+  // Fixture
+  buildImage(2, 100);
+
+  // Test
+  int actual = upload(imageSize, CHUNK);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_TRUE(trajectoryStoreIsValid(&store));
+  TEST_ASSERT_EQUAL_INT(1, eraseCount);
+  TEST_ASSERT_FALSE(isProgramInvalid);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(image, sector, imageSize);
+}
+
+void testThatIndexIsReadFromTheImage() {
+  // Fixture
+  buildImage(2, 100);
+  upload(imageSize, CHUNK);
+
+  // Test
+  trajectoryStoreEntry_t entry;
+  bool actual = trajectoryStoreGetEntry(&store, 1, &entry);
+
+  // Assert
+  TEST_ASSERT_TRUE(actual);
+  TEST_ASSERT_EQUAL_INT(2, trajectoryStoreCount(&store));
+  TEST_ASSERT_EQUAL_UINT8(11, entry.trajectoryId);
+  TEST_ASSERT_EQUAL_UINT32(100, entry.size);
+  TEST_ASSERT_EQUAL_PTR(&sector[entry.offset], trajectoryStoreGetData(&store, entry.offset, entry.size));
+  TEST_ASSERT_FALSE(trajectoryStoreGetEntry(&store, 2, &entry));
+}
+
+void testThatImageIsFoundAfterRestart() {
+  // Fixture
+  buildImage(1, 64);
+  upload(imageSize, CHUNK);
+
+  // Test
+  trajectoryStoreInit(&store, sector, CAPACITY, &flash);
+
+  // Assert
+  TEST_ASSERT_TRUE(trajectoryStoreIsValid(&store));
+  TEST_ASSERT_EQUAL_INT(1, trajectoryStoreCount(&store));
+}
+
+void testThatInterruptedUploadLeavesNoImage() {
+  // Fixture
+  buildImage(1, 64);
+
+  // Test
+  upload(imageSize - 1, CHUNK);
+  trajectoryStoreInit(&store, sector, CAPACITY, &flash);
+
+  // Assert
+  TEST_ASSERT_FALSE(trajectoryStoreIsValid(&store));
+  TEST_ASSERT_EQUAL_HEX8(0xFF, sector[0]);
+}
+
+void testThatImageWithBadCrcIsRejected() {
+  // Fixture
+  buildImage(1, 64);
+  image[imageSize - 1] ^= 0x01;
+
+  // Test
+  int actual = upload(imageSize, CHUNK);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EIO, actual);
+  TEST_ASSERT_FALSE(trajectoryStoreIsValid(&store));
+  TEST_ASSERT_EQUAL_HEX8(0xFF, sector[0]);
+}
+
+void testThatEntryWithBadCrcIsRejected() {
+  // Fixture
+  buildImage(1, 64);
+  trajectoryStoreHeader_t header;
+  memcpy(&header, image, sizeof(header));
+  image[sizeof(header) + offsetof(trajectoryStoreEntry_t, crc)] ^= 0x01;
+  header.crc = crcSlow(&image[sizeof(header)], imageSize - sizeof(header));
+  memcpy(image, &header, sizeof(header));
+
+  // Test
+  int actual = upload(imageSize, CHUNK);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EIO, actual);
+  TEST_ASSERT_FALSE(trajectoryStoreIsValid(&store));
+}
+
+void testThatWriteOutOfSequenceIsRejected() {
+  // Fixture
+  buildImage(1, 64);
+  trajectoryStoreWrite(&store, 0, image, CHUNK);
+
+  // Test
+  int actual = trajectoryStoreWrite(&store, 2 * CHUNK, &image[2 * CHUNK], CHUNK);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+}
+
+void testThatWriteWithoutUploadIsRejected() {
+  // Fixture
+  buildImage(1, 64);
+
+  // Test
+  int actual = trajectoryStoreWrite(&store, CHUNK, &image[CHUNK], CHUNK);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+  TEST_ASSERT_EQUAL_INT(0, programCount);
+}
+
+void testThatWritePastImageIsRejected() {
+  // Fixture
+  buildImage(0, 0);
+  uint8_t data[sizeof(trajectoryStoreHeader_t) + 4];
+  memcpy(data, image, imageSize);
+
+  // Test
+  int actual = trajectoryStoreWrite(&store, 0, data, sizeof(data));
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+  TEST_ASSERT_FALSE(trajectoryStoreIsValid(&store));
+}
+
+void testThatBadHeaderKeepsTheStoredImage() {
+  // Fixture
+  buildImage(1, 64);
+  upload(imageSize, CHUNK);
+
+  trajectoryStoreHeader_t header;
+  memcpy(&header, image, sizeof(header));
+  header.size = CAPACITY + 4;
+
+  // Test
+  int actual = trajectoryStoreWrite(&store, 0, (const uint8_t*)&header, sizeof(header));
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+  TEST_ASSERT_EQUAL_INT(1, eraseCount);
+  TEST_ASSERT_TRUE(trajectoryStoreIsValid(&store));
+}
+
+void testThatShortHeaderIsRejected() {
+  // Fixture
+  buildImage(1, 64);
+
+  // Test
+  int actual = trajectoryStoreWrite(&store, 0, image, sizeof(trajectoryStoreHeader_t) - 1);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EINVAL, actual);
+  TEST_ASSERT_EQUAL_INT(0, eraseCount);
+}
+
+void testThatFlashFailureAbortsTheUpload() {
+  // Fixture
+  buildImage(1, 64);
+  isProgramOk = false;
+
+  // Test
+  int actual = upload(imageSize, CHUNK);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(EIO, actual);
+  TEST_ASSERT_FALSE(trajectoryStoreIsValid(&store));
+}
+
+void testThatNewUploadReplacesTheImage() {
+  // Fixture
+  buildImage(2, 100);
+  upload(imageSize, CHUNK);
+  buildImage(1, 40);
+
+  // Test
+  int actual = upload(imageSize, 7);
+
+  // Assert
+  TEST_ASSERT_EQUAL_INT(0, actual);
+  TEST_ASSERT_EQUAL_INT(2, eraseCount);
+  TEST_ASSERT_EQUAL_INT(1, trajectoryStoreCount(&store));
+  TEST_ASSERT_FALSE(isProgramInvalid);
+}
+
+void testThatImageIsInvalidDuringUpload() {
+  // Fixture
+  buildImage(1, 64);
+  upload(imageSize, CHUNK);
+
+  // Test
+  trajectoryStoreWrite(&store, 0, image, CHUNK);
+
+  // Assert
+  TEST_ASSERT_FALSE(trajectoryStoreIsValid(&store));
+  TEST_ASSERT_NULL(trajectoryStoreGetData(&store, 32, 4));
+}
+
+void testThatDataOutsideImageIsNotReturned() {
+  // Fixture
+  buildImage(1, 64);
+  upload(imageSize, CHUNK);
+
+  // Test
+  // Assert
+  TEST_ASSERT_NOT_NULL(trajectoryStoreGetData(&store, imageSize - 4, 4));
+  TEST_ASSERT_NULL(trajectoryStoreGetData(&store, imageSize - 4, 8));
+  TEST_ASSERT_NULL(trajectoryStoreGetData(&store, 0xFFFFFFFC, 8));
+}
+
+void testThatReadIsLimitedToTheSector() {
+  // Fixture
+  uint8_t data[8];
+
+  // Test
+  // Assert
+  TEST_ASSERT_TRUE(trajectoryStoreRead(&store, CAPACITY - 8, 8, data));
+  TEST_ASSERT_FALSE(trajectoryStoreRead(&store, CAPACITY - 4, 8, data));
+  TEST_ASSERT_FALSE(trajectoryStoreRead(&store, 0xFFFFFFFC, 8, data));
+}
+
+// Helpers ////////////////////////////////////////////////////////////////
+
+// An image with count entries of dataSize bytes each, ids 10, 11...
+static void buildImage(int count, uint32_t dataSize) {
+  memset(image, 0, sizeof(image));
+
+  uint32_t offset = sizeof(trajectoryStoreHeader_t) + count * sizeof(trajectoryStoreEntry_t);
+  for (int i = 0; i < count; i++) {
+    for (uint32_t j = 0; j < dataSize; j++) {
+      image[offset + j] = (uint8_t)(i * 31 + j);
+    }
+
+    trajectoryStoreEntry_t entry = {
+      .trajectoryId = 10 + i,
+      .n_pieces = 1,
+      .offset = offset,
+      .size = dataSize,
+      .crc = crcSlow(&image[offset], dataSize),
+    };
+    memcpy(&image[sizeof(trajectoryStoreHeader_t) + i * sizeof(trajectoryStoreEntry_t)], &entry, sizeof(entry));
+
+    offset += (dataSize + 3) & ~3u;
+  }
+  imageSize = offset;
+
+  trajectoryStoreHeader_t header = {
+    .magic = TRAJECTORY_STORE_MAGIC,
+    .version = TRAJECTORY_STORE_VERSION,
+    .count = count,
+    .size = imageSize,
+    .crc = crcSlow(&image[sizeof(header)], imageSize - sizeof(header)),
+  };
+  memcpy(image, &header, sizeof(header));
+}
+
+// Uploads the first len bytes of the image, returns the first error
+static int upload(uint32_t len, uint32_t chunk) {
+  uint32_t addr = 0;
+  while (addr < len) {
+    uint32_t writeLen = (len - addr < chunk) ? len - addr : chunk;
+    if (addr == 0 && writeLen < sizeof(trajectoryStoreHeader_t)) {
+      writeLen = sizeof(trajectoryStoreHeader_t);
+    }
+
+    int result = trajectoryStoreWrite(&store, addr, &image[addr], writeLen);
+    if (result != 0) {
+      return result;
+    }
+    addr += writeLen;
+  }
+  return 0;
+}
@@ -0,0 +1,271 @@
+// File under test udFactor.c
+#include "udFactor.h"
+
+#include <math.h>
+#include <string.h>
+#include "unity.h"
+
+#define N 6
+
+static float P[N * N];
+static float U[N * N];
+static float D[N];
+
+// Deterministic pseudo random numbers in [-1, 1)
+static uint32_t seed;
+static float randomValue() {
+  seed = seed * 1664525 + 1013904223;
+  return ((float)(seed >> 8) / 8388608.0f) - 1.0f;
+}
+
+static void randomCovariance(float* M, int n);
+static void denseScalarUpdateDouble(double* M, int n, const float* h, double r);
+static void assertMatrixWithin(float relTolerance, const float* expected, const float* actual, int n);
+
+void setUp(void) {
+  seed = 17;
+  randomCovariance(P, N);
+}
+
+void tearDown(void) {
+  // Empty
+}
+
+void testThatFactorizationReconstructsTheMatrix() {
+  // Fixture
+  float actual[N * N];
+
+  // Test
+  bool ok = udFactorize(P, U, D, N);
+  udToCovariance(U, D, actual, N);
+
+  // Assert
+  TEST_ASSERT_TRUE(ok);
+  assertMatrixWithin(1e-5f, P, actual, N);
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, U[i * N + i]);
+    for (int j = 0; j < i; j++) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, U[i * N + j]);
+    }
+  }
+}
+
+void testThatFactorizationFailsForIndefiniteMatrix() {
+  // Fixture
+  const float M[2 * 2] = {1.0f, 2.0f, 2.0f, 1.0f};
+  float u[2 * 2];
+  float d[2];
+
+  // Test
+  bool ok = udFactorize(M, u, d, 2);
+
+  // Assert
+  TEST_ASSERT_FALSE(ok);
+}
+
+void testThatScalarUpdateMatchesDenseUpdate() {
+  // Fixture
+  const float h[N] = {1.0f, 0.0f, -0.5f, 0.0f, 0.25f, 2.0f};
+  const float r = 0.1f;
+
+  double expected[N * N];
+  double hph = 0;
+  for (int i = 0; i < N * N; i++) { expected[i] = P[i]; }
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      hph += h[i] * expected[i * N + j] * h[j];
+    }
+  }
+  double expectedK[N];
+  for (int i = 0; i < N; i++) {
+    double ph = 0;
+    for (int j = 0; j < N; j++) { ph += expected[i * N + j] * h[j]; }
+    expectedK[i] = ph / (hph + r);
+  }
+  denseScalarUpdateDouble(expected, N, h, r);
+
+  float K[N];
+  float actual[N * N];
+  udFactorize(P, U, D, N);
+
+  // Test
+  float alpha = udScalarUpdate(U, D, N, h, r, K);
+
+  // Assert
+  udToCovariance(U, D, actual, N);
+  float expectedF[N * N];
+  for (int i = 0; i < N * N; i++) { expectedF[i] = (float)expected[i]; }
+  assertMatrixWithin(1e-4f, expectedF, actual, N);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f * alpha, (float)(hph + r), alpha);
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)expectedK[i], K[i]);
+  }
+}
+
+void testThatPredictMatchesDensePrediction() {
+  // Fixture
+  float A[N * N];
+  float q[N];
+  for (int i = 0; i < N; i++) {
+    q[i] = 0.01f * (i + 1);
+    for (int j = 0; j < N; j++) {
+      A[i * N + j] = (i == j ? 1.0f : 0.0f) + 0.1f * randomValue();
+    }
+  }
+
+  // A (P + Q) A'
+  float expected[N * N];
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      double sum = 0;
+      for (int k = 0; k < N; k++) {
+        for (int l = 0; l < N; l++) {
+          double pq = P[k * N + l] + (k == l ? q[k] : 0.0f);
+          sum += (double)A[i * N + k] * pq * A[j * N + l];
+        }
+      }
+      expected[i * N + j] = (float)sum;
+    }
+  }
+
+  float actual[N * N];
+  udFactorize(P, U, D, N);
+
+  // Test
+  udPredict(U, D, N, A, q);
+
+  // Assert
+  udToCovariance(U, D, actual, N);
+  assertMatrixWithin(1e-4f, expected, actual, N);
+}
+
+void testThatPredictWithIdentityAndNoNoiseKeepsTheMatrix() {
+  // Fixture
+  float actual[N * N];
+  udFactorize(P, U, D, N);
+
+  // Test
+  udPredict(U, D, N, NULL, NULL);
+
+  // Assert
+  udToCovariance(U, D, actual, N);
+  assertMatrixWithin(1e-5f, P, actual, N);
+}
+
+void testThatPredictWithOnlyNoiseAddsToTheDiagonal() {
+  // Fixture
+  const float q[N] = {1.0f, 0.0f, 0.5f, 0.0f, 0.0f, 2.0f};
+  float expected[N * N];
+  memcpy(expected, P, sizeof(P));
+  for (int i = 0; i < N; i++) { expected[i * N + i] += q[i]; }
+
+  float actual[N * N];
+  udFactorize(P, U, D, N);
+
+  // Test
+  udPredict(U, D, N, NULL, q);
+
+  // Assert
+  udToCovariance(U, D, actual, N);
+  assertMatrixWithin(1e-5f, expected, actual, N);
+}
+
+void testThatManyAccurateUpdatesKeepTheCovariancePositiveDefinite() {
+  // Fixture
+  // Accurate range like measurements to changing anchors on a poorly known state,
+  // the case where the dense update loses precision
+  const float r = 1e-6f;
+  for (int i = 0; i < N * N; i++) { P[i] = 0.0f; }
+  for (int i = 0; i < N; i++) { P[i * N + i] = 100.0f; }
+  udFactorize(P, U, D, N);
+
+  double reference[N * N];
+  for (int i = 0; i < N * N; i++) { reference[i] = P[i]; }
+
+  float h[N];
+  float K[N];
+  float q[N];
+  for (int i = 0; i < N; i++) { q[i] = 1e-7f; }
+
+  // Test
+  for (int step = 0; step < 2000; step++) {
+    for (int i = 0; i < N; i++) { h[i] = randomValue(); }
+    udScalarUpdate(U, D, N, h, r, K);
+    denseScalarUpdateDouble(reference, N, h, r);
+
+    udPredict(U, D, N, NULL, q);
+    for (int i = 0; i < N; i++) { reference[i * N + i] += q[i]; }
+  }
+
+  // Assert
+  float actual[N * N];
+  float expected[N * N];
+  udToCovariance(U, D, actual, N);
+  for (int i = 0; i < N * N; i++) { expected[i] = (float)reference[i]; }
+
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_TRUE(D[i] > 0.0f);
+  }
+  assertMatrixWithin(1e-2f, expected, actual, N);
+}
+
+static void randomCovariance(float* M, int n) {
+  // M = B*B' + I is symmetric positive definite
+  float B[N * N];
+  for (int i = 0; i < n * n; i++) { B[i] = randomValue(); }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      float sum = (i == j) ? 1.0f : 0.0f;
+      for (int k = 0; k < n; k++) {
+        sum += B[i * n + k] * B[j * n + k];
+      }
+      M[i * n + j] = sum;
+    }
+  }
+}
+
+// Joseph form update in double precision, the reference
+static void denseScalarUpdateDouble(double* M, int n, const float* h, double r) {
+  double ph[N];
+  double hph = 0;
+  for (int i = 0; i < n; i++) {
+    ph[i] = 0;
+    for (int j = 0; j < n; j++) { ph[i] += M[i * n + j] * h[j]; }
+    hph += h[i] * ph[i];
+  }
+
+  double K[N];
+  for (int i = 0; i < n; i++) { K[i] = ph[i] / (hph + r); }
+
+  // (I - Kh) M (I - Kh)' + K r K'
+  double IKh[N * N];
+  double tmp[N * N];
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      IKh[i * n + j] = (i == j ? 1.0 : 0.0) - K[i] * h[j];
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      tmp[i * n + j] = 0;
+      for (int k = 0; k < n; k++) { tmp[i * n + j] += IKh[i * n + k] * M[k * n + j]; }
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      double sum = K[i] * r * K[j];
+      for (int k = 0; k < n; k++) { sum += tmp[i * n + k] * IKh[j * n + k]; }
+      M[i * n + j] = sum;
+    }
+  }
+}
+
+static void assertMatrixWithin(float relTolerance, const float* expected, const float* actual, int n) {
+  float scale = 0.0f;
+  for (int i = 0; i < n; i++) {
+    scale = fmaxf(scale, fabsf(expected[i * n + i]));
+  }
+  for (int i = 0; i < n * n; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(relTolerance * scale, expected[i], actual[i]);
+  }
+}
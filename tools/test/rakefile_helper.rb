@@ -1,5 +1,6 @@
 require 'yaml'
 require 'fileutils'
+require 'json'
 require './vendor/unity/auto/unity_test_summary'
 require './vendor/unity/auto/generate_test_runner'
 require './vendor/unity/auto/colour_reporter'
@@ -7,6 +8,27 @@ require './vendor/unity/auto/colour_reporter'
 module RakefileHelpers
 
   C_EXTENSION = '.c'
+  BENCH_PATH = 'test/bench/'
+  BENCH_BUILD_PATH = 'generated-test/bench/'
+  BENCH_DEFAULT_BASELINE = BENCH_PATH + 'baseline.json'
+  BENCH_DEFAULT_THRESHOLD = 10.0
+  BENCH_SOURCE_DIRS = ['src/modules/src/', 'src/utils/src/',
+    'vendor/CMSIS/CMSIS/DSP_Lib/Source/MatrixFunctions/', 'vendor/CMSIS/CMSIS/DSP_Lib/Source/FastMathFunctions/',
+    'vendor/CMSIS/CMSIS/DSP_Lib/Source/CommonTables/']
+  FUZZ_PATH = 'test/fuzz/'
+  FUZZ_BUILD_PATH = 'generated-test/fuzz/'
+  FUZZ_DEFAULT_RUNS = 100000
+  FUZZ_SANITIZERS = ['-fsanitize=address,undefined', '-fno-sanitize-recover=all', '-fno-omit-frame-pointer']
+  FUZZ_SOURCE_DIRS = ['src/modules/src/', 'src/hal/src/']
+  UNIT_TEST_SOURCE_DIRS = ['src/modules/src/']
+  REPLAY_PATH = 'test/replay/'
+  REPLAY_BUILD_PATH = 'generated-test/replay/'
+  REPLAY_SOURCE_DIRS = ['src/modules/src/', 'src/utils/src/']
+  REPLAY_DSP_PATH = 'vendor/CMSIS/CMSIS/DSP_Lib/Source/'
+  REPLAY_SUPPORT_SOURCES = ['test/testSupport/usdLog.c', 'src/utils/src/crc_bosch.c',
+    REPLAY_DSP_PATH + 'MatrixFunctions/arm_mat_trans_f32.c', REPLAY_DSP_PATH + 'MatrixFunctions/arm_mat_mult_f32.c',
+    REPLAY_DSP_PATH + 'MatrixFunctions/arm_mat_inverse_f32.c', REPLAY_DSP_PATH + 'FastMathFunctions/arm_sin_f32.c',
+    REPLAY_DSP_PATH + 'FastMathFunctions/arm_cos_f32.c', REPLAY_DSP_PATH + 'CommonTables/arm_common_tables.c']
 
   def load_configuration(config_file)
     $cfg_file = config_file
@@ -149,11 +171,11 @@ module RakefileHelpers
     return {:command => command, :pre_support => pre_support, :post_support => post_support}
   end
 
-  def execute(command_string, verbose=true)
+  def execute(command_string, verbose=true, raise_on_failure=true)
     report command_string
     output = `#{command_string}`.chomp
     report(output) if (verbose && !output.nil? && (output.length > 0))
-    if $?.exitstatus != 0
+    if $?.exitstatus != 0 && raise_on_failure
       raise "Command failed. (Returned #{$?.exitstatus})"
     end
     return output
@@ -216,14 +238,22 @@ module RakefileHelpers
       end
 
       #compile all mocks
+      src_files = []
       header_list.each do |header|
         #compile source file header if it exists
         src_file = find_source_file(header, include_dirs)
         if !src_file.nil?
-          obj_list << compile(src_file, test_defines)
+          src_files << src_file
         end
       end
 
+      # Sources outside of the include dirs, as the modules
+      extract_files_under_test(test).each do |name|
+        src_file = find_file(name, include_dirs + UNIT_TEST_SOURCE_DIRS)
+        src_files << src_file unless src_file.nil?
+      end
+      obj_list.concat(src_files.uniq.map { |src_file| compile(src_file, test_defines) })
+
       # Build the test runner (generate if configured to do so)
       test_base = File.basename(test, C_EXTENSION)
       runner_name = test_base + '_Runner.c'
@@ -287,6 +317,329 @@ module RakefileHelpers
     link_it(main_base, obj_list)
   end
 
+  def get_benchmark_files
+    FileList.new(BENCH_PATH + 'Bench*' + C_EXTENSION)
+  end
+
+  # Benchmarks are built optimized, into a separate directory so that objects
+  # never get mixed up with the -O0 unit test build
+  def configure_benchmark_build(defines)
+    load_configuration($cfg_file)
+    $cfg['compiler']['options'] = $cfg['compiler']['options'].map { |opt| opt == '-O0' ? '-O2' : opt }
+    # The FreeRTOS port of the replays, the modules benchmarked run on the host
+    $cfg['compiler']['includes']['items'].unshift(REPLAY_PATH + 'port/')
+    $cfg['compiler']['defines']['items'] = [] if $cfg['compiler']['defines']['items'].nil?
+    $cfg['compiler']['defines']['items'].concat ['TEST', 'BENCH', 'STM32F4XX']
+    $cfg['compiler']['defines']['items'].concat defines
+    $cfg['compiler']['object_files']['destination'] = BENCH_BUILD_PATH
+    # The log and parameter tables of a benchmark are collected as for the fuzz harnesses
+    $cfg['linker']['options'] = ($cfg['linker']['options'] || []) + ["-Wl,-T,#{FUZZ_PATH}sections.ld"]
+    $cfg['linker']['object_files']['path'] = BENCH_BUILD_PATH
+    $cfg['linker']['bin_files']['destination'] = BENCH_BUILD_PATH
+    FileUtils.mkdir_p(BENCH_BUILD_PATH)
+  end
+
+  # Usage: rake bench [FILES="test/bench/BenchFilter.c"] [DEFINES="-DMY_DEFINE"]
+  #                   [BASELINE=file.json] [THRESHOLD=percent]
+  #
+  # The default baseline, test/bench/baseline.json, is a results.json of a full
+  # run. The times depend on the host, record a new one when changing machines.
+  def parse_and_run_benchmarks(args)
+    defines = extract_defines(find_arg_value(args, 'DEFINES=') || '')
+    bench_files = (find_arg_value(args, 'FILES=') || '').split(' ')
+    bench_files = get_benchmark_files() if bench_files.length == 0
+
+    results = run_benchmarks(bench_files, defines)
+
+    results_file = BENCH_BUILD_PATH + 'results.json'
+    File.open(results_file, 'w') { |f| f.print JSON.pretty_generate(results) }
+    report "Benchmark results written to #{results_file}"
+
+    baseline_file = find_arg_value(args, 'BASELINE=')
+    baseline_file = BENCH_DEFAULT_BASELINE if baseline_file.nil? && File.exist?(BENCH_DEFAULT_BASELINE)
+    if !baseline_file.nil?
+      threshold = (find_arg_value(args, 'THRESHOLD=') || BENCH_DEFAULT_THRESHOLD).to_f
+      compare_benchmarks(results, JSON.parse(File.read(baseline_file)), threshold)
+    end
+  end
+
+  def run_benchmarks(bench_files, defines)
+    report 'Running benchmarks...'
+
+    configure_benchmark_build(defines)
+    include_dirs = get_local_include_dirs
+    results = []
+
+    bench_files.each do |bench|
+      src_files = []
+
+      extract_headers(bench).each do |header|
+        src_file = find_source_file(header, include_dirs)
+        src_files << src_file unless src_file.nil?
+      end
+      extract_files_under_test(bench).each do |name|
+        src_file = find_file(name, include_dirs + BENCH_SOURCE_DIRS)
+        raise "#{bench}: file under test #{name} not found" if src_file.nil?
+        src_files << src_file
+      end
+
+      obj_list = src_files.uniq.map { |src_file| compile(src_file) }
+      obj_list << compile(bench)
+
+      bench_base = File.basename(bench, C_EXTENSION)
+      link_it(bench_base, obj_list)
+
+      executable = BENCH_BUILD_PATH + bench_base + $cfg['linker']['bin_files']['extension']
+      output = execute(executable)
+
+      # Each benchmark prints one JSON object per line
+      output.each_line do |line|
+        results << JSON.parse(line) if line.start_with?('{')
+      end
+    end
+
+    return results
+  end
+
+  # Flags benchmarks whose median time grew more than threshold percent
+  # compared to the baseline
+  def compare_benchmarks(results, baseline, threshold)
+    baseline_ns = {}
+    baseline.each { |entry| baseline_ns[entry['name']] = entry['ns'] }
+
+    regressions = []
+    results.each do |entry|
+      reference = baseline_ns[entry['name']]
+      next if reference.nil? || reference <= 0
+
+      change = 100.0 * (entry['ns'] - reference) / reference
+      report format('%-32s %10.1f ns %10.1f ns %+7.1f%%', entry['name'], reference, entry['ns'], change)
+      regressions << entry['name'] if change > threshold
+    end
+
+    if regressions.length > 0
+      raise "Benchmarks slower than baseline by more than #{threshold}%: #{regressions.join(', ')}"
+    end
+  end
+
+  def get_fuzz_files
+    FileList.new(FUZZ_PATH + 'Fuzz*' + C_EXTENSION)
+  end
+
+  # Sources named in '// File under test x.c' comments of a harness
+  def extract_files_under_test(filename)
+    files = []
+    File.readlines(filename).each do |line|
+      m = line.match(/^\s*\/\/\s*File under test\s+(\S+\.c)/)
+      files << m[1] unless m.nil?
+    end
+    return files
+  end
+
+  # The harnesses are built with the sanitizers and the firmware language
+  # settings, into a separate directory. With libfuzzer, clang is used and the
+  # harness is linked with libFuzzer instead of the mutator in fuzz.c.
+  def configure_fuzz_build(defines, libfuzzer)
+    load_configuration($cfg_file)
+    sanitizers = FUZZ_SANITIZERS.dup
+    sanitizers[0] = '-fsanitize=fuzzer,address,undefined' if libfuzzer
+    options = $cfg['compiler']['options'].map do |opt|
+      case opt
+        when '-O0' then ['-O1', '-g']
+        when '-std=c11' then ['-std=gnu11', '-fno-strict-aliasing']
+        else opt
+      end
+    end
+    $cfg['compiler']['options'] = options.flatten + sanitizers
+    $cfg['compiler']['defines']['items'] = [] if $cfg['compiler']['defines']['items'].nil?
+    $cfg['compiler']['defines']['items'].concat ['TEST', 'FUZZ', 'STM32F4XX']
+    $cfg['compiler']['defines']['items'] << 'FUZZ_LIBFUZZER' if libfuzzer
+    $cfg['compiler']['defines']['items'].concat defines
+    $cfg['compiler']['object_files']['destination'] = FUZZ_BUILD_PATH
+    $cfg['linker']['options'] = ($cfg['linker']['options'] || []) + sanitizers + ["-Wl,-T,#{FUZZ_PATH}sections.ld"]
+    $cfg['linker']['object_files']['path'] = FUZZ_BUILD_PATH
+    $cfg['linker']['bin_files']['destination'] = FUZZ_BUILD_PATH
+    if libfuzzer
+      $cfg['compiler']['path'] = 'clang'
+      $cfg['linker']['path'] = 'clang'
+    end
+    FileUtils.mkdir_p(FUZZ_BUILD_PATH)
+  end
+
+  # Usage: rake fuzz [FILES="test/fuzz/FuzzParam.c"] [DEFINES="-DMY_DEFINE"]
+  #                  [RUNS=n] [LIBFUZZER=seconds]
+  def parse_and_run_fuzzers(args)
+    defines = extract_defines(find_arg_value(args, 'DEFINES=') || '')
+    fuzz_files = (find_arg_value(args, 'FILES=') || '').split(' ')
+    fuzz_files = get_fuzz_files() if fuzz_files.length == 0
+    runs = (find_arg_value(args, 'RUNS=') || FUZZ_DEFAULT_RUNS).to_i
+    libfuzzer_seconds = find_arg_value(args, 'LIBFUZZER=')
+
+    results = run_fuzzers(fuzz_files, defines, runs, libfuzzer_seconds)
+
+    if libfuzzer_seconds.nil?
+      results_file = FUZZ_BUILD_PATH + 'results.json'
+      File.open(results_file, 'w') { |f| f.print JSON.pretty_generate(results) }
+      report "Fuzz results written to #{results_file}"
+    end
+  end
+
+  def run_fuzzers(fuzz_files, defines, runs, libfuzzer_seconds)
+    report 'Running fuzz harnesses...'
+
+    configure_fuzz_build(defines, !libfuzzer_seconds.nil?)
+    include_dirs = get_local_include_dirs
+    results = []
+
+    fuzz_files.each do |harness|
+      src_files = []
+
+      extract_headers(harness).each do |header|
+        src_file = find_source_file(header, include_dirs)
+        src_files << src_file unless src_file.nil?
+      end
+      extract_files_under_test(harness).each do |name|
+        src_file = find_file(name, include_dirs + FUZZ_SOURCE_DIRS)
+        raise "#{harness}: file under test #{name} not found" if src_file.nil?
+        src_files << src_file
+      end
+
+      obj_list = src_files.uniq.map { |src_file| compile(src_file) }
+      obj_list << compile(harness)
+
+      harness_base = File.basename(harness, C_EXTENSION)
+      link_it(harness_base, obj_list)
+
+      executable = FUZZ_BUILD_PATH + harness_base + $cfg['linker']['bin_files']['extension']
+      if libfuzzer_seconds.nil?
+        output = execute("#{executable} -runs=#{runs}")
+
+        # The stand alone driver prints one JSON object with its throughput
+        output.each_line do |line|
+          results << JSON.parse(line) if line.start_with?('{')
+        end
+      else
+        corpus = FUZZ_BUILD_PATH + harness_base + '-corpus'
+        execute("#{executable} -write_corpus=#{corpus}")
+        execute("#{executable} -max_total_time=#{libfuzzer_seconds.to_i} #{corpus}")
+      end
+    end
+
+    return results
+  end
+
+  def get_replay_files
+    FileList.new(REPLAY_PATH + 'Replay*' + C_EXTENSION)
+  end
+
+  # The replays are built optimized, as the estimators run in the firmware, and
+  # with the FreeRTOS port in test/replay/port/ that runs on the host. The math
+  # is kept IEEE so that the estimates can be compared to the references.
+  def configure_replay_build(defines)
+    load_configuration($cfg_file)
+    options = $cfg['compiler']['options'].map do |opt|
+      case opt
+        when '-O0' then '-O2'
+        when '-std=c11' then ['-std=gnu11', '-fno-strict-aliasing', '-fno-math-errno', '-ffp-contract=off']
+        when '-pedantic' then []
+        else opt
+      end
+    end
+    $cfg['compiler']['options'] = options.flatten
+    $cfg['compiler']['includes']['items'].unshift(REPLAY_PATH + 'port/')
+    $cfg['compiler']['defines']['items'] = [] if $cfg['compiler']['defines']['items'].nil?
+    $cfg['compiler']['defines']['items'].concat ['TEST', 'REPLAY', 'STM32F4XX']
+    $cfg['compiler']['defines']['items'].concat defines
+    $cfg['compiler']['object_files']['destination'] = REPLAY_BUILD_PATH
+    $cfg['linker']['options'] = ($cfg['linker']['options'] || []) + ["-Wl,-T,#{REPLAY_PATH}sections.ld"]
+    $cfg['linker']['object_files']['path'] = REPLAY_BUILD_PATH
+    $cfg['linker']['bin_files']['destination'] = REPLAY_BUILD_PATH
+    FileUtils.mkdir_p(REPLAY_BUILD_PATH)
+  end
+
+  # Usage: rake replay [FILES="test/replay/ReplayKalman.c"] [DEFINES="-DMY_DEFINE"]
+  #                    [LOG=flight.bin] [WRITE_REFERENCE=1]
+  #
+  # Without LOG the synthetic flight is replayed and compared to the reference
+  # test/replay/ReplayX.ref, WRITE_REFERENCE=1 updates the references instead.
+  def parse_and_run_replays(args)
+    defines = extract_defines(find_arg_value(args, 'DEFINES=') || '')
+    replay_files = (find_arg_value(args, 'FILES=') || '').split(' ')
+    replay_files = get_replay_files() if replay_files.length == 0
+    log_file = find_arg_value(args, 'LOG=')
+    write_reference = !find_arg_value(args, 'WRITE_REFERENCE=').nil?
+
+    results, failures = run_replays(replay_files, defines, log_file, write_reference)
+
+    results_file = REPLAY_BUILD_PATH + 'results.json'
+    File.open(results_file, 'w') { |f| f.print JSON.pretty_generate(results) }
+    report "Replay results written to #{results_file}"
+
+    if failures.length > 0
+      raise "Replays failed: #{failures.join(', ')}"
+    end
+  end
+
+  def run_replays(replay_files, defines, log_file, write_reference)
+    report 'Running replays...'
+
+    configure_replay_build(defines)
+    include_dirs = get_local_include_dirs
+    results = []
+    failures = []
+
+    replay_files.each do |replay|
+      src_files = []
+
+      extract_headers(replay).each do |header|
+        src_file = find_source_file(header, include_dirs)
+        src_files << src_file unless src_file.nil?
+      end
+      extract_files_under_test(replay).each do |name|
+        src_file = find_file(name, include_dirs + REPLAY_SOURCE_DIRS)
+        raise "#{replay}: file under test #{name} not found" if src_file.nil?
+        src_files << src_file
+      end
+      src_files.concat REPLAY_SUPPORT_SOURCES
+
+      obj_list = src_files.uniq.map { |src_file| compile(src_file) }
+      obj_list << compile(replay)
+
+      replay_base = File.basename(replay, C_EXTENSION)
+      link_it(replay_base, obj_list)
+
+      executable = REPLAY_BUILD_PATH + replay_base + $cfg['linker']['bin_files']['extension']
+      reference = REPLAY_PATH + replay_base + '.ref'
+      if !log_file.nil?
+        command = "#{executable} -log=#{log_file}"
+      elsif write_reference
+        command = "#{executable} -synthetic=#{REPLAY_BUILD_PATH}flight.bin -write_reference=#{reference}"
+      else
+        command = "#{executable} -synthetic=#{REPLAY_BUILD_PATH}flight.bin -reference=#{reference}"
+      end
+
+      # A failing replay still prints its errors, collect them all before failing
+      output = execute(command, true, false)
+      failures << replay_base if $?.exitstatus != 0
+
+      # Each replay prints one JSON object per scenario
+      output.each_line do |line|
+        results << JSON.parse(line) if line.start_with?('{')
+      end
+    end
+
+    return results, failures
+  end
+
+  def find_arg_value(args, key)
+    args.each do |arg|
+      if arg.start_with?(key)
+        return arg[(key.length)..-1]
+      end
+    end
+    return nil
+  end
+
   def find_test_files_in_args(args)
     key = 'FILES='
     args.each do |arg|